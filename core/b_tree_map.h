@@ -0,0 +1,585 @@
+/*************************************************************************/
+/*  b_tree_map.h                                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef B_TREE_MAP_H
+#define B_TREE_MAP_H
+
+#include "core/error_macros.h"
+#include "core/os/copymem.h"
+#include "core/os/memory.h"
+#include "core/typedefs.h"
+
+/**
+ * An ordered map stored as a B+ tree. Keys and values live in arrays inside
+ * the leaves, which are linked in order, so lookups touch a few cache lines
+ * and iteration is a linear walk, unlike Map, which allocates a node per
+ * element.
+ *
+ * Like CowData, keys and values are moved around with memmove, so types
+ * must not depend on their own address.
+ *
+ * Iterators are invalidated by insertion and erasure. They mirror Map's
+ * Element, so loops such as:
+ *
+ *     for (auto E = map.front(); E; E = E->next()) { E->key(); E->get(); }
+ *
+ * work with either container.
+ */
+template <class K, class V, class C = Comparator<K>>
+class BTreeMap {
+	enum {
+		LEAF_SIZE = 32, // Elements per leaf.
+		LEAF_MIN = LEAF_SIZE / 2,
+		INTERNAL_SIZE = 31, // Keys per internal node, children are one more.
+		INTERNAL_MIN = INTERNAL_SIZE / 2,
+	};
+
+	struct Node {
+		uint32_t count = 0;
+		bool is_leaf = false;
+	};
+
+	struct Leaf : public Node {
+		Leaf *prev = nullptr;
+		Leaf *next = nullptr;
+		alignas(K) uint8_t key_data[sizeof(K) * LEAF_SIZE];
+		alignas(V) uint8_t value_data[sizeof(V) * LEAF_SIZE];
+
+		_FORCE_INLINE_ K *keys() { return reinterpret_cast<K *>(key_data); }
+		_FORCE_INLINE_ V *values() { return reinterpret_cast<V *>(value_data); }
+	};
+
+	// Child i holds the keys from keys[i - 1] included to keys[i] excluded.
+	struct Internal : public Node {
+		alignas(K) uint8_t key_data[sizeof(K) * INTERNAL_SIZE];
+		Node *children[INTERNAL_SIZE + 1];
+
+		_FORCE_INLINE_ K *keys() { return reinterpret_cast<K *>(key_data); }
+	};
+
+	Node *root = nullptr;
+	Leaf *first = nullptr;
+	Leaf *last = nullptr;
+	int element_count = 0;
+
+public:
+	class Iterator {
+		friend class BTreeMap;
+
+		Leaf *leaf = nullptr;
+		uint32_t index = 0;
+
+		Iterator(Leaf *p_leaf, uint32_t p_index) :
+				leaf(p_leaf),
+				index(p_index) {}
+
+	public:
+		_FORCE_INLINE_ const K &key() const { return leaf->keys()[index]; }
+		_FORCE_INLINE_ V &value() const { return leaf->values()[index]; }
+		_FORCE_INLINE_ V &get() const { return leaf->values()[index]; }
+
+		Iterator next() const {
+			if (index + 1 < leaf->count) {
+				return Iterator(leaf, index + 1);
+			}
+			return Iterator(leaf->next, 0);
+		}
+
+		Iterator prev() const {
+			if (index > 0) {
+				return Iterator(leaf, index - 1);
+			}
+			return leaf->prev ? Iterator(leaf->prev, leaf->prev->count - 1) : Iterator();
+		}
+
+		// Lets code written for Map's Element pointers compile unchanged.
+		_FORCE_INLINE_ const Iterator *operator->() const { return this; }
+
+		_FORCE_INLINE_ explicit operator bool() const { return leaf != nullptr; }
+		_FORCE_INLINE_ bool operator==(const Iterator &p_other) const { return leaf == p_other.leaf && index == p_other.index; }
+		_FORCE_INLINE_ bool operator!=(const Iterator &p_other) const { return !(*this == p_other); }
+
+		Iterator() {}
+	};
+
+private:
+	_FORCE_INLINE_ static bool _less(const K &p_a, const K &p_b) {
+		return C()(p_a, p_b);
+	}
+
+	// First index whose key is not less than p_key.
+	static uint32_t _lower_bound(const K *p_keys, uint32_t p_count, const K &p_key) {
+		uint32_t low = 0;
+		uint32_t high = p_count;
+		while (low < high) {
+			uint32_t mid = (low + high) >> 1;
+			if (_less(p_keys[mid], p_key)) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		return low;
+	}
+
+	// First index whose key is greater than p_key.
+	static uint32_t _upper_bound(const K *p_keys, uint32_t p_count, const K &p_key) {
+		uint32_t low = 0;
+		uint32_t high = p_count;
+		while (low < high) {
+			uint32_t mid = (low + high) >> 1;
+			if (_less(p_key, p_keys[mid])) {
+				high = mid;
+			} else {
+				low = mid + 1;
+			}
+		}
+		return low;
+	}
+
+	template <class T>
+	_FORCE_INLINE_ static void _move(T *p_to, T *p_from, uint32_t p_count) {
+		if (p_count) {
+			memmove((void *)p_to, (void *)p_from, sizeof(T) * p_count);
+		}
+	}
+
+	_FORCE_INLINE_ static bool _is_full(const Node *p_node) {
+		return p_node->count == (p_node->is_leaf ? uint32_t(LEAF_SIZE) : uint32_t(INTERNAL_SIZE));
+	}
+
+	_FORCE_INLINE_ static bool _is_minimal(const Node *p_node) {
+		return p_node->count <= (p_node->is_leaf ? uint32_t(LEAF_MIN) : uint32_t(INTERNAL_MIN));
+	}
+
+	Leaf *_find_leaf(const K &p_key) const {
+		Node *node = root;
+		while (!node->is_leaf) {
+			Internal *internal = static_cast<Internal *>(node);
+			node = internal->children[_upper_bound(internal->keys(), internal->count, p_key)];
+		}
+		return static_cast<Leaf *>(node);
+	}
+
+	// Splits the full child p_index of p_parent, which must not be full.
+	void _split_child(Internal *p_parent, uint32_t p_index) {
+		Node *child = p_parent->children[p_index];
+		Node *right;
+
+		if (child->is_leaf) {
+			Leaf *left_leaf = static_cast<Leaf *>(child);
+			Leaf *right_leaf = memnew(Leaf);
+			right_leaf->is_leaf = true;
+
+			right_leaf->count = LEAF_SIZE - LEAF_MIN;
+			left_leaf->count = LEAF_MIN;
+			_move(right_leaf->keys(), left_leaf->keys() + LEAF_MIN, right_leaf->count);
+			_move(right_leaf->values(), left_leaf->values() + LEAF_MIN, right_leaf->count);
+
+			right_leaf->prev = left_leaf;
+			right_leaf->next = left_leaf->next;
+			if (right_leaf->next) {
+				right_leaf->next->prev = right_leaf;
+			} else {
+				last = right_leaf;
+			}
+			left_leaf->next = right_leaf;
+
+			_move(p_parent->keys() + p_index + 1, p_parent->keys() + p_index, p_parent->count - p_index);
+			memnew_placement(&p_parent->keys()[p_index], K(right_leaf->keys()[0]));
+			right = right_leaf;
+		} else {
+			Internal *left_internal = static_cast<Internal *>(child);
+			Internal *right_internal = memnew(Internal);
+
+			// The middle key moves up to the parent.
+			right_internal->count = INTERNAL_SIZE - INTERNAL_MIN - 1;
+			left_internal->count = INTERNAL_MIN;
+			_move(right_internal->keys(), left_internal->keys() + INTERNAL_MIN + 1, right_internal->count);
+			_move(right_internal->children, left_internal->children + INTERNAL_MIN + 1, right_internal->count + 1);
+
+			_move(p_parent->keys() + p_index + 1, p_parent->keys() + p_index, p_parent->count - p_index);
+			_move(p_parent->keys() + p_index, left_internal->keys() + INTERNAL_MIN, 1);
+			right = right_internal;
+		}
+
+		_move(p_parent->children + p_index + 2, p_parent->children + p_index + 1, p_parent->count - p_index);
+		p_parent->children[p_index + 1] = right;
+		p_parent->count++;
+	}
+
+	// Merges child p_index + 1 of p_parent into child p_index.
+	void _merge_children(Internal *p_parent, uint32_t p_index) {
+		Node *left = p_parent->children[p_index];
+		Node *right = p_parent->children[p_index + 1];
+
+		if (left->is_leaf) {
+			Leaf *left_leaf = static_cast<Leaf *>(left);
+			Leaf *right_leaf = static_cast<Leaf *>(right);
+
+			_move(left_leaf->keys() + left_leaf->count, right_leaf->keys(), right_leaf->count);
+			_move(left_leaf->values() + left_leaf->count, right_leaf->values(), right_leaf->count);
+			left_leaf->count += right_leaf->count;
+
+			left_leaf->next = right_leaf->next;
+			if (left_leaf->next) {
+				left_leaf->next->prev = left_leaf;
+			} else {
+				last = left_leaf;
+			}
+
+			p_parent->keys()[p_index].~K();
+			memdelete(right_leaf);
+		} else {
+			Internal *left_internal = static_cast<Internal *>(left);
+			Internal *right_internal = static_cast<Internal *>(right);
+
+			// The separator comes down between both halves.
+			_move(left_internal->keys() + left_internal->count, p_parent->keys() + p_index, 1);
+			_move(left_internal->keys() + left_internal->count + 1, right_internal->keys(), right_internal->count);
+			_move(left_internal->children + left_internal->count + 1, right_internal->children, right_internal->count + 1);
+			left_internal->count += right_internal->count + 1;
+
+			memdelete(right_internal);
+		}
+
+		_move(p_parent->keys() + p_index, p_parent->keys() + p_index + 1, p_parent->count - p_index - 1);
+		_move(p_parent->children + p_index + 1, p_parent->children + p_index + 2, p_parent->count - p_index - 1);
+		p_parent->count--;
+	}
+
+	void _borrow_from_left(Internal *p_parent, uint32_t p_index) {
+		Node *left = p_parent->children[p_index - 1];
+		Node *child = p_parent->children[p_index];
+
+		if (child->is_leaf) {
+			Leaf *left_leaf = static_cast<Leaf *>(left);
+			Leaf *child_leaf = static_cast<Leaf *>(child);
+
+			_move(child_leaf->keys() + 1, child_leaf->keys(), child_leaf->count);
+			_move(child_leaf->values() + 1, child_leaf->values(), child_leaf->count);
+			_move(child_leaf->keys(), left_leaf->keys() + left_leaf->count - 1, 1);
+			_move(child_leaf->values(), left_leaf->values() + left_leaf->count - 1, 1);
+
+			p_parent->keys()[p_index - 1] = child_leaf->keys()[0];
+		} else {
+			Internal *left_internal = static_cast<Internal *>(left);
+			Internal *child_internal = static_cast<Internal *>(child);
+
+			_move(child_internal->keys() + 1, child_internal->keys(), child_internal->count);
+			_move(child_internal->children + 1, child_internal->children, child_internal->count + 1);
+			_move(child_internal->keys(), p_parent->keys() + p_index - 1, 1);
+			child_internal->children[0] = left_internal->children[left_internal->count];
+			_move(p_parent->keys() + p_index - 1, left_internal->keys() + left_internal->count - 1, 1);
+		}
+
+		left->count--;
+		child->count++;
+	}
+
+	void _borrow_from_right(Internal *p_parent, uint32_t p_index) {
+		Node *child = p_parent->children[p_index];
+		Node *right = p_parent->children[p_index + 1];
+
+		if (child->is_leaf) {
+			Leaf *child_leaf = static_cast<Leaf *>(child);
+			Leaf *right_leaf = static_cast<Leaf *>(right);
+
+			_move(child_leaf->keys() + child_leaf->count, right_leaf->keys(), 1);
+			_move(child_leaf->values() + child_leaf->count, right_leaf->values(), 1);
+			_move(right_leaf->keys(), right_leaf->keys() + 1, right_leaf->count - 1);
+			_move(right_leaf->values(), right_leaf->values() + 1, right_leaf->count - 1);
+
+			p_parent->keys()[p_index] = right_leaf->keys()[0];
+		} else {
+			Internal *child_internal = static_cast<Internal *>(child);
+			Internal *right_internal = static_cast<Internal *>(right);
+
+			_move(child_internal->keys() + child_internal->count, p_parent->keys() + p_index, 1);
+			child_internal->children[child_internal->count + 1] = right_internal->children[0];
+			_move(p_parent->keys() + p_index, right_internal->keys(), 1);
+			_move(right_internal->keys(), right_internal->keys() + 1, right_internal->count - 1);
+			_move(right_internal->children, right_internal->children + 1, right_internal->count);
+		}
+
+		child->count++;
+		right->count--;
+	}
+
+	// Makes sure child p_index of p_parent can lose an element, returns the
+	// index of the child that now covers its range.
+	uint32_t _fill_child(Internal *p_parent, uint32_t p_index) {
+		if (p_index > 0 && !_is_minimal(p_parent->children[p_index - 1])) {
+			_borrow_from_left(p_parent, p_index);
+			return p_index;
+		}
+		if (p_index < p_parent->count && !_is_minimal(p_parent->children[p_index + 1])) {
+			_borrow_from_right(p_parent, p_index);
+			return p_index;
+		}
+		if (p_index > 0) {
+			_merge_children(p_parent, p_index - 1);
+			return p_index - 1;
+		}
+		_merge_children(p_parent, p_index);
+		return p_index;
+	}
+
+	void _free_node(Node *p_node) {
+		if (p_node->is_leaf) {
+			Leaf *leaf = static_cast<Leaf *>(p_node);
+			for (uint32_t i = 0; i < leaf->count; i++) {
+				leaf->keys()[i].~K();
+				leaf->values()[i].~V();
+			}
+			memdelete(leaf);
+		} else {
+			Internal *internal = static_cast<Internal *>(p_node);
+			for (uint32_t i = 0; i < internal->count; i++) {
+				internal->keys()[i].~K();
+			}
+			for (uint32_t i = 0; i <= internal->count; i++) {
+				_free_node(internal->children[i]);
+			}
+			memdelete(internal);
+		}
+	}
+
+	void _copy_from(const BTreeMap &p_other) {
+		clear();
+		for (Iterator E = p_other.front(); E; E = E.next()) {
+			insert(E.key(), E.value());
+		}
+	}
+
+public:
+	Iterator find(const K &p_key) const {
+		if (!root) {
+			return Iterator();
+		}
+
+		Leaf *leaf = _find_leaf(p_key);
+		uint32_t index = _lower_bound(leaf->keys(), leaf->count, p_key);
+		if (index < leaf->count && !_less(p_key, leaf->keys()[index])) {
+			return Iterator(leaf, index);
+		}
+		return Iterator();
+	}
+
+	// The element with the greatest key not greater than p_key.
+	Iterator find_closest(const K &p_key) const {
+		if (!root) {
+			return Iterator();
+		}
+
+		Leaf *leaf = _find_leaf(p_key);
+		uint32_t index = _upper_bound(leaf->keys(), leaf->count, p_key);
+		if (index > 0) {
+			return Iterator(leaf, index - 1);
+		}
+		return leaf->prev ? Iterator(leaf->prev, leaf->prev->count - 1) : Iterator();
+	}
+
+	// The element with the smallest key not less than p_key.
+	Iterator lower_bound(const K &p_key) const {
+		if (!root) {
+			return Iterator();
+		}
+
+		Leaf *leaf = _find_leaf(p_key);
+		uint32_t index = _lower_bound(leaf->keys(), leaf->count, p_key);
+		if (index < leaf->count) {
+			return Iterator(leaf, index);
+		}
+		return Iterator(leaf->next, 0);
+	}
+
+	_FORCE_INLINE_ bool has(const K &p_key) const {
+		return bool(find(p_key));
+	}
+
+	V *getptr(const K &p_key) const {
+		Iterator E = find(p_key);
+		return E ? &E.value() : nullptr;
+	}
+
+	// Inserts p_key, or replaces its value if it is already there.
+	Iterator insert(const K &p_key, const V &p_value) {
+		if (!root) {
+			Leaf *leaf = memnew(Leaf);
+			leaf->is_leaf = true;
+			root = leaf;
+			first = leaf;
+			last = leaf;
+		}
+
+		// Full nodes are split on the way down, so there is always room in the
+		// parent for the key a split moves up.
+		if (_is_full(root)) {
+			Internal *new_root = memnew(Internal);
+			new_root->children[0] = root;
+			root = new_root;
+			_split_child(new_root, 0);
+		}
+
+		Node *node = root;
+		while (!node->is_leaf) {
+			Internal *internal = static_cast<Internal *>(node);
+			uint32_t index = _upper_bound(internal->keys(), internal->count, p_key);
+			if (_is_full(internal->children[index])) {
+				_split_child(internal, index);
+				if (!_less(p_key, internal->keys()[index])) {
+					index++;
+				}
+			}
+			node = internal->children[index];
+		}
+
+		Leaf *leaf = static_cast<Leaf *>(node);
+		uint32_t index = _lower_bound(leaf->keys(), leaf->count, p_key);
+		if (index < leaf->count && !_less(p_key, leaf->keys()[index])) {
+			leaf->values()[index] = p_value;
+			return Iterator(leaf, index);
+		}
+
+		_move(leaf->keys() + index + 1, leaf->keys() + index, leaf->count - index);
+		_move(leaf->values() + index + 1, leaf->values() + index, leaf->count - index);
+		memnew_placement(&leaf->keys()[index], K(p_key));
+		memnew_placement(&leaf->values()[index], V(p_value));
+		leaf->count++;
+		element_count++;
+
+		return Iterator(leaf, index);
+	}
+
+	bool erase(const K &p_key) {
+		if (!root) {
+			return false;
+		}
+
+		// Nodes at their minimum are refilled on the way down, so removing
+		// from the leaf never needs to walk back up.
+		Node *node = root;
+		while (!node->is_leaf) {
+			Internal *internal = static_cast<Internal *>(node);
+			uint32_t index = _upper_bound(internal->keys(), internal->count, p_key);
+			if (_is_minimal(internal->children[index])) {
+				index = _fill_child(internal, index);
+			}
+			node = internal->children[index];
+
+			if (internal == root && internal->count == 0) {
+				root = node;
+				memdelete(internal);
+			}
+		}
+
+		Leaf *leaf = static_cast<Leaf *>(node);
+		uint32_t index = _lower_bound(leaf->keys(), leaf->count, p_key);
+		if (index == leaf->count || _less(p_key, leaf->keys()[index])) {
+			return false;
+		}
+
+		leaf->keys()[index].~K();
+		leaf->values()[index].~V();
+		_move(leaf->keys() + index, leaf->keys() + index + 1, leaf->count - index - 1);
+		_move(leaf->values() + index, leaf->values() + index + 1, leaf->count - index - 1);
+		leaf->count--;
+		element_count--;
+
+		if (leaf->count == 0 && leaf == root) {
+			memdelete(leaf);
+			root = nullptr;
+			first = nullptr;
+			last = nullptr;
+		}
+
+		return true;
+	}
+
+	bool erase(const Iterator &p_iterator) {
+		ERR_FAIL_COND_V(!p_iterator, false);
+		K key = p_iterator.key();
+		return erase(key);
+	}
+
+	const V &operator[](const K &p_key) const {
+		Iterator E = find(p_key);
+		CRASH_COND(!E);
+		return E.value();
+	}
+
+	V &operator[](const K &p_key) {
+		Iterator E = find(p_key);
+		if (!E) {
+			E = insert(p_key, V());
+		}
+		return E.value();
+	}
+
+	_FORCE_INLINE_ Iterator front() const {
+		return first ? Iterator(first, 0) : Iterator();
+	}
+
+	_FORCE_INLINE_ Iterator back() const {
+		return last ? Iterator(last, last->count - 1) : Iterator();
+	}
+
+	_FORCE_INLINE_ bool empty() const { return element_count == 0; }
+	_FORCE_INLINE_ int size() const { return element_count; }
+
+	void clear() {
+		if (root) {
+			_free_node(root);
+		}
+		root = nullptr;
+		first = nullptr;
+		last = nullptr;
+		element_count = 0;
+	}
+
+	void operator=(const BTreeMap &p_other) {
+		if (this != &p_other) {
+			_copy_from(p_other);
+		}
+	}
+
+	BTreeMap(const BTreeMap &p_other) {
+		_copy_from(p_other);
+	}
+
+	_FORCE_INLINE_ BTreeMap() {}
+
+	~BTreeMap() {
+		clear();
+	}
+};
+
+#endif // B_TREE_MAP_H
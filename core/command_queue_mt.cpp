@@ -32,76 +32,95 @@
 
 #include "core/os/os.h"
 
-void CommandQueueMT::lock() {
-	mutex.lock();
-}
-
-void CommandQueueMT::unlock() {
-	mutex.unlock();
-}
-
 void CommandQueueMT::wait_for_flush() {
 	// wait one millisecond for a flush to happen
 	OS::get_singleton()->delay_usec(1000);
 }
 
 CommandQueueMT::SyncSemaphore *CommandQueueMT::_alloc_sync_sem() {
-	int idx = -1;
-
 	while (true) {
-		lock();
 		for (int i = 0; i < SYNC_SEMAPHORES; i++) {
-			if (!sync_sems[i].in_use) {
-				sync_sems[i].in_use = true;
-				idx = i;
-				break;
+			bool expected = false;
+			if (!sync_sems[i].in_use.load(std::memory_order_relaxed) && sync_sems[i].in_use.compare_exchange_strong(expected, true)) {
+				return &sync_sems[i];
 			}
 		}
-		unlock();
 
-		if (idx == -1) {
-			wait_for_flush();
-		} else {
-			break;
-		}
+		wait_for_flush();
 	}
-
-	return &sync_sems[idx];
 }
 
-bool CommandQueueMT::dealloc_one() {
-tryagain:
-	if (dealloc_ptr == write_ptr) {
-		// The queue is empty
-		return false;
-	}
+void CommandQueueMT::_grow(uint32_t p_size) {
+	uint32_t capacity = MAX(uint32_t(COMMAND_BLOCK_SIZE), p_size);
 
-	uint32_t size = *(uint32_t *)&command_mem[dealloc_ptr];
+	Block *block = spare_block.exchange(nullptr);
+	if (block && block->capacity < capacity) {
+		block->~Block();
+		memfree(block);
+		block = nullptr;
+	}
+	if (!block) {
+		block = memnew_placement(memalloc(DATA_OFFSET + capacity), Block);
+		block->capacity = capacity;
+	}
+	block->next.store(nullptr, std::memory_order_relaxed);
+	block->committed.store(0, std::memory_order_relaxed);
+
+	// Everything written so far is already committed; linking with release
+	// semantics publishes the reset of the new block as well.
+	write_block->next.store(block, std::memory_order_release);
+	write_block = block;
+	write_offset = 0;
+}
 
-	if (size == 0) {
-		// End of command buffer wrap down
-		dealloc_ptr = 0;
-		goto tryagain;
+void CommandQueueMT::_recycle(Block *p_block) {
+	Block *previous = spare_block.exchange(p_block);
+	if (previous) {
+		previous->~Block();
+		memfree(previous);
 	}
+}
 
-	if (size & 1) {
-		// Still used, nothing can be deallocated
-		return false;
+void CommandQueueMT::wait_and_flush() {
+	ERR_FAIL_COND(!sync);
+
+	while (!flush_one()) {
+		sleeping.store(true);
+		if (_has_commands()) {
+			// A producer may have cleared the flag already, in which case it
+			// also posted and the semaphore must be consumed to stay balanced.
+			if (!sleeping.exchange(false)) {
+				sync->wait();
+			}
+			continue;
+		}
+		sync->wait();
 	}
 
-	dealloc_ptr += (size >> 1) + 8;
-	return true;
+	flush_all();
 }
 
 CommandQueueMT::CommandQueueMT(bool p_sync) {
 	if (p_sync) {
 		sync = memnew(Semaphore);
 	}
+
+	write_block = memnew_placement(memalloc(DATA_OFFSET + COMMAND_BLOCK_SIZE), Block);
+	write_block->capacity = COMMAND_BLOCK_SIZE;
+	read_block = write_block;
 }
 
 CommandQueueMT::~CommandQueueMT() {
 	if (sync) {
 		memdelete(sync);
 	}
-	memfree(command_mem);
+
+	Block *block = read_block;
+	while (block) {
+		Block *next = block->next.load();
+		block->~Block();
+		memfree(block);
+		block = next;
+	}
+	_recycle(nullptr);
 }
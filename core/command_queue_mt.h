@@ -32,11 +32,13 @@
 #define COMMAND_QUEUE_MT_H
 
 #include "core/os/memory.h"
-#include "core/os/mutex.h"
 #include "core/os/semaphore.h"
 #include "core/simple_type.h"
+#include "core/spin_lock.h"
 #include "core/typedefs.h"
 
+#include <atomic>
+
 #define COMMA(N) _COMMA_##N
 #define _COMMA_0
 #define _COMMA_1 ,
@@ -213,7 +215,7 @@
 		T *instance;                                                   \
 		M method;                                                      \
 		SEMIC_SEP_LIST(PARAM_DECL, N);                                 \
-		virtual void call() {                                          \
+		void call() {                                                  \
 			(instance->*method)(COMMA_SEP_LIST(ARG, N));               \
 		}                                                              \
 	};
@@ -225,7 +227,7 @@
 		T *instance;                                                            \
 		M method;                                                               \
 		SEMIC_SEP_LIST(PARAM_DECL, N);                                          \
-		virtual void call() {                                                   \
+		void call() {                                                           \
 			*ret = (instance->*method)(COMMA_SEP_LIST(ARG, N));                 \
 		}                                                                       \
 	};
@@ -236,7 +238,7 @@
 		T *instance;                                                   \
 		M method;                                                      \
 		SEMIC_SEP_LIST(PARAM_DECL, N);                                 \
-		virtual void call() {                                          \
+		void call() {                                                  \
 			(instance->*method)(COMMA_SEP_LIST(ARG, N));               \
 		}                                                              \
 	};
@@ -252,9 +254,7 @@
 		cmd->instance = p_instance;                                          \
 		cmd->method = p_method;                                              \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                 \
-		unlock();                                                            \
-		if (sync)                                                            \
-			sync->post();                                                    \
+		commit_and_unlock();                                                 \
 	}
 
 #define CMD_RET_TYPE(N) CommandRet##N<T, M, COMMA_SEP_LIST(TYPE_ARG, N) COMMA(N) R>
@@ -269,9 +269,7 @@
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                                   \
 		cmd->ret = r_ret;                                                                      \
 		cmd->sync_sem = ss;                                                                    \
-		unlock();                                                                              \
-		if (sync)                                                                              \
-			sync->post();                                                                      \
+		commit_and_unlock();                                                                   \
 		ss->sem.wait();                                                                        \
 		ss->in_use = false;                                                                    \
 	}
@@ -287,9 +285,7 @@
 		cmd->method = p_method;                                                       \
 		SEMIC_SEP_LIST(CMD_ASSIGN_PARAM, N);                                          \
 		cmd->sync_sem = ss;                                                           \
-		unlock();                                                                     \
-		if (sync)                                                                     \
-			sync->post();                                                             \
+		commit_and_unlock();                                                          \
 		ss->sem.wait();                                                               \
 		ss->in_use = false;                                                           \
 	}
@@ -299,19 +295,19 @@
 class CommandQueueMT {
 	struct SyncSemaphore {
 		Semaphore sem;
-		bool in_use = false;
+		std::atomic<bool> in_use = { false };
 	};
 
+	// Commands are not polymorphic: each one is stored after a header holding
+	// a function that calls, posts and destroys it in a single indirect call.
 	struct CommandBase {
-		virtual void call() = 0;
-		virtual void post() {}
-		virtual ~CommandBase() {}
+		_FORCE_INLINE_ void post() {}
 	};
 
 	struct SyncCommand : public CommandBase {
 		SyncSemaphore *sync_sem;
 
-		virtual void post() {
+		_FORCE_INLINE_ void post() {
 			sync_sem->sem.post();
 		}
 	};
@@ -329,141 +325,123 @@ class CommandQueueMT {
 
 	/***** BASE *******/
 
-	enum {
-		COMMAND_MEM_SIZE_KB = 256,
-		COMMAND_MEM_SIZE = COMMAND_MEM_SIZE_KB * 1024,
-		SYNC_SEMAPHORES = 8
+	typedef void (*ExecuteFunc)(void *p_command);
+
+	struct CommandHeader {
+		ExecuteFunc execute;
+		uint32_t size; // Header included.
 	};
 
-	uint8_t *command_mem = (uint8_t *)memalloc(COMMAND_MEM_SIZE);
-	uint32_t read_ptr = 0;
-	uint32_t write_ptr = 0;
-	uint32_t dealloc_ptr = 0;
-	SyncSemaphore sync_sems[SYNC_SEMAPHORES];
-	Mutex mutex;
-	Semaphore *sync = nullptr;
+	// Commands are written into a chain of blocks. The producer appends to the
+	// last block and links a new one when it runs out of room, so pushing never
+	// waits for the consumer. The consumer walks the chain without locking and
+	// hands finished blocks back to be reused.
+	struct Block {
+		std::atomic<Block *> next = { nullptr };
+		std::atomic<uint32_t> committed = { 0 }; // Bytes visible to the consumer.
+		uint32_t capacity = 0;
 
-	template <class T>
-	T *allocate() {
-		// alloc size is size+T+safeguard
-		uint32_t alloc_size = ((sizeof(T) + 8 - 1) & ~(8 - 1)) + 8;
-
-	tryagain:
-
-		if (write_ptr < dealloc_ptr) {
-			// behind dealloc_ptr, check that there is room
-			if ((dealloc_ptr - write_ptr) <= alloc_size) {
-				// There is no more room, try to deallocate something
-				if (dealloc_one()) {
-					goto tryagain;
-				}
-				return nullptr;
-			}
-		} else {
-			// ahead of dealloc_ptr, check that there is room
+		_FORCE_INLINE_ uint8_t *get_data() { return reinterpret_cast<uint8_t *>(this) + DATA_OFFSET; }
+	};
 
-			if ((COMMAND_MEM_SIZE - write_ptr) < alloc_size + sizeof(uint32_t)) {
-				// no room at the end, wrap down;
+	enum {
+		COMMAND_BLOCK_SIZE_KB = 256,
+		COMMAND_BLOCK_SIZE = COMMAND_BLOCK_SIZE_KB * 1024,
+		SYNC_SEMAPHORES = 8,
+		DATA_OFFSET = (sizeof(Block) + 8 - 1) & ~(8 - 1),
+		HEADER_SIZE = (sizeof(CommandHeader) + 8 - 1) & ~(8 - 1),
+	};
 
-				if (dealloc_ptr == 0) { // don't want write_ptr to become dealloc_ptr
+	// Producer side, guarded by write_lock. Pushes from several threads must
+	// keep their relative order, so they are serialized, but the lock is only
+	// held while a command is being written and is never taken by the consumer.
+	SpinLock write_lock;
+	Block *write_block = nullptr;
+	uint32_t write_offset = 0;
 
-					// There is no more room, try to deallocate something
-					if (dealloc_one()) {
-						goto tryagain;
-					}
-					return nullptr;
-				}
+	// Consumer side, only touched by the flushing thread.
+	Block *read_block = nullptr;
+	uint32_t read_offset = 0;
 
-				// if this happens, it's a bug
-				ERR_FAIL_COND_V((COMMAND_MEM_SIZE - write_ptr) < 8, nullptr);
-				// zero means, wrap to beginning
+	// A drained block kept around so the producer does not need to allocate.
+	std::atomic<Block *> spare_block = { nullptr };
 
-				uint32_t *p = (uint32_t *)&command_mem[write_ptr];
-				*p = 0;
-				write_ptr = 0;
-				goto tryagain;
-			}
-		}
-		// Allocate the size and the 'in use' bit.
-		// First bit used to mark if command is still in use (1)
-		// or if it has been destroyed and can be deallocated (0).
-		uint32_t size = (sizeof(T) + 8 - 1) & ~(8 - 1);
-		uint32_t *p = (uint32_t *)&command_mem[write_ptr];
-		*p = (size << 1) | 1;
-		write_ptr += 8;
-		// allocate the command
-		T *cmd = memnew_placement(&command_mem[write_ptr], T);
-		write_ptr += size;
-		return cmd;
+	// Set by the consumer before it sleeps, so producers only post the
+	// semaphore when it is actually needed instead of once per command.
+	std::atomic<bool> sleeping = { false };
+
+	SyncSemaphore sync_sems[SYNC_SEMAPHORES];
+	Semaphore *sync = nullptr;
+
+	template <class T>
+	static void _execute(void *p_command) {
+		T *cmd = reinterpret_cast<T *>(p_command);
+		cmd->call();
+		cmd->post();
+		cmd->~T();
 	}
 
 	template <class T>
 	T *allocate_and_lock() {
-		lock();
-		T *ret;
-
-		while ((ret = allocate<T>()) == nullptr) {
-			unlock();
-			// sleep a little until fetch happened and some room is made
-			wait_for_flush();
-			lock();
-		}
-
-		return ret;
-	}
+		uint32_t size = HEADER_SIZE + ((sizeof(T) + 8 - 1) & ~(8 - 1));
 
-	bool flush_one(bool p_lock = true) {
-		if (p_lock) {
-			lock();
+		write_lock.lock();
+		if (unlikely(write_offset + size > write_block->capacity)) {
+			_grow(size);
 		}
-	tryagain:
 
-		// tried to read an empty queue
-		if (read_ptr == write_ptr) {
-			if (p_lock) {
-				unlock();
-			}
-			return false;
-		}
+		CommandHeader *header = reinterpret_cast<CommandHeader *>(write_block->get_data() + write_offset);
+		header->execute = &_execute<T>;
+		header->size = size;
+		write_offset += size;
 
-		uint32_t size_ptr = read_ptr;
-		uint32_t size = *(uint32_t *)&command_mem[read_ptr] >> 1;
+		return memnew_placement(reinterpret_cast<uint8_t *>(header) + HEADER_SIZE, T);
+	}
 
-		if (size == 0) {
-			//end of ringbuffer, wrap
-			read_ptr = 0;
-			goto tryagain;
+	_FORCE_INLINE_ void commit_and_unlock() {
+		// Sequentially consistent, paired with the consumer storing 'sleeping'
+		// before checking for commands; one of both sides sees the other.
+		write_block->committed.store(write_offset);
+		write_lock.unlock();
+		if (sync && sleeping.load() && sleeping.exchange(false)) {
+			sync->post();
 		}
+	}
 
-		read_ptr += 8;
-
-		CommandBase *cmd = reinterpret_cast<CommandBase *>(&command_mem[read_ptr]);
+	bool flush_one() {
+		while (true) {
+			if (read_offset < read_block->committed.load(std::memory_order_acquire)) {
+				CommandHeader *header = reinterpret_cast<CommandHeader *>(read_block->get_data() + read_offset);
+				read_offset += header->size;
+				header->execute(reinterpret_cast<uint8_t *>(header) + HEADER_SIZE);
+				return true;
+			}
 
-		read_ptr += size;
+			Block *next = read_block->next.load(std::memory_order_acquire);
+			if (!next) {
+				return false;
+			}
+			// The producer commits a block before linking the next one, so check
+			// again for commands written right before it moved on.
+			if (read_offset < read_block->committed.load(std::memory_order_acquire)) {
+				continue;
+			}
 
-		if (p_lock) {
-			unlock();
+			Block *drained = read_block;
+			read_block = next;
+			read_offset = 0;
+			_recycle(drained);
 		}
-		cmd->call();
-		if (p_lock) {
-			lock();
-		}
-
-		cmd->post();
-		cmd->~CommandBase();
-		*(uint32_t *)&command_mem[size_ptr] &= ~1;
+	}
 
-		if (p_lock) {
-			unlock();
-		}
-		return true;
+	_FORCE_INLINE_ bool _has_commands() const {
+		return read_offset < read_block->committed.load() || read_block->next.load() != nullptr;
 	}
 
-	void lock();
-	void unlock();
+	void _grow(uint32_t p_size);
+	void _recycle(Block *p_block);
 	void wait_for_flush();
 	SyncSemaphore *_alloc_sync_sem();
-	bool dealloc_one();
 
 public:
 	/* NORMAL PUSH COMMANDS */
@@ -478,18 +456,12 @@ public:
 	DECL_PUSH_AND_SYNC(0)
 	SPACE_SEP_LIST(DECL_PUSH_AND_SYNC, 15)
 
-	void wait_and_flush_one() {
-		ERR_FAIL_COND(!sync);
-		sync->wait();
-		flush_one();
-	}
+	// Waits until commands are available, then flushes all of them.
+	void wait_and_flush();
 
 	void flush_all() {
-		//ERR_FAIL_COND(sync);
-		lock();
-		while (flush_one(false)) {
+		while (flush_one()) {
 		}
-		unlock();
 	}
 
 	CommandQueueMT(bool p_sync);
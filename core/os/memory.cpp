@@ -34,6 +34,10 @@
 #include "core/os/copymem.h"
 #include "core/safe_refcount.h"
 
+#ifdef SMALL_ALLOCATOR_ENABLED
+#include "core/os/small_allocator.h"
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -66,6 +70,104 @@ uint64_t Memory::max_usage = 0;
 
 uint64_t Memory::alloc_count = 0;
 
+#ifdef SMALL_ALLOCATOR_ENABLED
+
+// Every block carries the header, and the size stored in it is tagged with
+// the size class the block came from, or zero when it came from malloc.
+// The upper half of the header belongs to the caller (CowData uses it).
+
+#define SIZE_CLASS_SHIFT 56
+#define SIZE_MASK ((uint64_t(1) << SIZE_CLASS_SHIFT) - 1)
+
+void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
+	int size_class = SmallAllocator::get_size_class(p_bytes + PAD_ALIGN);
+	uint8_t *mem = (uint8_t *)(size_class >= 0 ? SmallAllocator::alloc(size_class) : malloc(p_bytes + PAD_ALIGN));
+
+	ERR_FAIL_COND_V(!mem, nullptr);
+
+	*(uint64_t *)mem = p_bytes | (uint64_t(size_class + 1) << SIZE_CLASS_SHIFT);
+	SmallAllocator::count_alloc(p_bytes);
+
+	return mem + PAD_ALIGN;
+}
+
+void *Memory::realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align) {
+	if (p_memory == nullptr) {
+		return alloc_static(p_bytes, p_pad_align);
+	}
+
+	if (p_bytes == 0) {
+		free_static(p_memory, p_pad_align);
+		return nullptr;
+	}
+
+	uint8_t *mem = (uint8_t *)p_memory - PAD_ALIGN;
+	uint64_t header = *(uint64_t *)mem;
+	size_t old_bytes = header & SIZE_MASK;
+	int size_class = int(header >> SIZE_CLASS_SHIFT) - 1;
+
+	if (size_class >= 0) {
+		if (p_bytes + PAD_ALIGN > SmallAllocator::get_class_size(size_class)) {
+			// Outgrew its size class, move it to a bigger one or to malloc.
+			int new_class = SmallAllocator::get_size_class(p_bytes + PAD_ALIGN);
+			uint8_t *new_mem = (uint8_t *)(new_class >= 0 ? SmallAllocator::alloc(new_class) : malloc(p_bytes + PAD_ALIGN));
+			ERR_FAIL_COND_V(!new_mem, nullptr);
+
+			copymem(new_mem, mem, PAD_ALIGN + old_bytes);
+			SmallAllocator::free(mem, size_class);
+			mem = new_mem;
+			size_class = new_class;
+		}
+	} else {
+		// Blocks from malloc stay there, even when shrinking.
+		mem = (uint8_t *)realloc(mem, p_bytes + PAD_ALIGN);
+		ERR_FAIL_COND_V(!mem, nullptr);
+	}
+
+	*(uint64_t *)mem = p_bytes | (uint64_t(size_class + 1) << SIZE_CLASS_SHIFT);
+	SmallAllocator::count_resize(int64_t(p_bytes) - int64_t(old_bytes));
+
+	return mem + PAD_ALIGN;
+}
+
+void Memory::free_static(void *p_ptr, bool p_pad_align) {
+	ERR_FAIL_COND(p_ptr == nullptr);
+
+	uint8_t *mem = (uint8_t *)p_ptr - PAD_ALIGN;
+	uint64_t header = *(uint64_t *)mem;
+	int size_class = int(header >> SIZE_CLASS_SHIFT) - 1;
+
+	SmallAllocator::count_free(header & SIZE_MASK);
+
+	if (size_class >= 0) {
+		SmallAllocator::free(mem, size_class);
+	} else {
+		free(mem);
+	}
+}
+
+uint64_t Memory::get_mem_available() {
+	return -1; // 0xFFFF...
+}
+
+uint64_t Memory::get_mem_usage() {
+#ifdef DEBUG_ENABLED
+	return SmallAllocator::get_mem_usage();
+#else
+	return 0;
+#endif
+}
+
+uint64_t Memory::get_mem_max_usage() {
+#ifdef DEBUG_ENABLED
+	return SmallAllocator::get_mem_max_usage();
+#else
+	return 0;
+#endif
+}
+
+#else
+
 void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
 #ifdef DEBUG_ENABLED
 	bool prepad = true;
@@ -192,6 +294,8 @@ uint64_t Memory::get_mem_max_usage() {
 #endif
 }
 
+#endif // SMALL_ALLOCATOR_ENABLED
+
 _GlobalNil::_GlobalNil() {
 	left = this;
 	right = this;
@@ -0,0 +1,317 @@
+/*************************************************************************/
+/*  small_allocator.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "small_allocator.h"
+
+#include "core/spin_lock.h"
+
+#include <stdlib.h>
+#include <atomic>
+
+struct FreeBlock {
+	FreeBlock *next;
+};
+
+enum {
+	SPAN_SIZE = 64 * 1024,
+	BATCH_BYTES = 4096, // Blocks moved at once between a thread and the shared lists.
+	PEAK_SAMPLE_INTERVAL = 4096, // Allocations per thread between samples of the peak usage.
+};
+
+static _FORCE_INLINE_ uint32_t _get_batch_count(int p_class) {
+	return MAX(4u, uint32_t(BATCH_BYTES / SmallAllocator::get_class_size(p_class)));
+}
+
+struct SharedClass {
+	SpinLock lock;
+	FreeBlock *free_list = nullptr;
+	uint8_t *span_pos = nullptr;
+	uint8_t *span_end = nullptr;
+};
+
+static SharedClass shared_classes[SmallAllocator::CLASS_COUNT];
+
+// Plain data so it needs no construction and stays valid while other
+// thread_local destructors run; ThreadCacheReleaser does the cleanup.
+struct ThreadCache {
+	FreeBlock *free_lists[SmallAllocator::CLASS_COUNT];
+	uint32_t free_counts[SmallAllocator::CLASS_COUNT];
+
+	// Written only by the owning thread, read when totals are requested.
+	std::atomic<int64_t> alloc_count;
+	std::atomic<int64_t> mem_usage;
+	uint32_t alloc_ticks;
+
+	ThreadCache *next;
+	ThreadCache *prev;
+	bool registered;
+	bool released;
+};
+
+static thread_local ThreadCache thread_cache;
+
+static SpinLock registry_lock;
+static ThreadCache *registry = nullptr;
+// Counters of exited threads, and of allocations made after a thread's
+// cache was released.
+static std::atomic<int64_t> retired_alloc_count = { 0 };
+static std::atomic<int64_t> retired_mem_usage = { 0 };
+static std::atomic<uint64_t> max_mem_usage = { 0 };
+
+// Takes up to p_count blocks from the shared list, carving new ones from the
+// current span when it runs out. Returns how many were added to r_list.
+static uint32_t _take_shared(int p_class, uint32_t p_count, FreeBlock *&r_list) {
+	SharedClass &shared = shared_classes[p_class];
+	size_t size = SmallAllocator::get_class_size(p_class);
+	uint32_t taken = 0;
+
+	shared.lock.lock();
+	while (taken < p_count && shared.free_list) {
+		FreeBlock *block = shared.free_list;
+		shared.free_list = block->next;
+		block->next = r_list;
+		r_list = block;
+		taken++;
+	}
+	while (taken < p_count) {
+		if (shared.span_pos + size > shared.span_end) {
+			uint8_t *span = (uint8_t *)malloc(SPAN_SIZE);
+			if (!span) {
+				break;
+			}
+			// Keep blocks aligned like the ones malloc returns.
+			shared.span_pos = (uint8_t *)((uintptr_t(span) + 15) & ~uintptr_t(15));
+			shared.span_end = span + SPAN_SIZE;
+		}
+		FreeBlock *block = (FreeBlock *)shared.span_pos;
+		shared.span_pos += size;
+		block->next = r_list;
+		r_list = block;
+		taken++;
+	}
+	shared.lock.unlock();
+
+	return taken;
+}
+
+static void _give_shared(int p_class, FreeBlock *p_first, FreeBlock *p_last) {
+	SharedClass &shared = shared_classes[p_class];
+	shared.lock.lock();
+	p_last->next = shared.free_list;
+	shared.free_list = p_first;
+	shared.lock.unlock();
+}
+
+static void _release_thread_cache() {
+	ThreadCache &cache = thread_cache;
+
+	for (int i = 0; i < SmallAllocator::CLASS_COUNT; i++) {
+		FreeBlock *first = cache.free_lists[i];
+		if (!first) {
+			continue;
+		}
+		FreeBlock *last = first;
+		while (last->next) {
+			last = last->next;
+		}
+		_give_shared(i, first, last);
+		cache.free_lists[i] = nullptr;
+		cache.free_counts[i] = 0;
+	}
+
+	registry_lock.lock();
+	if (cache.prev) {
+		cache.prev->next = cache.next;
+	} else {
+		registry = cache.next;
+	}
+	if (cache.next) {
+		cache.next->prev = cache.prev;
+	}
+	retired_alloc_count.fetch_add(cache.alloc_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	retired_mem_usage.fetch_add(cache.mem_usage.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	cache.released = true;
+	registry_lock.unlock();
+}
+
+struct ThreadCacheReleaser {
+	~ThreadCacheReleaser() {
+		_release_thread_cache();
+	}
+};
+
+static void _register_thread_cache() {
+	ThreadCache &cache = thread_cache;
+
+	registry_lock.lock();
+	cache.prev = nullptr;
+	cache.next = registry;
+	if (registry) {
+		registry->prev = &cache;
+	}
+	registry = &cache;
+	cache.registered = true;
+	registry_lock.unlock();
+
+	// Constructed on first use, so its destructor runs when this thread exits.
+	static thread_local ThreadCacheReleaser releaser;
+	(void)releaser;
+}
+
+// Returns the cache of the calling thread, or null once it has been released.
+static _FORCE_INLINE_ ThreadCache *_get_thread_cache() {
+	ThreadCache *cache = &thread_cache;
+	if (unlikely(!cache->registered)) {
+		_register_thread_cache();
+	}
+	return cache->released ? nullptr : cache;
+}
+
+static _FORCE_INLINE_ void _add_relaxed(std::atomic<int64_t> &p_counter, int64_t p_value) {
+	// Only the owner writes, so a plain load and store is enough.
+	p_counter.store(p_counter.load(std::memory_order_relaxed) + p_value, std::memory_order_relaxed);
+}
+
+void *SmallAllocator::alloc(int p_class) {
+	ThreadCache *cache = _get_thread_cache();
+	if (unlikely(!cache)) {
+		FreeBlock *block = nullptr;
+		_take_shared(p_class, 1, block);
+		return block;
+	}
+
+	FreeBlock *block = cache->free_lists[p_class];
+	if (unlikely(!block)) {
+		cache->free_counts[p_class] = _take_shared(p_class, _get_batch_count(p_class), cache->free_lists[p_class]);
+		block = cache->free_lists[p_class];
+		if (!block) {
+			return nullptr;
+		}
+	}
+
+	cache->free_lists[p_class] = block->next;
+	cache->free_counts[p_class]--;
+	return block;
+}
+
+void SmallAllocator::free(void *p_block, int p_class) {
+	FreeBlock *block = (FreeBlock *)p_block;
+
+	ThreadCache *cache = _get_thread_cache();
+	if (unlikely(!cache)) {
+		_give_shared(p_class, block, block);
+		return;
+	}
+
+	block->next = cache->free_lists[p_class];
+	cache->free_lists[p_class] = block;
+
+	uint32_t batch = _get_batch_count(p_class);
+	if (unlikely(++cache->free_counts[p_class] > batch * 2)) {
+		// Hand a batch back, so blocks freed by a thread other than the one
+		// that allocated them don't pile up.
+		FreeBlock *last = block;
+		for (uint32_t i = 1; i < batch; i++) {
+			last = last->next;
+		}
+		cache->free_lists[p_class] = last->next;
+		cache->free_counts[p_class] -= batch;
+		_give_shared(p_class, block, last);
+	}
+}
+
+void SmallAllocator::count_alloc(int64_t p_bytes) {
+	ThreadCache *cache = _get_thread_cache();
+	if (likely(cache)) {
+		_add_relaxed(cache->alloc_count, 1);
+		_add_relaxed(cache->mem_usage, p_bytes);
+#ifdef DEBUG_ENABLED
+		if (unlikely(++cache->alloc_ticks == PEAK_SAMPLE_INTERVAL)) {
+			cache->alloc_ticks = 0;
+			get_mem_usage();
+		}
+#endif
+	} else {
+		retired_alloc_count.fetch_add(1, std::memory_order_relaxed);
+		retired_mem_usage.fetch_add(p_bytes, std::memory_order_relaxed);
+	}
+}
+
+void SmallAllocator::count_free(int64_t p_bytes) {
+	ThreadCache *cache = _get_thread_cache();
+	if (likely(cache)) {
+		_add_relaxed(cache->alloc_count, -1);
+		_add_relaxed(cache->mem_usage, -p_bytes);
+	} else {
+		retired_alloc_count.fetch_sub(1, std::memory_order_relaxed);
+		retired_mem_usage.fetch_sub(p_bytes, std::memory_order_relaxed);
+	}
+}
+
+void SmallAllocator::count_resize(int64_t p_delta) {
+	ThreadCache *cache = _get_thread_cache();
+	if (likely(cache)) {
+		_add_relaxed(cache->mem_usage, p_delta);
+	} else {
+		retired_mem_usage.fetch_add(p_delta, std::memory_order_relaxed);
+	}
+}
+
+uint64_t SmallAllocator::get_alloc_count() {
+	registry_lock.lock();
+	int64_t total = retired_alloc_count.load(std::memory_order_relaxed);
+	for (ThreadCache *cache = registry; cache; cache = cache->next) {
+		total += cache->alloc_count.load(std::memory_order_relaxed);
+	}
+	registry_lock.unlock();
+
+	return MAX(total, 0);
+}
+
+uint64_t SmallAllocator::get_mem_usage() {
+	registry_lock.lock();
+	int64_t total = retired_mem_usage.load(std::memory_order_relaxed);
+	for (ThreadCache *cache = registry; cache; cache = cache->next) {
+		total += cache->mem_usage.load(std::memory_order_relaxed);
+	}
+	registry_lock.unlock();
+
+	uint64_t usage = MAX(total, 0);
+	// The peak is sampled here, so it is only as precise as how often this runs.
+	uint64_t max_usage = max_mem_usage.load(std::memory_order_relaxed);
+	while (usage > max_usage && !max_mem_usage.compare_exchange_weak(max_usage, usage, std::memory_order_relaxed)) {
+	}
+	return usage;
+}
+
+uint64_t SmallAllocator::get_mem_max_usage() {
+	get_mem_usage();
+	return max_mem_usage.load(std::memory_order_relaxed);
+}
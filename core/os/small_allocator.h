@@ -0,0 +1,78 @@
+/*************************************************************************/
+/*  small_allocator.h                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef SMALL_ALLOCATOR_H
+#define SMALL_ALLOCATOR_H
+
+#include "core/typedefs.h"
+
+#include <stddef.h>
+
+// Serves small blocks from per-thread free lists, one per size class, backed
+// by shared lists refilled from large spans. Spans are never handed back to
+// the system; freed blocks are kept for reuse instead.
+//
+// It also keeps the allocation counters used by Memory, per thread, so that
+// allocating never touches a shared cache line. Totals are summed on demand.
+
+class SmallAllocator {
+public:
+	enum {
+		MAX_SIZE = 1024,
+		CLASS_COUNT = 28, // Steps of 16 bytes up to 256, then steps of 64.
+	};
+
+	_FORCE_INLINE_ static int get_size_class(size_t p_size) {
+		if (p_size <= 256) {
+			return p_size == 0 ? 0 : int((p_size + 15) >> 4) - 1;
+		}
+		if (p_size <= MAX_SIZE) {
+			return 16 + int((p_size - 256 + 63) >> 6) - 1;
+		}
+		return -1;
+	}
+
+	_FORCE_INLINE_ static size_t get_class_size(int p_class) {
+		return p_class < 16 ? size_t(p_class + 1) << 4 : 256 + (size_t(p_class - 15) << 6);
+	}
+
+	static void *alloc(int p_class);
+	static void free(void *p_block, int p_class);
+
+	static void count_alloc(int64_t p_bytes);
+	static void count_free(int64_t p_bytes);
+	static void count_resize(int64_t p_delta);
+
+	static uint64_t get_alloc_count();
+	static uint64_t get_mem_usage();
+	static uint64_t get_mem_max_usage();
+};
+
+#endif // SMALL_ALLOCATOR_H
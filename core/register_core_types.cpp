@@ -67,6 +67,7 @@
 #include "core/os/main_loop.h"
 #include "core/packed_data_container.h"
 #include "core/project_settings.h"
+#include "core/thread_work_pool.h"
 #include "core/translation.h"
 #include "core/undo_redo.h"
 
@@ -88,6 +89,8 @@ static _JSON *_json = nullptr;
 
 static IP *ip = nullptr;
 
+static ThreadWorkPool *thread_work_pool = nullptr;
+
 static _Geometry2D *_geometry_2d = nullptr;
 static _Geometry3D *_geometry_3d = nullptr;
 
@@ -97,6 +100,7 @@ extern void register_global_constants();
 extern void unregister_global_constants();
 extern void register_variant_methods();
 extern void unregister_variant_methods();
+extern void register_variant_operators();
 
 void register_core_types() {
 	//consistency check
@@ -108,8 +112,12 @@ void register_core_types() {
 	StringName::setup();
 	ResourceLoader::initialize();
 
+	// Threads are started by Main once project settings are loaded, until then work runs on the caller.
+	thread_work_pool = memnew(ThreadWorkPool);
+
 	register_global_constants();
 	register_variant_methods();
+	register_variant_operators();
 
 	CoreStringNames::create();
 
@@ -272,6 +280,9 @@ void register_core_singletons() {
 }
 
 void unregister_core_types() {
+	memdelete(thread_work_pool);
+	thread_work_pool = nullptr;
+
 	memdelete(_resource_loader);
 	memdelete(_resource_saver);
 	memdelete(_os);
@@ -31,3 +31,6 @@
 #include "rid_owner.h"
 
 volatile uint64_t RID_AllocBase::base_id = 1;
+
+thread_local uint32_t RID_AllocBase::thread_index = 0xFFFFFFFF;
+std::atomic<uint32_t> RID_AllocBase::thread_count = { 0 };
@@ -41,6 +41,7 @@
 #include "core/spin_lock.h"
 
 #include <stdio.h>
+#include <atomic>
 #include <typeinfo>
 
 class RID_AllocBase {
@@ -61,6 +62,17 @@ protected:
 		return _make_from_id(_gen_id());
 	}
 
+	static thread_local uint32_t thread_index;
+	static std::atomic<uint32_t> thread_count;
+
+	// Small number identifying the calling thread, assigned on first use.
+	_FORCE_INLINE_ static uint32_t _get_thread_index() {
+		if (unlikely(thread_index == 0xFFFFFFFF)) {
+			thread_index = thread_count.fetch_add(1, std::memory_order_relaxed);
+		}
+		return thread_index;
+	}
+
 public:
 	virtual ~RID_AllocBase() {}
 };
@@ -77,14 +89,8 @@ class RID_Alloc : public RID_AllocBase {
 
 	const char *description = nullptr;
 
-	SpinLock spin_lock;
-
 public:
 	RID make_rid(const T &p_value) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-
 		if (alloc_count == max_alloc) {
 			//allocate a new chunk
 			uint32_t chunk_count = alloc_count == 0 ? 0 : (max_alloc / elements_in_chunk);
@@ -126,24 +132,13 @@ public:
 		validator_chunks[free_chunk][free_element] = validator;
 		alloc_count++;
 
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
-
 		return _make_from_id(id);
 	}
 
 	_FORCE_INLINE_ T *getornull(const RID &p_rid) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-
 		uint64_t id = p_rid.get_id();
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
 		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
 			return nullptr;
 		}
 
@@ -152,32 +147,18 @@ public:
 
 		uint32_t validator = uint32_t(id >> 32);
 		if (unlikely(validator_chunks[idx_chunk][idx_element] != validator)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
 			return nullptr;
 		}
 
 		T *ptr = &chunks[idx_chunk][idx_element];
 
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
-
 		return ptr;
 	}
 
 	_FORCE_INLINE_ bool owns(const RID &p_rid) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-
 		uint64_t id = p_rid.get_id();
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
 		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
 			return false;
 		}
 
@@ -188,24 +169,13 @@ public:
 
 		bool owned = validator_chunks[idx_chunk][idx_element] == validator;
 
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
-
 		return owned;
 	}
 
 	_FORCE_INLINE_ void free(const RID &p_rid) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-
 		uint64_t id = p_rid.get_id();
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
 		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
 			ERR_FAIL();
 		}
 
@@ -214,9 +184,6 @@ public:
 
 		uint32_t validator = uint32_t(id >> 32);
 		if (unlikely(validator_chunks[idx_chunk][idx_element] != validator)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
 			ERR_FAIL();
 		}
 
@@ -225,10 +192,6 @@ public:
 
 		alloc_count--;
 		free_list_chunks[alloc_count / elements_in_chunk][alloc_count % elements_in_chunk] = idx;
-
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
 	}
 
 	_FORCE_INLINE_ uint32_t get_rid_count() const {
@@ -237,45 +200,27 @@ public:
 
 	_FORCE_INLINE_ T *get_ptr_by_index(uint32_t p_index) {
 		ERR_FAIL_INDEX_V(p_index, alloc_count, nullptr);
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
 		uint64_t idx = free_list_chunks[p_index / elements_in_chunk][p_index % elements_in_chunk];
 		T *ptr = &chunks[idx / elements_in_chunk][idx % elements_in_chunk];
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
 		return ptr;
 	}
 
 	_FORCE_INLINE_ RID get_rid_by_index(uint32_t p_index) {
 		ERR_FAIL_INDEX_V(p_index, alloc_count, RID());
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
 		uint64_t idx = free_list_chunks[p_index / elements_in_chunk][p_index % elements_in_chunk];
 		uint64_t validator = validator_chunks[idx / elements_in_chunk][idx % elements_in_chunk];
 
 		RID rid = _make_from_id((validator << 32) | idx);
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
 		return rid;
 	}
 
 	void get_owned_list(List<RID> *p_owned) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
 		for (size_t i = 0; i < max_alloc; i++) {
 			uint64_t validator = validator_chunks[i / elements_in_chunk][i % elements_in_chunk];
 			if (validator != 0xFFFFFFFF) {
 				p_owned->push_back(_make_from_id((validator << 32) | i));
 			}
 		}
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
 	}
 
 	void set_description(const char *p_descrption) {
@@ -321,6 +266,301 @@ public:
 	}
 };
 
+// Thread-safe variant. Lookups take no lock: chunks are never moved and a
+// slot is only valid while its validator matches the RID, so getornull() and
+// owns() are wait-free. Free slots are kept in a few lists picked by thread,
+// so threads allocating and freeing at the same time rarely share a lock.
+// Unlike the single-threaded version, indices are not kept dense, which
+// makes get_ptr_by_index() and get_rid_by_index() linear scans.
+template <class T>
+class RID_Alloc<T, true> : public RID_AllocBase {
+	enum {
+		FREE_LIST_COUNT = 8,
+		INVALID_VALIDATOR = 0xFFFFFFFF,
+	};
+
+	struct FreeList {
+		SpinLock lock;
+		uint32_t *indices = nullptr;
+		uint32_t count = 0;
+		uint32_t capacity = 0;
+	};
+
+	// Directories of chunks are replaced when they fill up, but old ones are
+	// kept until destruction since lookups may still be reading them.
+	std::atomic<T **> chunks = { nullptr };
+	std::atomic<std::atomic<uint32_t> **> validator_chunks = { nullptr };
+	List<void *> retired_directories;
+	uint32_t directory_size = 0;
+
+	uint32_t elements_in_chunk;
+	std::atomic<uint32_t> max_alloc = { 0 };
+	std::atomic<uint32_t> alloc_count = { 0 };
+
+	SpinLock grow_lock;
+	FreeList free_lists[FREE_LIST_COUNT];
+
+	const char *description = nullptr;
+
+	_FORCE_INLINE_ FreeList &_get_free_list() {
+		return free_lists[_get_thread_index() % FREE_LIST_COUNT];
+	}
+
+	static void _push_free(FreeList &p_list, uint32_t p_index) {
+		if (p_list.count == p_list.capacity) {
+			p_list.capacity = p_list.capacity ? p_list.capacity * 2 : 64;
+			p_list.indices = (uint32_t *)memrealloc(p_list.indices, sizeof(uint32_t) * p_list.capacity);
+		}
+		p_list.indices[p_list.count++] = p_index;
+	}
+
+	// Adds a chunk and gives all its slots to p_list, which must be locked.
+	void _grow(FreeList &p_list) {
+		grow_lock.lock();
+
+		uint32_t alloc_max = max_alloc.load(std::memory_order_relaxed);
+		uint32_t chunk_count = alloc_max / elements_in_chunk;
+
+		if (chunk_count == directory_size) {
+			uint32_t new_size = directory_size ? directory_size * 2 : 8;
+			T **old_chunks = chunks.load(std::memory_order_relaxed);
+			std::atomic<uint32_t> **old_validators = validator_chunks.load(std::memory_order_relaxed);
+
+			T **new_chunks = (T **)memalloc(sizeof(T *) * new_size);
+			std::atomic<uint32_t> **new_validators = (std::atomic<uint32_t> **)memalloc(sizeof(std::atomic<uint32_t> *) * new_size);
+			for (uint32_t i = 0; i < chunk_count; i++) {
+				new_chunks[i] = old_chunks[i];
+				new_validators[i] = old_validators[i];
+			}
+
+			chunks.store(new_chunks, std::memory_order_release);
+			validator_chunks.store(new_validators, std::memory_order_release);
+			if (old_chunks) {
+				retired_directories.push_back(old_chunks);
+				retired_directories.push_back(old_validators);
+			}
+			directory_size = new_size;
+		}
+
+		T *chunk = (T *)memalloc(sizeof(T) * elements_in_chunk); //but don't initialize
+		std::atomic<uint32_t> *validators = (std::atomic<uint32_t> *)memalloc(sizeof(std::atomic<uint32_t>) * elements_in_chunk);
+		for (uint32_t i = 0; i < elements_in_chunk; i++) {
+			memnew_placement(&validators[i], std::atomic<uint32_t>(INVALID_VALIDATOR));
+		}
+		chunks.load(std::memory_order_relaxed)[chunk_count] = chunk;
+		validator_chunks.load(std::memory_order_relaxed)[chunk_count] = validators;
+
+		// Publishes the new chunk to lookups.
+		max_alloc.store(alloc_max + elements_in_chunk, std::memory_order_release);
+
+		grow_lock.unlock();
+
+		for (uint32_t i = elements_in_chunk; i > 0; i--) {
+			_push_free(p_list, alloc_max + i - 1);
+		}
+	}
+
+	// Called with p_list locked and empty. Slots are freed to the list of the
+	// freeing thread, so before adding a chunk, take half of another list.
+	// Both locks are taken in list order, so two threads stealing from each
+	// other can't deadlock.
+	void _refill(FreeList &p_list) {
+		uint32_t list_index = &p_list - free_lists;
+		for (uint32_t i = 1; i < FREE_LIST_COUNT && p_list.count == 0; i++) {
+			uint32_t other_index = (list_index + i) % FREE_LIST_COUNT;
+			FreeList &other = free_lists[other_index];
+
+			p_list.lock.unlock();
+			if (other_index < list_index) {
+				other.lock.lock();
+				p_list.lock.lock();
+			} else {
+				p_list.lock.lock();
+				other.lock.lock();
+			}
+
+			uint32_t steal = (other.count + 1) / 2;
+			for (uint32_t j = 0; j < steal; j++) {
+				_push_free(p_list, other.indices[--other.count]);
+			}
+			other.lock.unlock();
+		}
+
+		if (p_list.count == 0) {
+			_grow(p_list);
+		}
+	}
+
+	_FORCE_INLINE_ std::atomic<uint32_t> *_get_validator(uint32_t p_index) {
+		if (unlikely(p_index >= max_alloc.load(std::memory_order_acquire))) {
+			return nullptr;
+		}
+		return &validator_chunks.load(std::memory_order_acquire)[p_index / elements_in_chunk][p_index % elements_in_chunk];
+	}
+
+	// Index of the p_index-th live slot, or -1.
+	int64_t _find_live_index(uint32_t p_index) {
+		uint32_t alloc_max = max_alloc.load(std::memory_order_acquire);
+		std::atomic<uint32_t> **validators = validator_chunks.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < alloc_max; i++) {
+			if (validators[i / elements_in_chunk][i % elements_in_chunk].load(std::memory_order_acquire) != INVALID_VALIDATOR) {
+				if (p_index == 0) {
+					return i;
+				}
+				p_index--;
+			}
+		}
+		return -1;
+	}
+
+public:
+	RID make_rid(const T &p_value) {
+		FreeList &list = _get_free_list();
+
+		list.lock.lock();
+		if (list.count == 0) {
+			_refill(list);
+		}
+		uint32_t free_index = list.indices[--list.count];
+		list.lock.unlock();
+
+		uint32_t free_chunk = free_index / elements_in_chunk;
+		uint32_t free_element = free_index % elements_in_chunk;
+
+		T *ptr = &chunks.load(std::memory_order_acquire)[free_chunk][free_element];
+		memnew_placement(ptr, T(p_value));
+
+		uint32_t validator = (uint32_t)(_gen_id() & 0x7FFFFFFF);
+		uint64_t id = validator;
+		id <<= 32;
+		id |= free_index;
+
+		// Publishes the constructed value to lookups.
+		validator_chunks.load(std::memory_order_acquire)[free_chunk][free_element].store(validator, std::memory_order_release);
+		alloc_count.fetch_add(1, std::memory_order_relaxed);
+
+		return _make_from_id(id);
+	}
+
+	_FORCE_INLINE_ T *getornull(const RID &p_rid) {
+		uint64_t id = p_rid.get_id();
+		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
+		std::atomic<uint32_t> *validator = _get_validator(idx);
+		if (unlikely(!validator || validator->load(std::memory_order_acquire) != uint32_t(id >> 32))) {
+			return nullptr;
+		}
+
+		return &chunks.load(std::memory_order_acquire)[idx / elements_in_chunk][idx % elements_in_chunk];
+	}
+
+	_FORCE_INLINE_ bool owns(const RID &p_rid) {
+		uint64_t id = p_rid.get_id();
+		std::atomic<uint32_t> *validator = _get_validator(uint32_t(id & 0xFFFFFFFF));
+		return validator && validator->load(std::memory_order_acquire) == uint32_t(id >> 32);
+	}
+
+	_FORCE_INLINE_ void free(const RID &p_rid) {
+		uint64_t id = p_rid.get_id();
+		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
+		std::atomic<uint32_t> *validator = _get_validator(idx);
+		ERR_FAIL_COND(!validator);
+
+		// Invalidate first, so lookups stop returning it and only one of
+		// several concurrent frees of the same RID succeeds.
+		uint32_t expected = uint32_t(id >> 32);
+		ERR_FAIL_COND(expected == INVALID_VALIDATOR || !validator->compare_exchange_strong(expected, INVALID_VALIDATOR, std::memory_order_acq_rel));
+
+		chunks.load(std::memory_order_acquire)[idx / elements_in_chunk][idx % elements_in_chunk].~T();
+		alloc_count.fetch_sub(1, std::memory_order_relaxed);
+
+		FreeList &list = _get_free_list();
+		list.lock.lock();
+		_push_free(list, idx);
+		list.lock.unlock();
+	}
+
+	_FORCE_INLINE_ uint32_t get_rid_count() const {
+		return alloc_count.load(std::memory_order_relaxed);
+	}
+
+	T *get_ptr_by_index(uint32_t p_index) {
+		ERR_FAIL_INDEX_V(p_index, get_rid_count(), nullptr);
+		int64_t idx = _find_live_index(p_index);
+		ERR_FAIL_COND_V(idx < 0, nullptr);
+		return &chunks.load(std::memory_order_acquire)[idx / elements_in_chunk][idx % elements_in_chunk];
+	}
+
+	RID get_rid_by_index(uint32_t p_index) {
+		ERR_FAIL_INDEX_V(p_index, get_rid_count(), RID());
+		int64_t idx = _find_live_index(p_index);
+		ERR_FAIL_COND_V(idx < 0, RID());
+		uint64_t validator = validator_chunks.load(std::memory_order_acquire)[idx / elements_in_chunk][idx % elements_in_chunk].load(std::memory_order_acquire);
+		return _make_from_id((validator << 32) | uint64_t(idx));
+	}
+
+	void get_owned_list(List<RID> *p_owned) {
+		uint32_t alloc_max = max_alloc.load(std::memory_order_acquire);
+		std::atomic<uint32_t> **validators = validator_chunks.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < alloc_max; i++) {
+			uint64_t validator = validators[i / elements_in_chunk][i % elements_in_chunk].load(std::memory_order_acquire);
+			if (validator != INVALID_VALIDATOR) {
+				p_owned->push_back(_make_from_id((validator << 32) | i));
+			}
+		}
+	}
+
+	void set_description(const char *p_descrption) {
+		description = p_descrption;
+	}
+
+	RID_Alloc(uint32_t p_target_chunk_byte_size = 4096) {
+		elements_in_chunk = sizeof(T) > p_target_chunk_byte_size ? 1 : (p_target_chunk_byte_size / sizeof(T));
+	}
+
+	~RID_Alloc() {
+		uint32_t alloc_max = max_alloc.load();
+		T **chunk_dir = chunks.load();
+		std::atomic<uint32_t> **validator_dir = validator_chunks.load();
+
+		if (alloc_count.load()) {
+			if (description) {
+				print_error("ERROR: " + itos(alloc_count.load()) + " RID allocations of type '" + description + "' were leaked at exit.");
+			} else {
+#ifdef NO_SAFE_CAST
+				print_error("ERROR: " + itos(alloc_count.load()) + " RID allocations of type 'unknown' were leaked at exit.");
+#else
+				print_error("ERROR: " + itos(alloc_count.load()) + " RID allocations of type '" + typeid(T).name() + "' were leaked at exit.");
+#endif
+			}
+
+			for (uint32_t i = 0; i < alloc_max; i++) {
+				if (validator_dir[i / elements_in_chunk][i % elements_in_chunk].load() != INVALID_VALIDATOR) {
+					chunk_dir[i / elements_in_chunk][i % elements_in_chunk].~T();
+				}
+			}
+		}
+
+		uint32_t chunk_count = alloc_max / elements_in_chunk;
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			memfree(chunk_dir[i]);
+			memfree(validator_dir[i]);
+		}
+
+		if (chunk_dir) {
+			memfree(chunk_dir);
+			memfree(validator_dir);
+		}
+		for (List<void *>::Element *E = retired_directories.front(); E; E = E->next()) {
+			memfree(E->get());
+		}
+		for (uint32_t i = 0; i < FREE_LIST_COUNT; i++) {
+			if (free_lists[i].indices) {
+				memfree(free_lists[i].indices);
+			}
+		}
+	}
+};
+
 template <class T, bool THREAD_SAFE = false>
 class RID_PtrOwner {
 	RID_Alloc<T *, THREAD_SAFE> alloc;
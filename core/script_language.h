@@ -290,6 +290,8 @@ public:
 	virtual String get_extension() const = 0;
 	virtual Error execute_file(const String &p_path) = 0;
 	virtual void finish() = 0;
+	// Called when a game starts, once autoload names are known and before any of them is loaded.
+	virtual void load_project_scripts() {}
 
 	/* EDITOR FUNCTIONS */
 	struct Warning {
@@ -39,42 +39,151 @@ StaticCString StaticCString::create(const char *p_ptr) {
 	return scs;
 }
 
-StringName::_Data *StringName::_table[STRING_TABLE_LEN];
+StringName::_Shard StringName::_shards[SHARD_COUNT];
 
 StringName _scs_create(const char *p_chr) {
 	return (p_chr[0] ? StringName(StaticCString::create(p_chr)) : StringName());
 }
 
 bool StringName::configured = false;
-Mutex StringName::mutex;
+
+bool StringName::_Data::matches(const char *p_name) const {
+	return cname ? strcmp(cname, p_name) == 0 : name == p_name;
+}
+
+bool StringName::_Data::matches(const CharType *p_name) const {
+	if (!cname) {
+		return name == p_name;
+	}
+
+	// Compare without building a String, static names are Latin-1.
+	const char *c = cname;
+	while (*c && CharType((uint8_t)*c) == *p_name) {
+		c++;
+		p_name++;
+	}
+	return *c == 0 && *p_name == 0;
+}
+
+bool StringName::_Data::matches(const String &p_name) const {
+	return cname ? p_name == cname : name == p_name;
+}
+
+template <class T>
+StringName::_Data *StringName::_find(const _Shard &p_shard, uint32_t p_hash, const T &p_name) {
+	_Data *data = p_shard.buckets[p_hash & p_shard.bucket_mask];
+
+	while (data) {
+		// compare hash first
+		if (data->hash == p_hash && data->matches(p_name)) {
+			return data;
+		}
+		data = data->next;
+	}
+
+	return nullptr;
+}
+
+void StringName::_insert(_Shard &p_shard, _Data *p_data) {
+	if (p_shard.count > p_shard.bucket_mask) {
+		// Keep chains short, double the buckets and rehash.
+		uint32_t new_mask = (p_shard.bucket_mask << 1) | 1;
+		_Data **new_buckets = memnew_arr(_Data *, new_mask + 1);
+		for (uint32_t i = 0; i <= new_mask; i++) {
+			new_buckets[i] = nullptr;
+		}
+
+		for (uint32_t i = 0; i <= p_shard.bucket_mask; i++) {
+			_Data *data = p_shard.buckets[i];
+			while (data) {
+				_Data *next = data->next;
+				uint32_t idx = data->hash & new_mask;
+				data->prev = nullptr;
+				data->next = new_buckets[idx];
+				if (new_buckets[idx]) {
+					new_buckets[idx]->prev = data;
+				}
+				new_buckets[idx] = data;
+				data = next;
+			}
+		}
+
+		memdelete_arr(p_shard.buckets);
+		p_shard.buckets = new_buckets;
+		p_shard.bucket_mask = new_mask;
+	}
+
+	uint32_t idx = p_data->hash & p_shard.bucket_mask;
+	p_data->prev = nullptr;
+	p_data->next = p_shard.buckets[idx];
+	if (p_shard.buckets[idx]) {
+		p_shard.buckets[idx]->prev = p_data;
+	}
+	p_shard.buckets[idx] = p_data;
+	p_shard.count++;
+}
+
+void StringName::_remove(_Shard &p_shard, _Data *p_data) {
+	if (p_data->prev) {
+		p_data->prev->next = p_data->next;
+	} else {
+		uint32_t idx = p_data->hash & p_shard.bucket_mask;
+		if (p_shard.buckets[idx] != p_data) {
+			ERR_PRINT("BUG!");
+		}
+		p_shard.buckets[idx] = p_data->next;
+	}
+
+	if (p_data->next) {
+		p_data->next->prev = p_data->prev;
+	}
+	p_shard.count--;
+}
 
 void StringName::setup() {
 	ERR_FAIL_COND(configured);
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
-		_table[i] = nullptr;
+	for (int i = 0; i < SHARD_COUNT; i++) {
+		_Shard &shard = _shards[i];
+		shard.buckets = memnew_arr(_Data *, SHARD_MIN_BUCKETS);
+		for (int j = 0; j < SHARD_MIN_BUCKETS; j++) {
+			shard.buckets[j] = nullptr;
+		}
+		shard.bucket_mask = SHARD_MIN_BUCKETS - 1;
+		shard.count = 0;
 	}
 	configured = true;
 }
 
 void StringName::cleanup() {
-	MutexLock lock(mutex);
-
 	int lost_strings = 0;
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
-		while (_table[i]) {
-			_Data *d = _table[i];
-			lost_strings++;
-			if (OS::get_singleton()->is_stdout_verbose()) {
-				if (d->cname) {
-					print_line("Orphan StringName: " + String(d->cname));
-				} else {
-					print_line("Orphan StringName: " + String(d->name));
+	for (int i = 0; i < SHARD_COUNT; i++) {
+		_Shard &shard = _shards[i];
+		MutexLock lock(shard.mutex);
+
+		for (uint32_t j = 0; j <= shard.bucket_mask; j++) {
+			while (shard.buckets[j]) {
+				_Data *d = shard.buckets[j];
+				// Static names are expected to live until now.
+				if (!d->is_static) {
+					lost_strings++;
+					if (OS::get_singleton()->is_stdout_verbose()) {
+						if (d->cname) {
+							print_line("Orphan StringName: " + String(d->cname));
+						} else {
+							print_line("Orphan StringName: " + String(d->name));
+						}
+					}
 				}
-			}
 
-			_table[i] = _table[i]->next;
-			memdelete(d);
+				shard.buckets[j] = shard.buckets[j]->next;
+				memdelete(d);
+			}
 		}
+
+		memdelete_arr(shard.buckets);
+		shard.buckets = nullptr;
+		shard.bucket_mask = 0;
+		shard.count = 0;
 	}
 	if (lost_strings) {
 		print_verbose("StringName: " + itos(lost_strings) + " unclaimed string names at exit.");
@@ -84,21 +193,11 @@ void StringName::cleanup() {
 void StringName::unref() {
 	ERR_FAIL_COND(!configured);
 
-	if (_data && _data->refcount.unref()) {
-		MutexLock lock(mutex);
-
-		if (_data->prev) {
-			_data->prev->next = _data->next;
-		} else {
-			if (_table[_data->idx] != _data) {
-				ERR_PRINT("BUG!");
-			}
-			_table[_data->idx] = _data->next;
-		}
+	if (_data && !_data->is_static && _data->refcount.unref()) {
+		_Shard &shard = _get_shard(_data->hash);
+		MutexLock lock(shard.mutex);
 
-		if (_data->next) {
-			_data->next->prev = _data->prev;
-		}
+		_remove(shard, _data);
 		memdelete(_data);
 	}
 
@@ -110,7 +209,7 @@ bool StringName::operator==(const String &p_name) const {
 		return (p_name.length() == 0);
 	}
 
-	return (_data->get_name() == p_name);
+	return _data->matches(p_name);
 }
 
 bool StringName::operator==(const char *p_name) const {
@@ -118,7 +217,7 @@ bool StringName::operator==(const char *p_name) const {
 		return (p_name[0] == 0);
 	}
 
-	return (_data->get_name() == p_name);
+	return _data->matches(p_name);
 }
 
 bool StringName::operator!=(const String &p_name) const {
@@ -138,7 +237,7 @@ void StringName::operator=(const StringName &p_name) {
 
 	unref();
 
-	if (p_name._data && p_name._data->refcount.ref()) {
+	if (p_name._data && _ref(p_name._data)) {
 		_data = p_name._data;
 	}
 }
@@ -148,7 +247,7 @@ StringName::StringName(const StringName &p_name) {
 
 	ERR_FAIL_COND(!configured);
 
-	if (p_name._data && p_name._data->refcount.ref()) {
+	if (p_name._data && _ref(p_name._data)) {
 		_data = p_name._data;
 	}
 }
@@ -162,24 +261,15 @@ StringName::StringName(const char *p_name) {
 		return; //empty, ignore
 	}
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = String::hash(p_name);
+	_Shard &shard = _get_shard(hash);
 
-	uint32_t idx = hash & STRING_TABLE_MASK;
+	MutexLock lock(shard.mutex);
 
-	_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
+	_data = _find(shard, hash, p_name);
 
 	if (_data) {
-		if (_data->refcount.ref()) {
+		if (_ref(_data)) {
 			// exists
 			return;
 		}
@@ -189,14 +279,8 @@ StringName::StringName(const char *p_name) {
 	_data->name = p_name;
 	_data->refcount.init();
 	_data->hash = hash;
-	_data->idx = idx;
 	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
+	_insert(shard, _data);
 }
 
 StringName::StringName(const StaticCString &p_static_string) {
@@ -206,24 +290,15 @@ StringName::StringName(const StaticCString &p_static_string) {
 
 	ERR_FAIL_COND(!p_static_string.ptr || !p_static_string.ptr[0]);
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = String::hash(p_static_string.ptr);
+	_Shard &shard = _get_shard(hash);
 
-	uint32_t idx = hash & STRING_TABLE_MASK;
+	MutexLock lock(shard.mutex);
 
-	_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_static_string.ptr) {
-			break;
-		}
-		_data = _data->next;
-	}
+	_data = _find(shard, hash, p_static_string.ptr);
 
 	if (_data) {
-		if (_data->refcount.ref()) {
+		if (_ref(_data)) {
 			// exists
 			return;
 		}
@@ -233,14 +308,9 @@ StringName::StringName(const StaticCString &p_static_string) {
 
 	_data->refcount.init();
 	_data->hash = hash;
-	_data->idx = idx;
 	_data->cname = p_static_string.ptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
+	_data->is_static = true;
+	_insert(shard, _data);
 }
 
 StringName::StringName(const String &p_name) {
@@ -252,22 +322,15 @@ StringName::StringName(const String &p_name) {
 		return;
 	}
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = p_name.hash();
-	uint32_t idx = hash & STRING_TABLE_MASK;
+	_Shard &shard = _get_shard(hash);
 
-	_data = _table[idx];
+	MutexLock lock(shard.mutex);
 
-	while (_data) {
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
+	_data = _find(shard, hash, p_name);
 
 	if (_data) {
-		if (_data->refcount.ref()) {
+		if (_ref(_data)) {
 			// exists
 			return;
 		}
@@ -277,14 +340,8 @@ StringName::StringName(const String &p_name) {
 	_data->name = p_name;
 	_data->refcount.init();
 	_data->hash = hash;
-	_data->idx = idx;
 	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
+	_insert(shard, _data);
 }
 
 StringName StringName::search(const char *p_name) {
@@ -295,22 +352,14 @@ StringName StringName::search(const char *p_name) {
 		return StringName();
 	}
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = String::hash(p_name);
-	uint32_t idx = hash & STRING_TABLE_MASK;
+	_Shard &shard = _get_shard(hash);
 
-	_Data *_data = _table[idx];
+	MutexLock lock(shard.mutex);
 
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
+	_Data *_data = _find(shard, hash, p_name);
 
-	if (_data && _data->refcount.ref()) {
+	if (_data && _ref(_data)) {
 		return StringName(_data);
 	}
 
@@ -325,23 +374,14 @@ StringName StringName::search(const CharType *p_name) {
 		return StringName();
 	}
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = String::hash(p_name);
+	_Shard &shard = _get_shard(hash);
 
-	uint32_t idx = hash & STRING_TABLE_MASK;
+	MutexLock lock(shard.mutex);
 
-	_Data *_data = _table[idx];
+	_Data *_data = _find(shard, hash, p_name);
 
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->get_name() == p_name) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
+	if (_data && _ref(_data)) {
 		return StringName(_data);
 	}
 
@@ -351,23 +391,14 @@ StringName StringName::search(const CharType *p_name) {
 StringName StringName::search(const String &p_name) {
 	ERR_FAIL_COND_V(p_name == "", StringName());
 
-	MutexLock lock(mutex);
-
 	uint32_t hash = p_name.hash();
+	_Shard &shard = _get_shard(hash);
 
-	uint32_t idx = hash & STRING_TABLE_MASK;
+	MutexLock lock(shard.mutex);
 
-	_Data *_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && p_name == _data->get_name()) {
-			break;
-		}
-		_data = _data->next;
-	}
+	_Data *_data = _find(shard, hash, p_name);
 
-	if (_data && _data->refcount.ref()) {
+	if (_data && _ref(_data)) {
 		return StringName(_data);
 	}
 
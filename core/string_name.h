@@ -42,10 +42,9 @@ struct StaticCString {
 
 class StringName {
 	enum {
-
-		STRING_TABLE_BITS = 12,
-		STRING_TABLE_LEN = 1 << STRING_TABLE_BITS,
-		STRING_TABLE_MASK = STRING_TABLE_LEN - 1
+		SHARD_BITS = 5,
+		SHARD_COUNT = 1 << SHARD_BITS,
+		SHARD_MIN_BUCKETS = 128,
 	};
 
 	struct _Data {
@@ -54,14 +53,43 @@ class StringName {
 		String name;
 
 		String get_name() const { return cname ? String(cname) : name; }
-		int idx = 0;
+		// Names from static C strings are never freed, so copies of them
+		// skip reference counting entirely.
+		bool is_static = false;
 		uint32_t hash = 0;
 		_Data *prev = nullptr;
 		_Data *next = nullptr;
 		_Data() {}
+
+		bool matches(const char *p_name) const;
+		bool matches(const CharType *p_name) const;
+		bool matches(const String &p_name) const;
 	};
 
-	static _Data *_table[STRING_TABLE_LEN];
+	// The table is split in shards picked by the upper bits of the hash, each
+	// with its own lock and a bucket array that grows with its name count, so
+	// threads interning different names rarely wait on each other.
+	struct _Shard {
+		Mutex mutex;
+		_Data **buckets = nullptr;
+		uint32_t bucket_mask = 0;
+		uint32_t count = 0;
+	};
+
+	static _Shard _shards[SHARD_COUNT];
+
+	_FORCE_INLINE_ static _Shard &_get_shard(uint32_t p_hash) {
+		return _shards[p_hash >> (32 - SHARD_BITS)];
+	}
+
+	_FORCE_INLINE_ static bool _ref(_Data *p_data) {
+		return p_data->is_static || p_data->refcount.ref();
+	}
+
+	template <class T>
+	static _Data *_find(const _Shard &p_shard, uint32_t p_hash, const T &p_name);
+	static void _insert(_Shard &p_shard, _Data *p_data);
+	static void _remove(_Shard &p_shard, _Data *p_data);
 
 	_Data *_data = nullptr;
 
@@ -74,7 +102,6 @@ class StringName {
 	friend void register_core_types();
 	friend void unregister_core_types();
 
-	static Mutex mutex;
 	static void setup();
 	static void cleanup();
 	static bool configured;
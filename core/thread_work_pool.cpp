@@ -32,28 +32,213 @@
 
 #include "core/os/os.h"
 
+ThreadWorkPool *ThreadWorkPool::singleton = nullptr;
+thread_local ThreadWorkPool::ThreadData *ThreadWorkPool::current_thread = nullptr;
+
+void ThreadWorkPool::JobQueue::push_back(Job *p_job) {
+	lock.lock();
+	uint32_t capacity = ring.size();
+	if (count == capacity) {
+		// Grow and unwrap the ring so head is at zero again.
+		uint32_t new_capacity = capacity ? capacity * 2 : 64;
+		LocalVector<Job *> new_ring;
+		new_ring.resize(new_capacity);
+		for (uint32_t i = 0; i < count; i++) {
+			new_ring[i] = ring[(head + i) & (capacity - 1)];
+		}
+		ring = new_ring;
+		head = 0;
+		capacity = new_capacity;
+	}
+	ring[(head + count) & (capacity - 1)] = p_job;
+	count++;
+	lock.unlock();
+}
+
+ThreadWorkPool::Job *ThreadWorkPool::JobQueue::pop_back() {
+	lock.lock();
+	Job *job = nullptr;
+	if (count > 0) {
+		count--;
+		job = ring[(head + count) & (ring.size() - 1)];
+	}
+	lock.unlock();
+	return job;
+}
+
+ThreadWorkPool::Job *ThreadWorkPool::JobQueue::pop_front() {
+	lock.lock();
+	Job *job = nullptr;
+	if (count > 0) {
+		job = ring[head];
+		head = (head + 1) & (ring.size() - 1);
+		count--;
+	}
+	lock.unlock();
+	return job;
+}
+
 void ThreadWorkPool::_thread_function(ThreadData *p_thread) {
-	while (true) {
-		p_thread->start.wait();
-		if (p_thread->exit.load()) {
-			break;
+	current_thread = p_thread;
+	ThreadWorkPool *pool = p_thread->pool;
+
+	while (!pool->exit.load()) {
+		Job *job = pool->_pop_job();
+		if (job) {
+			pool->_execute_job(job);
+			continue;
+		}
+
+		// Both counters are sequentially consistent: either this thread sees the
+		// queued job, or the pusher sees this thread sleeping and posts.
+		pool->sleeping_threads.fetch_add(1);
+		if (pool->queued_jobs.load() == 0 && !pool->exit.load()) {
+			pool->wake_semaphore.wait();
+		}
+		pool->sleeping_threads.fetch_sub(1);
+	}
+
+	current_thread = nullptr;
+}
+
+void ThreadWorkPool::_push_job(Job *p_job) {
+	if (current_thread && current_thread->pool == this) {
+		current_thread->queue.push_back(p_job);
+	} else {
+		global_queue.push_back(p_job);
+	}
+
+	queued_jobs.fetch_add(1);
+	if (sleeping_threads.load() > 0) {
+		wake_semaphore.post();
+	}
+}
+
+ThreadWorkPool::Job *ThreadWorkPool::_pop_job() {
+	if (queued_jobs.load() == 0) {
+		return nullptr;
+	}
+
+	Job *job = nullptr;
+	uint32_t start = 0;
+
+	if (current_thread && current_thread->pool == this) {
+		job = current_thread->queue.pop_back();
+		start = current_thread->index + 1;
+	}
+	if (!job) {
+		job = global_queue.pop_front();
+	}
+	for (uint32_t i = 0; !job && i < thread_count; i++) {
+		job = threads[(start + i) % thread_count].queue.pop_front();
+	}
+
+	if (job) {
+		queued_jobs.fetch_sub(1);
+	}
+	return job;
+}
+
+void ThreadWorkPool::_execute_job(Job *p_job) {
+	for (uint32_t i = p_job->from; i < p_job->to; i++) {
+		p_job->work->work(i);
+	}
+
+	p_job->lock.lock();
+	p_job->finished = true;
+	LocalVector<Job *> continuations = p_job->continuations;
+	p_job->continuations.reset();
+	p_job->lock.unlock();
+
+	for (uint32_t i = 0; i < continuations.size(); i++) {
+		if (continuations[i]->dependencies.fetch_sub(1) == 1) {
+			_push_job(continuations[i]);
 		}
-		p_thread->work->work();
-		p_thread->completed.post();
+	}
+
+	p_job->completed.store(true, std::memory_order_release);
+	_unref_job(p_job);
+}
+
+void ThreadWorkPool::_wait_for_completion(Job *p_job) {
+	while (!p_job->completed.load(std::memory_order_acquire)) {
+		Job *job = _pop_job();
+		if (job) {
+			_execute_job(job);
+		} else {
+			// The awaited job is running elsewhere or is blocked on a dependency.
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ThreadWorkPool::_unref_job(Job *p_job) {
+	if (p_job->refcount.unref()) {
+		if (p_job->owns_work) {
+			memdelete(p_job->work);
+		}
+		memdelete(p_job);
+	}
+}
+
+void ThreadWorkPool::add_dependency(Job *p_job, Job *p_dependency) {
+	ERR_FAIL_COND(!p_job || !p_dependency);
+	ERR_FAIL_COND_MSG(p_job->dependencies.load() == 0, "Dependencies must be added before the job is submitted.");
+
+	p_dependency->lock.lock();
+	if (!p_dependency->finished) {
+		p_job->dependencies.fetch_add(1);
+		p_dependency->continuations.push_back(p_job);
+	}
+	p_dependency->lock.unlock();
+}
+
+void ThreadWorkPool::submit_job(Job *p_job) {
+	ERR_FAIL_COND(!p_job);
+
+	if (p_job->dependencies.fetch_sub(1) == 1) {
+		_push_job(p_job);
 	}
 }
 
+bool ThreadWorkPool::is_job_completed(const Job *p_job) const {
+	ERR_FAIL_COND_V(!p_job, true);
+	return p_job->completed.load(std::memory_order_acquire);
+}
+
+void ThreadWorkPool::wait_for_job(Job *p_job) {
+	ERR_FAIL_COND(!p_job);
+
+	_wait_for_completion(p_job);
+	_unref_job(p_job);
+}
+
+void ThreadWorkPool::release_job(Job *p_job) {
+	ERR_FAIL_COND(!p_job);
+
+	_unref_job(p_job);
+}
+
 void ThreadWorkPool::init(int p_thread_count) {
 	ERR_FAIL_COND(threads != nullptr);
 	if (p_thread_count < 0) {
-		p_thread_count = OS::get_singleton()->get_processor_count();
+		// The thread calling do_work() takes part in it, so leave it a core.
+		p_thread_count = MAX(1, OS::get_singleton()->get_processor_count() - 1);
 	}
 
+#ifdef NO_THREADS
+	p_thread_count = 0;
+#endif
+
+	exit.store(false);
 	thread_count = p_thread_count;
 	threads = memnew_arr(ThreadData, thread_count);
 
 	for (uint32_t i = 0; i < thread_count; i++) {
-		threads[i].exit.store(false);
+		threads[i].pool = this;
+		threads[i].index = i;
+	}
+	for (uint32_t i = 0; i < thread_count; i++) {
 		threads[i].thread = memnew(std::thread(ThreadWorkPool::_thread_function, &threads[i]));
 	}
 }
@@ -63,9 +248,18 @@ void ThreadWorkPool::finish() {
 		return;
 	}
 
+	// Drain what is still queued so no handle is left dangling.
+	while (true) {
+		Job *job = _pop_job();
+		if (!job) {
+			break;
+		}
+		_execute_job(job);
+	}
+
+	exit.store(true);
 	for (uint32_t i = 0; i < thread_count; i++) {
-		threads[i].exit.store(true);
-		threads[i].start.post();
+		wake_semaphore.post();
 	}
 	for (uint32_t i = 0; i < thread_count; i++) {
 		threads[i].thread->join();
@@ -74,8 +268,23 @@ void ThreadWorkPool::finish() {
 
 	memdelete_arr(threads);
 	threads = nullptr;
+	thread_count = 0;
+}
+
+ThreadWorkPool::ThreadWorkPool() {
+	queued_jobs.store(0);
+	sleeping_threads.store(0);
+	exit.store(false);
+
+	if (!singleton) {
+		singleton = this;
+	}
 }
 
 ThreadWorkPool::~ThreadWorkPool() {
 	finish();
+
+	if (singleton == this) {
+		singleton = nullptr;
+	}
 }
@@ -31,80 +31,185 @@
 #ifndef THREAD_WORK_POOL_H
 #define THREAD_WORK_POOL_H
 
+#include "core/local_vector.h"
 #include "core/os/memory.h"
 #include "core/os/semaphore.h"
+#include "core/safe_refcount.h"
+#include "core/spin_lock.h"
 
 #include <atomic>
 #include <thread>
 
-class ThreadWorkPool {
-	std::atomic<uint32_t> index;
+// Persistent work-stealing scheduler.
+//
+// Every worker owns a deque: it pushes and pops jobs at the back (LIFO, cache
+// friendly) while idle workers steal from the front of the other deques.
+// Threads that are not part of the pool push into a shared injection queue.
+// Waiting on a job never blocks the thread: it keeps executing queued jobs
+// until the awaited one completes, so jobs may submit and wait on other jobs
+// (nested parallel-for) without deadlocking the pool.
 
+class ThreadWorkPool {
 	struct BaseWork {
-		std::atomic<uint32_t> *index;
-		uint32_t max_elements;
-		virtual void work() = 0;
+		virtual void work(uint32_t p_index) = 0;
 		virtual ~BaseWork() = default;
 	};
 
 	template <class C, class M, class U>
-	struct Work : public BaseWork {
+	struct IndexedWork : public BaseWork {
+		C *instance;
+		M method;
+		U userdata;
+		virtual void work(uint32_t p_index) {
+			(instance->*method)(p_index, userdata);
+		}
+	};
+
+	template <class C, class M, class U>
+	struct SingleWork : public BaseWork {
 		C *instance;
 		M method;
 		U userdata;
-		virtual void work() {
-			while (true) {
-				uint32_t work_index = index->fetch_add(1, std::memory_order_relaxed);
-				if (work_index >= max_elements) {
-					break;
-				}
-				(instance->*method)(work_index, userdata);
-			}
+		virtual void work(uint32_t p_index) {
+			(instance->*method)(userdata);
 		}
 	};
 
+public:
+	// Opaque job handle, see create_job().
+	struct Job {
+	private:
+		friend class ThreadWorkPool;
+
+		BaseWork *work = nullptr;
+		bool owns_work = false;
+		uint32_t from = 0;
+		uint32_t to = 0;
+
+		SafeRefCount refcount; // One for the handle owner, one for the scheduler.
+		std::atomic<uint32_t> dependencies; // Unfinished dependencies, plus one until submitted.
+		std::atomic<bool> completed;
+
+		SpinLock lock; // Protects finished and continuations.
+		bool finished = false;
+		LocalVector<Job *> continuations;
+
+		Job() {
+			refcount.init(2);
+			dependencies.store(1);
+			completed.store(false);
+		}
+	};
+
+private:
+	struct JobQueue {
+		SpinLock lock;
+		LocalVector<Job *> ring;
+		uint32_t head = 0;
+		uint32_t count = 0;
+
+		void push_back(Job *p_job);
+		Job *pop_back();
+		Job *pop_front();
+	};
+
 	struct ThreadData {
-		std::thread *thread;
-		Semaphore start;
-		Semaphore completed;
-		std::atomic<bool> exit;
-		BaseWork *work;
+		ThreadWorkPool *pool = nullptr;
+		uint32_t index = 0;
+		std::thread *thread = nullptr;
+		JobQueue queue;
 	};
 
 	ThreadData *threads = nullptr;
 	uint32_t thread_count = 0;
 
+	JobQueue global_queue;
+	Semaphore wake_semaphore;
+	std::atomic<uint32_t> queued_jobs;
+	std::atomic<uint32_t> sleeping_threads;
+	std::atomic<bool> exit;
+
+	static ThreadWorkPool *singleton;
+	static thread_local ThreadData *current_thread;
+
 	static void _thread_function(ThreadData *p_thread);
 
-public:
-	template <class C, class M, class U>
-	void do_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata) {
-		ERR_FAIL_COND(!threads); //never initialized
+	void _push_job(Job *p_job);
+	Job *_pop_job();
+	void _execute_job(Job *p_job);
+	void _wait_for_completion(Job *p_job);
+	void _unref_job(Job *p_job);
 
-		index.store(0);
+public:
+	static ThreadWorkPool *get_singleton() { return singleton; }
 
-		Work<C, M, U> *w = memnew((Work<C, M, U>));
+	// Creates a job that will call (p_instance->*p_method)(p_userdata) once submitted.
+	// Dependencies must be added before submit_job(). The returned handle must be
+	// given back with either wait_for_job() or release_job().
+	template <class C, class M, class U>
+	Job *create_job(C *p_instance, M p_method, U p_userdata) {
+		SingleWork<C, M, U> *w = memnew((SingleWork<C, M, U>));
 		w->instance = p_instance;
-		w->userdata = p_userdata;
 		w->method = p_method;
-		w->index = &index;
-		w->max_elements = p_elements;
+		w->userdata = p_userdata;
 
-		for (uint32_t i = 0; i < thread_count; i++) {
-			threads[i].work = w;
-			threads[i].start.post();
+		Job *job = memnew(Job);
+		job->work = w;
+		job->owns_work = true;
+		job->to = 1;
+		return job;
+	}
+
+	// p_job will only start once p_dependency has completed (a continuation of it).
+	void add_dependency(Job *p_job, Job *p_dependency);
+	void submit_job(Job *p_job);
+	bool is_job_completed(const Job *p_job) const;
+	// Executes other jobs until p_job completes, then releases the handle.
+	void wait_for_job(Job *p_job);
+	// Gives up the handle without waiting; the job is freed once it has run.
+	void release_job(Job *p_job);
+
+	// Calls (p_instance->*p_method)(index, p_userdata) for every index in [0, p_elements)
+	// and returns once all calls are done. The calling thread takes part in the work,
+	// and it is safe to call from inside another job.
+	template <class C, class M, class U>
+	void do_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata) {
+		if (p_elements == 0) {
+			return;
 		}
-		for (uint32_t i = 0; i < thread_count; i++) {
-			threads[i].completed.wait();
-			threads[i].work = nullptr;
+
+		IndexedWork<C, M, U> w;
+		w.instance = p_instance;
+		w.method = p_method;
+		w.userdata = p_userdata;
+
+		// A few batches per thread, so stealing can even out uneven elements.
+		uint32_t batch_count = MIN(p_elements, (thread_count + 1) * 4);
+		uint32_t batch_size = (p_elements + batch_count - 1) / batch_count;
+		batch_count = (p_elements + batch_size - 1) / batch_size;
+
+		Job **jobs = (Job **)alloca(sizeof(Job *) * batch_count);
+		for (uint32_t i = 0; i < batch_count; i++) {
+			Job *job = memnew(Job);
+			job->work = &w;
+			job->from = i * batch_size;
+			job->to = MIN(p_elements, job->from + batch_size);
+			jobs[i] = job;
+			submit_job(job);
 		}
 
-		memdelete(w);
+		for (uint32_t i = 0; i < batch_count; i++) {
+			wait_for_job(jobs[i]);
+		}
 	}
 
+	_FORCE_INLINE_ uint32_t get_thread_count() const { return thread_count; }
+
 	void init(int p_thread_count = -1);
 	void finish();
+
+	ThreadWorkPool();
 	~ThreadWorkPool();
 };
 
-#endif // THREAD_POOL_H
+#endif // THREAD_WORK_POOL_H
@@ -120,6 +120,7 @@ public:
 
 private:
 	friend struct _VariantCall;
+	friend struct _VariantOp;
 	// Variant takes 20 bytes when real_t is float, and 36 if double
 	// it only allocates extra memory for aabb/matrix.
 
@@ -401,6 +402,11 @@ public:
 
 	static String get_operator_name(Operator p_op);
 	static void evaluate(const Operator &p_op, const Variant &p_a, const Variant &p_b, Variant &r_ret, bool &r_valid);
+
+	// Evaluates an operator on operands of known types without checking them. Null if the
+	// combination has no such evaluator, in which case evaluate() must be used.
+	typedef void (*ValidatedOperatorEvaluator)(const Variant &p_a, const Variant &p_b, Variant &r_ret);
+	static ValidatedOperatorEvaluator get_validated_operator_evaluator(Operator p_op, Type p_type_a, Type p_type_b);
 	static _FORCE_INLINE_ Variant evaluate(const Operator &p_op, const Variant &p_a, const Variant &p_b) {
 		bool valid = true;
 		Variant res;
@@ -430,6 +436,11 @@ public:
 	static Vector<StringName> get_method_argument_names(Variant::Type p_type, const StringName &p_method);
 	static bool is_method_const(Variant::Type p_type, const StringName &p_method);
 
+	// Builtin methods can be resolved once and then called by index, skipping the name lookup.
+	// Indices are stable for the lifetime of the engine, -1 means the type has no such method.
+	static int get_builtin_method_index(Variant::Type p_type, const StringName &p_method);
+	void call_builtin_method(int p_index, const Variant **p_args, int p_argcount, Variant *r_ret, Callable::CallError &r_error);
+
 	void set_named(const StringName &p_index, const Variant &p_value, bool *r_valid = nullptr);
 	Variant get_named(const StringName &p_index, bool *r_valid = nullptr) const;
 
@@ -441,6 +452,13 @@ public:
 	bool iter_next(Variant &r_iter, bool &r_valid) const;
 	Variant iter_get(const Variant &r_iter, bool &r_valid) const;
 
+	// The array held by a packed array Variant, for callers that already checked
+	// that the type matches T. It is shared with every copy of this Variant.
+	template <class T>
+	_FORCE_INLINE_ Vector<T> *get_packed_array_ptr() const {
+		return PackedArrayRef<T>::get_array_ptr(_data.packed_array);
+	}
+
 	void get_property_list(List<PropertyInfo> *p_list) const;
 
 	//argsVariant call()
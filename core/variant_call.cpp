@@ -35,6 +35,7 @@
 #include "core/crypto/crypto_core.h"
 #include "core/debugger/engine_debugger.h"
 #include "core/io/compression.h"
+#include "core/local_vector.h"
 #include "core/object.h"
 #include "core/os/os.h"
 
@@ -124,8 +125,99 @@ struct _VariantCall {
 		}
 	};
 
+	// Method and constant names are fixed once registration is done, so each type gets a
+	// table indexed by the precomputed StringName hash. It is grown until every name has
+	// its own slot, linear probing only kicks in for names that still collide.
+	struct NameIndex {
+		enum {
+			MAX_GROWTH = 4
+		};
+
+		struct Slot {
+			StringName name;
+			int index = -1;
+		};
+
+		LocalVector<Slot> slots;
+		uint32_t mask = 0;
+
+		static bool _is_collision_free(const LocalVector<StringName> &p_names, uint32_t p_mask) {
+			LocalVector<bool> used;
+			used.resize(p_mask + 1);
+			for (uint32_t i = 0; i <= p_mask; i++) {
+				used[i] = false;
+			}
+			for (uint32_t i = 0; i < p_names.size(); i++) {
+				uint32_t pos = p_names[i].hash() & p_mask;
+				if (used[pos]) {
+					return false;
+				}
+				used[pos] = true;
+			}
+			return true;
+		}
+
+		void build(const LocalVector<StringName> &p_names) {
+			slots.clear();
+			mask = 0;
+			if (p_names.size() == 0) {
+				return;
+			}
+
+			uint32_t capacity = next_power_of_2(p_names.size() * 2);
+			for (int i = 0; i < MAX_GROWTH && !_is_collision_free(p_names, capacity - 1); i++) {
+				capacity <<= 1;
+			}
+
+			mask = capacity - 1;
+			slots.resize(capacity);
+			for (uint32_t i = 0; i < p_names.size(); i++) {
+				uint32_t pos = p_names[i].hash() & mask;
+				while (slots[pos].index >= 0) {
+					pos = (pos + 1) & mask;
+				}
+				slots[pos].name = p_names[i];
+				slots[pos].index = i;
+			}
+		}
+
+		_FORCE_INLINE_ int find(const StringName &p_name) const {
+			if (unlikely(slots.size() == 0)) {
+				return -1;
+			}
+			uint32_t pos = p_name.hash() & mask;
+			while (true) {
+				const Slot &slot = slots[pos];
+				if (slot.index < 0) {
+					return -1;
+				}
+				if (slot.name == p_name) {
+					return slot.index;
+				}
+				pos = (pos + 1) & mask;
+			}
+		}
+	};
+
+	// Only used while registering, before the indices are built.
+	static int _find_registered_name(const LocalVector<StringName> &p_names, const StringName &p_name) {
+		for (uint32_t i = 0; i < p_names.size(); i++) {
+			if (p_names[i] == p_name) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
 	struct TypeFunc {
-		Map<StringName, FuncData> functions;
+		LocalVector<StringName> names;
+		LocalVector<FuncData> functions;
+		NameIndex index;
+
+		_FORCE_INLINE_ FuncData *get_function(const StringName &p_name) {
+			int i = index.find(p_name);
+			return i >= 0 ? &functions[i] : nullptr;
+		}
 	};
 
 	static TypeFunc *type_funcs;
@@ -144,7 +236,9 @@ struct _VariantCall {
 
 	static void make_func_return_variant(Variant::Type p_type, const StringName &p_name) {
 #ifdef DEBUG_ENABLED
-		type_funcs[p_type].functions[p_name].returns = true;
+		int index = _find_registered_name(type_funcs[p_type].names, p_name);
+		ERR_FAIL_COND(index < 0);
+		type_funcs[p_type].functions[index].returns = true;
 #endif
 	}
 
@@ -207,7 +301,14 @@ struct _VariantCall {
 	end:
 
 		funcdata.arg_count = funcdata.arg_types.size();
-		type_funcs[p_type].functions[p_name] = funcdata;
+		TypeFunc &tf = type_funcs[p_type];
+		int index = _find_registered_name(tf.names, p_name);
+		if (index >= 0) {
+			tf.functions[index] = funcdata;
+		} else {
+			tf.names.push_back(p_name);
+			tf.functions.push_back(funcdata);
+		}
 	}
 
 #define VCALL_LOCALMEM0(m_type, m_method) \
@@ -1169,30 +1270,44 @@ struct _VariantCall {
 	}
 
 	struct ConstantData {
-		Map<StringName, int> value;
-#ifdef DEBUG_ENABLED
-		List<StringName> value_ordered;
-#endif
-		Map<StringName, Variant> variant_value;
-#ifdef DEBUG_ENABLED
-		List<StringName> variant_value_ordered;
-#endif
+		LocalVector<StringName> value_names;
+		LocalVector<int> value;
+		NameIndex value_index;
+		LocalVector<StringName> variant_value_names;
+		LocalVector<Variant> variant_value;
+		NameIndex variant_value_index;
 	};
 
 	static ConstantData *constant_data;
 
 	static void add_constant(int p_type, StringName p_constant_name, int p_constant_value) {
-		constant_data[p_type].value[p_constant_name] = p_constant_value;
-#ifdef DEBUG_ENABLED
-		constant_data[p_type].value_ordered.push_back(p_constant_name);
-#endif
+		ConstantData &cd = constant_data[p_type];
+		int index = _find_registered_name(cd.value_names, p_constant_name);
+		if (index >= 0) {
+			cd.value[index] = p_constant_value;
+		} else {
+			cd.value_names.push_back(p_constant_name);
+			cd.value.push_back(p_constant_value);
+		}
 	}
 
 	static void add_variant_constant(int p_type, StringName p_constant_name, const Variant &p_constant_value) {
-		constant_data[p_type].variant_value[p_constant_name] = p_constant_value;
-#ifdef DEBUG_ENABLED
-		constant_data[p_type].variant_value_ordered.push_back(p_constant_name);
-#endif
+		ConstantData &cd = constant_data[p_type];
+		int index = _find_registered_name(cd.variant_value_names, p_constant_name);
+		if (index >= 0) {
+			cd.variant_value[index] = p_constant_value;
+		} else {
+			cd.variant_value_names.push_back(p_constant_name);
+			cd.variant_value.push_back(p_constant_value);
+		}
+	}
+
+	static void build_indices() {
+		for (int i = 0; i < Variant::VARIANT_MAX; i++) {
+			type_funcs[i].index.build(type_funcs[i].names);
+			constant_data[i].value_index.build(constant_data[i].value_names);
+			constant_data[i].variant_value_index.build(constant_data[i].variant_value_names);
+		}
 	}
 };
 
@@ -1230,11 +1345,10 @@ void Variant::call_ptr(const StringName &p_method, const Variant **p_args, int p
 	} else {
 		r_error.error = Callable::CallError::CALL_OK;
 
-		Map<StringName, _VariantCall::FuncData>::Element *E = _VariantCall::type_funcs[type].functions.find(p_method);
+		_VariantCall::FuncData *funcdata = _VariantCall::type_funcs[type].get_function(p_method);
 
-		if (E) {
-			_VariantCall::FuncData &funcdata = E->get();
-			funcdata.call(ret, *this, p_args, p_argcount, r_error);
+		if (funcdata) {
+			funcdata->call(ret, *this, p_args, p_argcount, r_error);
 
 		} else {
 			//handle vararg functions manually
@@ -1484,76 +1598,87 @@ bool Variant::has_method(const StringName &p_method) const {
 	}
 
 	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[type];
-	return tf.functions.has(p_method);
+	return tf.index.find(p_method) >= 0;
 }
 
-Vector<Variant::Type> Variant::get_method_argument_types(Variant::Type p_type, const StringName &p_method) {
-	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[p_type];
+int Variant::get_builtin_method_index(Variant::Type p_type, const StringName &p_method) {
+	ERR_FAIL_INDEX_V(p_type, VARIANT_MAX, -1);
+	return _VariantCall::type_funcs[p_type].index.find(p_method);
+}
+
+void Variant::call_builtin_method(int p_index, const Variant **p_args, int p_argcount, Variant *r_ret, Callable::CallError &r_error) {
+	_VariantCall::TypeFunc &tf = _VariantCall::type_funcs[type];
+	if (unlikely(p_index < 0 || p_index >= (int)tf.functions.size())) {
+		r_error.error = Callable::CallError::CALL_ERROR_INVALID_METHOD;
+		ERR_FAIL_MSG("Invalid builtin method index " + itos(p_index) + " for type '" + get_type_name(type) + "'.");
+	}
+
+	r_error.error = Callable::CallError::CALL_OK;
+	Variant ret;
+	tf.functions[p_index].call(ret, *this, p_args, p_argcount, r_error);
 
-	const Map<StringName, _VariantCall::FuncData>::Element *E = tf.functions.find(p_method);
-	if (!E) {
+	if (r_error.error == Callable::CallError::CALL_OK && r_ret) {
+		*r_ret = ret;
+	}
+}
+
+Vector<Variant::Type> Variant::get_method_argument_types(Variant::Type p_type, const StringName &p_method) {
+	const _VariantCall::FuncData *fd = _VariantCall::type_funcs[p_type].get_function(p_method);
+	if (!fd) {
 		return Vector<Variant::Type>();
 	}
 
-	return E->get().arg_types;
+	return fd->arg_types;
 }
 
 bool Variant::is_method_const(Variant::Type p_type, const StringName &p_method) {
-	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[p_type];
-
-	const Map<StringName, _VariantCall::FuncData>::Element *E = tf.functions.find(p_method);
-	if (!E) {
+	const _VariantCall::FuncData *fd = _VariantCall::type_funcs[p_type].get_function(p_method);
+	if (!fd) {
 		return false;
 	}
 
-	return E->get()._const;
+	return fd->_const;
 }
 
 Vector<StringName> Variant::get_method_argument_names(Variant::Type p_type, const StringName &p_method) {
-	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[p_type];
-
-	const Map<StringName, _VariantCall::FuncData>::Element *E = tf.functions.find(p_method);
-	if (!E) {
+	const _VariantCall::FuncData *fd = _VariantCall::type_funcs[p_type].get_function(p_method);
+	if (!fd) {
 		return Vector<StringName>();
 	}
 
-	return E->get().arg_names;
+	return fd->arg_names;
 }
 
 Variant::Type Variant::get_method_return_type(Variant::Type p_type, const StringName &p_method, bool *r_has_return) {
-	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[p_type];
-
-	const Map<StringName, _VariantCall::FuncData>::Element *E = tf.functions.find(p_method);
-	if (!E) {
+	const _VariantCall::FuncData *fd = _VariantCall::type_funcs[p_type].get_function(p_method);
+	if (!fd) {
 		return Variant::NIL;
 	}
 
 	if (r_has_return) {
-		*r_has_return = E->get().returns;
+		*r_has_return = fd->returns;
 	}
 
-	return E->get().return_type;
+	return fd->return_type;
 }
 
 Vector<Variant> Variant::get_method_default_arguments(Variant::Type p_type, const StringName &p_method) {
-	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[p_type];
-
-	const Map<StringName, _VariantCall::FuncData>::Element *E = tf.functions.find(p_method);
-	if (!E) {
+	const _VariantCall::FuncData *fd = _VariantCall::type_funcs[p_type].get_function(p_method);
+	if (!fd) {
 		return Vector<Variant>();
 	}
 
-	return E->get().default_args;
+	return fd->default_args;
 }
 
 void Variant::get_method_list(List<MethodInfo> *p_list) const {
 	const _VariantCall::TypeFunc &tf = _VariantCall::type_funcs[type];
 
-	for (const Map<StringName, _VariantCall::FuncData>::Element *E = tf.functions.front(); E; E = E->next()) {
-		const _VariantCall::FuncData &fd = E->get();
+	for (uint32_t i = 0; i < tf.functions.size(); i++) {
+		const _VariantCall::FuncData &fd = tf.functions[i];
 
 		MethodInfo mi;
-		mi.name = E->key();
+		mi.name = tf.names[i];
 
 		if (fd._const) {
 			mi.flags |= METHOD_FLAG_CONST;
@@ -1647,31 +1772,21 @@ void Variant::get_constructor_list(Variant::Type p_type, List<MethodInfo> *p_lis
 void Variant::get_constants_for_type(Variant::Type p_type, List<StringName> *p_constants) {
 	ERR_FAIL_INDEX(p_type, Variant::VARIANT_MAX);
 
-	_VariantCall::ConstantData &cd = _VariantCall::constant_data[p_type];
+	const _VariantCall::ConstantData &cd = _VariantCall::constant_data[p_type];
 
-#ifdef DEBUG_ENABLED
-	for (List<StringName>::Element *E = cd.value_ordered.front(); E; E = E->next()) {
-		p_constants->push_back(E->get());
-#else
-	for (Map<StringName, int>::Element *E = cd.value.front(); E; E = E->next()) {
-		p_constants->push_back(E->key());
-#endif
+	for (uint32_t i = 0; i < cd.value_names.size(); i++) {
+		p_constants->push_back(cd.value_names[i]);
 	}
 
-#ifdef DEBUG_ENABLED
-	for (List<StringName>::Element *E = cd.variant_value_ordered.front(); E; E = E->next()) {
-		p_constants->push_back(E->get());
-#else
-	for (Map<StringName, Variant>::Element *E = cd.variant_value.front(); E; E = E->next()) {
-		p_constants->push_back(E->key());
-#endif
+	for (uint32_t i = 0; i < cd.variant_value_names.size(); i++) {
+		p_constants->push_back(cd.variant_value_names[i]);
 	}
 }
 
 bool Variant::has_constant(Variant::Type p_type, const StringName &p_value) {
 	ERR_FAIL_INDEX_V(p_type, Variant::VARIANT_MAX, false);
-	_VariantCall::ConstantData &cd = _VariantCall::constant_data[p_type];
-	return cd.value.has(p_value) || cd.variant_value.has(p_value);
+	const _VariantCall::ConstantData &cd = _VariantCall::constant_data[p_type];
+	return cd.value_index.find(p_value) >= 0 || cd.variant_value_index.find(p_value) >= 0;
 }
 
 Variant Variant::get_constant_value(Variant::Type p_type, const StringName &p_value, bool *r_valid) {
@@ -1680,16 +1795,16 @@ Variant Variant::get_constant_value(Variant::Type p_type, const StringName &p_va
 	}
 
 	ERR_FAIL_INDEX_V(p_type, Variant::VARIANT_MAX, 0);
-	_VariantCall::ConstantData &cd = _VariantCall::constant_data[p_type];
+	const _VariantCall::ConstantData &cd = _VariantCall::constant_data[p_type];
 
-	Map<StringName, int>::Element *E = cd.value.find(p_value);
-	if (!E) {
-		Map<StringName, Variant>::Element *F = cd.variant_value.find(p_value);
-		if (F) {
+	int index = cd.value_index.find(p_value);
+	if (index < 0) {
+		int variant_index = cd.variant_value_index.find(p_value);
+		if (variant_index >= 0) {
 			if (r_valid) {
 				*r_valid = true;
 			}
-			return F->get();
+			return cd.variant_value[variant_index];
 		} else {
 			return -1;
 		}
@@ -1698,7 +1813,7 @@ Variant Variant::get_constant_value(Variant::Type p_type, const StringName &p_va
 		*r_valid = true;
 	}
 
-	return E->get();
+	return cd.value[index];
 }
 
 void register_variant_methods() {
@@ -2359,6 +2474,8 @@ void register_variant_methods() {
 	_VariantCall::add_variant_constant(Variant::PLANE, "PLANE_XY", Plane(Vector3(0, 0, 1), 0));
 
 	_VariantCall::add_variant_constant(Variant::QUAT, "IDENTITY", Quat(0, 0, 0, 1));
+
+	_VariantCall::build_indices();
 }
 
 void unregister_variant_methods() {
@@ -1417,6 +1417,169 @@ void Variant::evaluate(const Operator &p_op, const Variant &p_a,
 	}
 }
 
+// Evaluators handed out by Variant::get_validated_operator_evaluator(). The operand types
+// are known, so they read the stored values directly. Each one uses the same expression as
+// the matching case in evaluate(), and only combinations that can't fail are registered.
+struct _VariantOp {
+	template <class T>
+	struct Tag {};
+
+	template <class T>
+	static _FORCE_INLINE_ const T &get_value(const Variant &p_v, Tag<T>) {
+		return *reinterpret_cast<const T *>(p_v._data._mem);
+	}
+	static _FORCE_INLINE_ const int64_t &get_value(const Variant &p_v, Tag<int64_t>) {
+		return p_v._data._int;
+	}
+	static _FORCE_INLINE_ const double &get_value(const Variant &p_v, Tag<double>) {
+		return p_v._data._float;
+	}
+
+	template <class T>
+	static _FORCE_INLINE_ const T &get(const Variant &p_v) {
+		return get_value(p_v, Tag<T>());
+	}
+
+#define VARIANT_OP_BINARY(m_name, m_op)                                          \
+	template <class A, class B>                                                  \
+	static void m_name(const Variant &p_a, const Variant &p_b, Variant &r_ret) { \
+		r_ret = get<A>(p_a) m_op get<B>(p_b);                                    \
+	}
+
+	VARIANT_OP_BINARY(equal, ==)
+	VARIANT_OP_BINARY(not_equal, !=)
+	VARIANT_OP_BINARY(less, <)
+	VARIANT_OP_BINARY(less_equal, <=)
+	VARIANT_OP_BINARY(greater, >)
+	VARIANT_OP_BINARY(greater_equal, >=)
+	VARIANT_OP_BINARY(add, +)
+	VARIANT_OP_BINARY(subtract, -)
+	VARIANT_OP_BINARY(multiply, *)
+	VARIANT_OP_BINARY(divide, /)
+	VARIANT_OP_BINARY(bit_and, &)
+	VARIANT_OP_BINARY(bit_or, |)
+	VARIANT_OP_BINARY(bit_xor, ^)
+
+#undef VARIANT_OP_BINARY
+
+	// Vectors implement > and >= by swapping the operands of < and <=.
+	template <class A>
+	static void greater_swapped(const Variant &p_a, const Variant &p_b, Variant &r_ret) {
+		r_ret = get<A>(p_b) < get<A>(p_a);
+	}
+
+	template <class A>
+	static void greater_equal_swapped(const Variant &p_a, const Variant &p_b, Variant &r_ret) {
+		r_ret = get<A>(p_b) <= get<A>(p_a);
+	}
+
+	template <class A>
+	static void negate(const Variant &p_a, const Variant &p_b, Variant &r_ret) {
+		r_ret = -get<A>(p_a);
+	}
+
+	template <class A>
+	static void positive(const Variant &p_a, const Variant &p_b, Variant &r_ret) {
+		r_ret = get<A>(p_a);
+	}
+
+	template <class A>
+	static void bit_negate(const Variant &p_a, const Variant &p_b, Variant &r_ret) {
+		r_ret = ~get<A>(p_a);
+	}
+
+	static Variant::ValidatedOperatorEvaluator evaluators[Variant::OP_MAX][Variant::VARIANT_MAX][Variant::VARIANT_MAX];
+
+	static void add_evaluator(Variant::Operator p_op, Variant::Type p_type_a, Variant::Type p_type_b, Variant::ValidatedOperatorEvaluator p_evaluator) {
+		evaluators[p_op][p_type_a][p_type_b] = p_evaluator;
+	}
+
+	template <class A, class B>
+	static void add_comparisons(Variant::Type p_type_a, Variant::Type p_type_b) {
+		add_evaluator(Variant::OP_EQUAL, p_type_a, p_type_b, equal<A, B>);
+		add_evaluator(Variant::OP_NOT_EQUAL, p_type_a, p_type_b, not_equal<A, B>);
+		add_evaluator(Variant::OP_LESS, p_type_a, p_type_b, less<A, B>);
+		add_evaluator(Variant::OP_LESS_EQUAL, p_type_a, p_type_b, less_equal<A, B>);
+		add_evaluator(Variant::OP_GREATER, p_type_a, p_type_b, greater<A, B>);
+		add_evaluator(Variant::OP_GREATER_EQUAL, p_type_a, p_type_b, greater_equal<A, B>);
+	}
+
+	template <class A, class B>
+	static void add_numeric(Variant::Type p_type_a, Variant::Type p_type_b) {
+		add_comparisons<A, B>(p_type_a, p_type_b);
+		add_evaluator(Variant::OP_ADD, p_type_a, p_type_b, add<A, B>);
+		add_evaluator(Variant::OP_SUBTRACT, p_type_a, p_type_b, subtract<A, B>);
+		add_evaluator(Variant::OP_MULTIPLY, p_type_a, p_type_b, multiply<A, B>);
+	}
+
+	template <class V>
+	static void add_vector(Variant::Type p_type, bool p_integer) {
+		add_evaluator(Variant::OP_EQUAL, p_type, p_type, equal<V, V>);
+		add_evaluator(Variant::OP_NOT_EQUAL, p_type, p_type, not_equal<V, V>);
+		add_evaluator(Variant::OP_LESS, p_type, p_type, less<V, V>);
+		add_evaluator(Variant::OP_LESS_EQUAL, p_type, p_type, less_equal<V, V>);
+		add_evaluator(Variant::OP_GREATER, p_type, p_type, greater_swapped<V>);
+		add_evaluator(Variant::OP_GREATER_EQUAL, p_type, p_type, greater_equal_swapped<V>);
+		add_evaluator(Variant::OP_ADD, p_type, p_type, add<V, V>);
+		add_evaluator(Variant::OP_SUBTRACT, p_type, p_type, subtract<V, V>);
+		add_evaluator(Variant::OP_MULTIPLY, p_type, p_type, multiply<V, V>);
+		add_evaluator(Variant::OP_MULTIPLY, p_type, Variant::INT, multiply<V, int64_t>);
+		add_evaluator(Variant::OP_MULTIPLY, p_type, Variant::FLOAT, multiply<V, double>);
+		add_evaluator(Variant::OP_NEGATE, p_type, Variant::NIL, negate<V>);
+		add_evaluator(Variant::OP_POSITIVE, p_type, Variant::NIL, positive<V>);
+
+		if (!p_integer) {
+			// Integer vectors trap on division by zero, evaluate() is left to deal with those.
+			add_evaluator(Variant::OP_DIVIDE, p_type, p_type, divide<V, V>);
+			add_evaluator(Variant::OP_DIVIDE, p_type, Variant::INT, divide<V, int64_t>);
+			add_evaluator(Variant::OP_DIVIDE, p_type, Variant::FLOAT, divide<V, double>);
+			// Scalar * vector reads the right operand as a float vector, so only those are safe.
+			add_evaluator(Variant::OP_MULTIPLY, Variant::INT, p_type, multiply<int64_t, V>);
+			add_evaluator(Variant::OP_MULTIPLY, Variant::FLOAT, p_type, multiply<double, V>);
+		}
+	}
+
+	static void register_evaluators() {
+		add_numeric<int64_t, int64_t>(Variant::INT, Variant::INT);
+		add_numeric<int64_t, double>(Variant::INT, Variant::FLOAT);
+		add_numeric<double, int64_t>(Variant::FLOAT, Variant::INT);
+		add_numeric<double, double>(Variant::FLOAT, Variant::FLOAT);
+#ifndef DEBUG_ENABLED
+		// Debug builds report float division by zero as an error.
+		add_evaluator(Variant::OP_DIVIDE, Variant::INT, Variant::FLOAT, divide<int64_t, double>);
+		add_evaluator(Variant::OP_DIVIDE, Variant::FLOAT, Variant::INT, divide<double, int64_t>);
+		add_evaluator(Variant::OP_DIVIDE, Variant::FLOAT, Variant::FLOAT, divide<double, double>);
+#endif
+
+		add_evaluator(Variant::OP_NEGATE, Variant::INT, Variant::NIL, negate<int64_t>);
+		add_evaluator(Variant::OP_POSITIVE, Variant::INT, Variant::NIL, positive<int64_t>);
+		add_evaluator(Variant::OP_BIT_NEGATE, Variant::INT, Variant::NIL, bit_negate<int64_t>);
+		add_evaluator(Variant::OP_NEGATE, Variant::FLOAT, Variant::NIL, negate<double>);
+		add_evaluator(Variant::OP_POSITIVE, Variant::FLOAT, Variant::NIL, positive<double>);
+		add_evaluator(Variant::OP_BIT_AND, Variant::INT, Variant::INT, bit_and<int64_t, int64_t>);
+		add_evaluator(Variant::OP_BIT_OR, Variant::INT, Variant::INT, bit_or<int64_t, int64_t>);
+		add_evaluator(Variant::OP_BIT_XOR, Variant::INT, Variant::INT, bit_xor<int64_t, int64_t>);
+
+		add_vector<Vector2>(Variant::VECTOR2, false);
+		add_vector<Vector2i>(Variant::VECTOR2I, true);
+		add_vector<Vector3>(Variant::VECTOR3, false);
+		add_vector<Vector3i>(Variant::VECTOR3I, true);
+	}
+};
+
+Variant::ValidatedOperatorEvaluator _VariantOp::evaluators[Variant::OP_MAX][Variant::VARIANT_MAX][Variant::VARIANT_MAX] = {};
+
+Variant::ValidatedOperatorEvaluator Variant::get_validated_operator_evaluator(Operator p_op, Type p_type_a, Type p_type_b) {
+	ERR_FAIL_INDEX_V(p_op, OP_MAX, nullptr);
+	ERR_FAIL_INDEX_V(p_type_a, VARIANT_MAX, nullptr);
+	ERR_FAIL_INDEX_V(p_type_b, VARIANT_MAX, nullptr);
+	return _VariantOp::evaluators[p_op][p_type_a][p_type_b];
+}
+
+void register_variant_operators() {
+	_VariantOp::register_evaluators();
+}
+
 void Variant::set_named(const StringName &p_index, const Variant &p_value, bool *r_valid) {
 	bool valid = false;
 	switch (type) {
@@ -45,6 +45,7 @@
 #include "core/os/os.h"
 #include "core/project_settings.h"
 #include "core/register_core_types.h"
+#include "core/thread_work_pool.h"
 #include "core/translation.h"
 #include "core/version.h"
 #include "core/version_hash.gen.h"
@@ -1121,6 +1122,9 @@ Error Main::setup(const char *execpath, int argc, char *argv[], bool p_second_ph
 		OS::get_singleton()->_render_thread_mode = OS::RenderThreadMode(rtm);
 	}
 
+	ThreadWorkPool::get_singleton()->init(GLOBAL_DEF_RST("threading/worker_pool/max_threads", -1));
+	ProjectSettings::get_singleton()->set_custom_property_info("threading/worker_pool/max_threads", PropertyInfo(Variant::INT, "threading/worker_pool/max_threads", PROPERTY_HINT_RANGE, "-1,256,1,or_greater"));
+
 	/* Determine audio and video drivers */
 
 	for (int i = 0; i < DisplayServer::get_create_function_count(); i++) {
@@ -1814,6 +1818,10 @@ bool Main::start() {
 					}
 				}
 
+				for (int i = 0; i < ScriptServer::get_language_count(); i++) {
+					ScriptServer::get_language(i)->load_project_scripts();
+				}
+
 				//second pass, load into global constants
 				List<Node *> to_add;
 				for (List<PropertyInfo>::Element *E = props.front(); E; E = E->next()) {
@@ -0,0 +1,128 @@
+/*************************************************************************/
+/*  test_broad_phase_2d.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_broad_phase_2d.h"
+
+#include "core/local_vector.h"
+#include "core/math/math_funcs.h"
+#include "core/os/os.h"
+#include "servers/physics_2d/broad_phase_2d_hash_grid.h"
+
+namespace TestBroadPhase2D {
+
+enum {
+	BODY_COUNT = 10000,
+	STEP_COUNT = 100,
+};
+
+static int pair_count = 0;
+
+static void *_pair_callback(CollisionObject2DSW *p_object_A, int p_subindex_A, CollisionObject2DSW *p_object_B, int p_subindex_B, void *p_userdata) {
+	pair_count++;
+	return nullptr;
+}
+
+static void _unpair_callback(CollisionObject2DSW *p_object_A, int p_subindex_A, CollisionObject2DSW *p_object_B, int p_subindex_B, void *p_data, void *p_userdata) {
+	pair_count--;
+}
+
+MainLoop *test() {
+	OS::get_singleton()->print("\n\nBroadPhase2DHashGrid: moving %d bodies for %d steps\n", BODY_COUNT, STEP_COUNT);
+
+	BroadPhase2DSW *bp = BroadPhase2DHashGrid::_create();
+	bp->set_pair_callback(_pair_callback, nullptr);
+	bp->set_unpair_callback(_unpair_callback, nullptr);
+
+	const real_t world_size = 8192;
+	const Size2 body_size(24, 24);
+
+	LocalVector<BroadPhase2DSW::ID> ids;
+	LocalVector<Vector2> positions;
+	LocalVector<Vector2> velocities;
+
+	Math::seed(0x60d07);
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < BODY_COUNT; i++) {
+		// The owner is only compared against other owners, never dereferenced.
+		BroadPhase2DSW::ID id = bp->create((CollisionObject2DSW *)(uintptr_t)(i + 1));
+		Vector2 pos(Math::randf() * world_size, Math::randf() * world_size);
+		bp->move(id, Rect2(pos, body_size));
+
+		ids.push_back(id);
+		positions.push_back(pos);
+		velocities.push_back(Vector2(Math::randf() * 2.0 - 1.0, Math::randf() * 2.0 - 1.0) * 16.0);
+	}
+
+	uint64_t insert_usec = OS::get_singleton()->get_ticks_usec() - from;
+	OS::get_singleton()->print("\tinsert: %.3f msec, %d pairs\n", insert_usec / 1000.0, pair_count);
+
+	from = OS::get_singleton()->get_ticks_usec();
+
+	for (int s = 0; s < STEP_COUNT; s++) {
+		for (int i = 0; i < BODY_COUNT; i++) {
+			Vector2 pos = positions[i] + velocities[i];
+			if (pos.x < 0 || pos.x > world_size) {
+				velocities[i].x = -velocities[i].x;
+			}
+			if (pos.y < 0 || pos.y > world_size) {
+				velocities[i].y = -velocities[i].y;
+			}
+			positions[i] = pos;
+			bp->move(ids[i], Rect2(pos, body_size));
+		}
+		bp->update();
+	}
+
+	uint64_t move_usec = OS::get_singleton()->get_ticks_usec() - from;
+	OS::get_singleton()->print("\tmove: %.3f msec total, %.3f msec/step, %d pairs\n", move_usec / 1000.0, move_usec / 1000.0 / STEP_COUNT, pair_count);
+
+	from = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < BODY_COUNT; i++) {
+		bp->remove(ids[i]);
+	}
+
+	uint64_t remove_usec = OS::get_singleton()->get_ticks_usec() - from;
+	OS::get_singleton()->print("\tremove: %.3f msec, %d pairs\n", remove_usec / 1000.0, pair_count);
+
+	if (pair_count != 0) {
+		OS::get_singleton()->print("BroadPhase2DHashGrid pair tracking test FAILED: %d pairs left after removal.\n", pair_count);
+	} else {
+		OS::get_singleton()->print("BroadPhase2DHashGrid pair tracking test passed.\n");
+	}
+
+	memdelete(bp);
+
+	return nullptr;
+}
+
+} // namespace TestBroadPhase2D
@@ -0,0 +1,175 @@
+/*************************************************************************/
+/*  test_command_queue.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_command_queue.h"
+
+#include "core/command_queue_mt.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
+
+#include <atomic>
+
+namespace TestCommandQueue {
+
+enum {
+	PRODUCERS = 4,
+	COMMANDS_PER_PRODUCER = 250000,
+	SYNC_INTERVAL = 10000,
+};
+
+struct Server {
+	CommandQueueMT queue;
+	bool exit = false;
+
+	uint32_t last_sequence[PRODUCERS];
+	uint64_t executed = 0;
+	uint64_t checksum = 0;
+	int out_of_order = 0;
+
+	void thread_exit() {
+		exit = true;
+	}
+
+	void work(int p_producer, uint32_t p_sequence, uint64_t p_a, uint64_t p_b) {
+		if (p_sequence != last_sequence[p_producer] + 1) {
+			out_of_order++;
+		}
+		last_sequence[p_producer] = p_sequence;
+		checksum += p_a ^ p_b;
+		executed++;
+	}
+
+	uint64_t get_executed() {
+		return executed;
+	}
+
+	void sync() {
+	}
+
+	static void thread_loop(void *p_user) {
+		Server *server = (Server *)p_user;
+		while (!server->exit) {
+			server->queue.wait_and_flush();
+		}
+		server->queue.flush_all();
+	}
+
+	Server() :
+			queue(true) {
+		for (int i = 0; i < PRODUCERS; i++) {
+			last_sequence[i] = 0;
+		}
+	}
+};
+
+struct Producer {
+	Server *server = nullptr;
+	int index = 0;
+	std::atomic<bool> *start = nullptr;
+	uint64_t checksum = 0;
+
+	static void thread_func(void *p_user) {
+		Producer *producer = (Producer *)p_user;
+		Server *server = producer->server;
+
+		while (!producer->start->load()) {
+		}
+
+		for (uint32_t i = 1; i <= COMMANDS_PER_PRODUCER; i++) {
+			uint64_t a = uint64_t(producer->index) << 32 | i;
+			uint64_t b = uint64_t(i) * 2654435761u;
+			producer->checksum += a ^ b;
+			server->queue.push(server, &Server::work, producer->index, i, a, b);
+
+			if (i % SYNC_INTERVAL == 0) {
+				// Mix in blocking commands, like RenderingServer getters do.
+				uint64_t executed = 0;
+				server->queue.push_and_ret(server, &Server::get_executed, &executed);
+				server->queue.push_and_sync(server, &Server::sync);
+			}
+		}
+	}
+};
+
+MainLoop *test() {
+	OS::get_singleton()->print("\n\nCommandQueueMT stress test: %d producers, %d commands each\n", PRODUCERS, COMMANDS_PER_PRODUCER);
+
+	Server server;
+	Thread *server_thread = Thread::create(Server::thread_loop, &server);
+
+	std::atomic<bool> start = { false };
+	Producer producers[PRODUCERS];
+	Thread *threads[PRODUCERS];
+	for (int i = 0; i < PRODUCERS; i++) {
+		producers[i].server = &server;
+		producers[i].index = i;
+		producers[i].start = &start;
+		threads[i] = Thread::create(Producer::thread_func, &producers[i]);
+	}
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	start.store(true);
+
+	uint64_t expected_checksum = 0;
+	for (int i = 0; i < PRODUCERS; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+		expected_checksum += producers[i].checksum;
+	}
+
+	server.queue.push(&server, &Server::thread_exit);
+	Thread::wait_to_finish(server_thread);
+	memdelete(server_thread);
+
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - from;
+	uint64_t total = uint64_t(PRODUCERS) * COMMANDS_PER_PRODUCER;
+
+	OS::get_singleton()->print("\t%d commands in %.3f msec (%.1f ns per command)\n", (int)total, usec / 1000.0, usec * 1000.0 / total);
+
+	bool ok = true;
+	if (server.executed != total) {
+		OS::get_singleton()->print("\texecuted %d commands, expected %d\n", (int)server.executed, (int)total);
+		ok = false;
+	}
+	if (server.out_of_order) {
+		OS::get_singleton()->print("\t%d commands ran out of order\n", server.out_of_order);
+		ok = false;
+	}
+	if (server.checksum != expected_checksum) {
+		OS::get_singleton()->print("\tchecksum mismatch\n");
+		ok = false;
+	}
+
+	OS::get_singleton()->print("CommandQueueMT stress test %s.\n", ok ? "passed" : "FAILED");
+
+	return nullptr;
+}
+
+} // namespace TestCommandQueue
@@ -0,0 +1,283 @@
+/*************************************************************************/
+/*  test_containers.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_containers.h"
+
+#include "core/b_tree_map.h"
+#include "core/hash_map.h"
+#include "core/local_vector.h"
+#include "core/map.h"
+#include "core/math/random_pcg.h"
+#include "core/oa_hash_map.h"
+#include "core/os/os.h"
+
+namespace TestContainers {
+
+enum {
+	OPS_PER_SIZE = 1000000, // Small sizes are repeated to get comparable totals.
+};
+
+// Random operations on BTreeMap, checked against Map after each batch.
+static bool _test_b_tree_map() {
+	OS::get_singleton()->print("\n\nBTreeMap against Map, random insertions and erasures\n");
+
+	RandomPCG rng(42);
+	BTreeMap<int, int> tree;
+	Map<int, int> reference;
+
+	for (int round = 0; round < 200; round++) {
+		// Alternate between growing and shrinking to exercise splits and merges.
+		bool grow = (round / 20) % 2 == 0;
+		for (int i = 0; i < 500; i++) {
+			int key = rng.rand() % 5000;
+			if (grow || rng.rand() % 4 == 0) {
+				tree.insert(key, key * 3);
+				reference.insert(key, key * 3);
+			} else if (tree.erase(key) != reference.erase(key)) {
+				OS::get_singleton()->print("\terase() result differs for %d\n", key);
+				return false;
+			}
+		}
+
+		if (tree.size() != reference.size()) {
+			OS::get_singleton()->print("\tsize %d, expected %d\n", tree.size(), reference.size());
+			return false;
+		}
+
+		auto E = tree.front();
+		for (Map<int, int>::Element *F = reference.front(); F; F = F->next()) {
+			if (!E || E->key() != F->key() || E->get() != F->get()) {
+				OS::get_singleton()->print("\titeration differs at key %d\n", F->key());
+				return false;
+			}
+			E = E->next();
+		}
+		if (E) {
+			OS::get_singleton()->print("\titeration has extra elements\n");
+			return false;
+		}
+
+		for (int i = 0; i < 50; i++) {
+			int key = rng.rand() % 5200 - 100;
+			auto closest = tree.find_closest(key);
+			Map<int, int>::Element *expected = reference.find_closest(key);
+			if (bool(closest) != (expected != nullptr) || (closest && closest->key() != expected->key())) {
+				OS::get_singleton()->print("\tfind_closest() differs for %d\n", key);
+				return false;
+			}
+			if (tree.has(key) != reference.has(key)) {
+				OS::get_singleton()->print("\thas() differs for %d\n", key);
+				return false;
+			}
+		}
+	}
+
+	BTreeMap<int, int> copy = tree;
+	tree.clear();
+	if (copy.size() != reference.size() || !tree.empty()) {
+		OS::get_singleton()->print("\tcopy or clear() failed\n");
+		return false;
+	}
+
+	OS::get_singleton()->print("\tpassed\n");
+	return true;
+}
+
+struct Timings {
+	uint64_t insert = 0;
+	uint64_t lookup = 0;
+	uint64_t iterate = 0;
+	uint64_t checksum = 0;
+};
+
+#define TIME_BEGIN uint64_t from = OS::get_singleton()->get_ticks_usec();
+#define TIME_END(m_field) r_timings.m_field += OS::get_singleton()->get_ticks_usec() - from;
+
+static void _bench_map(const LocalVector<uint32_t> &p_keys, Timings &r_timings) {
+	Map<uint32_t, uint32_t> map;
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			map.insert(p_keys[i], i);
+		}
+		TIME_END(insert)
+	}
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			r_timings.checksum += map.find(p_keys[i])->get();
+		}
+		TIME_END(lookup)
+	}
+	{
+		TIME_BEGIN
+		for (Map<uint32_t, uint32_t>::Element *E = map.front(); E; E = E->next()) {
+			r_timings.checksum += E->get();
+		}
+		TIME_END(iterate)
+	}
+}
+
+static void _bench_b_tree_map(const LocalVector<uint32_t> &p_keys, Timings &r_timings) {
+	BTreeMap<uint32_t, uint32_t> map;
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			map.insert(p_keys[i], i);
+		}
+		TIME_END(insert)
+	}
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			r_timings.checksum += map.find(p_keys[i])->get();
+		}
+		TIME_END(lookup)
+	}
+	{
+		TIME_BEGIN
+		for (BTreeMap<uint32_t, uint32_t>::Iterator E = map.front(); E; E = E.next()) {
+			r_timings.checksum += E.get();
+		}
+		TIME_END(iterate)
+	}
+}
+
+static void _bench_hash_map(const LocalVector<uint32_t> &p_keys, Timings &r_timings) {
+	HashMap<uint32_t, uint32_t> map;
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			map.set(p_keys[i], i);
+		}
+		TIME_END(insert)
+	}
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			r_timings.checksum += *map.getptr(p_keys[i]);
+		}
+		TIME_END(lookup)
+	}
+	{
+		TIME_BEGIN
+		const uint32_t *K = nullptr;
+		while ((K = map.next(K))) {
+			r_timings.checksum += map.get(*K);
+		}
+		TIME_END(iterate)
+	}
+}
+
+static void _bench_oa_hash_map(const LocalVector<uint32_t> &p_keys, Timings &r_timings) {
+	OAHashMap<uint32_t, uint32_t> map;
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			map.set(p_keys[i], i);
+		}
+		TIME_END(insert)
+	}
+	{
+		TIME_BEGIN
+		for (uint32_t i = 0; i < p_keys.size(); i++) {
+			r_timings.checksum += *map.lookup_ptr(p_keys[i]);
+		}
+		TIME_END(lookup)
+	}
+	{
+		TIME_BEGIN
+		for (OAHashMap<uint32_t, uint32_t>::Iterator it = map.iter(); it.valid; it = map.next_iter(it)) {
+			r_timings.checksum += *it.value;
+		}
+		TIME_END(iterate)
+	}
+}
+
+#undef TIME_BEGIN
+#undef TIME_END
+
+typedef void (*BenchFunc)(const LocalVector<uint32_t> &, Timings &);
+
+static bool _bench_size(uint32_t p_size) {
+	static const char *names[] = { "Map", "BTreeMap", "HashMap", "OAHashMap" };
+	static const BenchFunc funcs[] = { _bench_map, _bench_b_tree_map, _bench_hash_map, _bench_oa_hash_map };
+	const int count = sizeof(funcs) / sizeof(funcs[0]);
+
+	// Unique keys in random order.
+	RandomPCG rng(p_size);
+	LocalVector<uint32_t> keys;
+	keys.resize(p_size);
+	for (uint32_t i = 0; i < p_size; i++) {
+		keys[i] = i * 2654435761u;
+	}
+	for (uint32_t i = p_size - 1; i > 0; i--) {
+		SWAP(keys[i], keys[rng.rand() % (i + 1)]);
+	}
+
+	uint32_t rounds = MAX(1u, OPS_PER_SIZE / p_size);
+	OS::get_singleton()->print("\n%d elements, %d rounds (nsec per element: insert, lookup, iterate)\n", p_size, rounds);
+
+	bool ok = true;
+	uint64_t expected_checksum = 0;
+	for (int i = 0; i < count; i++) {
+		Timings timings;
+		for (uint32_t round = 0; round < rounds; round++) {
+			funcs[i](keys, timings);
+		}
+
+		double scale = 1000.0 / (double(p_size) * rounds);
+		OS::get_singleton()->print("\t%-10s %8.1f %8.1f %8.1f\n", names[i], timings.insert * scale, timings.lookup * scale, timings.iterate * scale);
+
+		if (i == 0) {
+			expected_checksum = timings.checksum;
+		} else if (timings.checksum != expected_checksum) {
+			OS::get_singleton()->print("\t%s: checksum mismatch\n", names[i]);
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+MainLoop *test() {
+	bool ok = _test_b_tree_map();
+
+	OS::get_singleton()->print("\n\nContainer benchmark\n");
+	ok = _bench_size(1000) && ok;
+	ok = _bench_size(100000) && ok;
+	ok = _bench_size(1000000) && ok;
+
+	OS::get_singleton()->print("\nContainer test %s.\n", ok ? "passed" : "FAILED");
+
+	return nullptr;
+}
+
+} // namespace TestContainers
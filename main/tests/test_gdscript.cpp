@@ -30,18 +30,26 @@
 
 #include "test_gdscript.h"
 
+#include "core/io/resource_loader.h"
+#include "core/os/dir_access.h"
 #include "core/os/file_access.h"
 #include "core/os/main_loop.h"
 #include "core/os/os.h"
+#include "core/project_settings.h"
 
 #include "modules/modules_enabled.gen.h"
 #ifdef MODULE_GDSCRIPT_ENABLED
 
 #include "modules/gdscript/gdscript.h"
+#include "modules/gdscript/gdscript_aot.h"
+#include "modules/gdscript/gdscript_compile_cache.h"
 #include "modules/gdscript/gdscript_compiler.h"
 #include "modules/gdscript/gdscript_parser.h"
 #include "modules/gdscript/gdscript_tokenizer.h"
 
+// Defined in test_gdscript_aot_fixture.cpp.
+void register_gdscript_aot_gd_aot_fixture();
+
 namespace TestGDScript {
 
 static void _print_indent(int p_ident, const String &p_text) {
@@ -530,7 +538,11 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 			String txt = itos(ip) + " ";
 
 			switch (code[ip]) {
-				case GDScriptFunction::OPCODE_OPERATOR: {
+				case GDScriptFunction::OPCODE_OPERATOR:
+				case GDScriptFunction::OPCODE_OPERATOR_INT:
+				case GDScriptFunction::OPCODE_OPERATOR_FLOAT:
+				case GDScriptFunction::OPCODE_OPERATOR_VECTOR2:
+				case GDScriptFunction::OPCODE_OPERATOR_VECTOR3: {
 					int op = code[ip + 1];
 					txt += " op ";
 
@@ -564,6 +576,27 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 					txt += "]";
 					incr += 4;
 
+				} break;
+				case GDScriptFunction::OPCODE_SET_PACKED: {
+					txt += " set_packed ";
+					txt += DADDR(1);
+					txt += "[";
+					txt += DADDR(2);
+					txt += "]=";
+					txt += DADDR(3);
+					incr += 4;
+
+				} break;
+				case GDScriptFunction::OPCODE_GET_PACKED: {
+					txt += " get_packed ";
+					txt += DADDR(3);
+					txt += "=";
+					txt += DADDR(1);
+					txt += "[";
+					txt += DADDR(2);
+					txt += "]";
+					incr += 4;
+
 				} break;
 				case GDScriptFunction::OPCODE_SET_NAMED: {
 					txt += " set_named ";
@@ -571,19 +604,19 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 					txt += "[\"";
 					txt += func.get_global_name(code[ip + 2]);
 					txt += "\"]=";
-					txt += DADDR(3);
-					incr += 4;
+					txt += DADDR(4);
+					incr += 5;
 
 				} break;
 				case GDScriptFunction::OPCODE_GET_NAMED: {
 					txt += " get_named ";
-					txt += DADDR(3);
+					txt += DADDR(4);
 					txt += "=";
 					txt += DADDR(1);
 					txt += "[\"";
 					txt += func.get_global_name(code[ip + 2]);
 					txt += "\"]";
-					incr += 4;
+					incr += 5;
 
 				} break;
 				case GDScriptFunction::OPCODE_SET_MEMBER: {
@@ -731,7 +764,37 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 
 					int argc = code[ip + 1];
 					if (ret) {
-						txt += DADDR(4 + argc) + "=";
+						txt += DADDR(5 + argc) + "=";
+					}
+
+					txt += DADDR(2) + ".";
+					txt += String(func.get_global_name(code[ip + 3]));
+					txt += "(";
+
+					for (int i = 0; i < argc; i++) {
+						if (i > 0) {
+							txt += ", ";
+						}
+						txt += DADDR(5 + i);
+					}
+					txt += ")";
+
+					incr = 6 + argc;
+
+				} break;
+				case GDScriptFunction::OPCODE_CALL_PTRCALL:
+				case GDScriptFunction::OPCODE_CALL_PTRCALL_RETURN: {
+					bool ret = code[ip] == GDScriptFunction::OPCODE_CALL_PTRCALL_RETURN;
+
+					if (ret) {
+						txt += " ptrcall-ret ";
+					} else {
+						txt += " ptrcall ";
+					}
+
+					int argc = code[ip + 1];
+					if (ret) {
+						txt += DADDR(5 + argc) + "=";
 					}
 
 					txt += DADDR(2) + ".";
@@ -742,11 +805,11 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 						if (i > 0) {
 							txt += ", ";
 						}
-						txt += DADDR(4 + i);
+						txt += DADDR(5 + i);
 					}
 					txt += ")";
 
-					incr = 5 + argc;
+					incr = 6 + argc;
 
 				} break;
 				case GDScriptFunction::OPCODE_CALL_BUILT_IN: {
@@ -849,6 +912,16 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 					txt += " for-loop " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
 					incr += 5;
 
+				} break;
+				case GDScriptFunction::OPCODE_ITERATE_BEGIN_PACKED: {
+					txt += " for-init-packed " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
+					incr += 5;
+
+				} break;
+				case GDScriptFunction::OPCODE_ITERATE_PACKED: {
+					txt += " for-loop-packed " + DADDR(4) + " in " + DADDR(2) + " counter " + DADDR(1) + " end " + itos(code[ip + 3]);
+					incr += 5;
+
 				} break;
 				case GDScriptFunction::OPCODE_LINE: {
 					int line = code[ip + 1] - 1;
@@ -883,7 +956,346 @@ static void _disassemble_class(const Ref<GDScript> &p_class, const Vector<String
 	}
 }
 
+// Many objects each running a coroutine that yields once per step, like AI behaviors
+// written as coroutines and resumed every frame.
+static const char *_coroutine_benchmark_code =
+		"extends Reference\n"
+		"var steps_done = 0\n"
+		"func think(p_steps):\n"
+		"\tvar target = Vector2(100, 50)\n"
+		"\tvar position = Vector2()\n"
+		"\tfor i in range(p_steps):\n"
+		"\t\tposition += (target - position) * 0.1\n"
+		"\t\tsteps_done += 1\n"
+		"\t\tyield()\n"
+		"\treturn position\n";
+
+static void _benchmark_coroutines() {
+	const int instance_count = 10000;
+	const int step_count = 60;
+
+	Ref<GDScript> script;
+	script.instance();
+	script->set_source_code(_coroutine_benchmark_code);
+	Error err = script->reload();
+	ERR_FAIL_COND_MSG(err != OK, "Could not compile the coroutine benchmark script.");
+
+	Vector<Variant> instances;
+	Vector<Variant> states;
+	instances.resize(instance_count);
+	states.resize(instance_count);
+
+	Callable::CallError ce;
+	for (int i = 0; i < instance_count; i++) {
+		instances.write[i] = script->_new(nullptr, 0, ce);
+		ERR_FAIL_COND(ce.error != Callable::CallError::CALL_OK);
+	}
+
+	Variant steps = step_count;
+	const Variant *args[1] = { &steps };
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < instance_count; i++) {
+		Object *obj = instances[i];
+		states.write[i] = obj->call("think", args, 1, ce);
+	}
+	uint64_t started = OS::get_singleton()->get_ticks_usec();
+
+	for (int step = 0; step < step_count; step++) {
+		for (int i = 0; i < instance_count; i++) {
+			Ref<GDScriptFunctionState> state = states[i];
+			ERR_FAIL_COND_MSG(state.is_null(), "Coroutine finished too early.");
+			states.write[i] = state->resume();
+		}
+	}
+	uint64_t end = OS::get_singleton()->get_ticks_usec();
+
+	for (int i = 0; i < instance_count; i++) {
+		Object *obj = instances[i];
+		ERR_FAIL_COND_MSG(int(obj->get("steps_done")) != step_count || states[i].get_type() != Variant::VECTOR2, "Coroutine did not run to completion.");
+	}
+
+	uint64_t resumes = uint64_t(instance_count) * step_count;
+	print_line("Started " + itos(instance_count) + " coroutines in " + rtos((started - begin) / 1000.0) + " ms.");
+	print_line("Resumed " + itos(resumes) + " times in " + rtos((end - started) / 1000.0) + " ms, " + rtos(double(end - started) * 1000.0 / resumes) + " ns per resume.");
+}
+
+// C extends B extends A, and A gains a member before the one B and C use. B's source
+// doesn't change, but C's cache entry has B's member indices folded in and must be rejected.
+#define COMPILE_CACHE_TEST_DIR "user://gd_compile_cache_test"
+
+static const char *_compile_cache_base_code[2] = {
+	"extends Reference\n"
+	"var a = 1\n",
+	"extends Reference\n"
+	"var inserted = 10\n"
+	"var a = 1\n",
+};
+
+static bool _write_text(const String &p_path, const String &p_text) {
+	FileAccessRef f = FileAccess::open(p_path, FileAccess::WRITE);
+	ERR_FAIL_COND_V_MSG(!f, false, "Could not write: " + p_path);
+	f->store_string(p_text);
+	return true;
+}
+
+// Same path as GDScriptCompileCache::_get_cache_path().
+static Vector<uint8_t> _read_cache_entry(const String &p_script_path) {
+	return FileAccess::get_file_as_array(String("user://.gdscript_cache").plus_file(p_script_path.md5_text() + ".gdcache"));
+}
+
+static bool _same_bytes(const Vector<uint8_t> &p_a, const Vector<uint8_t> &p_b) {
+	return p_a.size() == p_b.size() && (p_a.empty() || memcmp(p_a.ptr(), p_b.ptr(), p_a.size()) == 0);
+}
+
+static Variant _call_compile_cache_script(const String &p_path) {
+	Ref<GDScript> script = ResourceLoader::load(p_path);
+	ERR_FAIL_COND_V_MSG(script.is_null(), Variant(), "Could not load: " + p_path);
+
+	Callable::CallError ce;
+	Variant instance = script->_new(nullptr, 0, ce);
+	ERR_FAIL_COND_V(ce.error != Callable::CallError::CALL_OK, Variant());
+	Object *obj = instance;
+	return obj->call("get_b");
+}
+
+static void _test_compile_cache() {
+	if (!GDScriptCompileCache::is_enabled()) {
+		print_line("The compile cache is disabled, nothing to test.");
+		return;
+	}
+
+	String a_path = String(COMPILE_CACHE_TEST_DIR).plus_file("a.gd");
+	String b_path = String(COMPILE_CACHE_TEST_DIR).plus_file("b.gd");
+	String c_path = String(COMPILE_CACHE_TEST_DIR).plus_file("c.gd");
+
+	DirAccessRef da = DirAccess::create(DirAccess::ACCESS_USERDATA);
+	da->make_dir_recursive(COMPILE_CACHE_TEST_DIR);
+	bool written = _write_text(a_path, _compile_cache_base_code[0]);
+	written = written && _write_text(b_path, "extends \"" + a_path + "\"\nvar b = 2\n");
+	written = written && _write_text(c_path, "extends \"" + b_path + "\"\nfunc get_b():\n\treturn b\n");
+	ERR_FAIL_COND(!written);
+
+	bool ok = true;
+
+	// Compiles all three and writes their entries, then restores them from the cache.
+	ok = _call_compile_cache_script(c_path) == Variant(2) && ok;
+	Vector<uint8_t> entry = _read_cache_entry(c_path);
+	ok = !entry.empty() && ok;
+	ok = _call_compile_cache_script(c_path) == Variant(2) && ok;
+	ok = _same_bytes(_read_cache_entry(c_path), entry) && ok;
+
+	// A stale entry would read `a` from b's old slot.
+	ERR_FAIL_COND(!_write_text(a_path, _compile_cache_base_code[1]));
+	ok = _call_compile_cache_script(c_path) == Variant(2) && ok;
+	ok = !_same_bytes(_read_cache_entry(c_path), entry) && ok;
+
+	da->remove(a_path);
+	da->remove(b_path);
+	da->remove(c_path);
+	da->remove(COMPILE_CACHE_TEST_DIR);
+
+	print_line(String("Compile cache test ") + (ok ? "passed." : "FAILED."));
+}
+
+// test_gdscript_aot_fixture.cpp holds the code gd_aot generated from this source, registered
+// under this path. The test also compiles a copy with a changed collatz(), whose compiled body
+// is stale and must not be used. Regenerate the fixture whenever the test says so.
+#define AOT_FIXTURE_PATH "res://gd_aot_fixture.gd"
+
+static const char *_aot_fixture_code =
+	"extends Reference\n"
+	"var total = 0\n"
+	"var scale: float = 1.5\n"
+	"func sum_squares(n: int) -> int:\n"
+	"\tvar s: int = 0\n"
+	"\tfor i in range(n):\n"
+	"\t\ts += i * i\n"
+	"\treturn s\n"
+	"func mix(a: float, b: float = 2.0) -> float:\n"
+	"\tvar x: float = a * b - a / b\n"
+	"\tif x > 10.0:\n"
+	"\t\tx = sqrt(x)\n"
+	"\treturn x * scale\n"
+	"func collatz(n: int) -> int:\n"
+	"\tvar steps := 0\n"
+	"\twhile n != 1:\n"
+	"\t\tif n % 2 == 0:\n"
+	"\t\t\tn /= 2\n"
+	"\t\telse:\n"
+	"\t\t\tn = 3 * n + 1\n"
+	"\t\tsteps += 1\n"
+	"\treturn steps\n"
+	"func join_words(words: Array) -> String:\n"
+	"\tvar out := \"\"\n"
+	"\tfor w in words:\n"
+	"\t\tif out != \"\":\n"
+	"\t\t\tout += \",\"\n"
+	"\t\tout += str(w).to_upper()\n"
+	"\treturn out\n"
+	"func accumulate(v: int) -> int:\n"
+	"\ttotal += v\n"
+	"\treturn total\n"
+	"func vectors(x: float) -> Vector3:\n"
+	"\tvar a := Vector3(x, 1, 2)\n"
+	"\tvar b := Vector3(0.5, x, -1)\n"
+	"\treturn a + b * 2.0 - a.cross(b)\n"
+	"func tally(items: Array) -> Array:\n"
+	"\tvar d := {}\n"
+	"\tfor item in items:\n"
+	"\t\td[item] = d.get(item, 0) + 1\n"
+	"\treturn [d.keys(), d.values()]\n";
+
+static Ref<GDScript> _compile_aot_fixture(const String &p_code) {
+	GDScriptParser parser;
+	Error err = parser.parse(p_code);
+	ERR_FAIL_COND_V_MSG(err, Ref<GDScript>(), "Parse Error: " + itos(parser.get_error_line()) + ":" + parser.get_error());
+
+	Ref<GDScript> gds;
+	gds.instance();
+	gds->set_script_path(AOT_FIXTURE_PATH);
+
+	GDScriptCompiler gdc;
+	err = gdc.compile(&parser, gds.ptr());
+	ERR_FAIL_COND_V_MSG(err, Ref<GDScript>(), "Compile Error: " + itos(gdc.get_error_line()) + ":" + gdc.get_error());
+	return gds;
+}
+
+// Calls every fixture function on a new instance of p_script, going through GDScriptFunction::call()
+// like scripts do. accumulate() is called twice, so the second call reads the member the first one changed.
+static Array _call_aot_fixture(Ref<GDScript> p_script) {
+	Array results;
+
+	Callable::CallError ce;
+	Variant owner = p_script->_new(nullptr, 0, ce);
+	ERR_FAIL_COND_V(ce.error != Callable::CallError::CALL_OK, results);
+	GDScriptInstance *instance = static_cast<GDScriptInstance *>(Object::cast_to<Object>(owner)->get_script_instance());
+
+	Array words;
+	words.push_back("one");
+	words.push_back(2);
+	words.push_back(Vector2(3, 4));
+	Array items;
+	items.push_back("a");
+	items.push_back(1);
+	items.push_back("a");
+	items.push_back(2.5);
+	items.push_back(1);
+	items.push_back("a");
+
+	struct Call {
+		const char *function;
+		Vector<Variant> args;
+	};
+	Vector<Call> calls;
+	calls.push_back({ "sum_squares", varray(0) });
+	calls.push_back({ "sum_squares", varray(100) });
+	calls.push_back({ "mix", varray(3.0) });
+	calls.push_back({ "mix", varray(12.0, 4.0) });
+	calls.push_back({ "mix", varray(7, 0.25) }); // Int argument, converted to the typed parameter.
+	calls.push_back({ "collatz", varray(1) });
+	calls.push_back({ "collatz", varray(27) });
+	calls.push_back({ "join_words", varray(words) });
+	calls.push_back({ "join_words", varray(Array()) });
+	calls.push_back({ "accumulate", varray(5) });
+	calls.push_back({ "accumulate", varray(-12) });
+	calls.push_back({ "vectors", varray(0.0) });
+	calls.push_back({ "vectors", varray(-3.5) });
+	calls.push_back({ "tally", varray(items) });
+
+	for (int i = 0; i < calls.size(); i++) {
+		GDScriptFunction *function = p_script->get_member_functions()[calls[i].function];
+		Vector<const Variant *> args;
+		for (int j = 0; j < calls[i].args.size(); j++) {
+			args.push_back(&calls[i].args[j]);
+		}
+		Variant ret = function->call(instance, args.ptrw(), args.size(), ce);
+		results.push_back(ce.error == Callable::CallError::CALL_OK ? ret : Variant("call failed"));
+	}
+
+	return results;
+}
+
+static bool _has_aot_body(const Ref<GDScript> &p_script, const StringName &p_function) {
+	return GDScriptAOT::get_function(AOT_FIXTURE_PATH, p_script->get_member_functions()[p_function]) != nullptr;
+}
+
+static void _test_aot() {
+	String stale_code = String(_aot_fixture_code).replace("\t\tsteps += 1\n", "\t\tsteps += 2\n");
+
+	Ref<GDScript> interpreted = _compile_aot_fixture(_aot_fixture_code);
+	Ref<GDScript> interpreted_stale = _compile_aot_fixture(stale_code);
+
+	register_gdscript_aot_gd_aot_fixture();
+	Ref<GDScript> compiled = _compile_aot_fixture(_aot_fixture_code);
+	Ref<GDScript> stale = _compile_aot_fixture(stale_code);
+	ERR_FAIL_COND(interpreted.is_null() || interpreted_stale.is_null() || compiled.is_null() || stale.is_null());
+
+	bool ok = true;
+
+	// Every function of the fixture must have picked up its compiled body.
+	bool fixture_current = true;
+	for (const Map<StringName, GDScriptFunction *>::Element *E = compiled->get_member_functions().front(); E; E = E->next()) {
+		if (E->get()->get_code_size() && !_has_aot_body(compiled, E->key())) {
+			print_line("No compiled body for " + String(E->key()) + "().");
+			fixture_current = false;
+		}
+	}
+
+	if (fixture_current) {
+		// The stale collatz() must be left to the interpreter, and the rest of that script must not.
+		for (const Map<StringName, GDScriptFunction *>::Element *E = stale->get_member_functions().front(); E; E = E->next()) {
+			if (E->get()->get_code_size() && _has_aot_body(stale, E->key()) != (String(E->key()) != "collatz")) {
+				print_line("Wrong compiled body choice for " + String(E->key()) + "() of the changed script.");
+				ok = false;
+			}
+		}
+	} else {
+		String aot_code;
+		GDScriptAOT::generate(interpreted, "register_gdscript_aot_gd_aot_fixture", aot_code);
+		print_line("The bytecode changed, regenerate the code of main/tests/test_gdscript_aot_fixture.cpp:\n" + aot_code);
+		ok = false;
+	}
+
+	Array expected = _call_aot_fixture(interpreted);
+	Array results = _call_aot_fixture(compiled);
+	Array expected_stale = _call_aot_fixture(interpreted_stale);
+	Array results_stale = _call_aot_fixture(stale);
+
+	for (int i = 0; i < expected.size(); i++) {
+		if (i >= results.size() || !expected[i].hash_compare(results[i])) {
+			print_line("Result " + itos(i) + " differs: interpreter " + expected[i].get_construct_string() + ", compiled " + (i < results.size() ? results[i].get_construct_string() : String("missing")));
+			ok = false;
+		}
+		if (i >= results_stale.size() || !expected_stale[i].hash_compare(results_stale[i])) {
+			print_line("Result " + itos(i) + " of the changed script differs: interpreter " + expected_stale[i].get_construct_string() + ", compiled " + (i < results_stale.size() ? results_stale[i].get_construct_string() : String("missing")));
+			ok = false;
+		}
+	}
+	// Makes sure the stale change is visible in the results at all.
+	ok = expected.size() == expected_stale.size() && !Variant(expected).hash_compare(expected_stale) && ok;
+
+	GDScriptAOT::clear();
+
+	print_line(String("AOT fixture test ") + (ok ? "passed." : "FAILED."));
+}
+
 MainLoop *test(TestType p_type) {
+	if (p_type == TEST_COROUTINES) {
+		_benchmark_coroutines();
+		return nullptr;
+	}
+
+	if (p_type == TEST_COMPILE_CACHE) {
+		_test_compile_cache();
+		return nullptr;
+	}
+
+	if (p_type == TEST_AOT_FIXTURE) {
+		_test_aot();
+		return nullptr;
+	}
+
 	List<String> cmdlargs = OS::get_singleton()->get_cmdline_args();
 
 	if (cmdlargs.empty()) {
@@ -977,7 +1389,7 @@ MainLoop *test(TestType p_type) {
 		_parser_show_class(cnode, 0, lines);
 	}
 
-	if (p_type == TEST_COMPILER) {
+	if (p_type == TEST_COMPILER || p_type == TEST_AOT) {
 		GDScriptParser parser;
 
 		Error err = parser.parse(code);
@@ -989,6 +1401,10 @@ MainLoop *test(TestType p_type) {
 
 		Ref<GDScript> gds;
 		gds.instance();
+		if (p_type == TEST_AOT) {
+			// Compiled bodies are registered under the path the script is loaded from.
+			gds->set_script_path(ProjectSettings::get_singleton()->localize_path(test));
+		}
 
 		GDScriptCompiler gdc;
 		err = gdc.compile(&parser, gds.ptr());
@@ -997,6 +1413,18 @@ MainLoop *test(TestType p_type) {
 			return nullptr;
 		}
 
+		if (p_type == TEST_AOT) {
+			String symbol = "register_gdscript_aot_" + test.get_file().get_basename().replace("-", "_").replace(".", "_").replace(" ", "_");
+			String aot_code;
+			err = GDScriptAOT::generate(gds, symbol, aot_code);
+			print_line(aot_code);
+			if (err) {
+				print_line("No function could be compiled ahead of time.");
+			}
+			memdelete(fa);
+			return nullptr;
+		}
+
 		Ref<GDScript> current = gds;
 
 		while (current.is_valid()) {
@@ -40,6 +40,10 @@ enum TestType {
 	TEST_PARSER,
 	TEST_COMPILER,
 	TEST_BYTECODE,
+	TEST_AOT,
+	TEST_COROUTINES,
+	TEST_COMPILE_CACHE,
+	TEST_AOT_FIXTURE,
 };
 
 MainLoop *test(TestType p_type);
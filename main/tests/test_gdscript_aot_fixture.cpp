@@ -0,0 +1,473 @@
+/*************************************************************************/
+/*  test_gdscript_aot_fixture.cpp                                        */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+// Code generated by the GDScript ahead-of-time compiler from the fixture script in
+// test_gdscript.cpp, checked by the gd_aot_fixture test. When the bytecode changes, that
+// test prints the new code: replace everything between the #ifdef and the #endif with it.
+
+#include "modules/modules_enabled.gen.h"
+
+#ifdef MODULE_GDSCRIPT_ENABLED
+
+/* Generated from res://gd_aot_fixture.gd by the GDScript ahead-of-time compiler. */
+/* Bodies are only used while the script compiles to the same bytecode. */
+
+#include "modules/gdscript/gdscript_aot.h"
+
+// res://gd_aot_fixture.gd::accumulate
+static bool _gdaot_0_accumulate(GDScriptAOTFrame &f) {
+	if (unlikely(!f.self)) {
+		f.error = "Cannot access member without instance.";
+		return false;
+	}
+	Variant *stack = f.stack;
+
+	f.line = 31;
+	GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), f.members[0], stack[0], stack[1])); // +
+	f.members[0] = stack[1];
+	f.line = 32;
+	*f.retvalue = f.members[0];
+	return true;
+	return true;
+}
+
+// res://gd_aot_fixture.gd::_init
+static bool _gdaot_1__init(GDScriptAOTFrame &f) {
+	if (unlikely(!f.self)) {
+		f.error = "Cannot access member without instance.";
+		return false;
+	}
+
+	f.line = 2;
+	f.members[0] = f.constants[0];
+	f.line = 3;
+	if (likely(f.constants[1].get_type() == Variant::Type(3))) {
+		f.members[1] = f.constants[1];
+	} else {
+		GDAOT_TRY(GDScriptAOT::assign_typed(f, Variant::Type(3), f.constants[1], f.members[1]));
+	}
+	return true;
+}
+
+// res://gd_aot_fixture.gd::sum_squares
+static Variant::ValidatedOperatorEvaluator _gdaot_2_sum_squares_ops[2];
+
+static bool _gdaot_2_sum_squares(GDScriptAOTFrame &f) {
+	Variant *stack = f.stack;
+
+	f.line = 5;
+	if (likely(f.constants[0].get_type() == Variant::Type(2))) {
+		stack[1] = f.constants[0];
+	} else {
+		GDAOT_TRY(GDScriptAOT::assign_typed(f, Variant::Type(2), f.constants[0], stack[1]));
+	}
+	f.line = 6;
+	{
+		const Variant *args[] = { &stack[0] };
+		GDAOT_TRY(GDScriptAOT::construct(f, Variant::Type(2), args, 1, stack[5]));
+	}
+	stack[4] = stack[5];
+	{
+		int result = GDScriptAOT::iterate(f, true, stack[3], stack[4], stack[2]);
+		if (unlikely(result < 0)) {
+			return false;
+		}
+		if (!result) {
+			goto L23;
+		}
+	}
+	goto L30;
+L23:
+	goto L47;
+L25:
+	{
+		int result = GDScriptAOT::iterate(f, false, stack[3], stack[4], stack[2]);
+		if (unlikely(result < 0)) {
+			return false;
+		}
+		if (!result) {
+			goto L23;
+		}
+	}
+L30:
+	f.line = 7;
+	if (likely(stack[2].get_type() == Variant::INT && stack[2].get_type() == Variant::INT && _gdaot_2_sum_squares_ops[0])) { // *
+		_gdaot_2_sum_squares_ops[0](stack[2], stack[2], stack[7]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(8), stack[2], stack[2], stack[7]));
+	}
+	if (likely(stack[1].get_type() == Variant::INT && stack[7].get_type() == Variant::INT && _gdaot_2_sum_squares_ops[1])) { // +
+		_gdaot_2_sum_squares_ops[1](stack[1], stack[7], stack[6]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), stack[1], stack[7], stack[6]));
+	}
+	stack[1] = stack[6];
+	goto L25;
+L47:
+	f.line = 8;
+	*f.retvalue = stack[1];
+	return true;
+	return true;
+}
+
+// res://gd_aot_fixture.gd::mix
+static Variant::ValidatedOperatorEvaluator _gdaot_3_mix_ops[5];
+
+static bool _gdaot_3_mix(GDScriptAOTFrame &f) {
+	if (unlikely(!f.self)) {
+		f.error = "Cannot access member without instance.";
+		return false;
+	}
+	Variant *stack = f.stack;
+
+	switch (f.defarg) {
+		case 0:
+			goto L4;
+		case 1:
+			goto L1;
+	}
+L1:
+	stack[1] = f.constants[0];
+L4:
+	f.line = 10;
+	if (likely(stack[0].get_type() == Variant::FLOAT && stack[1].get_type() == Variant::FLOAT && _gdaot_3_mix_ops[0])) { // *
+		_gdaot_3_mix_ops[0](stack[0], stack[1], stack[4]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(8), stack[0], stack[1], stack[4]));
+	}
+	if (likely(stack[0].get_type() == Variant::FLOAT && stack[1].get_type() == Variant::FLOAT && _gdaot_3_mix_ops[1])) { // /
+		_gdaot_3_mix_ops[1](stack[0], stack[1], stack[5]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(9), stack[0], stack[1], stack[5]));
+	}
+	if (likely(stack[4].get_type() == Variant::FLOAT && stack[5].get_type() == Variant::FLOAT && _gdaot_3_mix_ops[2])) { // -
+		_gdaot_3_mix_ops[2](stack[4], stack[5], stack[4]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(7), stack[4], stack[5], stack[4]));
+	}
+	if (likely(stack[4].get_type() == Variant::Type(3))) {
+		stack[2] = stack[4];
+	} else {
+		GDAOT_TRY(GDScriptAOT::assign_typed(f, Variant::Type(3), stack[4], stack[2]));
+	}
+	f.line = 11;
+	if (likely(stack[2].get_type() == Variant::FLOAT && f.constants[1].get_type() == Variant::FLOAT && _gdaot_3_mix_ops[3])) { // >
+		_gdaot_3_mix_ops[3](stack[2], f.constants[1], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(4), stack[2], f.constants[1], stack[3]));
+	}
+	if (!stack[3].booleanize()) {
+		goto L45;
+	}
+	f.line = 12;
+	{
+		const Variant *args[] = { &stack[2] };
+		GDAOT_TRY(GDScriptAOT::call_builtin(f, 10, args, 1, stack[4])); // sqrt
+	}
+	stack[2] = stack[4];
+L45:
+	f.line = 13;
+	if (likely(stack[2].get_type() == Variant::FLOAT && f.members[1].get_type() == Variant::FLOAT && _gdaot_3_mix_ops[4])) { // *
+		_gdaot_3_mix_ops[4](stack[2], f.members[1], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(8), stack[2], f.members[1], stack[3]));
+	}
+	*f.retvalue = stack[3];
+	return true;
+	return true;
+}
+
+// res://gd_aot_fixture.gd::collatz
+static Variant::ValidatedOperatorEvaluator _gdaot_4_collatz_ops[7];
+
+static bool _gdaot_4_collatz(GDScriptAOTFrame &f) {
+	Variant *stack = f.stack;
+
+	f.line = 15;
+	stack[1] = f.constants[0];
+	f.line = 16;
+	goto L11;
+L9:
+	goto L75;
+L11:
+	if (likely(stack[0].get_type() == Variant::INT && f.constants[1].get_type() == Variant::INT && _gdaot_4_collatz_ops[0])) { // !=
+		_gdaot_4_collatz_ops[0](stack[0], f.constants[1], stack[2]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(1), stack[0], f.constants[1], stack[2]));
+	}
+	if (!stack[2].booleanize()) {
+		goto L9;
+	}
+	f.line = 17;
+	if (likely(stack[0].get_type() == Variant::INT && f.constants[2].get_type() == Variant::INT && _gdaot_4_collatz_ops[1])) { // %
+		_gdaot_4_collatz_ops[1](stack[0], f.constants[2], stack[2]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(12), stack[0], f.constants[2], stack[2]));
+	}
+	if (likely(stack[2].get_type() == Variant::INT && f.constants[0].get_type() == Variant::INT && _gdaot_4_collatz_ops[2])) { // ==
+		_gdaot_4_collatz_ops[2](stack[2], f.constants[0], stack[2]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(0), stack[2], f.constants[0], stack[2]));
+	}
+	if (!stack[2].booleanize()) {
+		goto L46;
+	}
+	f.line = 18;
+	if (likely(stack[0].get_type() == Variant::INT && f.constants[2].get_type() == Variant::INT && _gdaot_4_collatz_ops[3])) { // /
+		_gdaot_4_collatz_ops[3](stack[0], f.constants[2], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(9), stack[0], f.constants[2], stack[3]));
+	}
+	stack[0] = stack[3];
+	goto L63;
+L46:
+	f.line = 20;
+	f.line = 19;
+	if (likely(f.constants[3].get_type() == Variant::INT && stack[0].get_type() == Variant::INT && _gdaot_4_collatz_ops[4])) { // *
+		_gdaot_4_collatz_ops[4](f.constants[3], stack[0], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(8), f.constants[3], stack[0], stack[3]));
+	}
+	if (likely(stack[3].get_type() == Variant::INT && f.constants[1].get_type() == Variant::INT && _gdaot_4_collatz_ops[5])) { // +
+		_gdaot_4_collatz_ops[5](stack[3], f.constants[1], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), stack[3], f.constants[1], stack[3]));
+	}
+	stack[0] = stack[3];
+L63:
+	f.line = 21;
+	if (likely(stack[1].get_type() == Variant::INT && f.constants[1].get_type() == Variant::INT && _gdaot_4_collatz_ops[6])) { // +
+		_gdaot_4_collatz_ops[6](stack[1], f.constants[1], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), stack[1], f.constants[1], stack[3]));
+	}
+	stack[1] = stack[3];
+	goto L11;
+L75:
+	f.line = 22;
+	*f.retvalue = stack[1];
+	return true;
+	return true;
+}
+
+// res://gd_aot_fixture.gd::join_words
+static bool _gdaot_5_join_words(GDScriptAOTFrame &f) {
+	Variant *stack = f.stack;
+
+	f.line = 24;
+	stack[1] = f.constants[0];
+	f.line = 25;
+	stack[4] = stack[0];
+	{
+		int result = GDScriptAOT::iterate(f, true, stack[3], stack[4], stack[2]);
+		if (unlikely(result < 0)) {
+			return false;
+		}
+		if (!result) {
+			goto L17;
+		}
+	}
+	goto L24;
+L17:
+	goto L67;
+L19:
+	{
+		int result = GDScriptAOT::iterate(f, false, stack[3], stack[4], stack[2]);
+		if (unlikely(result < 0)) {
+			return false;
+		}
+		if (!result) {
+			goto L17;
+		}
+	}
+L24:
+	f.line = 26;
+	GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(1), stack[1], f.constants[0], stack[5])); // !=
+	if (!stack[5].booleanize()) {
+		goto L44;
+	}
+	f.line = 27;
+	GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), stack[1], f.constants[1], stack[6])); // +
+	stack[1] = stack[6];
+L44:
+	f.line = 28;
+	{
+		const Variant *args[] = { &stack[2] };
+		GDAOT_TRY(GDScriptAOT::call_builtin(f, 61, args, 1, stack[7])); // str
+	}
+	{
+		GDAOT_TRY(GDScriptAOT::call(f, stack[7], f.global_names[0], nullptr, 0, &stack[7])); // to_upper
+	}
+	GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), stack[1], stack[7], stack[6])); // +
+	stack[1] = stack[6];
+	goto L19;
+L67:
+	f.line = 29;
+	*f.retvalue = stack[1];
+	return true;
+	return true;
+}
+
+// res://gd_aot_fixture.gd::vectors
+static Variant::ValidatedOperatorEvaluator _gdaot_6_vectors_ops[3];
+
+static bool _gdaot_6_vectors(GDScriptAOTFrame &f) {
+	Variant *stack = f.stack;
+
+	f.line = 34;
+	{
+		const Variant *args[] = { &stack[0], &f.constants[0], &f.constants[1] };
+		GDAOT_TRY(GDScriptAOT::construct(f, Variant::Type(9), args, 3, stack[3]));
+	}
+	stack[1] = stack[3];
+	f.line = 35;
+	{
+		const Variant *args[] = { &f.constants[2], &stack[0], &f.constants[3] };
+		GDAOT_TRY(GDScriptAOT::construct(f, Variant::Type(9), args, 3, stack[4]));
+	}
+	stack[2] = stack[4];
+	f.line = 36;
+	if (likely(stack[2].get_type() == Variant::VECTOR3 && f.constants[4].get_type() == Variant::VECTOR3 && _gdaot_6_vectors_ops[0])) { // *
+		_gdaot_6_vectors_ops[0](stack[2], f.constants[4], stack[4]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(8), stack[2], f.constants[4], stack[4]));
+	}
+	if (likely(stack[1].get_type() == Variant::VECTOR3 && stack[4].get_type() == Variant::VECTOR3 && _gdaot_6_vectors_ops[1])) { // +
+		_gdaot_6_vectors_ops[1](stack[1], stack[4], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), stack[1], stack[4], stack[3]));
+	}
+	{
+		const Variant *args[] = { &stack[2] };
+		GDAOT_TRY(GDScriptAOT::call(f, stack[1], f.global_names[0], args, 1, &stack[4])); // cross
+	}
+	if (likely(stack[3].get_type() == Variant::VECTOR3 && stack[4].get_type() == Variant::VECTOR3 && _gdaot_6_vectors_ops[2])) { // -
+		_gdaot_6_vectors_ops[2](stack[3], stack[4], stack[3]);
+	} else {
+		GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(7), stack[3], stack[4], stack[3]));
+	}
+	*f.retvalue = stack[3];
+	return true;
+	return true;
+}
+
+// res://gd_aot_fixture.gd::tally
+static bool _gdaot_7_tally(GDScriptAOTFrame &f) {
+	Variant *stack = f.stack;
+
+	f.line = 38;
+	{
+		Dictionary dict;
+		stack[3] = dict;
+	}
+	stack[1] = stack[3];
+	f.line = 39;
+	stack[4] = stack[0];
+	{
+		int result = GDScriptAOT::iterate(f, true, stack[3], stack[4], stack[2]);
+		if (unlikely(result < 0)) {
+			return false;
+		}
+		if (!result) {
+			goto L20;
+		}
+	}
+	goto L27;
+L20:
+	goto L48;
+L22:
+	{
+		int result = GDScriptAOT::iterate(f, false, stack[3], stack[4], stack[2]);
+		if (unlikely(result < 0)) {
+			return false;
+		}
+		if (!result) {
+			goto L20;
+		}
+	}
+L27:
+	f.line = 40;
+	{
+		const Variant *args[] = { &stack[2], &f.constants[0] };
+		GDAOT_TRY(GDScriptAOT::call(f, stack[1], f.global_names[0], args, 2, &stack[8])); // get
+	}
+	GDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(6), stack[8], f.constants[1], stack[8])); // +
+	GDAOT_TRY(GDScriptAOT::set(f, stack[1], stack[2], stack[8]));
+	goto L22;
+L48:
+	f.line = 41;
+	{
+		GDAOT_TRY(GDScriptAOT::call(f, stack[1], f.global_names[1], nullptr, 0, &stack[2])); // keys
+	}
+	{
+		GDAOT_TRY(GDScriptAOT::call(f, stack[1], f.global_names[2], nullptr, 0, &stack[3])); // values
+	}
+	{
+		Array array;
+		array.resize(2);
+		array[0] = stack[2];
+		array[1] = stack[3];
+		stack[2] = array;
+	}
+	*f.retvalue = stack[2];
+	return true;
+	f.line = 42;
+	return true;
+}
+
+void register_gdscript_aot_gd_aot_fixture() {
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "accumulate", 3698940249u, _gdaot_0_accumulate);
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "_init", 3179021867u, _gdaot_1__init);
+	_gdaot_2_sum_squares_ops[0] = Variant::get_validated_operator_evaluator(Variant::Operator(8), Variant::INT, Variant::INT);
+	_gdaot_2_sum_squares_ops[1] = Variant::get_validated_operator_evaluator(Variant::Operator(6), Variant::INT, Variant::INT);
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "sum_squares", 1604774527u, _gdaot_2_sum_squares);
+	_gdaot_3_mix_ops[0] = Variant::get_validated_operator_evaluator(Variant::Operator(8), Variant::FLOAT, Variant::FLOAT);
+	_gdaot_3_mix_ops[1] = Variant::get_validated_operator_evaluator(Variant::Operator(9), Variant::FLOAT, Variant::FLOAT);
+	_gdaot_3_mix_ops[2] = Variant::get_validated_operator_evaluator(Variant::Operator(7), Variant::FLOAT, Variant::FLOAT);
+	_gdaot_3_mix_ops[3] = Variant::get_validated_operator_evaluator(Variant::Operator(4), Variant::FLOAT, Variant::FLOAT);
+	_gdaot_3_mix_ops[4] = Variant::get_validated_operator_evaluator(Variant::Operator(8), Variant::FLOAT, Variant::FLOAT);
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "mix", 3532399721u, _gdaot_3_mix);
+	_gdaot_4_collatz_ops[0] = Variant::get_validated_operator_evaluator(Variant::Operator(1), Variant::INT, Variant::INT);
+	_gdaot_4_collatz_ops[1] = Variant::get_validated_operator_evaluator(Variant::Operator(12), Variant::INT, Variant::INT);
+	_gdaot_4_collatz_ops[2] = Variant::get_validated_operator_evaluator(Variant::Operator(0), Variant::INT, Variant::INT);
+	_gdaot_4_collatz_ops[3] = Variant::get_validated_operator_evaluator(Variant::Operator(9), Variant::INT, Variant::INT);
+	_gdaot_4_collatz_ops[4] = Variant::get_validated_operator_evaluator(Variant::Operator(8), Variant::INT, Variant::INT);
+	_gdaot_4_collatz_ops[5] = Variant::get_validated_operator_evaluator(Variant::Operator(6), Variant::INT, Variant::INT);
+	_gdaot_4_collatz_ops[6] = Variant::get_validated_operator_evaluator(Variant::Operator(6), Variant::INT, Variant::INT);
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "collatz", 2543056405u, _gdaot_4_collatz);
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "join_words", 1085380127u, _gdaot_5_join_words);
+	_gdaot_6_vectors_ops[0] = Variant::get_validated_operator_evaluator(Variant::Operator(8), Variant::VECTOR3, Variant::VECTOR3);
+	_gdaot_6_vectors_ops[1] = Variant::get_validated_operator_evaluator(Variant::Operator(6), Variant::VECTOR3, Variant::VECTOR3);
+	_gdaot_6_vectors_ops[2] = Variant::get_validated_operator_evaluator(Variant::Operator(7), Variant::VECTOR3, Variant::VECTOR3);
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "vectors", 906866059u, _gdaot_6_vectors);
+	GDScriptAOT::register_function("res://gd_aot_fixture.gd", "tally", 4278981133u, _gdaot_7_tally);
+}
+
+#endif // MODULE_GDSCRIPT_ENABLED
@@ -35,17 +35,24 @@
 #ifdef DEBUG_ENABLED
 
 #include "test_astar.h"
+#include "test_broad_phase_2d.h"
 #include "test_class_db.h"
+#include "test_command_queue.h"
+#include "test_containers.h"
 #include "test_gdscript.h"
 #include "test_gui.h"
 #include "test_math.h"
+#include "test_navigation.h"
 #include "test_oa_hash_map.h"
 #include "test_ordered_hash_map.h"
 #include "test_physics_2d.h"
 #include "test_physics_3d.h"
+#include "test_physics_3d_queries.h"
 #include "test_render.h"
+#include "test_rid_alloc.h"
 #include "test_shader_lang.h"
 #include "test_string.h"
+#include "test_variant_op.h"
 
 const char **tests_get_names() {
 	static const char *test_names[] = {
@@ -53,6 +60,7 @@ const char **tests_get_names() {
 		"math",
 		"physics_2d",
 		"physics_3d",
+		"physics_3d_queries",
 		"render",
 		"oa_hash_map",
 		"class_db",
@@ -62,8 +70,18 @@ const char **tests_get_names() {
 		"gd_parser",
 		"gd_compiler",
 		"gd_bytecode",
+		"gd_aot",
+		"gd_aot_fixture",
+		"gd_coroutines",
+		"gd_compile_cache",
 		"ordered_hash_map",
 		"astar",
+		"broad_phase_2d",
+		"navigation",
+		"variant_op",
+		"command_queue",
+		"rid_alloc",
+		"containers",
 		nullptr
 	};
 
@@ -87,6 +105,10 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestPhysics3D::test();
 	}
 
+	if (p_test == "physics_3d_queries") {
+		return TestPhysics3DQueries::test();
+	}
+
 	if (p_test == "render") {
 		return TestRender::test();
 	}
@@ -125,6 +147,22 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestGDScript::test(TestGDScript::TEST_BYTECODE);
 	}
 
+	if (p_test == "gd_aot") {
+		return TestGDScript::test(TestGDScript::TEST_AOT);
+	}
+
+	if (p_test == "gd_aot_fixture") {
+		return TestGDScript::test(TestGDScript::TEST_AOT_FIXTURE);
+	}
+
+	if (p_test == "gd_coroutines") {
+		return TestGDScript::test(TestGDScript::TEST_COROUTINES);
+	}
+
+	if (p_test == "gd_compile_cache") {
+		return TestGDScript::test(TestGDScript::TEST_COMPILE_CACHE);
+	}
+
 	if (p_test == "ordered_hash_map") {
 		return TestOrderedHashMap::test();
 	}
@@ -133,6 +171,30 @@ MainLoop *test_main(String p_test, const List<String> &p_args) {
 		return TestAStar::test();
 	}
 
+	if (p_test == "broad_phase_2d") {
+		return TestBroadPhase2D::test();
+	}
+
+	if (p_test == "navigation") {
+		return TestNavigation::test();
+	}
+
+	if (p_test == "variant_op") {
+		return TestVariantOp::test();
+	}
+
+	if (p_test == "command_queue") {
+		return TestCommandQueue::test();
+	}
+
+	if (p_test == "rid_alloc") {
+		return TestRIDAlloc::test();
+	}
+
+	if (p_test == "containers") {
+		return TestContainers::test();
+	}
+
 	print_line("Unknown test: " + p_test);
 	return nullptr;
 }
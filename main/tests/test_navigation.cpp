@@ -0,0 +1,155 @@
+/*************************************************************************/
+/*  test_navigation.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_navigation.h"
+
+#include "core/local_vector.h"
+#include "core/math/math_funcs.h"
+#include "core/os/os.h"
+#include "core/project_settings.h"
+#include "scene/resources/navigation_mesh.h"
+#include "servers/navigation_server_3d.h"
+
+namespace TestNavigation {
+
+enum {
+	REGION_SIDE = 8, // Regions along each side of the map.
+	CELL_SIDE = 16, // Quads along each side of a region.
+	QUERY_COUNT = 2000,
+	REPEATED_PAIRS = 100,
+};
+
+static Ref<NavigationMesh> _make_region_mesh(int p_x, int p_z) {
+	Ref<NavigationMesh> mesh;
+	mesh.instance();
+
+	// Neighbour regions share the border vertices, so their edges get connected.
+	Vector<Vector3> vertices;
+	for (int z = 0; z <= CELL_SIDE; z++) {
+		for (int x = 0; x <= CELL_SIDE; x++) {
+			vertices.push_back(Vector3(p_x * CELL_SIDE + x, 0, p_z * CELL_SIDE + z));
+		}
+	}
+	mesh->set_vertices(vertices);
+
+	for (int z = 0; z < CELL_SIDE; z++) {
+		for (int x = 0; x < CELL_SIDE; x++) {
+			const int i = z * (CELL_SIDE + 1) + x;
+			Vector<int> quad;
+			quad.push_back(i);
+			quad.push_back(i + CELL_SIDE + 1);
+			quad.push_back(i + CELL_SIDE + 2);
+			quad.push_back(i + 1);
+			mesh->add_polygon(quad);
+		}
+	}
+
+	return mesh;
+}
+
+static void _run_queries(const String &p_name, bool p_hierarchical, int p_cache_size, const LocalVector<Vector3> &p_from, const LocalVector<Vector3> &p_to) {
+	NavigationServer3D *ns = NavigationServer3D::get_singleton_mut();
+
+	// The settings are read when the map is created.
+	ProjectSettings::get_singleton()->set("navigation/3d/use_hierarchical_pathfinding", p_hierarchical);
+	ProjectSettings::get_singleton()->set("navigation/3d/path_cache_size", p_cache_size);
+
+	RID map = ns->map_create();
+	ns->map_set_active(map, true);
+
+	LocalVector<RID> regions;
+	for (int z = 0; z < REGION_SIDE; z++) {
+		for (int x = 0; x < REGION_SIDE; x++) {
+			RID region = ns->region_create();
+			ns->region_set_map(region, map);
+			ns->region_set_navmesh(region, _make_region_mesh(x, z));
+			regions.push_back(region);
+		}
+	}
+
+	ns->process(0.0);
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	uint64_t points = 0;
+
+	for (uint32_t i = 0; i < p_from.size(); i++) {
+		points += ns->map_get_path(map, p_from[i], p_to[i], true).size();
+	}
+
+	uint64_t usec = MAX(OS::get_singleton()->get_ticks_usec() - from, (uint64_t)1);
+	OS::get_singleton()->print("\t%s: %.3f msec, %.0f queries/sec, %.2f points per path\n", p_name.utf8().get_data(), usec / 1000.0, p_from.size() * 1000000.0 / usec, double(points) / p_from.size());
+
+	for (uint32_t i = 0; i < regions.size(); i++) {
+		ns->free(regions[i]);
+	}
+	ns->free(map);
+	ns->process(0.0);
+}
+
+MainLoop *test() {
+	const real_t map_size = REGION_SIDE * CELL_SIDE;
+	OS::get_singleton()->print("\n\nNavigation: %d path queries on a map of %d regions, %d polygons\n", QUERY_COUNT, REGION_SIDE * REGION_SIDE, REGION_SIDE * REGION_SIDE * CELL_SIDE * CELL_SIDE);
+
+	NavigationServer3D::get_singleton_mut()->set_active(true);
+
+	const Variant hierarchical = ProjectSettings::get_singleton()->get("navigation/3d/use_hierarchical_pathfinding");
+	const Variant cache_size = ProjectSettings::get_singleton()->get("navigation/3d/path_cache_size");
+
+	Math::seed(0x9a7f);
+
+	LocalVector<Vector3> random_from;
+	LocalVector<Vector3> random_to;
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		random_from.push_back(Vector3(Math::randf() * map_size, 0, Math::randf() * map_size));
+		random_to.push_back(Vector3(Math::randf() * map_size, 0, Math::randf() * map_size));
+	}
+
+	// Agents going back and forth between a few places.
+	LocalVector<Vector3> repeated_from;
+	LocalVector<Vector3> repeated_to;
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		const int pair = Math::rand() % REPEATED_PAIRS;
+		repeated_from.push_back(random_from[pair]);
+		repeated_to.push_back(random_to[pair]);
+	}
+
+	_run_queries("random, A*", false, 0, random_from, random_to);
+	_run_queries("random, hierarchical", true, 0, random_from, random_to);
+	_run_queries("repeated, A*", false, 0, repeated_from, repeated_to);
+	_run_queries("repeated, A* + cache", false, REPEATED_PAIRS, repeated_from, repeated_to);
+	_run_queries("repeated, hierarchical + cache", true, REPEATED_PAIRS, repeated_from, repeated_to);
+
+	ProjectSettings::get_singleton()->set("navigation/3d/use_hierarchical_pathfinding", hierarchical);
+	ProjectSettings::get_singleton()->set("navigation/3d/path_cache_size", cache_size);
+
+	return nullptr;
+}
+
+} // namespace TestNavigation
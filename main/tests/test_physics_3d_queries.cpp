@@ -0,0 +1,279 @@
+/*************************************************************************/
+/*  test_physics_3d_queries.cpp                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_physics_3d_queries.h"
+
+#include "core/math/random_pcg.h"
+#include "core/os/os.h"
+#include "servers/physics_server_3d.h"
+
+namespace TestPhysics3DQueries {
+
+enum {
+	// More than one batch, so queries on both sides of a batch boundary are covered.
+	RANDOM_QUERY_COUNT = 150,
+	SHAPE_RESULT_MAX = 8,
+	LAYER_2 = 2,
+};
+
+struct Scene {
+	RID space;
+	Vector<RID> shapes;
+	Vector<RID> bodies;
+	Vector<Object *> objects;
+	RID query_shape;
+	RID first_box;
+};
+
+static RID _add_body(Scene &p_scene, RID p_shape, const Transform &p_xform, uint32_t p_layer = 1) {
+	PhysicsServer3D *ps = PhysicsServer3D::get_singleton();
+
+	Object *object = memnew(Object);
+	RID body = ps->body_create(PhysicsServer3D::BODY_MODE_STATIC);
+	ps->body_add_shape(body, p_shape);
+	ps->body_set_space(body, p_scene.space);
+	ps->body_set_collision_layer(body, p_layer);
+	ps->body_attach_object_instance_id(body, object->get_instance_id());
+	ps->body_set_state(body, PhysicsServer3D::BODY_STATE_TRANSFORM, p_xform);
+
+	p_scene.bodies.push_back(body);
+	p_scene.objects.push_back(object);
+	return body;
+}
+
+static void _build_scene(Scene &p_scene) {
+	PhysicsServer3D *ps = PhysicsServer3D::get_singleton();
+
+	p_scene.space = ps->space_create();
+
+	RID box = ps->shape_create(PhysicsServer3D::SHAPE_BOX);
+	ps->shape_set_data(box, Vector3(0.5, 0.5, 0.5));
+	p_scene.shapes.push_back(box);
+
+	RID sphere = ps->shape_create(PhysicsServer3D::SHAPE_SPHERE);
+	ps->shape_set_data(sphere, 1.0);
+	p_scene.shapes.push_back(sphere);
+
+	p_scene.query_shape = ps->shape_create(PhysicsServer3D::SHAPE_SPHERE);
+	ps->shape_set_data(p_scene.query_shape, 1.2);
+	p_scene.shapes.push_back(p_scene.query_shape);
+
+	// A row of boxes along X, so rays along the row pass through all of them.
+	for (int i = 0; i < 5; i++) {
+		RID body = _add_body(p_scene, box, Transform(Basis(), Vector3(i * 3, 0, 0)));
+		if (i == 0) {
+			p_scene.first_box = body;
+		}
+	}
+
+	_add_body(p_scene, sphere, Transform(Basis(Vector3(0, 1, 0), 0.5), Vector3(3, 0, -4)));
+	_add_body(p_scene, box, Transform(Basis(Vector3(1, 1, 0).normalized(), 0.7), Vector3(9, 1, 3)));
+	_add_body(p_scene, box, Transform(Basis(), Vector3(0, 3, 0)), LAYER_2);
+
+	// Two shapes on one body, so the reported shape index matters.
+	RID compound = _add_body(p_scene, box, Transform(Basis(), Vector3(6, 0, 4)));
+	ps->body_set_shape_transform(compound, 0, Transform(Basis(), Vector3(0, 0, -1)));
+	ps->body_add_shape(compound, box, Transform(Basis(), Vector3(0, 0, 1)));
+}
+
+static void _free_scene(Scene &p_scene) {
+	PhysicsServer3D *ps = PhysicsServer3D::get_singleton();
+
+	for (int i = 0; i < p_scene.bodies.size(); i++) {
+		ps->free(p_scene.bodies[i]);
+		memdelete(p_scene.objects[i]);
+	}
+	for (int i = 0; i < p_scene.shapes.size(); i++) {
+		ps->free(p_scene.shapes[i]);
+	}
+	ps->free(p_scene.space);
+}
+
+static bool _check_rays(PhysicsDirectSpaceState3D *p_state, const Vector<Vector3> &p_from, const Vector<Vector3> &p_to, const Set<RID> &p_exclude, uint32_t p_mask, int &r_hits) {
+	Vector<PhysicsDirectSpaceState3D::RayResult> batch;
+	batch.resize(p_from.size());
+	int batch_hits = p_state->intersect_rays(p_from.ptr(), p_to.ptr(), p_from.size(), batch.ptrw(), p_exclude, p_mask);
+
+	bool ok = true;
+	r_hits = 0;
+	for (int i = 0; i < p_from.size(); i++) {
+		PhysicsDirectSpaceState3D::RayResult single;
+		bool hit = p_state->intersect_ray(p_from[i], p_to[i], single, p_exclude, p_mask);
+		const PhysicsDirectSpaceState3D::RayResult &r = batch[i];
+
+		bool same = hit == r.rid.is_valid();
+		if (same && hit) {
+			same = r.rid == single.rid && r.shape == single.shape && r.collider_id == single.collider_id && r.collider == single.collider &&
+				   r.position.is_equal_approx(single.position) && r.normal.is_equal_approx(single.normal);
+		}
+
+		if (!same) {
+			String batch_hit = r.rid.is_valid() ? "at " + String(r.position) + " normal " + String(r.normal) + " shape " + itos(r.shape) : String("nothing");
+			String single_hit = hit ? "at " + String(single.position) + " normal " + String(single.normal) + " shape " + itos(single.shape) : String("nothing");
+			OS::get_singleton()->print("\tray %d from %s to %s: batch hit %s, single hit %s\n", i, String(p_from[i]).utf8().get_data(), String(p_to[i]).utf8().get_data(), batch_hit.utf8().get_data(), single_hit.utf8().get_data());
+			ok = false;
+		}
+
+		if (hit) {
+			r_hits++;
+		}
+	}
+
+	if (batch_hits != r_hits) {
+		OS::get_singleton()->print("\tintersect_rays returned %d hits, expected %d\n", batch_hits, r_hits);
+		ok = false;
+	}
+
+	return ok;
+}
+
+static bool _same_shape_result(const PhysicsDirectSpaceState3D::ShapeResult &p_a, const PhysicsDirectSpaceState3D::ShapeResult &p_b) {
+	return p_a.rid == p_b.rid && p_a.shape == p_b.shape && p_a.collider_id == p_b.collider_id && p_a.collider == p_b.collider;
+}
+
+static bool _check_shapes(PhysicsDirectSpaceState3D *p_state, RID p_shape, const Vector<Transform> &p_xforms, const Set<RID> &p_exclude, uint32_t p_mask, int &r_hits) {
+	Vector<PhysicsDirectSpaceState3D::ShapeResult> batch;
+	batch.resize(p_xforms.size() * SHAPE_RESULT_MAX);
+	Vector<int> batch_counts;
+	batch_counts.resize(p_xforms.size());
+	p_state->intersect_shapes(p_shape, p_xforms.ptr(), p_xforms.size(), 0, batch.ptrw(), SHAPE_RESULT_MAX, batch_counts.ptrw(), p_exclude, p_mask);
+
+	bool ok = true;
+	r_hits = 0;
+	for (int i = 0; i < p_xforms.size(); i++) {
+		PhysicsDirectSpaceState3D::ShapeResult single[SHAPE_RESULT_MAX];
+		int count = p_state->intersect_shape(p_shape, p_xforms[i], 0, single, SHAPE_RESULT_MAX, p_exclude, p_mask);
+		const PhysicsDirectSpaceState3D::ShapeResult *results = batch.ptr() + i * SHAPE_RESULT_MAX;
+
+		// Both report every overlapping shape, but not necessarily in the same order.
+		bool same = count == batch_counts[i];
+		for (int j = 0; same && j < count; j++) {
+			bool found = false;
+			for (int k = 0; !found && k < count; k++) {
+				found = _same_shape_result(single[j], results[k]);
+			}
+			same = found;
+		}
+
+		if (!same) {
+			OS::get_singleton()->print("\tshape query %d at %s: batch found %d shapes, single found %d\n", i, String(p_xforms[i].origin).utf8().get_data(), batch_counts[i], count);
+			ok = false;
+		}
+
+		r_hits += count;
+	}
+
+	return ok;
+}
+
+static bool _run(PhysicsDirectSpaceState3D *p_state, const Scene &p_scene, const char *p_name, const Set<RID> &p_exclude, uint32_t p_mask) {
+	Vector<Vector3> from;
+	Vector<Vector3> to;
+
+	// Through the whole row of boxes, both ways, and along the compound body.
+	from.push_back(Vector3(-5, 0, 0));
+	to.push_back(Vector3(20, 0, 0));
+	from.push_back(Vector3(20, 0.2, 0.1));
+	to.push_back(Vector3(-5, 0.2, 0.1));
+	from.push_back(Vector3(6, 0, -2));
+	to.push_back(Vector3(6, 0, 10));
+	from.push_back(Vector3(6, 0, 10));
+	to.push_back(Vector3(6, 0, 2));
+	from.push_back(Vector3(-3, -3, -4));
+	to.push_back(Vector3(10, 3, -4));
+	from.push_back(Vector3(0, -5, 0.2));
+	to.push_back(Vector3(0, 5, 0.2));
+	// Misses: above the row, between two boxes, and stopping short of the first box.
+	from.push_back(Vector3(-5, 10, 0));
+	to.push_back(Vector3(20, 10, 0));
+	from.push_back(Vector3(1.5, -5, 0));
+	to.push_back(Vector3(1.5, 5, 0));
+	from.push_back(Vector3(-5, 0, 0));
+	to.push_back(Vector3(-1, 0, 0));
+	from.push_back(Vector3(6, -5, 4));
+	to.push_back(Vector3(6, 5, 4));
+
+	Vector<Transform> xforms;
+	// Overlapping two boxes of the row, both shapes of the compound body, and nothing.
+	xforms.push_back(Transform(Basis(), Vector3(1.5, 0, 0)));
+	xforms.push_back(Transform(Basis(), Vector3(6, 0, 4)));
+	xforms.push_back(Transform(Basis(), Vector3(0, 1.5, 0)));
+	xforms.push_back(Transform(Basis(), Vector3(1.5, 10, 0)));
+	xforms.push_back(Transform(Basis(), Vector3(-5, 0, 0)));
+
+	RandomPCG rng(1234);
+	for (int i = 0; i < RANDOM_QUERY_COUNT; i++) {
+		from.push_back(Vector3(rng.random(-4.0f, 16.0f), rng.random(-3.0f, 4.0f), rng.random(-6.0f, 6.0f)));
+		to.push_back(Vector3(rng.random(-4.0f, 16.0f), rng.random(-3.0f, 4.0f), rng.random(-6.0f, 6.0f)));
+		xforms.push_back(Transform(Basis(), Vector3(rng.random(-4.0f, 16.0f), rng.random(-3.0f, 4.0f), rng.random(-6.0f, 6.0f))));
+	}
+
+	int ray_hits = 0;
+	int shape_hits = 0;
+	bool ok = _check_rays(p_state, from, to, p_exclude, p_mask, ray_hits);
+	ok = _check_shapes(p_state, p_scene.query_shape, xforms, p_exclude, p_mask, shape_hits) && ok;
+
+	// A pass where everything hits or everything misses would not tell much.
+	if (ray_hits == 0 || ray_hits == from.size() || shape_hits == 0) {
+		OS::get_singleton()->print("\t%s: the queries did not mix hits and misses\n", p_name);
+		ok = false;
+	}
+
+	OS::get_singleton()->print("\t%s: %d of %d rays hit, %d shapes found by %d shape queries\n", p_name, ray_hits, from.size(), shape_hits, xforms.size());
+	return ok;
+}
+
+MainLoop *test() {
+	OS::get_singleton()->print("\n\nBatched PhysicsDirectSpaceState3D queries, compared with single queries\n");
+
+	Scene scene;
+	_build_scene(scene);
+
+	bool ok = true;
+	PhysicsDirectSpaceState3D *state = PhysicsServer3D::get_singleton()->space_get_direct_state(scene.space);
+	if (!state) {
+		OS::get_singleton()->print("\tcould not get the direct space state\n");
+		ok = false;
+	} else {
+		Set<RID> exclude;
+		ok = _run(state, scene, "all layers", exclude, 0xFFFFFFFF) && ok;
+		ok = _run(state, scene, "layer 2", exclude, LAYER_2) && ok;
+		exclude.insert(scene.first_box);
+		ok = _run(state, scene, "first box excluded", exclude, 0xFFFFFFFF) && ok;
+	}
+
+	_free_scene(scene);
+
+	OS::get_singleton()->print("Physics 3D query test %s.\n", ok ? "passed" : "FAILED");
+
+	return nullptr;
+}
+
+} // namespace TestPhysics3DQueries
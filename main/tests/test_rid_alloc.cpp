@@ -0,0 +1,243 @@
+/*************************************************************************/
+/*  test_rid_alloc.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_rid_alloc.h"
+
+#include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/rid_owner.h"
+
+#include <atomic>
+
+namespace TestRIDAlloc {
+
+enum {
+	THREADS = 4,
+	ROUNDS = 2000,
+	RIDS_PER_ROUND = 64,
+	LOOKUPS_PER_RID = 16,
+	SHARED_RIDS = 256,
+	HANDOFF_RIDS = 256,
+	HANDOFF_COUNT = 200000,
+};
+
+struct Item {
+	uint64_t owner = 0;
+	uint64_t value = 0;
+};
+
+// Behaves like the thread-safe allocator did before lookups became lock-free:
+// the single-threaded one with one spin lock around every call.
+class LockedAlloc {
+	RID_Alloc<Item> alloc;
+	SpinLock lock;
+
+public:
+	RID make_rid(const Item &p_value) {
+		lock.lock();
+		RID rid = alloc.make_rid(p_value);
+		lock.unlock();
+		return rid;
+	}
+
+	Item *getornull(const RID &p_rid) {
+		lock.lock();
+		Item *item = alloc.getornull(p_rid);
+		lock.unlock();
+		return item;
+	}
+
+	void free(const RID &p_rid) {
+		lock.lock();
+		alloc.free(p_rid);
+		lock.unlock();
+	}
+
+	uint32_t get_rid_count() const {
+		return alloc.get_rid_count();
+	}
+};
+
+template <class A>
+struct Context {
+	A *alloc = nullptr;
+	RID shared[SHARED_RIDS];
+	std::atomic<bool> start = { false };
+	std::atomic<int> errors = { 0 };
+};
+
+template <class A>
+struct Worker {
+	Context<A> *context = nullptr;
+	uint64_t index = 0;
+
+	static void thread_func(void *p_user) {
+		Worker *worker = (Worker *)p_user;
+		Context<A> *context = worker->context;
+		A *alloc = context->alloc;
+
+		while (!context->start.load()) {
+		}
+
+		RID rids[RIDS_PER_ROUND];
+		int errors = 0;
+		for (uint32_t round = 0; round < ROUNDS; round++) {
+			for (uint32_t i = 0; i < RIDS_PER_ROUND; i++) {
+				Item item;
+				item.owner = worker->index;
+				item.value = round * RIDS_PER_ROUND + i;
+				rids[i] = alloc->make_rid(item);
+			}
+
+			for (uint32_t i = 0; i < RIDS_PER_ROUND * LOOKUPS_PER_RID; i++) {
+				uint32_t idx = i % RIDS_PER_ROUND;
+				Item *item = alloc->getornull(rids[idx]);
+				if (!item || item->owner != worker->index || item->value != round * RIDS_PER_ROUND + idx) {
+					errors++;
+				}
+				Item *shared = alloc->getornull(context->shared[i % SHARED_RIDS]);
+				if (!shared || shared->value != i % SHARED_RIDS) {
+					errors++;
+				}
+			}
+
+			for (uint32_t i = 0; i < RIDS_PER_ROUND; i++) {
+				alloc->free(rids[i]);
+				if (alloc->getornull(rids[i])) {
+					errors++;
+				}
+			}
+		}
+
+		context->errors.fetch_add(errors);
+	}
+};
+
+template <class A>
+static bool _run(const char *p_name) {
+	A alloc;
+	Context<A> context;
+	context.alloc = &alloc;
+
+	for (uint32_t i = 0; i < SHARED_RIDS; i++) {
+		Item item;
+		item.owner = THREADS;
+		item.value = i;
+		context.shared[i] = alloc.make_rid(item);
+	}
+
+	Worker<A> workers[THREADS];
+	Thread *threads[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		workers[i].context = &context;
+		workers[i].index = i;
+		threads[i] = Thread::create(Worker<A>::thread_func, &workers[i]);
+	}
+
+	uint64_t from = OS::get_singleton()->get_ticks_usec();
+	context.start.store(true);
+	for (int i = 0; i < THREADS; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+	}
+	uint64_t usec = OS::get_singleton()->get_ticks_usec() - from;
+
+	for (uint32_t i = 0; i < SHARED_RIDS; i++) {
+		alloc.free(context.shared[i]);
+	}
+
+	OS::get_singleton()->print("\t%s: %.3f msec\n", p_name, usec / 1000.0);
+
+	bool ok = context.errors.load() == 0 && alloc.get_rid_count() == 0;
+	if (!ok) {
+		OS::get_singleton()->print("\t%s: %d lookups failed, %d RIDs left\n", p_name, context.errors.load(), alloc.get_rid_count());
+	}
+	return ok;
+}
+
+// One thread makes RIDs and another frees them, like resources created on
+// the main thread and freed on the render thread.
+struct Handoff {
+	RID_Alloc<Item, true> alloc;
+	RID rids[HANDOFF_RIDS];
+	std::atomic<uint32_t> made = { 0 };
+	std::atomic<uint32_t> freed = { 0 };
+
+	static void free_func(void *p_user) {
+		Handoff *handoff = (Handoff *)p_user;
+		for (uint32_t i = 0; i < HANDOFF_COUNT; i++) {
+			while (handoff->made.load(std::memory_order_acquire) == i) {
+			}
+			handoff->alloc.free(handoff->rids[i % HANDOFF_RIDS]);
+			handoff->freed.store(i + 1, std::memory_order_release);
+		}
+	}
+};
+
+static bool _run_handoff() {
+	Handoff *handoff = memnew(Handoff);
+	Thread *thread = Thread::create(Handoff::free_func, handoff);
+
+	// The slot index is the low half of the id, so the highest one seen is
+	// how far the allocator grew.
+	uint32_t max_index = 0;
+	for (uint32_t i = 0; i < HANDOFF_COUNT; i++) {
+		while (i - handoff->freed.load(std::memory_order_acquire) == HANDOFF_RIDS) {
+		}
+		RID rid = handoff->alloc.make_rid(Item());
+		max_index = MAX(max_index, uint32_t(rid.get_id() & 0xFFFFFFFF));
+		handoff->rids[i % HANDOFF_RIDS] = rid;
+		handoff->made.store(i + 1, std::memory_order_release);
+	}
+
+	Thread::wait_to_finish(thread);
+	memdelete(thread);
+
+	// At most HANDOFF_RIDS are alive at once, so the allocator should only
+	// grow past that by a few chunks.
+	bool ok = max_index < HANDOFF_RIDS * 8 && handoff->alloc.get_rid_count() == 0;
+	OS::get_singleton()->print("\tcross-thread free: %d RIDs, highest slot %d\n", HANDOFF_COUNT, max_index);
+	memdelete(handoff);
+	return ok;
+}
+
+MainLoop *test() {
+	OS::get_singleton()->print("\n\nRID_Alloc benchmark: %d threads, %d make/free and %d lookups each\n", THREADS, ROUNDS * RIDS_PER_ROUND, ROUNDS * RIDS_PER_ROUND * LOOKUPS_PER_RID * 2);
+
+	bool ok = _run<LockedAlloc>("spin lock");
+	ok = _run<RID_Alloc<Item, true>>("thread-safe") && ok;
+	ok = _run_handoff() && ok;
+
+	OS::get_singleton()->print("RID_Alloc test %s.\n", ok ? "passed" : "FAILED");
+
+	return nullptr;
+}
+
+} // namespace TestRIDAlloc
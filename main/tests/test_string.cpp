@@ -32,6 +32,8 @@
 
 #include "core/io/ip_address.h"
 #include "core/os/os.h"
+#include "core/os/thread.h"
+#include "core/string_name.h"
 #include "core/ustring.h"
 
 #include "modules/modules_enabled.gen.h"
@@ -1127,6 +1129,56 @@ bool test_35() {
 	return state;
 }
 
+struct StringNameThreadData {
+	int index = 0;
+	Vector<StringName> names;
+};
+
+static void _string_name_thread(void *p_user) {
+	StringNameThreadData *data = (StringNameThreadData *)p_user;
+	// Every thread interns the same names, enough to grow the table.
+	for (int i = 0; i < 5000; i++) {
+		StringName a = "test_36_" + itos(i);
+		StringName b = a;
+		if (i % 2 == data->index % 2) {
+			data->names.push_back(StringName(("test_36_" + itos(i)).utf8().get_data()));
+		} else {
+			data->names.push_back(b);
+		}
+	}
+}
+
+bool test_36() {
+	OS::get_singleton()->print("\n\nTest 36: StringName interning from several threads\n");
+
+	const int thread_count = 4;
+	StringNameThreadData data[thread_count];
+	Thread *threads[thread_count];
+	for (int i = 0; i < thread_count; i++) {
+		data[i].index = i;
+		threads[i] = Thread::create(_string_name_thread, &data[i]);
+	}
+	for (int i = 0; i < thread_count; i++) {
+		Thread::wait_to_finish(threads[i]);
+		memdelete(threads[i]);
+	}
+
+	bool state = true;
+	for (int i = 0; i < 5000 && state; i++) {
+		StringName name = StringName::search("test_36_" + itos(i));
+		state = name == String("test_36_" + itos(i));
+		for (int j = 0; j < thread_count && state; j++) {
+			state = data[j].names[i] == name;
+		}
+	}
+
+	StringName static_name = StaticCString::create("test_36_static");
+	StringName copy = static_name;
+	state = state && copy == static_name && StringName("test_36_static") == static_name && copy == "test_36_static";
+
+	return state;
+}
+
 typedef bool (*TestFunc)();
 
 TestFunc test_funcs[] = {
@@ -1166,6 +1218,7 @@ TestFunc test_funcs[] = {
 	test_33,
 	test_34,
 	test_35,
+	test_36,
 	nullptr
 
 };
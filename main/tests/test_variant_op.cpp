@@ -0,0 +1,130 @@
+/*************************************************************************/
+/*  test_variant_op.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "test_variant_op.h"
+
+#include "core/local_vector.h"
+#include "core/os/os.h"
+
+namespace TestVariantOp {
+
+enum {
+	ITERATIONS = 1000000,
+};
+
+struct Case {
+	Variant::Operator op;
+	Variant a;
+	Variant b;
+};
+
+static void _add_binary_cases(LocalVector<Case> &r_cases, const Variant &p_a, const Variant &p_b) {
+	static const Variant::Operator ops[] = {
+		Variant::OP_EQUAL,
+		Variant::OP_LESS,
+		Variant::OP_ADD,
+		Variant::OP_SUBTRACT,
+		Variant::OP_MULTIPLY,
+		Variant::OP_DIVIDE,
+	};
+	for (int i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])); i++) {
+		r_cases.push_back({ ops[i], p_a, p_b });
+	}
+}
+
+MainLoop *test() {
+	LocalVector<Case> cases;
+	_add_binary_cases(cases, Variant(int64_t(1234)), Variant(int64_t(7)));
+	_add_binary_cases(cases, Variant(int64_t(1234)), Variant(2.5));
+	_add_binary_cases(cases, Variant(1234.5), Variant(int64_t(7)));
+	_add_binary_cases(cases, Variant(1234.5), Variant(2.5));
+	_add_binary_cases(cases, Variant(Vector2(1, 2)), Variant(Vector2(3, 4)));
+	_add_binary_cases(cases, Variant(Vector2(1, 2)), Variant(2.5));
+	_add_binary_cases(cases, Variant(Vector2i(1, 2)), Variant(Vector2i(3, 4)));
+	_add_binary_cases(cases, Variant(Vector3(1, 2, 3)), Variant(Vector3(4, 5, 6)));
+	_add_binary_cases(cases, Variant(Vector3(1, 2, 3)), Variant(2.5));
+	_add_binary_cases(cases, Variant(Vector3i(1, 2, 3)), Variant(Vector3i(4, 5, 6)));
+	cases.push_back({ Variant::OP_NEGATE, Variant(1234.5), Variant() });
+	cases.push_back({ Variant::OP_NEGATE, Variant(Vector3(1, 2, 3)), Variant() });
+
+	OS::get_singleton()->print("\n\nVariant operators: %d evaluations per case, evaluate() vs validated evaluator\n", ITERATIONS);
+
+	uint64_t total_generic = 0;
+	uint64_t total_validated = 0;
+	int mismatches = 0;
+
+	for (uint32_t i = 0; i < cases.size(); i++) {
+		const Case &c = cases[i];
+		String name = Variant::get_type_name(c.a.get_type()) + " " + Variant::get_operator_name(c.op) + " " + Variant::get_type_name(c.b.get_type());
+
+		Variant::ValidatedOperatorEvaluator evaluator = Variant::get_validated_operator_evaluator(c.op, c.a.get_type(), c.b.get_type());
+		if (!evaluator) {
+			// Combinations that can fail, like divisions checked for zero, stay on evaluate().
+			OS::get_singleton()->print("\t%s: no validated evaluator\n", name.utf8().get_data());
+			continue;
+		}
+
+		Variant generic_ret;
+		bool valid = true;
+		uint64_t from = OS::get_singleton()->get_ticks_usec();
+		for (int j = 0; j < ITERATIONS; j++) {
+			Variant::evaluate(c.op, c.a, c.b, generic_ret, valid);
+		}
+		uint64_t generic_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+		Variant validated_ret;
+		from = OS::get_singleton()->get_ticks_usec();
+		for (int j = 0; j < ITERATIONS; j++) {
+			evaluator(c.a, c.b, validated_ret);
+		}
+		uint64_t validated_usec = OS::get_singleton()->get_ticks_usec() - from;
+
+		total_generic += generic_usec;
+		total_validated += validated_usec;
+
+		bool match = valid && generic_ret.get_type() == validated_ret.get_type() && generic_ret == validated_ret;
+		if (!match) {
+			mismatches++;
+		}
+		OS::get_singleton()->print("\t%s: %.3f msec vs %.3f msec%s\n", name.utf8().get_data(), generic_usec / 1000.0, validated_usec / 1000.0, match ? "" : " (MISMATCH)");
+	}
+
+	OS::get_singleton()->print("\ttotal: %.3f msec vs %.3f msec\n", total_generic / 1000.0, total_validated / 1000.0);
+
+	if (mismatches) {
+		OS::get_singleton()->print("Variant validated operator test FAILED: %d results differ from evaluate().\n", mismatches);
+	} else {
+		OS::get_singleton()->print("Variant validated operator test passed.\n");
+	}
+
+	return nullptr;
+}
+
+} // namespace TestVariantOp
@@ -31,6 +31,7 @@
 #include "gd_navigation_server.h"
 
 #include "core/os/mutex.h"
+#include "core/project_settings.h"
 
 #ifndef _3D_DISABLED
 #include "navigation_mesh_generator.h"
@@ -115,6 +116,9 @@
 
 GdNavigationServer::GdNavigationServer() :
 		NavigationServer3D() {
+	GLOBAL_DEF("navigation/3d/use_hierarchical_pathfinding", false);
+	GLOBAL_DEF("navigation/3d/path_cache_size", 0);
+	ProjectSettings::get_singleton()->set_custom_property_info("navigation/3d/path_cache_size", PropertyInfo(Variant::INT, "navigation/3d/path_cache_size", PROPERTY_HINT_RANGE, "0,4096,1,or_greater"));
 }
 
 GdNavigationServer::~GdNavigationServer() {
@@ -133,6 +137,8 @@ RID GdNavigationServer::map_create() const {
 	auto mut_this = const_cast<GdNavigationServer *>(this);
 	MutexLock lock(mut_this->operations_mutex);
 	NavMap *space = memnew(NavMap);
+	space->set_use_hierarchical_pathfinding(GLOBAL_GET("navigation/3d/use_hierarchical_pathfinding"));
+	space->set_path_cache_size(GLOBAL_GET("navigation/3d/path_cache_size"));
 	RID rid = map_owner.make_rid(space);
 	space->set_self(rid);
 	return rid;
@@ -207,6 +213,21 @@ Vector<Vector3> GdNavigationServer::map_get_path(RID p_map, Vector3 p_origin, Ve
 	return map->get_path(p_origin, p_destination, p_optimize);
 }
 
+void GdNavigationServer::map_query_path(RID p_map, Vector3 p_origin, Vector3 p_destination, bool p_optimize, Object *p_receiver, StringName p_method, Variant p_udata) const {
+	NavMap *map = map_owner.getornull(p_map);
+	ERR_FAIL_COND(map == nullptr);
+	ERR_FAIL_COND(p_receiver == nullptr);
+
+	NavMap::PathQuery query;
+	query.origin = p_origin;
+	query.destination = p_destination;
+	query.optimize = p_optimize;
+	query.receiver = p_receiver->get_instance_id();
+	query.method = p_method;
+	query.udata = p_udata;
+	map->query_path(query);
+}
+
 Vector3 GdNavigationServer::map_get_closest_point_to_segment(RID p_map, const Vector3 &p_from, const Vector3 &p_to, const bool p_use_collision) const {
 	const NavMap *map = map_owner.getornull(p_map);
 	ERR_FAIL_COND_V(map == nullptr, Vector3());
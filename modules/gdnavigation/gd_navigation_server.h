@@ -101,6 +101,7 @@ public:
 	virtual real_t map_get_edge_connection_margin(RID p_map) const;
 
 	virtual Vector<Vector3> map_get_path(RID p_map, Vector3 p_origin, Vector3 p_destination, bool p_optimize) const;
+	virtual void map_query_path(RID p_map, Vector3 p_origin, Vector3 p_destination, bool p_optimize, Object *p_receiver, StringName p_method, Variant p_udata = Variant()) const;
 
 	virtual Vector3 map_get_closest_point_to_segment(RID p_map, const Vector3 &p_from, const Vector3 &p_to, const bool p_use_collision = false) const;
 	virtual Vector3 map_get_closest_point(RID p_map, const Vector3 &p_point) const;
@@ -35,12 +35,20 @@
 #include "rvo_agent.h"
 
 #include <algorithm>
+#include <functional>
 
 /**
 	@author AndreaCatania
 */
 
-#define USE_ENTRY_POINT
+NavMap::~NavMap() {
+	if (queries_job) {
+		_finish_path_queries();
+	}
+	if (snapshot) {
+		snapshot->release();
+	}
+}
 
 void NavMap::set_up(Vector3 p_up) {
 	up = p_up;
@@ -57,6 +65,16 @@ void NavMap::set_edge_connection_margin(float p_edge_connection_margin) {
 	regenerate_links = true;
 }
 
+void NavMap::set_use_hierarchical_pathfinding(bool p_enabled) {
+	use_hierarchical_pathfinding = p_enabled;
+	regenerate_snapshot = true;
+}
+
+void NavMap::set_path_cache_size(int p_size) {
+	path_cache_size = p_size;
+	regenerate_snapshot = true;
+}
+
 gd::PointKey NavMap::get_point_key(const Vector3 &p_pos) const {
 	const int x = int(Math::floor(p_pos.x / cell_size));
 	const int y = int(Math::floor(p_pos.y / cell_size));
@@ -70,317 +88,29 @@ gd::PointKey NavMap::get_point_key(const Vector3 &p_pos) const {
 	return p;
 }
 
-Vector<Vector3> NavMap::get_path(Vector3 p_origin, Vector3 p_destination, bool p_optimize) const {
-	const gd::Polygon *begin_poly = nullptr;
-	const gd::Polygon *end_poly = nullptr;
-	Vector3 begin_point;
-	Vector3 end_point;
-	float begin_d = 1e20;
-	float end_d = 1e20;
-
-	// Find the initial poly and the end poly on this map.
-	for (size_t i(0); i < polygons.size(); i++) {
-		const gd::Polygon &p = polygons[i];
-
-		// For each point cast a face and check the distance between the origin/destination
-		for (size_t point_id = 2; point_id < p.points.size(); point_id++) {
-			Face3 f(p.points[point_id - 2].pos, p.points[point_id - 1].pos, p.points[point_id].pos);
-			Vector3 spoint = f.get_closest_point_to(p_origin);
-			float dpoint = spoint.distance_to(p_origin);
-			if (dpoint < begin_d) {
-				begin_d = dpoint;
-				begin_poly = &p;
-				begin_point = spoint;
-			}
-
-			spoint = f.get_closest_point_to(p_destination);
-			dpoint = spoint.distance_to(p_destination);
-			if (dpoint < end_d) {
-				end_d = dpoint;
-				end_poly = &p;
-				end_point = spoint;
-			}
-		}
+NavMapSnapshot *NavMap::get_snapshot() const {
+	MutexLock lock(snapshot_mutex);
+	if (snapshot) {
+		snapshot->reference();
 	}
+	return snapshot;
+}
 
-	if (!begin_poly || !end_poly) {
-		// No path
+Vector<Vector3> NavMap::get_path(Vector3 p_origin, Vector3 p_destination, bool p_optimize) const {
+	NavMapSnapshot *current = get_snapshot();
+	if (!current) {
+		// Not synced yet.
 		return Vector<Vector3>();
 	}
 
-	if (begin_poly == end_poly) {
-		Vector<Vector3> path;
-		path.resize(2);
-		path.write[0] = begin_point;
-		path.write[1] = end_point;
-		return path;
-	}
-
-	std::vector<gd::NavigationPoly> navigation_polys;
-	navigation_polys.reserve(polygons.size() * 0.75);
-
-	// The elements indices in the `navigation_polys`.
-	int least_cost_id(-1);
-	List<uint32_t> open_list;
-	bool found_route = false;
-
-	navigation_polys.push_back(gd::NavigationPoly(begin_poly));
-	{
-		least_cost_id = 0;
-		gd::NavigationPoly *least_cost_poly = &navigation_polys[least_cost_id];
-		least_cost_poly->self_id = least_cost_id;
-		least_cost_poly->entry = begin_point;
-	}
-
-	open_list.push_back(0);
-
-	const gd::Polygon *reachable_end = nullptr;
-	float reachable_d = 1e30;
-	bool is_reachable = true;
-
-	while (found_route == false) {
-		{
-			// Takes the current least_cost_poly neighbors and compute the traveled_distance of each
-			for (size_t i = 0; i < navigation_polys[least_cost_id].poly->edges.size(); i++) {
-				gd::NavigationPoly *least_cost_poly = &navigation_polys[least_cost_id];
-
-				const gd::Edge &edge = least_cost_poly->poly->edges[i];
-				if (!edge.other_polygon) {
-					continue;
-				}
-
-#ifdef USE_ENTRY_POINT
-				Vector3 edge_line[2] = {
-					least_cost_poly->poly->points[i].pos,
-					least_cost_poly->poly->points[(i + 1) % least_cost_poly->poly->points.size()].pos
-				};
-
-				const Vector3 new_entry = Geometry3D::get_closest_point_to_segment(least_cost_poly->entry, edge_line);
-				const float new_distance = least_cost_poly->entry.distance_to(new_entry) + least_cost_poly->traveled_distance;
-#else
-				const float new_distance = least_cost_poly->poly->center.distance_to(edge.other_polygon->center) + least_cost_poly->traveled_distance;
-#endif
-
-				auto it = std::find(
-						navigation_polys.begin(),
-						navigation_polys.end(),
-						gd::NavigationPoly(edge.other_polygon));
-
-				if (it != navigation_polys.end()) {
-					// Oh this was visited already, can we win the cost?
-					if (it->traveled_distance > new_distance) {
-						it->prev_navigation_poly_id = least_cost_id;
-						it->back_navigation_edge = edge.other_edge;
-						it->traveled_distance = new_distance;
-#ifdef USE_ENTRY_POINT
-						it->entry = new_entry;
-#endif
-					}
-				} else {
-					// Add to open neighbours
-
-					navigation_polys.push_back(gd::NavigationPoly(edge.other_polygon));
-					gd::NavigationPoly *np = &navigation_polys[navigation_polys.size() - 1];
-
-					np->self_id = navigation_polys.size() - 1;
-					np->prev_navigation_poly_id = least_cost_id;
-					np->back_navigation_edge = edge.other_edge;
-					np->traveled_distance = new_distance;
-#ifdef USE_ENTRY_POINT
-					np->entry = new_entry;
-#endif
-					open_list.push_back(navigation_polys.size() - 1);
-				}
-			}
-		}
-
-		// Removes the least cost polygon from the open list so we can advance.
-		open_list.erase(least_cost_id);
-
-		if (open_list.size() == 0) {
-			// When the open list is empty at this point the End Polygon is not reachable
-			// so use the further reachable polygon
-			ERR_BREAK_MSG(is_reachable == false, "It's not expect to not find the most reachable polygons");
-			is_reachable = false;
-			if (reachable_end == nullptr) {
-				// The path is not found and there is not a way out.
-				break;
-			}
-
-			// Set as end point the furthest reachable point.
-			end_poly = reachable_end;
-			end_d = 1e20;
-			for (size_t point_id = 2; point_id < end_poly->points.size(); point_id++) {
-				Face3 f(end_poly->points[point_id - 2].pos, end_poly->points[point_id - 1].pos, end_poly->points[point_id].pos);
-				Vector3 spoint = f.get_closest_point_to(p_destination);
-				float dpoint = spoint.distance_to(p_destination);
-				if (dpoint < end_d) {
-					end_point = spoint;
-					end_d = dpoint;
-				}
-			}
-
-			// Reset open and navigation_polys
-			gd::NavigationPoly np = navigation_polys[0];
-			navigation_polys.clear();
-			navigation_polys.push_back(np);
-			open_list.clear();
-			open_list.push_back(0);
-
-			reachable_end = nullptr;
-
-			continue;
-		}
-
-		// Now take the new least_cost_poly from the open list.
-		least_cost_id = -1;
-		float least_cost = 1e30;
-
-		for (auto element = open_list.front(); element != nullptr; element = element->next()) {
-			gd::NavigationPoly *np = &navigation_polys[element->get()];
-			float cost = np->traveled_distance;
-#ifdef USE_ENTRY_POINT
-			cost += np->entry.distance_to(end_point);
-#else
-			cost += np->poly->center.distance_to(end_point);
-#endif
-			if (cost < least_cost) {
-				least_cost_id = np->self_id;
-				least_cost = cost;
-			}
-		}
-
-		// Stores the further reachable end polygon, in case our goal is not reachable.
-		if (is_reachable) {
-			float d = navigation_polys[least_cost_id].entry.distance_to(p_destination);
-			if (reachable_d > d) {
-				reachable_d = d;
-				reachable_end = navigation_polys[least_cost_id].poly;
-			}
-		}
-
-		ERR_BREAK(least_cost_id == -1);
-
-		// Check if we reached the end
-		if (navigation_polys[least_cost_id].poly == end_poly) {
-			// Yep, done!!
-			found_route = true;
-			break;
-		}
-	}
-
-	if (found_route) {
-		Vector<Vector3> path;
-		if (p_optimize) {
-			// String pulling
-
-			gd::NavigationPoly *apex_poly = &navigation_polys[least_cost_id];
-			Vector3 apex_point = end_point;
-			Vector3 portal_left = apex_point;
-			Vector3 portal_right = apex_point;
-			gd::NavigationPoly *left_poly = apex_poly;
-			gd::NavigationPoly *right_poly = apex_poly;
-			gd::NavigationPoly *p = apex_poly;
-
-			path.push_back(end_point);
-
-			while (p) {
-				Vector3 left;
-				Vector3 right;
-
-#define CLOCK_TANGENT(m_a, m_b, m_c) (((m_a) - (m_c)).cross((m_a) - (m_b)))
-
-				if (p->poly == begin_poly) {
-					left = begin_point;
-					right = begin_point;
-				} else {
-					int prev = p->back_navigation_edge;
-					int prev_n = (p->back_navigation_edge + 1) % p->poly->points.size();
-					left = p->poly->points[prev].pos;
-					right = p->poly->points[prev_n].pos;
-
-					if (p->poly->clockwise) {
-						SWAP(left, right);
-					}
-				}
-
-				bool skip = false;
-
-				if (CLOCK_TANGENT(apex_point, portal_left, left).dot(up) >= 0) {
-					//process
-					if (portal_left == apex_point || CLOCK_TANGENT(apex_point, left, portal_right).dot(up) > 0) {
-						left_poly = p;
-						portal_left = left;
-					} else {
-						clip_path(navigation_polys, path, apex_poly, portal_right, right_poly);
-
-						apex_point = portal_right;
-						p = right_poly;
-						left_poly = p;
-						apex_poly = p;
-						portal_left = apex_point;
-						portal_right = apex_point;
-						path.push_back(apex_point);
-						skip = true;
-					}
-				}
-
-				if (!skip && CLOCK_TANGENT(apex_point, portal_right, right).dot(up) <= 0) {
-					//process
-					if (portal_right == apex_point || CLOCK_TANGENT(apex_point, right, portal_left).dot(up) < 0) {
-						right_poly = p;
-						portal_right = right;
-					} else {
-						clip_path(navigation_polys, path, apex_poly, portal_left, left_poly);
-
-						apex_point = portal_left;
-						p = left_poly;
-						right_poly = p;
-						apex_poly = p;
-						portal_right = apex_point;
-						portal_left = apex_point;
-						path.push_back(apex_point);
-					}
-				}
-
-				if (p->prev_navigation_poly_id != -1) {
-					p = &navigation_polys[p->prev_navigation_poly_id];
-				} else {
-					// The end
-					p = nullptr;
-				}
-			}
-
-			if (path[path.size() - 1] != begin_point) {
-				path.push_back(begin_point);
-			}
-
-			path.invert();
-
-		} else {
-			path.push_back(end_point);
-
-			// Add mid points
-			int np_id = least_cost_id;
-			while (np_id != -1) {
-#ifdef USE_ENTRY_POINT
-				Vector3 point = navigation_polys[np_id].entry;
-#else
-				int prev = navigation_polys[np_id].back_navigation_edge;
-				int prev_n = (navigation_polys[np_id].back_navigation_edge + 1) % navigation_polys[np_id].poly->points.size();
-				Vector3 point = (navigation_polys[np_id].poly->points[prev].pos + navigation_polys[np_id].poly->points[prev_n].pos) * 0.5;
-#endif
-
-				path.push_back(point);
-				np_id = navigation_polys[np_id].prev_navigation_poly_id;
-			}
-
-			path.invert();
-		}
+	Vector<Vector3> path = current->get_path(p_origin, p_destination, p_optimize);
+	current->release();
+	return path;
+}
 
-		return path;
-	}
-	return Vector<Vector3>();
+void NavMap::query_path(const PathQuery &p_query) {
+	MutexLock lock(queries_mutex);
+	queued_queries.push_back(p_query);
 }
 
 Vector3 NavMap::get_closest_point_to_segment(const Vector3 &p_from, const Vector3 &p_to, const bool p_use_collision) const {
@@ -390,7 +120,7 @@ Vector3 NavMap::get_closest_point_to_segment(const Vector3 &p_from, const Vector
 
 	// Find the initial poly and the end poly on this map.
 	for (size_t i(0); i < polygons.size(); i++) {
-		const gd::Polygon &p = polygons[i];
+		const gd::Polygon &p = *polygons[i];
 
 		// For each point cast a face and check the distance to the segment
 		for (size_t point_id = 2; point_id < p.points.size(); point_id += 1) {
@@ -441,7 +171,7 @@ Vector3 NavMap::get_closest_point(const Vector3 &p_point) const {
 
 	// Find the initial poly and the end poly on this map.
 	for (size_t i(0); i < polygons.size(); i++) {
-		const gd::Polygon &p = polygons[i];
+		const gd::Polygon &p = *polygons[i];
 
 		// For each point cast a face and check the distance to the point
 		for (size_t point_id = 2; point_id < p.points.size(); point_id += 1) {
@@ -467,7 +197,7 @@ Vector3 NavMap::get_closest_point_normal(const Vector3 &p_point) const {
 
 	// Find the initial poly and the end poly on this map.
 	for (size_t i(0); i < polygons.size(); i++) {
-		const gd::Polygon &p = polygons[i];
+		const gd::Polygon &p = *polygons[i];
 
 		// For each point cast a face and check the distance to the point
 		for (size_t point_id = 2; point_id < p.points.size(); point_id += 1) {
@@ -494,7 +224,7 @@ RID NavMap::get_closest_point_owner(const Vector3 &p_point) const {
 
 	// Find the initial poly and the end poly on this map.
 	for (size_t i(0); i < polygons.size(); i++) {
-		const gd::Polygon &p = polygons[i];
+		const gd::Polygon &p = *polygons[i];
 
 		// For each point cast a face and check the distance to the point
 		for (size_t point_id = 2; point_id < p.points.size(); point_id += 1) {
@@ -513,15 +243,20 @@ RID NavMap::get_closest_point_owner(const Vector3 &p_point) const {
 }
 
 void NavMap::add_region(NavRegion *p_region) {
+	// The region is connected on the next sync, when its polygons are built for this map.
 	regions.push_back(p_region);
-	regenerate_links = true;
 }
 
 void NavMap::remove_region(NavRegion *p_region) {
 	std::vector<NavRegion *>::iterator it = std::find(regions.begin(), regions.end(), p_region);
 	if (it != regions.end()) {
+		_disconnect_region(p_region);
 		regions.erase(it);
-		regenerate_links = true;
+		regions_removed = true;
+
+		// The region is freed right after this, and the map may not be synced
+		// again before the next query: its polygons must go now.
+		_update_polygons();
 	}
 }
 
@@ -560,156 +295,292 @@ void NavMap::remove_agent_as_controlled(RvoAgent *agent) {
 	}
 }
 
-void NavMap::sync() {
-	if (regenerate_polygons) {
-		for (size_t r(0); r < regions.size(); r++) {
-			regions[r]->scratch_polygons();
-		}
-		regenerate_links = true;
-	}
+void NavMap::_reopen_edge(gd::Polygon *p_poly, int p_edge) {
+	p_poly->edges[p_edge] = gd::Edge();
 
-	for (size_t r(0); r < regions.size(); r++) {
-		if (regions[r]->sync()) {
-			regenerate_links = true;
+	gd::FreeEdge free_edge;
+	free_edge.is_free = true;
+	free_edge.poly = p_poly;
+	free_edge.edge_id = p_edge;
+	reopened_edges.push_back(free_edge);
+}
+
+void NavMap::_disconnect_region(NavRegion *p_region) {
+	// Edges of this region that were waiting for a link are about to go away.
+	for (size_t i(0); i < reopened_edges.size(); i++) {
+		if (reopened_edges[i].poly->owner == p_region) {
+			reopened_edges[i] = reopened_edges.back();
+			reopened_edges.pop_back();
+			i--;
 		}
 	}
 
-	if (regenerate_links) {
-		// Copy all region polygons in the map.
-		int count = 0;
-		for (size_t r(0); r < regions.size(); r++) {
-			count += regions[r]->get_polygons().size();
-		}
+	std::vector<gd::Polygon> &region_polygons = p_region->get_polygons();
+	for (size_t poly_id(0); poly_id < region_polygons.size(); poly_id++) {
+		gd::Polygon &poly(region_polygons[poly_id]);
 
-		polygons.resize(count);
-		count = 0;
+		for (size_t p(0); p < poly.points.size(); p++) {
+			int next_point = (p + 1) % poly.points.size();
+			gd::EdgeKey ek(poly.points[p].key, poly.points[next_point].key);
 
-		for (size_t r(0); r < regions.size(); r++) {
-			std::copy(
-					regions[r]->get_polygons().data(),
-					regions[r]->get_polygons().data() + regions[r]->get_polygons().size(),
-					polygons.begin() + count);
+			// Drop the polygon from the connection, the other side keeps the entry.
+			Map<gd::EdgeKey, gd::Connection>::Element *connection = connections.find(ek);
+			if (connection) {
+				gd::Connection &c = connection->get();
+				if (c.B == &poly) {
+					c.B = nullptr;
+					c.B_edge = -1;
+				} else if (c.A == &poly) {
+					c.A = c.B;
+					c.A_edge = c.B_edge;
+					c.B = nullptr;
+					c.B_edge = -1;
+				}
+				if (c.A == nullptr) {
+					connections.erase(connection);
+				}
+			}
 
-			count += regions[r]->get_polygons().size();
+			// The polygon on the other side can link again on the next sync.
+			gd::Edge &edge = poly.edges[p];
+			if (edge.other_polygon && edge.other_polygon->owner != p_region && edge.other_polygon->edges[edge.other_edge].other_polygon == &poly) {
+				_reopen_edge(edge.other_polygon, edge.other_edge);
+			}
+			edge = gd::Edge();
 		}
+	}
+}
 
-		// Connects the `Edges` of all the `Polygons` of all `Regions` each other.
-		Map<gd::EdgeKey, gd::Connection> connections;
-
-		for (size_t poly_id(0); poly_id < polygons.size(); poly_id++) {
-			gd::Polygon &poly(polygons[poly_id]);
+void NavMap::_connect_region(NavRegion *p_region) {
+	std::vector<gd::Polygon> &region_polygons = p_region->get_polygons();
+	for (size_t poly_id(0); poly_id < region_polygons.size(); poly_id++) {
+		gd::Polygon &poly(region_polygons[poly_id]);
+
+		for (size_t p(0); p < poly.points.size(); p++) {
+			int next_point = (p + 1) % poly.points.size();
+			gd::EdgeKey ek(poly.points[p].key, poly.points[next_point].key);
+
+			Map<gd::EdgeKey, gd::Connection>::Element *connection = connections.find(ek);
+			if (!connection) {
+				// Nothing yet
+				gd::Connection c;
+				c.A = &poly;
+				c.A_edge = p;
+				c.B = nullptr;
+				c.B_edge = -1;
+				connections[ek] = c;
+
+			} else if (connection->get().B == nullptr) {
+				CRASH_COND(connection->get().A == nullptr); // Unreachable
+
+				// A shared edge wins over a link to a near edge made in a previous sync.
+				gd::Edge &a_edge = connection->get().A->edges[connection->get().A_edge];
+				if (a_edge.other_polygon) {
+					_reopen_edge(a_edge.other_polygon, a_edge.other_edge);
+				}
 
-			for (size_t p(0); p < poly.points.size(); p++) {
-				int next_point = (p + 1) % poly.points.size();
-				gd::EdgeKey ek(poly.points[p].key, poly.points[next_point].key);
+				// Connect the two Polygons by this edge
+				connection->get().B = &poly;
+				connection->get().B_edge = p;
 
-				Map<gd::EdgeKey, gd::Connection>::Element *connection = connections.find(ek);
-				if (!connection) {
-					// Nothing yet
-					gd::Connection c;
-					c.A = &poly;
-					c.A_edge = p;
-					c.B = nullptr;
-					c.B_edge = -1;
-					connections[ek] = c;
+				connection->get().A->edges[connection->get().A_edge].this_edge = connection->get().A_edge;
+				connection->get().A->edges[connection->get().A_edge].other_polygon = connection->get().B;
+				connection->get().A->edges[connection->get().A_edge].other_edge = connection->get().B_edge;
 
-				} else if (connection->get().B == nullptr) {
-					CRASH_COND(connection->get().A == nullptr); // Unreachable
-
-					// Connect the two Polygons by this edge
-					connection->get().B = &poly;
-					connection->get().B_edge = p;
+				connection->get().B->edges[connection->get().B_edge].this_edge = connection->get().B_edge;
+				connection->get().B->edges[connection->get().B_edge].other_polygon = connection->get().A;
+				connection->get().B->edges[connection->get().B_edge].other_edge = connection->get().A_edge;
+			} else {
+				// The edge is already connected with another edge, skip.
+				ERR_PRINT("Attempted to merge a navigation mesh triangle edge with another already-merged edge. This happens when the Navigation3D's `cell_size` is different from the one used to generate the navigation mesh. This will cause navigation problem.");
+			}
+		}
+	}
+}
 
-					connection->get().A->edges[connection->get().A_edge].this_edge = connection->get().A_edge;
-					connection->get().A->edges[connection->get().A_edge].other_polygon = connection->get().B;
-					connection->get().A->edges[connection->get().A_edge].other_edge = connection->get().B_edge;
+static void _fill_free_edge(gd::FreeEdge &r_edge) {
+	uint32_t point_0(r_edge.edge_id);
+	uint32_t point_1((r_edge.edge_id + 1) % r_edge.poly->points.size());
+	Vector3 pos_0 = r_edge.poly->points[point_0].pos;
+	Vector3 pos_1 = r_edge.poly->points[point_1].pos;
+	Vector3 relative = pos_1 - pos_0;
+	r_edge.edge_center = (pos_0 + pos_1) / 2.0;
+	r_edge.edge_dir = relative.normalized();
+	r_edge.edge_len_squared = relative.length_squared();
+}
 
-					connection->get().B->edges[connection->get().B_edge].this_edge = connection->get().B_edge;
-					connection->get().B->edges[connection->get().B_edge].other_polygon = connection->get().A;
-					connection->get().B->edges[connection->get().B_edge].other_edge = connection->get().A_edge;
-				} else {
-					// The edge is already connected with another edge, skip.
-					ERR_PRINT("Attempted to merge a navigation mesh triangle edge with another already-merged edge. This happens when the Navigation3D's `cell_size` is different from the one used to generate the navigation mesh. This will cause navigation problem.");
+void NavMap::_link_free_edges(const std::vector<NavRegion *> &p_changed_regions) {
+	// Only the free edges of the changed regions, and the ones they left free, look for a partner.
+	std::vector<gd::FreeEdge> new_edges;
+	new_edges.swap(reopened_edges);
+
+	for (size_t r(0); r < p_changed_regions.size(); r++) {
+		std::vector<gd::Polygon> &region_polygons = p_changed_regions[r]->get_polygons();
+		for (size_t poly_id(0); poly_id < region_polygons.size(); poly_id++) {
+			gd::Polygon &poly(region_polygons[poly_id]);
+			for (size_t p(0); p < poly.edges.size(); p++) {
+				if (poly.edges[p].other_polygon == nullptr) {
+					gd::FreeEdge free_edge;
+					free_edge.is_free = true;
+					free_edge.poly = &poly;
+					free_edge.edge_id = p;
+					new_edges.push_back(free_edge);
 				}
 			}
 		}
+	}
 
-		// Takes all the free edges.
-		std::vector<gd::FreeEdge> free_edges;
-		free_edges.reserve(connections.size());
-
-		for (auto connection_element = connections.front(); connection_element; connection_element = connection_element->next()) {
-			if (connection_element->get().B == nullptr) {
-				CRASH_COND(connection_element->get().A == nullptr); // Unreachable
-				CRASH_COND(connection_element->get().A_edge < 0); // Unreachable
-
-				// This is a free edge
-				uint32_t id(free_edges.size());
-				free_edges.push_back(gd::FreeEdge());
-				free_edges[id].is_free = true;
-				free_edges[id].poly = connection_element->get().A;
-				free_edges[id].edge_id = connection_element->get().A_edge;
-				uint32_t point_0(free_edges[id].edge_id);
-				uint32_t point_1((free_edges[id].edge_id + 1) % free_edges[id].poly->points.size());
-				Vector3 pos_0 = free_edges[id].poly->points[point_0].pos;
-				Vector3 pos_1 = free_edges[id].poly->points[point_1].pos;
-				Vector3 relative = pos_1 - pos_0;
-				free_edges[id].edge_center = (pos_0 + pos_1) / 2.0;
-				free_edges[id].edge_dir = relative.normalized();
-				free_edges[id].edge_len_squared = relative.length_squared();
-			}
+	if (new_edges.empty()) {
+		return;
+	}
+
+	// Takes all the free edges.
+	std::vector<gd::FreeEdge> free_edges;
+	free_edges.reserve(connections.size());
+
+	for (auto connection_element = connections.front(); connection_element; connection_element = connection_element->next()) {
+		const gd::Connection &c = connection_element->get();
+		if (c.B == nullptr && c.A->edges[c.A_edge].other_polygon == nullptr) {
+			// This is a free edge
+			gd::FreeEdge free_edge;
+			free_edge.is_free = true;
+			free_edge.poly = c.A;
+			free_edge.edge_id = c.A_edge;
+			_fill_free_edge(free_edge);
+			free_edges.push_back(free_edge);
 		}
+	}
 
-		const float ecm_squared(edge_connection_margin * edge_connection_margin);
+	const float ecm_squared(edge_connection_margin * edge_connection_margin);
 #define LEN_TOLLERANCE 0.1
 #define DIR_TOLLERANCE 0.9
-		// In front of tolerance
+	// In front of tolerance
 #define IFO_TOLLERANCE 0.5
 
-		// Find the compatible near edges.
-		//
-		// Note:
-		// Considering that the edges must be compatible (for obvious reasons)
-		// to be connected, create new polygons to remove that small gap is
-		// not really useful and would result in wasteful computation during
-		// connection, integration and path finding.
-		for (size_t i(0); i < free_edges.size(); i++) {
-			if (!free_edges[i].is_free) {
+	// Find the compatible near edges.
+	//
+	// Note:
+	// Considering that the edges must be compatible (for obvious reasons)
+	// to be connected, create new polygons to remove that small gap is
+	// not really useful and would result in wasteful computation during
+	// connection, integration and path finding.
+	for (size_t i(0); i < new_edges.size(); i++) {
+		gd::FreeEdge &edge = new_edges[i];
+		if (edge.poly->edges[edge.edge_id].other_polygon != nullptr) {
+			continue; // Linked since it was collected.
+		}
+		_fill_free_edge(edge);
+
+		for (size_t y(0); y < free_edges.size(); y++) {
+			gd::FreeEdge &other_edge = free_edges[y];
+			if (other_edge.poly->owner == edge.poly->owner || other_edge.poly->edges[other_edge.edge_id].other_polygon != nullptr) {
 				continue;
 			}
-			gd::FreeEdge &edge = free_edges[i];
-			for (size_t y(0); y < free_edges.size(); y++) {
-				gd::FreeEdge &other_edge = free_edges[y];
-				if (i == y || !other_edge.is_free || edge.poly->owner == other_edge.poly->owner) {
-					continue;
-				}
 
-				Vector3 rel_centers = other_edge.edge_center - edge.edge_center;
-				if (ecm_squared > rel_centers.length_squared() // Are enough closer?
-						&& ABS(edge.edge_len_squared - other_edge.edge_len_squared) < LEN_TOLLERANCE // Are the same length?
-						&& ABS(edge.edge_dir.dot(other_edge.edge_dir)) > DIR_TOLLERANCE // Are aligned?
-						&& ABS(rel_centers.normalized().dot(edge.edge_dir)) < IFO_TOLLERANCE // Are one in front the other?
-				) {
-					// The edges can be connected
-					edge.is_free = false;
-					other_edge.is_free = false;
-
-					edge.poly->edges[edge.edge_id].this_edge = edge.edge_id;
-					edge.poly->edges[edge.edge_id].other_edge = other_edge.edge_id;
-					edge.poly->edges[edge.edge_id].other_polygon = other_edge.poly;
-
-					other_edge.poly->edges[other_edge.edge_id].this_edge = other_edge.edge_id;
-					other_edge.poly->edges[other_edge.edge_id].other_edge = edge.edge_id;
-					other_edge.poly->edges[other_edge.edge_id].other_polygon = edge.poly;
-				}
+			Vector3 rel_centers = other_edge.edge_center - edge.edge_center;
+			if (ecm_squared > rel_centers.length_squared() // Are enough closer?
+					&& ABS(edge.edge_len_squared - other_edge.edge_len_squared) < LEN_TOLLERANCE // Are the same length?
+					&& ABS(edge.edge_dir.dot(other_edge.edge_dir)) > DIR_TOLLERANCE // Are aligned?
+					&& ABS(rel_centers.normalized().dot(edge.edge_dir)) < IFO_TOLLERANCE // Are one in front the other?
+			) {
+				// The edges can be connected
+				edge.poly->edges[edge.edge_id].this_edge = edge.edge_id;
+				edge.poly->edges[edge.edge_id].other_edge = other_edge.edge_id;
+				edge.poly->edges[edge.edge_id].other_polygon = other_edge.poly;
+
+				other_edge.poly->edges[other_edge.edge_id].this_edge = other_edge.edge_id;
+				other_edge.poly->edges[other_edge.edge_id].other_edge = edge.edge_id;
+				other_edge.poly->edges[other_edge.edge_id].other_polygon = edge.poly;
+				break;
 			}
 		}
 	}
+}
+
+void NavMap::_update_polygons() {
+	polygons.clear();
+	for (size_t r(0); r < regions.size(); r++) {
+		std::vector<gd::Polygon> &region_polygons = regions[r]->get_polygons();
+		for (size_t poly_id(0); poly_id < region_polygons.size(); poly_id++) {
+			region_polygons[poly_id].id = polygons.size();
+			region_polygons[poly_id].cluster = r;
+			polygons.push_back(&region_polygons[poly_id]);
+		}
+	}
+}
+
+void NavMap::_update_snapshot() {
+	NavMapSnapshot *new_snapshot = NavMapSnapshot::create(polygons, regions.size(), up, use_hierarchical_pathfinding, path_cache_size);
+
+	NavMapSnapshot *old_snapshot;
+	{
+		MutexLock lock(snapshot_mutex);
+		old_snapshot = snapshot;
+		snapshot = new_snapshot;
+	}
+
+	// The queries still running keep their own reference.
+	if (old_snapshot) {
+		old_snapshot->release();
+	}
+}
+
+void NavMap::sync() {
+	if (regenerate_polygons) {
+		for (size_t r(0); r < regions.size(); r++) {
+			regions[r]->scratch_polygons();
+		}
+		regenerate_links = true;
+	}
+
+	std::vector<NavRegion *> changed_regions;
 
 	if (regenerate_links) {
+		// Connect everything from scratch.
+		connections.clear();
+		reopened_edges.clear();
+		for (size_t r(0); r < regions.size(); r++) {
+			std::vector<gd::Polygon> &region_polygons = regions[r]->get_polygons();
+			for (size_t poly_id(0); poly_id < region_polygons.size(); poly_id++) {
+				std::vector<gd::Edge> &edges = region_polygons[poly_id].edges;
+				for (size_t e(0); e < edges.size(); e++) {
+					edges[e] = gd::Edge();
+				}
+			}
+			changed_regions.push_back(regions[r]);
+		}
+	} else {
+		// The polygons of dirty regions are rebuilt, so they have to be disconnected first.
+		for (size_t r(0); r < regions.size(); r++) {
+			if (regions[r]->is_dirty()) {
+				_disconnect_region(regions[r]);
+				changed_regions.push_back(regions[r]);
+			}
+		}
+	}
+
+	for (size_t r(0); r < changed_regions.size(); r++) {
+		changed_regions[r]->sync();
+	}
+
+	for (size_t r(0); r < changed_regions.size(); r++) {
+		_connect_region(changed_regions[r]);
+	}
+
+	if (changed_regions.size() || regions_removed) {
+		_link_free_edges(changed_regions);
+
+		_update_polygons();
+
+		regenerate_snapshot = true;
+
 		map_update_id = map_update_id + 1 % 9999999;
 	}
 
+	if (regenerate_snapshot) {
+		_update_snapshot();
+	}
+
 	if (agents_dirty) {
 		std::vector<RVO::Agent *> raw_agents;
 		raw_agents.reserve(agents.size());
@@ -721,7 +592,11 @@ void NavMap::sync() {
 
 	regenerate_polygons = false;
 	regenerate_links = false;
+	regions_removed = false;
+	regenerate_snapshot = false;
 	agents_dirty = false;
+
+	_start_path_queries();
 }
 
 void NavMap::compute_single_step(uint32_t index, RvoAgent **agent) {
@@ -740,41 +615,67 @@ void NavMap::step(real_t p_deltatime) {
 	}
 }
 
-void NavMap::dispatch_callbacks() {
-	for (int i(0); i < static_cast<int>(controlled_agents.size()); i++) {
-		controlled_agents[i]->dispatch_callback();
+void NavMap::_start_path_queries() {
+	if (queries_job) {
+		// The previous queries are still running, these wait for the next sync.
+		return;
+	}
+
+	{
+		MutexLock lock(queries_mutex);
+		if (queued_queries.empty()) {
+			return;
+		}
+		running_queries.swap(queued_queries);
 	}
+
+	running_snapshot = get_snapshot();
+	queries_job = ThreadWorkPool::get_singleton()->create_job(this, &NavMap::_solve_path_queries, running_snapshot);
+	ThreadWorkPool::get_singleton()->submit_job(queries_job);
 }
 
-void NavMap::clip_path(const std::vector<gd::NavigationPoly> &p_navigation_polys, Vector<Vector3> &path, const gd::NavigationPoly *from_poly, const Vector3 &p_to_point, const gd::NavigationPoly *p_to_poly) const {
-	Vector3 from = path[path.size() - 1];
+void NavMap::_solve_path_query(uint32_t p_index, NavMapSnapshot *p_snapshot) {
+	PathQuery &query = running_queries[p_index];
+	query.path = p_snapshot->get_path(query.origin, query.destination, query.optimize);
+}
 
-	if (from.distance_to(p_to_point) < CMP_EPSILON) {
-		return;
+void NavMap::_solve_path_queries(NavMapSnapshot *p_snapshot) {
+	ThreadWorkPool::get_singleton()->do_work(running_queries.size(), this, &NavMap::_solve_path_query, p_snapshot);
+}
+
+void NavMap::_finish_path_queries() {
+	ThreadWorkPool::get_singleton()->wait_for_job(queries_job);
+	queries_job = nullptr;
+
+	running_snapshot->release();
+	running_snapshot = nullptr;
+}
+
+void NavMap::dispatch_callbacks() {
+	for (int i(0); i < static_cast<int>(controlled_agents.size()); i++) {
+		controlled_agents[i]->dispatch_callback();
 	}
-	Plane cut_plane;
-	cut_plane.normal = (from - p_to_point).cross(up);
-	if (cut_plane.normal == Vector3()) {
+
+	if (queries_job == nullptr || !ThreadWorkPool::get_singleton()->is_job_completed(queries_job)) {
+		// Never wait here, the results are delivered on a later frame.
 		return;
 	}
-	cut_plane.normal.normalize();
-	cut_plane.d = cut_plane.normal.dot(from);
+	_finish_path_queries();
 
-	while (from_poly != p_to_poly) {
-		int back_nav_edge = from_poly->back_navigation_edge;
-		Vector3 a = from_poly->poly->points[back_nav_edge].pos;
-		Vector3 b = from_poly->poly->points[(back_nav_edge + 1) % from_poly->poly->points.size()].pos;
+	std::vector<PathQuery> results;
+	results.swap(running_queries);
 
-		ERR_FAIL_COND(from_poly->prev_navigation_poly_id == -1);
-		from_poly = &p_navigation_polys[from_poly->prev_navigation_poly_id];
-
-		if (a.distance_to(b) > CMP_EPSILON) {
-			Vector3 inters;
-			if (cut_plane.intersects_segment(a, b, &inters)) {
-				if (inters.distance_to(p_to_point) > CMP_EPSILON && inters.distance_to(path[path.size() - 1]) > CMP_EPSILON) {
-					path.push_back(inters);
-				}
-			}
+	for (size_t i(0); i < results.size(); i++) {
+		const PathQuery &query = results[i];
+		Object *obj = ObjectDB::get_instance(query.receiver);
+		if (obj == nullptr) {
+			continue;
 		}
+
+		Callable::CallError call_error;
+		const Variant path = query.path;
+		const Variant *vp[2] = { &path, &query.udata };
+		int argc = (query.udata.get_type() == Variant::NIL) ? 1 : 2;
+		obj->call(query.method, vp, argc, call_error);
 	}
 }
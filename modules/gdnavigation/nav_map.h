@@ -33,7 +33,12 @@
 
 #include "nav_rid.h"
 
+#include "core/map.h"
 #include "core/math/math_defs.h"
+#include "core/object.h"
+#include "core/os/mutex.h"
+#include "core/thread_work_pool.h"
+#include "nav_map_snapshot.h"
 #include "nav_utils.h"
 #include <KdTree.h>
 
@@ -46,6 +51,20 @@ class RvoAgent;
 class NavRegion;
 
 class NavMap : public NavRid {
+public:
+	/// A path query solved asynchronously, the result is delivered to
+	/// the receiver method in `dispatch_callbacks`.
+	struct PathQuery {
+		Vector3 origin;
+		Vector3 destination;
+		bool optimize = false;
+		ObjectID receiver;
+		StringName method;
+		Variant udata;
+		Vector<Vector3> path;
+	};
+
+private:
 	/// Map Up
 	Vector3 up = Vector3(0, 1, 0);
 
@@ -59,10 +78,37 @@ class NavMap : public NavRid {
 	bool regenerate_polygons = true;
 	bool regenerate_links = true;
 
+	/// A region was removed since the last sync.
+	bool regions_removed = false;
+
 	std::vector<NavRegion *> regions;
 
-	/// Map polygons
-	std::vector<gd::Polygon> polygons;
+	/// Map polygons, owned by the regions.
+	std::vector<gd::Polygon *> polygons;
+
+	/// All the polygon edges of the map by key, kept between syncs so only
+	/// the regions that changed have to be connected again.
+	Map<gd::EdgeKey, gd::Connection> connections;
+
+	/// Edges of unchanged regions that lost their link since the last sync.
+	std::vector<gd::FreeEdge> reopened_edges;
+
+	bool use_hierarchical_pathfinding = false;
+	int path_cache_size = 0;
+
+	/// Copy of the map used by the path queries, rebuilt when the map changes.
+	NavMapSnapshot *snapshot = nullptr;
+	bool regenerate_snapshot = true;
+	mutable Mutex snapshot_mutex;
+
+	/// Path queries waiting for the next sync.
+	std::vector<PathQuery> queued_queries;
+	Mutex queries_mutex;
+
+	/// Path queries being solved on the worker threads, against `running_snapshot`.
+	std::vector<PathQuery> running_queries;
+	NavMapSnapshot *running_snapshot = nullptr;
+	ThreadWorkPool::Job *queries_job = nullptr;
 
 	/// Rvo world
 	RVO::KdTree rvo;
@@ -84,6 +130,7 @@ class NavMap : public NavRid {
 
 public:
 	NavMap() {}
+	~NavMap();
 
 	void set_up(Vector3 p_up);
 	Vector3 get_up() const {
@@ -100,9 +147,24 @@ public:
 		return edge_connection_margin;
 	}
 
+	void set_use_hierarchical_pathfinding(bool p_enabled);
+	bool is_using_hierarchical_pathfinding() const {
+		return use_hierarchical_pathfinding;
+	}
+
+	void set_path_cache_size(int p_size);
+	int get_path_cache_size() const {
+		return path_cache_size;
+	}
+
 	gd::PointKey get_point_key(const Vector3 &p_pos) const;
 
+	/// Returns the current snapshot with a reference, that the caller has to release.
+	NavMapSnapshot *get_snapshot() const;
+
 	Vector<Vector3> get_path(Vector3 p_origin, Vector3 p_destination, bool p_optimize) const;
+	/// Thread safe, the query is solved after the next sync.
+	void query_path(const PathQuery &p_query);
 	Vector3 get_closest_point_to_segment(const Vector3 &p_from, const Vector3 &p_to, const bool p_use_collision) const;
 	Vector3 get_closest_point(const Vector3 &p_point) const;
 	Vector3 get_closest_point_normal(const Vector3 &p_point) const;
@@ -133,8 +195,19 @@ public:
 	void dispatch_callbacks();
 
 private:
+	void _disconnect_region(NavRegion *p_region);
+	void _connect_region(NavRegion *p_region);
+	void _reopen_edge(gd::Polygon *p_poly, int p_edge);
+	void _link_free_edges(const std::vector<NavRegion *> &p_changed_regions);
+	void _update_polygons();
+	void _update_snapshot();
+
+	void _start_path_queries();
+	void _solve_path_queries(NavMapSnapshot *p_snapshot);
+	void _solve_path_query(uint32_t p_index, NavMapSnapshot *p_snapshot);
+	void _finish_path_queries();
+
 	void compute_single_step(uint32_t index, RvoAgent **agent);
-	void clip_path(const std::vector<gd::NavigationPoly> &p_navigation_polys, Vector<Vector3> &path, const gd::NavigationPoly *from_poly, const Vector3 &p_to_point, const gd::NavigationPoly *p_to_poly) const;
 };
 
 #endif // RVO_SPACE_H
@@ -0,0 +1,585 @@
+/*************************************************************************/
+/*  nav_map_snapshot.cpp                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "nav_map_snapshot.h"
+
+#include "core/math/geometry_3d.h"
+
+#include <algorithm>
+#include <functional>
+
+#define USE_ENTRY_POINT
+
+NavMapSnapshot *NavMapSnapshot::create(const std::vector<gd::Polygon *> &p_polygons, uint32_t p_region_count, const Vector3 &p_up, bool p_use_hierarchical_pathfinding, int p_path_cache_size) {
+	NavMapSnapshot *snapshot = memnew(NavMapSnapshot);
+	snapshot->refcount.init();
+	snapshot->up = p_up;
+	snapshot->use_hierarchical_pathfinding = p_use_hierarchical_pathfinding;
+	snapshot->path_cache.set_capacity(MAX(p_path_cache_size, 0));
+
+	std::vector<gd::Polygon> &polygons = snapshot->polygons;
+	polygons.resize(p_polygons.size());
+	for (size_t i(0); i < p_polygons.size(); i++) {
+		gd::Polygon &poly = polygons[i];
+		poly = *p_polygons[i];
+		// The regions can be freed while the snapshot is still in use.
+		poly.owner = nullptr;
+
+		for (size_t e(0); e < poly.edges.size(); e++) {
+			if (poly.edges[e].other_polygon) {
+				poly.edges[e].other_polygon = &polygons[poly.edges[e].other_polygon->id];
+			}
+		}
+	}
+
+	std::vector<Cluster> &clusters = snapshot->clusters;
+	clusters.resize(p_region_count);
+	std::vector<uint32_t> cluster_polygons(p_region_count, 0);
+	for (size_t i(0); i < polygons.size(); i++) {
+		const gd::Polygon &poly(polygons[i]);
+		Cluster &cluster = clusters[poly.cluster];
+		cluster.center += poly.center;
+		cluster_polygons[poly.cluster]++;
+
+		for (size_t e(0); e < poly.edges.size(); e++) {
+			const gd::Polygon *other = poly.edges[e].other_polygon;
+			if (other && other->cluster != poly.cluster) {
+				cluster.links.push_back(other->cluster);
+			}
+		}
+	}
+
+	for (size_t c(0); c < clusters.size(); c++) {
+		Cluster &cluster = clusters[c];
+		if (cluster_polygons[c]) {
+			cluster.center /= float(cluster_polygons[c]);
+		}
+		std::sort(cluster.links.begin(), cluster.links.end());
+		cluster.links.erase(std::unique(cluster.links.begin(), cluster.links.end()), cluster.links.end());
+	}
+
+	return snapshot;
+}
+
+void NavMapSnapshot::reference() {
+	refcount.ref();
+}
+
+void NavMapSnapshot::release() {
+	if (refcount.unref()) {
+		memdelete(this);
+	}
+}
+
+void NavMapSnapshot::set_path_cache_size(int p_size) {
+	path_cache.set_capacity(MAX(p_size, 0));
+}
+
+bool NavMapSnapshot::_mark_cluster_route(gd::PathScratch &r_scratch, uint32_t p_from, uint32_t p_to) const {
+	const uint32_t cluster_count = clusters.size();
+	if (r_scratch.cluster_search_pass.size() < cluster_count) {
+		r_scratch.cluster_search_pass.resize(cluster_count, 0);
+		r_scratch.cluster_route_pass.resize(cluster_count, 0);
+		r_scratch.cluster_distance.resize(cluster_count);
+		r_scratch.cluster_prev.resize(cluster_count);
+	}
+	r_scratch.cluster_pass++;
+	if (r_scratch.cluster_pass == 0) {
+		std::fill(r_scratch.cluster_search_pass.begin(), r_scratch.cluster_search_pass.end(), 0);
+		std::fill(r_scratch.cluster_route_pass.begin(), r_scratch.cluster_route_pass.end(), 0);
+		r_scratch.cluster_pass = 1;
+	}
+	const uint32_t pass = r_scratch.cluster_pass;
+
+	// Dijkstra over the regions graph, there are only a few regions.
+	typedef std::pair<float, uint32_t> ClusterEntry;
+	std::vector<ClusterEntry> open;
+	open.push_back(ClusterEntry(0.0, p_from));
+	r_scratch.cluster_search_pass[p_from] = pass;
+	r_scratch.cluster_distance[p_from] = 0.0;
+	r_scratch.cluster_prev[p_from] = -1;
+
+	bool found = false;
+	while (open.size()) {
+		std::pop_heap(open.begin(), open.end(), std::greater<ClusterEntry>());
+		const ClusterEntry current = open.back();
+		open.pop_back();
+
+		if (current.first > r_scratch.cluster_distance[current.second]) {
+			continue; // Stale.
+		}
+		if (current.second == p_to) {
+			found = true;
+			break;
+		}
+
+		const Cluster &cluster = clusters[current.second];
+		for (size_t i(0); i < cluster.links.size(); i++) {
+			const uint32_t other = cluster.links[i];
+			const float distance = current.first + cluster.center.distance_to(clusters[other].center);
+			if (r_scratch.cluster_search_pass[other] != pass || distance < r_scratch.cluster_distance[other]) {
+				r_scratch.cluster_search_pass[other] = pass;
+				r_scratch.cluster_distance[other] = distance;
+				r_scratch.cluster_prev[other] = current.second;
+				open.push_back(ClusterEntry(distance, other));
+				std::push_heap(open.begin(), open.end(), std::greater<ClusterEntry>());
+			}
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	for (int c = p_to; c != -1; c = r_scratch.cluster_prev[c]) {
+		r_scratch.cluster_route_pass[c] = pass;
+	}
+	return true;
+}
+
+bool NavMapSnapshot::_find_route(gd::PathScratch &r_scratch, const gd::Polygon *p_begin_poly, const Vector3 &p_begin_point, const gd::Polygon *&r_end_poly, Vector3 &r_end_point, const Vector3 &p_destination, bool p_restricted, int &r_least_cost_id) const {
+	std::vector<gd::NavigationPoly> &navigation_polys = r_scratch.navigation_polys;
+	std::vector<gd::PathScratch::OpenEntry> &open_heap = r_scratch.open_heap;
+
+	if (r_scratch.poly_pass.size() < polygons.size()) {
+		r_scratch.poly_pass.resize(polygons.size(), 0);
+		r_scratch.poly_navigation_id.resize(polygons.size());
+	}
+
+	const gd::Polygon *reachable_end = nullptr;
+	float reachable_d = 1e30;
+	bool is_reachable = true;
+
+	while (true) {
+		r_scratch.pass++;
+		if (r_scratch.pass == 0) {
+			std::fill(r_scratch.poly_pass.begin(), r_scratch.poly_pass.end(), 0);
+			r_scratch.pass = 1;
+		}
+		const uint32_t pass = r_scratch.pass;
+
+		navigation_polys.clear();
+		open_heap.clear();
+
+		navigation_polys.push_back(gd::NavigationPoly(p_begin_poly));
+		navigation_polys[0].self_id = 0;
+		navigation_polys[0].entry = p_begin_point;
+		r_scratch.poly_pass[p_begin_poly->id] = pass;
+		r_scratch.poly_navigation_id[p_begin_poly->id] = 0;
+
+		gd::PathScratch::OpenEntry begin_entry;
+		begin_entry.cost = 0.0;
+		begin_entry.traveled_distance = 0.0;
+		begin_entry.navigation_poly_id = 0;
+		open_heap.push_back(begin_entry);
+
+		while (open_heap.size()) {
+			// Take the least cost polygon from the open list.
+			std::pop_heap(open_heap.begin(), open_heap.end());
+			const gd::PathScratch::OpenEntry current = open_heap.back();
+			open_heap.pop_back();
+
+			r_least_cost_id = current.navigation_poly_id;
+			gd::NavigationPoly &least_cost_poly = navigation_polys[r_least_cost_id];
+			if (least_cost_poly.closed || current.traveled_distance > least_cost_poly.traveled_distance) {
+				continue; // Stale entry, the polygon was reached by a shorter way.
+			}
+			least_cost_poly.closed = true;
+
+			// Stores the further reachable end polygon, in case our goal is not reachable.
+			if (is_reachable && r_least_cost_id != 0) {
+				float d = least_cost_poly.entry.distance_to(p_destination);
+				if (reachable_d > d) {
+					reachable_d = d;
+					reachable_end = least_cost_poly.poly;
+				}
+			}
+
+			// Check if we reached the end
+			if (least_cost_poly.poly == r_end_poly) {
+				return true;
+			}
+
+			// Takes the current least_cost_poly neighbors and compute the traveled_distance of each
+			const gd::Polygon *poly = least_cost_poly.poly;
+			for (size_t i = 0; i < poly->edges.size(); i++) {
+				const gd::Edge &edge = poly->edges[i];
+				if (!edge.other_polygon) {
+					continue;
+				}
+				if (p_restricted && r_scratch.cluster_route_pass[edge.other_polygon->cluster] != r_scratch.cluster_pass) {
+					continue;
+				}
+
+				const gd::NavigationPoly &from = navigation_polys[r_least_cost_id];
+
+#ifdef USE_ENTRY_POINT
+				Vector3 edge_line[2] = {
+					poly->points[i].pos,
+					poly->points[(i + 1) % poly->points.size()].pos
+				};
+
+				const Vector3 new_entry = Geometry3D::get_closest_point_to_segment(from.entry, edge_line);
+				const float new_distance = from.entry.distance_to(new_entry) + from.traveled_distance;
+#else
+				const float new_distance = poly->center.distance_to(edge.other_polygon->center) + from.traveled_distance;
+#endif
+
+				int np_id;
+				if (r_scratch.poly_pass[edge.other_polygon->id] == pass) {
+					np_id = r_scratch.poly_navigation_id[edge.other_polygon->id];
+					gd::NavigationPoly &np = navigation_polys[np_id];
+
+					// Oh this was visited already, can we win the cost?
+					if (np.traveled_distance <= new_distance) {
+						continue;
+					}
+					np.prev_navigation_poly_id = r_least_cost_id;
+					np.back_navigation_edge = edge.other_edge;
+					np.traveled_distance = new_distance;
+#ifdef USE_ENTRY_POINT
+					np.entry = new_entry;
+#endif
+					if (np.closed) {
+						continue;
+					}
+				} else {
+					// Add to open neighbours
+					np_id = navigation_polys.size();
+					navigation_polys.push_back(gd::NavigationPoly(edge.other_polygon));
+					r_scratch.poly_pass[edge.other_polygon->id] = pass;
+					r_scratch.poly_navigation_id[edge.other_polygon->id] = np_id;
+
+					gd::NavigationPoly &np = navigation_polys[np_id];
+					np.self_id = np_id;
+					np.prev_navigation_poly_id = r_least_cost_id;
+					np.back_navigation_edge = edge.other_edge;
+					np.traveled_distance = new_distance;
+#ifdef USE_ENTRY_POINT
+					np.entry = new_entry;
+#endif
+				}
+
+				const gd::NavigationPoly &np = navigation_polys[np_id];
+				gd::PathScratch::OpenEntry entry;
+				entry.traveled_distance = np.traveled_distance;
+#ifdef USE_ENTRY_POINT
+				entry.cost = np.traveled_distance + np.entry.distance_to(r_end_point);
+#else
+				entry.cost = np.traveled_distance + np.poly->center.distance_to(r_end_point);
+#endif
+				entry.navigation_poly_id = np_id;
+				open_heap.push_back(entry);
+				std::push_heap(open_heap.begin(), open_heap.end());
+			}
+		}
+
+		// When the open list is empty at this point the End Polygon is not reachable
+		// so use the further reachable polygon. The restricted search leaves this to
+		// the search on the whole map.
+		if (p_restricted) {
+			return false;
+		}
+		ERR_FAIL_COND_V_MSG(is_reachable == false, false, "It's not expect to not find the most reachable polygons");
+		is_reachable = false;
+		if (reachable_end == nullptr) {
+			// The path is not found and there is not a way out.
+			return false;
+		}
+
+		// Set as end point the furthest reachable point.
+		r_end_poly = reachable_end;
+		float end_d = 1e20;
+		for (size_t point_id = 2; point_id < r_end_poly->points.size(); point_id++) {
+			Face3 f(r_end_poly->points[point_id - 2].pos, r_end_poly->points[point_id - 1].pos, r_end_poly->points[point_id].pos);
+			Vector3 spoint = f.get_closest_point_to(p_destination);
+			float dpoint = spoint.distance_to(p_destination);
+			if (dpoint < end_d) {
+				r_end_point = spoint;
+				end_d = dpoint;
+			}
+		}
+		reachable_end = nullptr;
+	}
+}
+
+int NavMapSnapshot::_follow_route(gd::PathScratch &r_scratch, const Vector3 &p_begin_point) const {
+	// The cached corridor is a chain, only the entry points depend on the query.
+	std::vector<gd::NavigationPoly> &navigation_polys = r_scratch.navigation_polys;
+	navigation_polys[0].entry = p_begin_point;
+	navigation_polys[0].traveled_distance = 0.0;
+
+	for (size_t i(1); i < navigation_polys.size(); i++) {
+		const gd::NavigationPoly &prev = navigation_polys[i - 1];
+		gd::NavigationPoly &np = navigation_polys[i];
+
+		const int back_edge = np.back_navigation_edge;
+		Vector3 edge_line[2] = {
+			np.poly->points[back_edge].pos,
+			np.poly->points[(back_edge + 1) % np.poly->points.size()].pos
+		};
+		np.entry = Geometry3D::get_closest_point_to_segment(prev.entry, edge_line);
+		np.traveled_distance = prev.traveled_distance + prev.entry.distance_to(np.entry);
+	}
+
+	return navigation_polys.size() - 1;
+}
+
+Vector<Vector3> NavMapSnapshot::get_path(Vector3 p_origin, Vector3 p_destination, bool p_optimize) const {
+	const gd::Polygon *begin_poly = nullptr;
+	const gd::Polygon *end_poly = nullptr;
+	Vector3 begin_point;
+	Vector3 end_point;
+	float begin_d = 1e20;
+	float end_d = 1e20;
+
+	// Find the initial poly and the end poly on this map.
+	for (size_t i(0); i < polygons.size(); i++) {
+		const gd::Polygon &p = polygons[i];
+
+		// For each point cast a face and check the distance between the origin/destination
+		for (size_t point_id = 2; point_id < p.points.size(); point_id++) {
+			Face3 f(p.points[point_id - 2].pos, p.points[point_id - 1].pos, p.points[point_id].pos);
+			Vector3 spoint = f.get_closest_point_to(p_origin);
+			float dpoint = spoint.distance_to(p_origin);
+			if (dpoint < begin_d) {
+				begin_d = dpoint;
+				begin_poly = &p;
+				begin_point = spoint;
+			}
+
+			spoint = f.get_closest_point_to(p_destination);
+			dpoint = spoint.distance_to(p_destination);
+			if (dpoint < end_d) {
+				end_d = dpoint;
+				end_poly = &p;
+				end_point = spoint;
+			}
+		}
+	}
+
+	if (!begin_poly || !end_poly) {
+		// No path
+		return Vector<Vector3>();
+	}
+
+	if (begin_poly == end_poly) {
+		Vector<Vector3> path;
+		path.resize(2);
+		path.write[0] = begin_point;
+		path.write[1] = end_point;
+		return path;
+	}
+
+	static thread_local gd::PathScratch scratch;
+
+	// The elements indices in the `navigation_polys`.
+	int least_cost_id(-1);
+	bool found_route = false;
+
+	const uint64_t cache_key = (uint64_t(begin_poly->id) << 32) | end_poly->id;
+	if (path_cache.get_capacity() > 0 && path_cache.get(cache_key, scratch.navigation_polys)) {
+		least_cost_id = _follow_route(scratch, begin_point);
+		found_route = true;
+	} else {
+		const gd::Polygon *destination_poly = end_poly;
+
+		if (use_hierarchical_pathfinding && _mark_cluster_route(scratch, begin_poly->cluster, end_poly->cluster)) {
+			found_route = _find_route(scratch, begin_poly, begin_point, end_poly, end_point, p_destination, true, least_cost_id);
+		}
+		if (!found_route) {
+			// The regions on the way are not enough, search the whole map.
+			found_route = _find_route(scratch, begin_poly, begin_point, end_poly, end_point, p_destination, false, least_cost_id);
+		}
+
+		if (found_route && end_poly == destination_poly && path_cache.get_capacity() > 0) {
+			// Store the corridor from the begin to the end polygon.
+			std::vector<gd::NavigationPoly> &route = scratch.route;
+			route.clear();
+			for (int np_id = least_cost_id; np_id != -1; np_id = scratch.navigation_polys[np_id].prev_navigation_poly_id) {
+				route.push_back(scratch.navigation_polys[np_id]);
+			}
+			std::reverse(route.begin(), route.end());
+			for (size_t i(0); i < route.size(); i++) {
+				route[i].self_id = i;
+				route[i].prev_navigation_poly_id = int(i) - 1;
+			}
+			path_cache.put(cache_key, route);
+		}
+	}
+
+	std::vector<gd::NavigationPoly> &navigation_polys = scratch.navigation_polys;
+
+	if (found_route) {
+		Vector<Vector3> path;
+		if (p_optimize) {
+			// String pulling
+
+			gd::NavigationPoly *apex_poly = &navigation_polys[least_cost_id];
+			Vector3 apex_point = end_point;
+			Vector3 portal_left = apex_point;
+			Vector3 portal_right = apex_point;
+			gd::NavigationPoly *left_poly = apex_poly;
+			gd::NavigationPoly *right_poly = apex_poly;
+			gd::NavigationPoly *p = apex_poly;
+
+			path.push_back(end_point);
+
+			while (p) {
+				Vector3 left;
+				Vector3 right;
+
+#define CLOCK_TANGENT(m_a, m_b, m_c) (((m_a) - (m_c)).cross((m_a) - (m_b)))
+
+				if (p->poly == begin_poly) {
+					left = begin_point;
+					right = begin_point;
+				} else {
+					int prev = p->back_navigation_edge;
+					int prev_n = (p->back_navigation_edge + 1) % p->poly->points.size();
+					left = p->poly->points[prev].pos;
+					right = p->poly->points[prev_n].pos;
+
+					if (p->poly->clockwise) {
+						SWAP(left, right);
+					}
+				}
+
+				bool skip = false;
+
+				if (CLOCK_TANGENT(apex_point, portal_left, left).dot(up) >= 0) {
+					//process
+					if (portal_left == apex_point || CLOCK_TANGENT(apex_point, left, portal_right).dot(up) > 0) {
+						left_poly = p;
+						portal_left = left;
+					} else {
+						clip_path(navigation_polys, path, apex_poly, portal_right, right_poly);
+
+						apex_point = portal_right;
+						p = right_poly;
+						left_poly = p;
+						apex_poly = p;
+						portal_left = apex_point;
+						portal_right = apex_point;
+						path.push_back(apex_point);
+						skip = true;
+					}
+				}
+
+				if (!skip && CLOCK_TANGENT(apex_point, portal_right, right).dot(up) <= 0) {
+					//process
+					if (portal_right == apex_point || CLOCK_TANGENT(apex_point, right, portal_left).dot(up) < 0) {
+						right_poly = p;
+						portal_right = right;
+					} else {
+						clip_path(navigation_polys, path, apex_poly, portal_left, left_poly);
+
+						apex_point = portal_left;
+						p = left_poly;
+						right_poly = p;
+						apex_poly = p;
+						portal_right = apex_point;
+						portal_left = apex_point;
+						path.push_back(apex_point);
+					}
+				}
+
+				if (p->prev_navigation_poly_id != -1) {
+					p = &navigation_polys[p->prev_navigation_poly_id];
+				} else {
+					// The end
+					p = nullptr;
+				}
+			}
+
+			if (path[path.size() - 1] != begin_point) {
+				path.push_back(begin_point);
+			}
+
+			path.invert();
+
+		} else {
+			path.push_back(end_point);
+
+			// Add mid points
+			int np_id = least_cost_id;
+			while (np_id != -1) {
+#ifdef USE_ENTRY_POINT
+				Vector3 point = navigation_polys[np_id].entry;
+#else
+				int prev = navigation_polys[np_id].back_navigation_edge;
+				int prev_n = (navigation_polys[np_id].back_navigation_edge + 1) % navigation_polys[np_id].poly->points.size();
+				Vector3 point = (navigation_polys[np_id].poly->points[prev].pos + navigation_polys[np_id].poly->points[prev_n].pos) * 0.5;
+#endif
+
+				path.push_back(point);
+				np_id = navigation_polys[np_id].prev_navigation_poly_id;
+			}
+
+			path.invert();
+		}
+
+		return path;
+	}
+	return Vector<Vector3>();
+}
+
+void NavMapSnapshot::clip_path(const std::vector<gd::NavigationPoly> &p_navigation_polys, Vector<Vector3> &path, const gd::NavigationPoly *from_poly, const Vector3 &p_to_point, const gd::NavigationPoly *p_to_poly) const {
+	Vector3 from = path[path.size() - 1];
+
+	if (from.distance_to(p_to_point) < CMP_EPSILON) {
+		return;
+	}
+	Plane cut_plane;
+	cut_plane.normal = (from - p_to_point).cross(up);
+	if (cut_plane.normal == Vector3()) {
+		return;
+	}
+	cut_plane.normal.normalize();
+	cut_plane.d = cut_plane.normal.dot(from);
+
+	while (from_poly != p_to_poly) {
+		int back_nav_edge = from_poly->back_navigation_edge;
+		Vector3 a = from_poly->poly->points[back_nav_edge].pos;
+		Vector3 b = from_poly->poly->points[(back_nav_edge + 1) % from_poly->poly->points.size()].pos;
+
+		ERR_FAIL_COND(from_poly->prev_navigation_poly_id == -1);
+		from_poly = &p_navigation_polys[from_poly->prev_navigation_poly_id];
+
+		if (a.distance_to(b) > CMP_EPSILON) {
+			Vector3 inters;
+			if (cut_plane.intersects_segment(a, b, &inters)) {
+				if (inters.distance_to(p_to_point) > CMP_EPSILON && inters.distance_to(path[path.size() - 1]) > CMP_EPSILON) {
+					path.push_back(inters);
+				}
+			}
+		}
+	}
+}
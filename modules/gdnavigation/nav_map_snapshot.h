@@ -0,0 +1,86 @@
+/*************************************************************************/
+/*  nav_map_snapshot.h                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef NAV_MAP_SNAPSHOT_H
+#define NAV_MAP_SNAPSHOT_H
+
+#include "core/safe_refcount.h"
+#include "core/vector.h"
+#include "nav_utils.h"
+
+#include <vector>
+
+/// Immutable copy of the polygons of a `NavMap`, taken at the end of `sync`.
+/// The path queries run on it, so they are not affected by the map changing
+/// in the meantime and can be solved on any thread.
+class NavMapSnapshot {
+	/// A node of the regions graph, one for each region.
+	struct Cluster {
+		Vector3 center;
+		/// The clusters connected to this one.
+		std::vector<uint32_t> links;
+	};
+
+	SafeRefCount refcount;
+
+	Vector3 up;
+
+	/// Copy of the map polygons, the edges link the polygons of this copy.
+	std::vector<gd::Polygon> polygons;
+
+	/// Regions graph used to restrict the path search to the regions on the way.
+	std::vector<Cluster> clusters;
+	bool use_hierarchical_pathfinding = false;
+
+	/// Corridors of the recent paths.
+	mutable gd::PathCache path_cache;
+
+	bool _mark_cluster_route(gd::PathScratch &r_scratch, uint32_t p_from, uint32_t p_to) const;
+	bool _find_route(gd::PathScratch &r_scratch, const gd::Polygon *p_begin_poly, const Vector3 &p_begin_point, const gd::Polygon *&r_end_poly, Vector3 &r_end_point, const Vector3 &p_destination, bool p_restricted, int &r_least_cost_id) const;
+	int _follow_route(gd::PathScratch &r_scratch, const Vector3 &p_begin_point) const;
+	void clip_path(const std::vector<gd::NavigationPoly> &p_navigation_polys, Vector<Vector3> &path, const gd::NavigationPoly *from_poly, const Vector3 &p_to_point, const gd::NavigationPoly *p_to_poly) const;
+
+	NavMapSnapshot() {}
+
+public:
+	/// `p_polygons` are the map polygons, their `id` is the index in the vector
+	/// and their `cluster` the index of the owner region.
+	static NavMapSnapshot *create(const std::vector<gd::Polygon *> &p_polygons, uint32_t p_region_count, const Vector3 &p_up, bool p_use_hierarchical_pathfinding, int p_path_cache_size);
+
+	/// The snapshot is freed once the last reference is released.
+	void reference();
+	void release();
+
+	void set_path_cache_size(int p_size);
+
+	Vector<Vector3> get_path(Vector3 p_origin, Vector3 p_destination, bool p_optimize) const;
+};
+
+#endif // NAV_MAP_SNAPSHOT_H
@@ -80,6 +80,15 @@ public:
 		return polygons;
 	}
 
+	/// The map links the polygons to each other through their edges.
+	std::vector<gd::Polygon> &get_polygons() {
+		return polygons;
+	}
+
+	bool is_dirty() const {
+		return polygons_dirty;
+	}
+
 	bool sync();
 
 private:
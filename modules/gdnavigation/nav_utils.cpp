@@ -0,0 +1,116 @@
+/*************************************************************************/
+/*  nav_utils.cpp                                                        */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "nav_utils.h"
+
+void gd::PathCache::_unlink(int p_entry) {
+	Entry &e = entries[p_entry];
+	if (e.prev != -1) {
+		entries[e.prev].next = e.next;
+	} else {
+		head = e.next;
+	}
+	if (e.next != -1) {
+		entries[e.next].prev = e.prev;
+	} else {
+		tail = e.prev;
+	}
+	e.prev = -1;
+	e.next = -1;
+}
+
+void gd::PathCache::_push_front(int p_entry) {
+	Entry &e = entries[p_entry];
+	e.prev = -1;
+	e.next = head;
+	if (head != -1) {
+		entries[head].prev = p_entry;
+	} else {
+		tail = p_entry;
+	}
+	head = p_entry;
+}
+
+void gd::PathCache::set_capacity(uint32_t p_capacity) {
+	MutexLock lock(mutex);
+	capacity = p_capacity;
+	entries.clear();
+	entry_map.clear();
+	head = -1;
+	tail = -1;
+}
+
+bool gd::PathCache::get(uint64_t p_key, std::vector<NavigationPoly> &r_route) {
+	MutexLock lock(mutex);
+	int *entry = entry_map.lookup_ptr(p_key);
+	if (!entry) {
+		return false;
+	}
+
+	_unlink(*entry);
+	_push_front(*entry);
+	r_route = entries[*entry].route;
+	return true;
+}
+
+void gd::PathCache::put(uint64_t p_key, const std::vector<NavigationPoly> &p_route) {
+	MutexLock lock(mutex);
+	if (capacity == 0) {
+		return;
+	}
+
+	int index;
+	int *existing = entry_map.lookup_ptr(p_key);
+	if (existing) {
+		index = *existing;
+		_unlink(index);
+	} else if (entries.size() < capacity) {
+		index = entries.size();
+		entries.push_back(Entry());
+	} else {
+		// Evict the least recently used.
+		index = tail;
+		_unlink(index);
+		entry_map.remove(entries[index].key);
+	}
+
+	entries[index].key = p_key;
+	entries[index].route = p_route;
+	entry_map.set(p_key, index);
+	_push_front(index);
+}
+
+void gd::PathCache::clear() {
+	MutexLock lock(mutex);
+	entries.clear();
+	entry_map.clear();
+	head = -1;
+	tail = -1;
+}
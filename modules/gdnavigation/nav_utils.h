@@ -32,6 +32,8 @@
 #define NAV_UTILS_H
 
 #include "core/math/vector3.h"
+#include "core/oa_hash_map.h"
+#include "core/os/mutex.h"
 
 #include <vector>
 
@@ -93,6 +95,13 @@ struct Edge {
 struct Polygon {
 	NavRegion *owner;
 
+	/// Index of this `Polygon` in the map.
+	uint32_t id = 0;
+
+	/// Index of the owner region in the map, regions are the clusters of
+	/// the hierarchical pathfinding.
+	uint32_t cluster = 0;
+
 	/// The points of this `Polygon`
 	std::vector<Point> points;
 
@@ -127,6 +136,8 @@ struct NavigationPoly {
 	Vector3 entry;
 	/// The distance to the destination.
 	float traveled_distance = 0.0;
+	/// Already expanded by the search.
+	bool closed = false;
 
 	NavigationPoly(const Polygon *p_poly) :
 			poly(p_poly) {}
@@ -148,6 +159,67 @@ struct FreeEdge {
 	Vector3 edge_dir;
 	float edge_len_squared;
 };
+
+/// Search state of `NavMap::get_path`, reused between queries so the search
+/// doesn't allocate. Per polygon data is only valid when its pass matches.
+struct PathScratch {
+	struct OpenEntry {
+		float cost;
+		float traveled_distance;
+		int navigation_poly_id;
+
+		bool operator<(const OpenEntry &p_other) const {
+			return cost > p_other.cost; // Min heap.
+		}
+	};
+
+	std::vector<NavigationPoly> navigation_polys;
+	std::vector<OpenEntry> open_heap;
+
+	std::vector<uint32_t> poly_pass;
+	std::vector<int> poly_navigation_id;
+	uint32_t pass = 0;
+
+	std::vector<uint32_t> cluster_search_pass;
+	std::vector<uint32_t> cluster_route_pass;
+	std::vector<float> cluster_distance;
+	std::vector<int> cluster_prev;
+	uint32_t cluster_pass = 0;
+
+	/// The polygon corridor stored in the `PathCache`.
+	std::vector<NavigationPoly> route;
+};
+
+/// Least recently used cache of the polygon corridors found by `NavMap::get_path`,
+/// by begin and end polygon. Thread safe.
+class PathCache {
+	struct Entry {
+		uint64_t key = 0;
+		std::vector<NavigationPoly> route;
+		int prev = -1; // More recently used.
+		int next = -1; // Less recently used.
+	};
+
+	Mutex mutex;
+	std::vector<Entry> entries;
+	OAHashMap<uint64_t, int> entry_map;
+	int head = -1;
+	int tail = -1;
+	uint32_t capacity = 0;
+
+	void _unlink(int p_entry);
+	void _push_front(int p_entry);
+
+public:
+	void set_capacity(uint32_t p_capacity);
+	uint32_t get_capacity() const {
+		return capacity;
+	}
+
+	bool get(uint64_t p_key, std::vector<NavigationPoly> &r_route);
+	void put(uint64_t p_key, const std::vector<NavigationPoly> &p_route);
+	void clear();
+};
 } // namespace gd
 
 #endif // NAV_UTILS_H
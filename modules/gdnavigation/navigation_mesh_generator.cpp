@@ -34,6 +34,7 @@
 
 #include "core/math/quick_hull.h"
 #include "core/os/thread.h"
+#include "core/thread_work_pool.h"
 #include "scene/3d/collision_shape_3d.h"
 #include "scene/3d/mesh_instance_3d.h"
 #include "scene/3d/physics_body_3d.h"
@@ -273,14 +274,11 @@ void NavigationMeshGenerator::_parse_geometry(Transform p_accumulated_transform,
 	}
 }
 
-void NavigationMeshGenerator::_convert_detail_mesh_to_native_navigation_mesh(const rcPolyMeshDetail *p_detail_mesh, Ref<NavigationMesh> p_nav_mesh) {
-	Vector<Vector3> nav_vertices;
-
+void NavigationMeshGenerator::_convert_detail_mesh(const rcPolyMeshDetail *p_detail_mesh, Vector<Vector3> &r_vertices, Vector<Vector<int>> &r_polygons) {
 	for (int i = 0; i < p_detail_mesh->nverts; i++) {
 		const float *v = &p_detail_mesh->verts[i * 3];
-		nav_vertices.push_back(Vector3(v[0], v[1], v[2]));
+		r_vertices.push_back(Vector3(v[0], v[1], v[2]));
 	}
-	p_nav_mesh->set_vertices(nav_vertices);
 
 	for (int i = 0; i < p_detail_mesh->nmeshes; i++) {
 		const unsigned int *m = &p_detail_mesh->meshes[i * 4];
@@ -295,11 +293,40 @@ void NavigationMeshGenerator::_convert_detail_mesh_to_native_navigation_mesh(con
 			nav_indices.write[0] = ((int)(bverts + tris[j * 4 + 0]));
 			nav_indices.write[1] = ((int)(bverts + tris[j * 4 + 2]));
 			nav_indices.write[2] = ((int)(bverts + tris[j * 4 + 1]));
-			p_nav_mesh->add_polygon(nav_indices);
+			r_polygons.push_back(nav_indices);
 		}
 	}
 }
 
+void NavigationMeshGenerator::_convert_detail_mesh_to_native_navigation_mesh(const rcPolyMeshDetail *p_detail_mesh, Ref<NavigationMesh> p_nav_mesh) {
+	Vector<Vector3> nav_vertices;
+	Vector<Vector<int>> nav_polygons;
+	_convert_detail_mesh(p_detail_mesh, nav_vertices, nav_polygons);
+
+	p_nav_mesh->set_vertices(nav_vertices);
+	for (int i = 0; i < nav_polygons.size(); i++) {
+		p_nav_mesh->add_polygon(nav_polygons[i]);
+	}
+}
+
+void NavigationMeshGenerator::_configure_recast(rcConfig &r_cfg, Ref<NavigationMesh> p_nav_mesh) {
+	memset(&r_cfg, 0, sizeof(r_cfg));
+
+	r_cfg.cs = p_nav_mesh->get_cell_size();
+	r_cfg.ch = p_nav_mesh->get_cell_height();
+	r_cfg.walkableSlopeAngle = p_nav_mesh->get_agent_max_slope();
+	r_cfg.walkableHeight = (int)Math::ceil(p_nav_mesh->get_agent_height() / r_cfg.ch);
+	r_cfg.walkableClimb = (int)Math::floor(p_nav_mesh->get_agent_max_climb() / r_cfg.ch);
+	r_cfg.walkableRadius = (int)Math::ceil(p_nav_mesh->get_agent_radius() / r_cfg.cs);
+	r_cfg.maxEdgeLen = (int)(p_nav_mesh->get_edge_max_length() / p_nav_mesh->get_cell_size());
+	r_cfg.maxSimplificationError = p_nav_mesh->get_edge_max_error();
+	r_cfg.minRegionArea = (int)(p_nav_mesh->get_region_min_size() * p_nav_mesh->get_region_min_size());
+	r_cfg.mergeRegionArea = (int)(p_nav_mesh->get_region_merge_size() * p_nav_mesh->get_region_merge_size());
+	r_cfg.maxVertsPerPoly = (int)p_nav_mesh->get_verts_per_poly();
+	r_cfg.detailSampleDist = p_nav_mesh->get_detail_sample_distance() < 0.9f ? 0 : p_nav_mesh->get_cell_size() * p_nav_mesh->get_detail_sample_distance();
+	r_cfg.detailSampleMaxError = p_nav_mesh->get_cell_height() * p_nav_mesh->get_detail_sample_max_error();
+}
+
 void NavigationMeshGenerator::_build_recast_navigation_mesh(
 		Ref<NavigationMesh> p_nav_mesh,
 #ifdef TOOLS_ENABLED
@@ -329,21 +356,7 @@ void NavigationMeshGenerator::_build_recast_navigation_mesh(
 	rcCalcBounds(verts, nverts, bmin, bmax);
 
 	rcConfig cfg;
-	memset(&cfg, 0, sizeof(cfg));
-
-	cfg.cs = p_nav_mesh->get_cell_size();
-	cfg.ch = p_nav_mesh->get_cell_height();
-	cfg.walkableSlopeAngle = p_nav_mesh->get_agent_max_slope();
-	cfg.walkableHeight = (int)Math::ceil(p_nav_mesh->get_agent_height() / cfg.ch);
-	cfg.walkableClimb = (int)Math::floor(p_nav_mesh->get_agent_max_climb() / cfg.ch);
-	cfg.walkableRadius = (int)Math::ceil(p_nav_mesh->get_agent_radius() / cfg.cs);
-	cfg.maxEdgeLen = (int)(p_nav_mesh->get_edge_max_length() / p_nav_mesh->get_cell_size());
-	cfg.maxSimplificationError = p_nav_mesh->get_edge_max_error();
-	cfg.minRegionArea = (int)(p_nav_mesh->get_region_min_size() * p_nav_mesh->get_region_min_size());
-	cfg.mergeRegionArea = (int)(p_nav_mesh->get_region_merge_size() * p_nav_mesh->get_region_merge_size());
-	cfg.maxVertsPerPoly = (int)p_nav_mesh->get_verts_per_poly();
-	cfg.detailSampleDist = p_nav_mesh->get_detail_sample_distance() < 0.9f ? 0 : p_nav_mesh->get_cell_size() * p_nav_mesh->get_detail_sample_distance();
-	cfg.detailSampleMaxError = p_nav_mesh->get_cell_height() * p_nav_mesh->get_detail_sample_max_error();
+	_configure_recast(cfg, p_nav_mesh);
 
 	cfg.bmin[0] = bmin[0];
 	cfg.bmin[1] = bmin[1];
@@ -488,6 +501,250 @@ NavigationMeshGenerator::NavigationMeshGenerator() {
 NavigationMeshGenerator::~NavigationMeshGenerator() {
 }
 
+void NavigationMeshGenerator::_parse_source_geometry(Ref<NavigationMesh> p_nav_mesh, Node *p_node, Vector<float> &p_verticies, Vector<int> &p_indices) {
+	List<Node *> parse_nodes;
+
+	if (p_nav_mesh->get_source_geometry_mode() == NavigationMesh::SOURCE_GEOMETRY_NAVMESH_CHILDREN) {
+		parse_nodes.push_back(p_node);
+	} else {
+		p_node->get_tree()->get_nodes_in_group(p_nav_mesh->get_source_group_name(), &parse_nodes);
+	}
+
+	Transform navmesh_xform = Object::cast_to<Node3D>(p_node)->get_transform().affine_inverse();
+	for (const List<Node *>::Element *E = parse_nodes.front(); E; E = E->next()) {
+		int geometry_type = p_nav_mesh->get_parsed_geometry_type();
+		uint32_t collision_mask = p_nav_mesh->get_collision_mask();
+		bool recurse_children = p_nav_mesh->get_source_geometry_mode() != NavigationMesh::SOURCE_GEOMETRY_GROUPS_EXPLICIT;
+		_parse_geometry(navmesh_xform, E->get(), p_verticies, p_indices, geometry_type, collision_mask, recurse_children);
+	}
+}
+
+struct RecastTileData {
+	rcHeightfield *hf = nullptr;
+	rcCompactHeightfield *chf = nullptr;
+	rcContourSet *cset = nullptr;
+	rcPolyMesh *poly_mesh = nullptr;
+	rcPolyMeshDetail *detail_mesh = nullptr;
+
+	~RecastTileData() {
+		rcFreeHeightField(hf);
+		rcFreeCompactHeightfield(chf);
+		rcFreeContourSet(cset);
+		rcFreePolyMesh(poly_mesh);
+		rcFreePolyMeshDetail(detail_mesh);
+	}
+};
+
+void NavigationMeshGenerator::_bake_tile(uint32_t p_index, TiledBake *p_bake) {
+	BakeTile &tile = p_bake->tiles[p_index];
+	const Ref<NavigationMesh> &nav_mesh = p_bake->nav_mesh;
+
+	// No logs nor timers, the context is per tile.
+	rcContext ctx(false);
+
+	rcConfig cfg;
+	_configure_recast(cfg, nav_mesh);
+
+	// The border makes the tile see the geometry around it, so the polygons
+	// are cut at the tile bounds the same way on both sides.
+	cfg.borderSize = cfg.walkableRadius + 3;
+	cfg.tileSize = p_bake->tile_cells;
+	cfg.width = cfg.tileSize + cfg.borderSize * 2;
+	cfg.height = cfg.tileSize + cfg.borderSize * 2;
+
+	const float border = cfg.borderSize * cfg.cs;
+	cfg.bmin[0] = tile.x * p_bake->tile_world_size - border;
+	cfg.bmin[1] = p_bake->bmin[1];
+	cfg.bmin[2] = tile.z * p_bake->tile_world_size - border;
+	cfg.bmax[0] = (tile.x + 1) * p_bake->tile_world_size + border;
+	cfg.bmax[1] = p_bake->bmax[1];
+	cfg.bmax[2] = (tile.z + 1) * p_bake->tile_world_size + border;
+
+	// Only the triangles touching the tile are rasterized.
+	LocalVector<int> tris;
+	for (int i = 0; i < p_bake->ntris; i++) {
+		const int *t = &p_bake->tris[i * 3];
+		const float *v0 = &p_bake->verts[t[0] * 3];
+		const float *v1 = &p_bake->verts[t[1] * 3];
+		const float *v2 = &p_bake->verts[t[2] * 3];
+
+		if (MAX(v0[0], MAX(v1[0], v2[0])) < cfg.bmin[0] || MIN(v0[0], MIN(v1[0], v2[0])) > cfg.bmax[0]) {
+			continue;
+		}
+		if (MAX(v0[2], MAX(v1[2], v2[2])) < cfg.bmin[2] || MIN(v0[2], MIN(v1[2], v2[2])) > cfg.bmax[2]) {
+			continue;
+		}
+		tris.push_back(t[0]);
+		tris.push_back(t[1]);
+		tris.push_back(t[2]);
+	}
+
+	const int ntris = tris.size() / 3;
+	if (ntris == 0) {
+		return;
+	}
+
+	RecastTileData data;
+
+	data.hf = rcAllocHeightfield();
+	ERR_FAIL_COND(!data.hf);
+	ERR_FAIL_COND(!rcCreateHeightfield(&ctx, *data.hf, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+
+	{
+		LocalVector<unsigned char> tri_areas;
+		tri_areas.resize(ntris);
+		memset(tri_areas.ptr(), 0, ntris * sizeof(unsigned char));
+		rcMarkWalkableTriangles(&ctx, cfg.walkableSlopeAngle, p_bake->verts, p_bake->nverts, tris.ptr(), ntris, tri_areas.ptr());
+
+		ERR_FAIL_COND(!rcRasterizeTriangles(&ctx, p_bake->verts, p_bake->nverts, tris.ptr(), tri_areas.ptr(), ntris, *data.hf, cfg.walkableClimb));
+	}
+
+	if (nav_mesh->get_filter_low_hanging_obstacles()) {
+		rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, *data.hf);
+	}
+	if (nav_mesh->get_filter_ledge_spans()) {
+		rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, *data.hf);
+	}
+	if (nav_mesh->get_filter_walkable_low_height_spans()) {
+		rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, *data.hf);
+	}
+
+	data.chf = rcAllocCompactHeightfield();
+	ERR_FAIL_COND(!data.chf);
+	ERR_FAIL_COND(!rcBuildCompactHeightfield(&ctx, cfg.walkableHeight, cfg.walkableClimb, *data.hf, *data.chf));
+
+	rcFreeHeightField(data.hf);
+	data.hf = nullptr;
+
+	ERR_FAIL_COND(!rcErodeWalkableArea(&ctx, cfg.walkableRadius, *data.chf));
+
+	if (nav_mesh->get_sample_partition_type() == NavigationMesh::SAMPLE_PARTITION_WATERSHED) {
+		ERR_FAIL_COND(!rcBuildDistanceField(&ctx, *data.chf));
+		ERR_FAIL_COND(!rcBuildRegions(&ctx, *data.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea));
+	} else if (nav_mesh->get_sample_partition_type() == NavigationMesh::SAMPLE_PARTITION_MONOTONE) {
+		ERR_FAIL_COND(!rcBuildRegionsMonotone(&ctx, *data.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea));
+	} else {
+		ERR_FAIL_COND(!rcBuildLayerRegions(&ctx, *data.chf, cfg.borderSize, cfg.minRegionArea));
+	}
+
+	data.cset = rcAllocContourSet();
+	ERR_FAIL_COND(!data.cset);
+	ERR_FAIL_COND(!rcBuildContours(&ctx, *data.chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *data.cset));
+
+	data.poly_mesh = rcAllocPolyMesh();
+	ERR_FAIL_COND(!data.poly_mesh);
+	ERR_FAIL_COND(!rcBuildPolyMesh(&ctx, *data.cset, cfg.maxVertsPerPoly, *data.poly_mesh));
+
+	data.detail_mesh = rcAllocPolyMeshDetail();
+	ERR_FAIL_COND(!data.detail_mesh);
+	ERR_FAIL_COND(!rcBuildPolyMeshDetail(&ctx, *data.poly_mesh, *data.chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *data.detail_mesh));
+
+	_convert_detail_mesh(data.detail_mesh, tile.vertices, tile.polygons);
+}
+
+void NavigationMeshGenerator::_bake_tiles(Ref<NavigationMesh> p_nav_mesh, const Vector<float> &p_vertices, const Vector<int> &p_indices, const AABB *p_area) {
+	TiledBake bake;
+	bake.nav_mesh = p_nav_mesh;
+	bake.verts = p_vertices.ptr();
+	bake.nverts = p_vertices.size() / 3;
+	bake.tris = p_indices.ptr();
+	bake.ntris = p_indices.size() / 3;
+	rcCalcBounds(bake.verts, bake.nverts, bake.bmin, bake.bmax);
+
+	// The tiles are aligned to the cells, starting from the origin of the mesh,
+	// so baking an area again gives the same tiles.
+	bake.tile_cells = MAX(1, (int)(p_nav_mesh->get_tile_size() / p_nav_mesh->get_cell_size()));
+	bake.tile_world_size = bake.tile_cells * p_nav_mesh->get_cell_size();
+
+	int from_x, from_z, to_x, to_z;
+	if (p_area) {
+		from_x = (int)Math::floor(p_area->position.x / bake.tile_world_size);
+		from_z = (int)Math::floor(p_area->position.z / bake.tile_world_size);
+		to_x = (int)Math::floor((p_area->position.x + p_area->size.x) / bake.tile_world_size);
+		to_z = (int)Math::floor((p_area->position.z + p_area->size.z) / bake.tile_world_size);
+	} else {
+		from_x = (int)Math::floor(bake.bmin[0] / bake.tile_world_size);
+		from_z = (int)Math::floor(bake.bmin[2] / bake.tile_world_size);
+		to_x = (int)Math::floor(bake.bmax[0] / bake.tile_world_size);
+		to_z = (int)Math::floor(bake.bmax[2] / bake.tile_world_size);
+	}
+
+	for (int z = from_z; z <= to_z; z++) {
+		for (int x = from_x; x <= to_x; x++) {
+			BakeTile tile;
+			tile.x = x;
+			tile.z = z;
+			bake.tiles.push_back(tile);
+		}
+	}
+
+	ThreadWorkPool::get_singleton()->do_work(bake.tiles.size(), this, &NavigationMeshGenerator::_bake_tile, &bake);
+
+	Vector<Vector3> nav_vertices;
+	Vector<Vector<int>> nav_polygons;
+
+	if (p_area) {
+		// Keep the polygons of the tiles that were not baked again, a polygon
+		// belongs to the tile containing its center.
+		const Vector<Vector3> old_vertices = p_nav_mesh->get_vertices();
+		LocalVector<int> vertex_map;
+		vertex_map.resize(old_vertices.size());
+		for (uint32_t i = 0; i < vertex_map.size(); i++) {
+			vertex_map[i] = -1;
+		}
+
+		for (int i = 0; i < p_nav_mesh->get_polygon_count(); i++) {
+			Vector<int> polygon = p_nav_mesh->get_polygon(i);
+			if (polygon.size() == 0) {
+				continue;
+			}
+
+			Vector3 center;
+			for (int j = 0; j < polygon.size(); j++) {
+				ERR_CONTINUE(polygon[j] < 0 || polygon[j] >= old_vertices.size());
+				center += old_vertices[polygon[j]];
+			}
+			center /= polygon.size();
+
+			const int x = (int)Math::floor(center.x / bake.tile_world_size);
+			const int z = (int)Math::floor(center.z / bake.tile_world_size);
+			if (x >= from_x && x <= to_x && z >= from_z && z <= to_z) {
+				continue;
+			}
+
+			for (int j = 0; j < polygon.size(); j++) {
+				int &index = vertex_map[polygon[j]];
+				if (index == -1) {
+					index = nav_vertices.size();
+					nav_vertices.push_back(old_vertices[polygon[j]]);
+				}
+				polygon.write[j] = index;
+			}
+			nav_polygons.push_back(polygon);
+		}
+	}
+
+	for (uint32_t i = 0; i < bake.tiles.size(); i++) {
+		const BakeTile &tile = bake.tiles[i];
+		const int offset = nav_vertices.size();
+		nav_vertices.append_array(tile.vertices);
+
+		for (int j = 0; j < tile.polygons.size(); j++) {
+			Vector<int> polygon = tile.polygons[j];
+			for (int k = 0; k < polygon.size(); k++) {
+				polygon.write[k] += offset;
+			}
+			nav_polygons.push_back(polygon);
+		}
+	}
+
+	p_nav_mesh->clear_polygons();
+	p_nav_mesh->set_vertices(nav_vertices);
+	for (int i = 0; i < nav_polygons.size(); i++) {
+		p_nav_mesh->add_polygon(nav_polygons[i]);
+	}
+}
+
 void NavigationMeshGenerator::bake(Ref<NavigationMesh> p_nav_mesh, Node *p_node) {
 	ERR_FAIL_COND(!p_nav_mesh.is_valid());
 
@@ -504,24 +761,19 @@ void NavigationMeshGenerator::bake(Ref<NavigationMesh> p_nav_mesh, Node *p_node)
 
 	Vector<float> vertices;
 	Vector<int> indices;
+	_parse_source_geometry(p_nav_mesh, p_node, vertices, indices);
 
-	List<Node *> parse_nodes;
-
-	if (p_nav_mesh->get_source_geometry_mode() == NavigationMesh::SOURCE_GEOMETRY_NAVMESH_CHILDREN) {
-		parse_nodes.push_back(p_node);
-	} else {
-		p_node->get_tree()->get_nodes_in_group(p_nav_mesh->get_source_group_name(), &parse_nodes);
-	}
-
-	Transform navmesh_xform = Object::cast_to<Node3D>(p_node)->get_transform().affine_inverse();
-	for (const List<Node *>::Element *E = parse_nodes.front(); E; E = E->next()) {
-		int geometry_type = p_nav_mesh->get_parsed_geometry_type();
-		uint32_t collision_mask = p_nav_mesh->get_collision_mask();
-		bool recurse_children = p_nav_mesh->get_source_geometry_mode() != NavigationMesh::SOURCE_GEOMETRY_GROUPS_EXPLICIT;
-		_parse_geometry(navmesh_xform, E->get(), vertices, indices, geometry_type, collision_mask, recurse_children);
-	}
+	if (p_nav_mesh->get_tile_size() > 0) {
+#ifdef TOOLS_ENABLED
+		if (ep) {
+			ep->step(TTR("Baking tiles..."), 1);
+		}
+#endif
+		if (vertices.size() > 0 && indices.size() > 0) {
+			_bake_tiles(p_nav_mesh, vertices, indices, nullptr);
+		}
 
-	if (vertices.size() > 0 && indices.size() > 0) {
+	} else if (vertices.size() > 0 && indices.size() > 0) {
 		rcHeightfield *hf = nullptr;
 		rcCompactHeightfield *chf = nullptr;
 		rcContourSet *cset = nullptr;
@@ -568,6 +820,24 @@ void NavigationMeshGenerator::bake(Ref<NavigationMesh> p_nav_mesh, Node *p_node)
 #endif
 }
 
+void NavigationMeshGenerator::bake_area(Ref<NavigationMesh> p_nav_mesh, Node *p_node, const AABB &p_area) {
+	ERR_FAIL_COND(!p_nav_mesh.is_valid());
+
+	if (p_nav_mesh->get_tile_size() <= 0) {
+		// Not tiled, everything has to be baked again.
+		clear(p_nav_mesh);
+		bake(p_nav_mesh, p_node);
+		return;
+	}
+
+	// The whole geometry is parsed, but only the tiles touching the area are baked.
+	Vector<float> vertices;
+	Vector<int> indices;
+	_parse_source_geometry(p_nav_mesh, p_node, vertices, indices);
+
+	_bake_tiles(p_nav_mesh, vertices, indices, &p_area);
+}
+
 void NavigationMeshGenerator::clear(Ref<NavigationMesh> p_nav_mesh) {
 	if (p_nav_mesh.is_valid()) {
 		p_nav_mesh->clear_polygons();
@@ -577,6 +847,7 @@ void NavigationMeshGenerator::clear(Ref<NavigationMesh> p_nav_mesh) {
 
 void NavigationMeshGenerator::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("bake", "nav_mesh", "root_node"), &NavigationMeshGenerator::bake);
+	ClassDB::bind_method(D_METHOD("bake_area", "nav_mesh", "root_node", "area"), &NavigationMeshGenerator::bake_area);
 	ClassDB::bind_method(D_METHOD("clear", "nav_mesh"), &NavigationMeshGenerator::clear);
 }
 
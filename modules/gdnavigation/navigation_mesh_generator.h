@@ -33,6 +33,7 @@
 
 #ifndef _3D_DISABLED
 
+#include "core/local_vector.h"
 #include "scene/3d/navigation_region_3d.h"
 
 #include <Recast.h>
@@ -46,6 +47,28 @@ class NavigationMeshGenerator : public Object {
 
 	static NavigationMeshGenerator *singleton;
 
+	/// A square of the tiled bake, and the polygons baked for it.
+	struct BakeTile {
+		int x = 0;
+		int z = 0;
+		Vector<Vector3> vertices;
+		Vector<Vector<int>> polygons;
+	};
+
+	/// Source geometry shared by the tiles baked in parallel.
+	struct TiledBake {
+		Ref<NavigationMesh> nav_mesh;
+		const float *verts = nullptr;
+		int nverts = 0;
+		const int *tris = nullptr;
+		int ntris = 0;
+		float bmin[3];
+		float bmax[3];
+		int tile_cells = 0;
+		float tile_world_size = 0.0;
+		LocalVector<BakeTile> tiles;
+	};
+
 protected:
 	static void _bind_methods();
 
@@ -54,7 +77,11 @@ protected:
 	static void _add_faces(const PackedVector3Array &p_faces, const Transform &p_xform, Vector<float> &p_verticies, Vector<int> &p_indices);
 	static void _parse_geometry(Transform p_accumulated_transform, Node *p_node, Vector<float> &p_verticies, Vector<int> &p_indices, int p_generate_from, uint32_t p_collision_mask, bool p_recurse_children);
 
+	static void _parse_source_geometry(Ref<NavigationMesh> p_nav_mesh, Node *p_node, Vector<float> &p_verticies, Vector<int> &p_indices);
+
+	static void _convert_detail_mesh(const rcPolyMeshDetail *p_detail_mesh, Vector<Vector3> &r_vertices, Vector<Vector<int>> &r_polygons);
 	static void _convert_detail_mesh_to_native_navigation_mesh(const rcPolyMeshDetail *p_detail_mesh, Ref<NavigationMesh> p_nav_mesh);
+	static void _configure_recast(rcConfig &r_cfg, Ref<NavigationMesh> p_nav_mesh);
 	static void _build_recast_navigation_mesh(
 			Ref<NavigationMesh> p_nav_mesh,
 #ifdef TOOLS_ENABLED
@@ -68,6 +95,9 @@ protected:
 			Vector<float> &vertices,
 			Vector<int> &indices);
 
+	void _bake_tile(uint32_t p_index, TiledBake *p_bake);
+	void _bake_tiles(Ref<NavigationMesh> p_nav_mesh, const Vector<float> &p_vertices, const Vector<int> &p_indices, const AABB *p_area);
+
 public:
 	static NavigationMeshGenerator *get_singleton();
 
@@ -75,6 +105,7 @@ public:
 	~NavigationMeshGenerator();
 
 	void bake(Ref<NavigationMesh> p_nav_mesh, Node *p_node);
+	void bake_area(Ref<NavigationMesh> p_nav_mesh, Node *p_node, const AABB &p_area);
 	void clear(Ref<NavigationMesh> p_nav_mesh);
 };
 
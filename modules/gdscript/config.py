@@ -3,7 +3,21 @@ def can_build(env, platform):
 
 
 def configure(env):
-    pass
+    from SCons.Script import BoolVariable, Variables, Help
+
+    envvars = Variables()
+    envvars.Add(
+        BoolVariable(
+            "gdscript_ptrcall",
+            "Dispatch typed native calls through MethodBind::ptrcall() (enables ptrcall for the whole engine)",
+            False,
+        )
+    )
+    envvars.Update(env)
+    Help(envvars.GenerateHelpText(env))
+
+    if env["gdscript_ptrcall"]:
+        env.use_ptrcall = True
 
 
 def get_doc_classes():
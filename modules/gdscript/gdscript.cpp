@@ -39,6 +39,8 @@
 #include "core/os/file_access.h"
 #include "core/os/os.h"
 #include "core/project_settings.h"
+#include "gdscript_batch_loader.h"
+#include "gdscript_compile_cache.h"
 #include "gdscript_compiler.h"
 
 ///////////////////////////
@@ -554,6 +556,17 @@ Error GDScript::reload(bool p_keep_state) {
 	}
 
 	valid = false;
+
+	source_hash = String();
+	effective_hash = String();
+	if (GDScriptCompileCache::is_enabled() && !p_keep_state) {
+		source_hash = GDScriptCompileCache::hash_source(source);
+		if (GDScriptCompileCache::load(this)) {
+			_finish_compile();
+			return OK;
+		}
+	}
+
 	GDScriptParser parser;
 	Error err = parser.parse(source, basedir, false, path);
 	if (err) {
@@ -580,6 +593,11 @@ Error GDScript::reload(bool p_keep_state) {
 			return err;
 		}
 	}
+
+	if (source_hash != String()) {
+		GDScriptCompileCache::save(this, parser, compiler);
+	}
+
 #ifdef DEBUG_ENABLED
 	for (const List<GDScriptWarning>::Element *E = parser.get_warnings().front(); E; E = E->next()) {
 		const GDScriptWarning &warning = E->get();
@@ -590,6 +608,12 @@ Error GDScript::reload(bool p_keep_state) {
 	}
 #endif
 
+	_finish_compile();
+
+	return OK;
+}
+
+void GDScript::_finish_compile() {
 	valid = true;
 
 	for (Map<StringName, Ref<GDScript>>::Element *E = subclasses.front(); E; E = E->next()) {
@@ -597,8 +621,6 @@ Error GDScript::reload(bool p_keep_state) {
 	}
 
 	_init_rpc_methods_properties();
-
-	return OK;
 }
 
 ScriptLanguage *GDScript::get_language() const {
@@ -757,9 +779,7 @@ Vector<uint8_t> GDScript::get_as_byte_code() const {
 	return tokenizer.parse_code_string(source);
 };
 
-Error GDScript::load_byte_code(const String &p_path) {
-	Vector<uint8_t> bytecode;
-
+Error GDScript::read_byte_code(const String &p_path, Vector<uint8_t> &r_bytecode) {
 	if (p_path.ends_with("gde")) {
 		FileAccess *fa = FileAccess::open(p_path, FileAccess::READ);
 		ERR_FAIL_COND_V(!fa, ERR_CANT_OPEN);
@@ -783,16 +803,26 @@ Error GDScript::load_byte_code(const String &p_path) {
 			ERR_FAIL_COND_V(err, err);
 		}
 
-		bytecode.resize(fae->get_len());
-		fae->get_buffer(bytecode.ptrw(), bytecode.size());
+		r_bytecode.resize(fae->get_len());
+		fae->get_buffer(r_bytecode.ptrw(), r_bytecode.size());
 		fae->close();
 		memdelete(fae);
 
 	} else {
-		bytecode = FileAccess::get_file_as_array(p_path);
+		r_bytecode = FileAccess::get_file_as_array(p_path);
+	}
+
+	ERR_FAIL_COND_V(r_bytecode.size() == 0, ERR_PARSE_ERROR);
+	return OK;
+}
+
+Error GDScript::load_byte_code(const String &p_path) {
+	Vector<uint8_t> bytecode;
+	Error err = read_byte_code(p_path, bytecode);
+	if (err) {
+		return err;
 	}
 
-	ERR_FAIL_COND_V(bytecode.size() == 0, ERR_PARSE_ERROR);
 	path = p_path;
 
 	String basedir = path;
@@ -806,8 +836,19 @@ Error GDScript::load_byte_code(const String &p_path) {
 	}
 
 	valid = false;
+
+	source_hash = String();
+	effective_hash = String();
+	if (GDScriptCompileCache::is_enabled()) {
+		source_hash = GDScriptCompileCache::hash_source(bytecode);
+		if (GDScriptCompileCache::load(this)) {
+			_finish_compile();
+			return OK;
+		}
+	}
+
 	GDScriptParser parser;
-	Error err = parser.parse_bytecode(bytecode, basedir, get_path());
+	err = parser.parse_bytecode(bytecode, basedir, get_path());
 	if (err) {
 		_err_print_error("GDScript::load_byte_code", path.empty() ? "built-in" : (const char *)path.utf8().get_data(), parser.get_error_line(), ("Parse Error: " + parser.get_error()).utf8().get_data(), ERR_HANDLER_SCRIPT);
 		ERR_FAIL_V(ERR_PARSE_ERROR);
@@ -821,13 +862,11 @@ Error GDScript::load_byte_code(const String &p_path) {
 		ERR_FAIL_V(ERR_COMPILATION_FAILED);
 	}
 
-	valid = true;
-
-	for (Map<StringName, Ref<GDScript>>::Element *E = subclasses.front(); E; E = E->next()) {
-		_set_subclass_path(E->get(), path);
+	if (source_hash != String()) {
+		GDScriptCompileCache::save(this, parser, compiler);
 	}
 
-	_init_rpc_methods_properties();
+	_finish_compile();
 
 	return OK;
 }
@@ -1051,6 +1090,7 @@ GDScript::~GDScript() {
 		}
 	}
 
+	GDScriptLanguage::get_singleton()->invalidate_inline_caches();
 	for (Map<StringName, GDScriptFunction *>::Element *E = member_functions.front(); E; E = E->next()) {
 		memdelete(E->get());
 	}
@@ -1535,6 +1575,8 @@ void GDScriptLanguage::init() {
 	for (List<Engine::Singleton>::Element *E = singletons.front(); E; E = E->next()) {
 		_add_global(E->get().name, E->get().ptr);
 	}
+
+	GDScriptCompileCache::init();
 }
 
 String GDScriptLanguage::get_type() const {
@@ -1551,6 +1593,19 @@ Error GDScriptLanguage::execute_file(const String &p_path) {
 }
 
 void GDScriptLanguage::finish() {
+	if (batch_loader) {
+		memdelete(batch_loader);
+		batch_loader = nullptr;
+	}
+}
+
+void GDScriptLanguage::load_project_scripts() {
+	if (!GLOBAL_GET("gdscript/batch_load/enabled") || batch_loader) {
+		return;
+	}
+
+	batch_loader = memnew(GDScriptBatchLoader);
+	batch_loader->load_project_scripts();
 }
 
 void GDScriptLanguage::profiling_start() {
@@ -2180,9 +2235,13 @@ GDScriptLanguage::GDScriptLanguage() {
 	_debug_parse_err_file = "";
 
 	profiling = false;
+	inline_cache_epoch = 0;
 	script_frame_time = 0;
 
 	_debug_call_stack_pos = 0;
+	GLOBAL_DEF("gdscript/compile_cache/enabled", true);
+	GLOBAL_DEF("gdscript/batch_load/enabled", false);
+
 	int dmcs = GLOBAL_DEF("debug/settings/gdscript/max_call_stack", 1024);
 	ProjectSettings::get_singleton()->set_custom_property_info("debug/settings/gdscript/max_call_stack", PropertyInfo(Variant::INT, "debug/settings/gdscript/max_call_stack", PROPERTY_HINT_RANGE, "1024,4096,1,or_greater")); //minimum is 1024
 
@@ -2218,10 +2277,13 @@ GDScriptLanguage::~GDScriptLanguage() {
 }
 
 void GDScriptLanguage::add_orphan_subclass(const String &p_qualified_name, const ObjectID &p_subclass) {
+	MutexLock lock(this->lock);
 	orphan_subclasses[p_qualified_name] = p_subclass;
 }
 
 Ref<GDScript> GDScriptLanguage::get_orphan_subclass(const String &p_qualified_name) {
+	// Scripts can be compiled on several threads at once, see GDScriptBatchLoader.
+	MutexLock lock(this->lock);
 	Map<String, ObjectID>::Element *orphan_subclass_element = orphan_subclasses.find(p_qualified_name);
 	if (!orphan_subclass_element) {
 		return Ref<GDScript>();
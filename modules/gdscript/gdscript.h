@@ -38,6 +38,8 @@
 #include "core/script_language.h"
 #include "gdscript_function.h"
 
+class GDScriptBatchLoader;
+
 class GDScriptNativeClass : public Reference {
 	GDCLASS(GDScriptNativeClass, Reference);
 
@@ -70,6 +72,8 @@ class GDScript : public Script {
 	friend class GDScriptInstance;
 	friend class GDScriptFunction;
 	friend class GDScriptCompiler;
+	friend class GDScriptAOT;
+	friend class GDScriptCompileCache;
 	friend class GDScriptFunctions;
 	friend class GDScriptLanguage;
 
@@ -110,6 +114,8 @@ class GDScript : public Script {
 	Set<Object *> instances;
 	//exported members
 	String source;
+	String source_hash; // Set when the compile cache is in use.
+	String effective_hash; // source_hash folded with the effective hashes of the scripts this one depends on, dependents record it to detect edits.
 	String path;
 	String name;
 	String fully_qualified_name;
@@ -137,6 +143,7 @@ class GDScript : public Script {
 
 	void _save_orphaned_subclasses();
 	void _init_rpc_methods_properties();
+	void _finish_compile();
 
 protected:
 	bool _get(const StringName &p_name, Variant &r_ret) const;
@@ -194,6 +201,7 @@ public:
 	void set_script_path(const String &p_path) { path = p_path; } //because subclasses need a path too...
 	Error load_source_code(const String &p_path);
 	Error load_byte_code(const String &p_path);
+	static Error read_byte_code(const String &p_path, Vector<uint8_t> &r_bytecode);
 
 	Vector<uint8_t> get_as_byte_code() const;
 
@@ -387,11 +395,20 @@ class GDScriptLanguage : public ScriptLanguage {
 	bool profiling;
 	uint64_t script_frame_time;
 
+	std::atomic<uint32_t> inline_cache_epoch;
+
 	Map<String, ObjectID> orphan_subclasses;
 
+	GDScriptBatchLoader *batch_loader = nullptr;
+
 public:
 	int calls;
 
+	// Inline caches in compiled functions are only valid for the epoch they were filled in.
+	// Bumped whenever script code is recompiled or freed.
+	_FORCE_INLINE_ uint32_t get_inline_cache_epoch() const { return inline_cache_epoch.load(std::memory_order_acquire); }
+	_FORCE_INLINE_ void invalidate_inline_caches() { inline_cache_epoch.fetch_add(1, std::memory_order_acq_rel); }
+
 	bool debug_break(const String &p_error, bool p_allow_continue = true);
 	bool debug_break_parse(const String &p_file, int p_line, const String &p_error);
 
@@ -479,6 +496,7 @@ public:
 	virtual String get_extension() const;
 	virtual Error execute_file(const String &p_path);
 	virtual void finish();
+	virtual void load_project_scripts();
 
 	/* EDITOR FUNCTIONS */
 	virtual void get_reserved_words(List<String> *p_words) const;
@@ -0,0 +1,792 @@
+/*************************************************************************/
+/*  gdscript_aot.cpp                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_aot.h"
+
+#include "gdscript.h"
+#include "gdscript_function.h"
+#include "gdscript_functions.h"
+
+GDScriptAOT::FunctionMap *GDScriptAOT::functions = nullptr;
+
+static String _get_call_error_text(const Callable::CallError &p_err, const String &p_where, const Variant **p_args) {
+	switch (p_err.error) {
+		case Callable::CallError::CALL_ERROR_INVALID_ARGUMENT:
+			return "Invalid type in " + p_where + ". Cannot convert argument " + itos(p_err.argument + 1) + " from " + Variant::get_type_name(p_args[p_err.argument]->get_type()) + " to " + Variant::get_type_name(Variant::Type(p_err.expected)) + ".";
+		case Callable::CallError::CALL_ERROR_TOO_MANY_ARGUMENTS:
+		case Callable::CallError::CALL_ERROR_TOO_FEW_ARGUMENTS:
+			return "Invalid call to " + p_where + ". Expected " + itos(p_err.argument) + " arguments.";
+		case Callable::CallError::CALL_ERROR_INVALID_METHOD:
+			return "Invalid call. Nonexistent " + p_where + ".";
+		case Callable::CallError::CALL_ERROR_INSTANCE_IS_NULL:
+			return "Attempt to call " + p_where + " on a null instance.";
+		default:
+			return "Bug, call error: #" + itos(p_err.error);
+	}
+}
+
+bool GDScriptAOT::evaluate(GDScriptAOTFrame &r_frame, Variant::Operator p_op, const Variant &p_a, const Variant &p_b, Variant &r_dst) {
+	bool valid;
+#ifdef DEBUG_ENABLED
+	Variant ret;
+	Variant::evaluate(p_op, p_a, p_b, ret, valid);
+	if (!valid) {
+		if (ret.get_type() == Variant::STRING) {
+			r_frame.error = String(ret) + " in operator '" + Variant::get_operator_name(p_op) + "'.";
+		} else {
+			r_frame.error = "Invalid operands '" + Variant::get_type_name(p_a.get_type()) + "' and '" + Variant::get_type_name(p_b.get_type()) + "' in operator '" + Variant::get_operator_name(p_op) + "'.";
+		}
+		return false;
+	}
+	r_dst = ret;
+#else
+	Variant::evaluate(p_op, p_a, p_b, r_dst, valid);
+#endif
+	return true;
+}
+
+bool GDScriptAOT::get(GDScriptAOTFrame &r_frame, const Variant &p_src, const Variant &p_index, Variant &r_dst) {
+	bool valid;
+	Variant ret = p_src.get(p_index, &valid);
+	if (unlikely(!valid)) {
+		r_frame.error = "Invalid get index of type '" + Variant::get_type_name(p_index.get_type()) + "' (on base: '" + Variant::get_type_name(p_src.get_type()) + "').";
+		return false;
+	}
+	r_dst = ret;
+	return true;
+}
+
+bool GDScriptAOT::set(GDScriptAOTFrame &r_frame, Variant &p_dst, const Variant &p_index, const Variant &p_value) {
+	bool valid;
+	p_dst.set(p_index, p_value, &valid);
+	if (unlikely(!valid)) {
+		r_frame.error = "Invalid set index of type '" + Variant::get_type_name(p_index.get_type()) + "' (on base: '" + Variant::get_type_name(p_dst.get_type()) + "') with value of type '" + Variant::get_type_name(p_value.get_type()) + "'.";
+		return false;
+	}
+	return true;
+}
+
+bool GDScriptAOT::get_named(GDScriptAOTFrame &r_frame, const Variant &p_src, const StringName &p_name, Variant &r_dst) {
+	bool valid;
+	Variant ret = p_src.get_named(p_name, &valid);
+	if (unlikely(!valid)) {
+		r_frame.error = "Invalid get index '" + String(p_name) + "' (on base: '" + Variant::get_type_name(p_src.get_type()) + "').";
+		return false;
+	}
+	r_dst = ret;
+	return true;
+}
+
+bool GDScriptAOT::set_named(GDScriptAOTFrame &r_frame, Variant &p_dst, const StringName &p_name, const Variant &p_value) {
+	bool valid;
+	p_dst.set_named(p_name, p_value, &valid);
+	if (unlikely(!valid)) {
+		r_frame.error = "Invalid set index '" + String(p_name) + "' (on base: '" + Variant::get_type_name(p_dst.get_type()) + "') with value of type '" + Variant::get_type_name(p_value.get_type()) + "'.";
+		return false;
+	}
+	return true;
+}
+
+bool GDScriptAOT::assign_typed(GDScriptAOTFrame &r_frame, Variant::Type p_type, const Variant &p_src, Variant &r_dst) {
+	if (p_src.get_type() == p_type) {
+		r_dst = p_src;
+		return true;
+	}
+	if (unlikely(!Variant::can_convert_strict(p_src.get_type(), p_type))) {
+		r_frame.error = "Trying to assign value of type '" + Variant::get_type_name(p_src.get_type()) + "' to a variable of type '" + Variant::get_type_name(p_type) + "'.";
+		return false;
+	}
+	const Variant *src = &p_src;
+	Callable::CallError ce;
+	r_dst = Variant::construct(p_type, &src, 1, ce);
+	return true;
+}
+
+bool GDScriptAOT::construct(GDScriptAOTFrame &r_frame, Variant::Type p_type, const Variant **p_args, int p_argcount, Variant &r_dst) {
+	Callable::CallError err;
+	r_dst = Variant::construct(p_type, p_args, p_argcount, err);
+	if (unlikely(err.error != Callable::CallError::CALL_OK)) {
+		r_frame.error = _get_call_error_text(err, "'" + Variant::get_type_name(p_type) + "' constructor", p_args);
+		return false;
+	}
+	return true;
+}
+
+bool GDScriptAOT::call(GDScriptAOTFrame &r_frame, Variant &p_base, const StringName &p_method, const Variant **p_args, int p_argcount, Variant *r_ret) {
+	Callable::CallError err;
+	p_base.call_ptr(p_method, p_args, p_argcount, r_ret, err);
+	if (unlikely(err.error != Callable::CallError::CALL_OK)) {
+		r_frame.error = _get_call_error_text(err, "function '" + String(p_method) + "' in base '" + Variant::get_type_name(p_base.get_type()) + "'", p_args);
+		return false;
+	}
+	return true;
+}
+
+bool GDScriptAOT::call_builtin(GDScriptAOTFrame &r_frame, int p_function, const Variant **p_args, int p_argcount, Variant &r_dst) {
+	GDScriptFunctions::Function func = GDScriptFunctions::Function(p_function);
+	Callable::CallError err;
+	GDScriptFunctions::call(func, p_args, p_argcount, r_dst, err);
+	if (unlikely(err.error != Callable::CallError::CALL_OK)) {
+		String methodstr = GDScriptFunctions::get_func_name(func);
+		if (r_dst.get_type() == Variant::STRING) {
+			r_frame.error = "Error calling built-in function '" + methodstr + "': " + String(r_dst);
+		} else {
+			r_frame.error = _get_call_error_text(err, "built-in function '" + methodstr + "'", p_args);
+		}
+		return false;
+	}
+	return true;
+}
+
+int GDScriptAOT::iterate(GDScriptAOTFrame &r_frame, bool p_begin, Variant &p_counter, const Variant &p_container, Variant &r_iterator) {
+	bool valid;
+	bool more = p_begin ? p_container.iter_init(p_counter, valid) : p_container.iter_next(p_counter, valid);
+	if (!more) {
+		if (unlikely(!valid)) {
+			r_frame.error = "Unable to iterate on object of type '" + Variant::get_type_name(p_container.get_type()) + "'.";
+			return -1;
+		}
+		return 0;
+	}
+
+	r_iterator = p_container.iter_get(p_counter, valid);
+	if (unlikely(!valid)) {
+		r_frame.error = "Unable to obtain iterator object of type '" + Variant::get_type_name(p_container.get_type()) + "'.";
+		return -1;
+	}
+	return 1;
+}
+
+// Size of the instruction at p_ip, or 0 if the translator does not handle its opcode.
+int GDScriptAOT::_get_instruction_size(const GDScriptFunction *p_function, int p_ip) {
+	const int *code = p_function->_code_ptr;
+	int remaining = p_function->_code_size - p_ip;
+	int size = 0;
+
+	switch (code[p_ip]) {
+		case GDScriptFunction::OPCODE_BREAKPOINT:
+		case GDScriptFunction::OPCODE_JUMP_TO_DEF_ARGUMENT:
+		case GDScriptFunction::OPCODE_END: {
+			size = 1;
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN_TRUE:
+		case GDScriptFunction::OPCODE_ASSIGN_FALSE:
+		case GDScriptFunction::OPCODE_JUMP:
+		case GDScriptFunction::OPCODE_RETURN:
+		case GDScriptFunction::OPCODE_LINE: {
+			size = 2;
+		} break;
+		case GDScriptFunction::OPCODE_ASSIGN:
+		case GDScriptFunction::OPCODE_JUMP_IF:
+		case GDScriptFunction::OPCODE_JUMP_IF_NOT: {
+			size = 3;
+		} break;
+		case GDScriptFunction::OPCODE_IS_BUILTIN:
+		case GDScriptFunction::OPCODE_SET:
+		case GDScriptFunction::OPCODE_GET:
+		case GDScriptFunction::OPCODE_SET_PACKED:
+		case GDScriptFunction::OPCODE_GET_PACKED:
+		case GDScriptFunction::OPCODE_ASSIGN_TYPED_BUILTIN: {
+			size = 4;
+		} break;
+		case GDScriptFunction::OPCODE_OPERATOR:
+		case GDScriptFunction::OPCODE_OPERATOR_INT:
+		case GDScriptFunction::OPCODE_OPERATOR_FLOAT:
+		case GDScriptFunction::OPCODE_OPERATOR_VECTOR2:
+		case GDScriptFunction::OPCODE_OPERATOR_VECTOR3:
+		case GDScriptFunction::OPCODE_SET_NAMED:
+		case GDScriptFunction::OPCODE_GET_NAMED:
+		case GDScriptFunction::OPCODE_ITERATE_BEGIN:
+		case GDScriptFunction::OPCODE_ITERATE:
+		case GDScriptFunction::OPCODE_ITERATE_BEGIN_PACKED:
+		case GDScriptFunction::OPCODE_ITERATE_PACKED: {
+			size = 5;
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT: {
+			if (remaining > 2) {
+				size = 4 + code[p_ip + 2];
+			}
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT_ARRAY: {
+			if (remaining > 1) {
+				size = 3 + code[p_ip + 1];
+			}
+		} break;
+		case GDScriptFunction::OPCODE_CONSTRUCT_DICTIONARY: {
+			if (remaining > 1) {
+				size = 3 + code[p_ip + 1] * 2;
+			}
+		} break;
+		case GDScriptFunction::OPCODE_CALL:
+		case GDScriptFunction::OPCODE_CALL_RETURN:
+		case GDScriptFunction::OPCODE_CALL_PTRCALL:
+		case GDScriptFunction::OPCODE_CALL_PTRCALL_RETURN: {
+			if (remaining > 1) {
+				size = 6 + code[p_ip + 1];
+			}
+		} break;
+		case GDScriptFunction::OPCODE_CALL_BUILT_IN: {
+			if (remaining > 2) {
+				size = 4 + code[p_ip + 2];
+			}
+		} break;
+		default: {
+			// Yields, self calls, type tests and casts, member access through self and
+			// assertions (which only exist in debug bytecode) stay in the interpreter.
+		} break;
+	}
+
+	if (size <= 0 || size > remaining) {
+		return 0;
+	}
+	return size;
+}
+
+bool GDScriptAOT::_is_supported_address(int p_address) {
+	switch ((p_address & GDScriptFunction::ADDR_TYPE_MASK) >> GDScriptFunction::ADDR_BITS) {
+		case GDScriptFunction::ADDR_TYPE_SELF:
+		case GDScriptFunction::ADDR_TYPE_MEMBER:
+		case GDScriptFunction::ADDR_TYPE_LOCAL_CONSTANT:
+		case GDScriptFunction::ADDR_TYPE_STACK:
+		case GDScriptFunction::ADDR_TYPE_STACK_VARIABLE:
+		case GDScriptFunction::ADDR_TYPE_NIL:
+			return true;
+		default:
+			// Class constants and globals are resolved through tables built at runtime.
+			return false;
+	}
+}
+
+String GDScriptAOT::_get_address(int p_address) {
+	int index = p_address & GDScriptFunction::ADDR_MASK;
+
+	switch ((p_address & GDScriptFunction::ADDR_TYPE_MASK) >> GDScriptFunction::ADDR_BITS) {
+		case GDScriptFunction::ADDR_TYPE_SELF:
+			return "(*f.self)";
+		case GDScriptFunction::ADDR_TYPE_MEMBER:
+			return "f.members[" + itos(index) + "]";
+		case GDScriptFunction::ADDR_TYPE_LOCAL_CONSTANT:
+			return "f.constants[" + itos(index) + "]";
+		case GDScriptFunction::ADDR_TYPE_STACK:
+		case GDScriptFunction::ADDR_TYPE_STACK_VARIABLE:
+			return "stack[" + itos(index) + "]";
+		default:
+			return "f.nil";
+	}
+}
+
+uint32_t GDScriptAOT::hash_function(const GDScriptFunction *p_function) {
+	const int *code = p_function->_code_ptr;
+	int code_size = p_function->_code_size;
+
+	// Line and breakpoint opcodes are only emitted in debug builds. They are left out and
+	// jump targets are renumbered, so bodies generated from the editor match release bytecode.
+	// Typed assignments also lose their type operand, see below.
+	Vector<int> remap;
+	remap.resize(code_size + 1);
+	int pos = 0;
+	for (int ip = 0; ip < code_size;) {
+		int size = _get_instruction_size(p_function, ip);
+		if (!size) {
+			return 0;
+		}
+		remap.write[ip] = pos;
+		if (code[ip] == GDScriptFunction::OPCODE_ASSIGN_TYPED_BUILTIN) {
+			pos += size - 1;
+		} else if (code[ip] != GDScriptFunction::OPCODE_LINE && code[ip] != GDScriptFunction::OPCODE_BREAKPOINT) {
+			pos += size;
+		}
+		ip += size;
+	}
+	remap.write[code_size] = pos;
+
+	uint32_t hash = hash_djb2_one_32(p_function->_argument_count);
+	hash = hash_djb2_one_32(p_function->_stack_size, hash);
+
+	for (int ip = 0; ip < code_size;) {
+		int opcode = code[ip];
+		int size = _get_instruction_size(p_function, ip);
+		if (opcode == GDScriptFunction::OPCODE_LINE || opcode == GDScriptFunction::OPCODE_BREAKPOINT) {
+			ip += size;
+			continue;
+		}
+
+		int jump_operand = -1;
+		int skipped_operand = -1;
+		switch (opcode) {
+			case GDScriptFunction::OPCODE_JUMP: {
+				jump_operand = 1;
+			} break;
+			case GDScriptFunction::OPCODE_JUMP_IF:
+			case GDScriptFunction::OPCODE_JUMP_IF_NOT: {
+				jump_operand = 2;
+			} break;
+			case GDScriptFunction::OPCODE_ITERATE_BEGIN:
+			case GDScriptFunction::OPCODE_ITERATE:
+			case GDScriptFunction::OPCODE_ITERATE_BEGIN_PACKED:
+			case GDScriptFunction::OPCODE_ITERATE_PACKED: {
+				jump_operand = 3;
+			} break;
+			case GDScriptFunction::OPCODE_CALL_PTRCALL: {
+				// Direct calls depend on build options, both forms are translated the same way.
+				opcode = GDScriptFunction::OPCODE_CALL;
+				skipped_operand = 4; // Native call slot, not used by translated code.
+			} break;
+			case GDScriptFunction::OPCODE_CALL_PTRCALL_RETURN: {
+				opcode = GDScriptFunction::OPCODE_CALL_RETURN;
+				skipped_operand = 4;
+			} break;
+			case GDScriptFunction::OPCODE_CALL:
+			case GDScriptFunction::OPCODE_CALL_RETURN: {
+				skipped_operand = 4; // Inline cache slot.
+			} break;
+			// Typed operators and assignments depend on the types the parser could infer, and
+			// native return types are only known with DEBUG_METHODS_ENABLED. The values have
+			// those types either way and the translation checks them before taking its fast
+			// path, so they are hashed as the generic opcode.
+			case GDScriptFunction::OPCODE_OPERATOR_INT:
+			case GDScriptFunction::OPCODE_OPERATOR_FLOAT:
+			case GDScriptFunction::OPCODE_OPERATOR_VECTOR2:
+			case GDScriptFunction::OPCODE_OPERATOR_VECTOR3: {
+				opcode = GDScriptFunction::OPCODE_OPERATOR;
+			} break;
+			case GDScriptFunction::OPCODE_ASSIGN_TYPED_BUILTIN: {
+				opcode = GDScriptFunction::OPCODE_ASSIGN;
+				skipped_operand = 1; // Type.
+			} break;
+		}
+
+		hash = hash_djb2_one_32(opcode, hash);
+		for (int i = 1; i < size; i++) {
+			int value = code[ip + i];
+			if (i == jump_operand) {
+				if (value < 0 || value > code_size) {
+					return 0;
+				}
+				value = remap[value];
+			} else if (i == skipped_operand) {
+				continue;
+			}
+			hash = hash_djb2_one_32(value, hash);
+		}
+		ip += size;
+	}
+
+	for (int i = 0; i < p_function->default_arguments.size(); i++) {
+		int addr = p_function->default_arguments[i];
+		if (addr < 0 || addr > code_size) {
+			return 0;
+		}
+		hash = hash_djb2_one_32(remap[addr], hash);
+	}
+
+	for (int i = 0; i < p_function->constants.size(); i++) {
+		const Variant &constant = p_function->constants[i];
+		if (constant.get_type() == Variant::OBJECT) {
+			return 0; // Object constants (like preloaded resources) can't be compared across runs.
+		}
+		hash = hash_djb2_one_32(constant.get_type(), hash);
+		hash = hash_djb2_one_32(constant.hash(), hash);
+	}
+
+	for (int i = 0; i < p_function->global_names.size(); i++) {
+		hash = hash_djb2_one_32(p_function->global_names[i].hash(), hash);
+	}
+
+	return hash ? hash : 1;
+}
+
+Error GDScriptAOT::_generate_function(const GDScriptFunction *p_function, const String &p_script, const String &p_symbol, String &r_code, String &r_setup) {
+	const int *code = p_function->_code_ptr;
+	int code_size = p_function->_code_size;
+
+	uint32_t hash = hash_function(p_function);
+	if (!hash) {
+		return ERR_UNAVAILABLE;
+	}
+
+	Set<int> targets;
+	for (int ip = 0; ip < code_size; ip += _get_instruction_size(p_function, ip)) {
+		switch (code[ip]) {
+			case GDScriptFunction::OPCODE_JUMP: {
+				targets.insert(code[ip + 1]);
+			} break;
+			case GDScriptFunction::OPCODE_JUMP_IF:
+			case GDScriptFunction::OPCODE_JUMP_IF_NOT: {
+				targets.insert(code[ip + 2]);
+			} break;
+			case GDScriptFunction::OPCODE_ITERATE_BEGIN:
+			case GDScriptFunction::OPCODE_ITERATE:
+			case GDScriptFunction::OPCODE_ITERATE_BEGIN_PACKED:
+			case GDScriptFunction::OPCODE_ITERATE_PACKED: {
+				targets.insert(code[ip + 3]);
+			} break;
+			case GDScriptFunction::OPCODE_JUMP_TO_DEF_ARGUMENT: {
+				for (int i = 0; i < p_function->default_arguments.size(); i++) {
+					targets.insert(p_function->default_arguments[i]);
+				}
+			} break;
+		}
+	}
+
+	String body;
+	int evaluator_count = 0;
+
+#define ADDR(m_ofs) _get_address(code[ip + (m_ofs)])
+#define CHECK_ADDR(m_ofs)                             \
+	if (!_is_supported_address(code[ip + (m_ofs)])) { \
+		return ERR_UNAVAILABLE;                       \
+	}
+
+	for (int ip = 0; ip < code_size;) {
+		int size = _get_instruction_size(p_function, ip);
+		int opcode = code[ip];
+
+		if (targets.has(ip)) {
+			body += "L" + itos(ip) + ":\n";
+		}
+
+		switch (opcode) {
+			case GDScriptFunction::OPCODE_OPERATOR: {
+				CHECK_ADDR(2);
+				CHECK_ADDR(3);
+				CHECK_ADDR(4);
+				Variant::Operator op = Variant::Operator(code[ip + 1]);
+				body += "\tGDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(" + itos(op) + "), " + ADDR(2) + ", " + ADDR(3) + ", " + ADDR(4) + ")); // " + Variant::get_operator_name(op) + "\n";
+			} break;
+			case GDScriptFunction::OPCODE_OPERATOR_INT:
+			case GDScriptFunction::OPCODE_OPERATOR_FLOAT:
+			case GDScriptFunction::OPCODE_OPERATOR_VECTOR2:
+			case GDScriptFunction::OPCODE_OPERATOR_VECTOR3: {
+				CHECK_ADDR(2);
+				CHECK_ADDR(3);
+				CHECK_ADDR(4);
+				Variant::Operator op = Variant::Operator(code[ip + 1]);
+				String type = opcode == GDScriptFunction::OPCODE_OPERATOR_INT ? "Variant::INT" : opcode == GDScriptFunction::OPCODE_OPERATOR_FLOAT ? "Variant::FLOAT" : opcode == GDScriptFunction::OPCODE_OPERATOR_VECTOR2 ? "Variant::VECTOR2" : "Variant::VECTOR3";
+				// Unary operators repeat their operand as the second one.
+				bool unary = op == Variant::OP_NEGATE || op == Variant::OP_POSITIVE || op == Variant::OP_BIT_NEGATE || op == Variant::OP_NOT;
+				String evaluator = p_symbol + "_ops[" + itos(evaluator_count++) + "]";
+				r_setup += "\t" + evaluator + " = Variant::get_validated_operator_evaluator(Variant::Operator(" + itos(op) + "), " + type + ", " + (unary ? String("Variant::NIL") : type) + ");\n";
+
+				String test = ADDR(2) + ".get_type() == " + type;
+				if (!unary) {
+					test += " && " + ADDR(3) + ".get_type() == " + type;
+				}
+				body += "\tif (likely(" + test + " && " + evaluator + ")) { // " + Variant::get_operator_name(op) + "\n";
+				body += "\t\t" + evaluator + "(" + ADDR(2) + ", " + ADDR(3) + ", " + ADDR(4) + ");\n";
+				body += "\t} else {\n";
+				body += "\t\tGDAOT_TRY(GDScriptAOT::evaluate(f, Variant::Operator(" + itos(op) + "), " + ADDR(2) + ", " + ADDR(3) + ", " + ADDR(4) + "));\n";
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_IS_BUILTIN: {
+				CHECK_ADDR(1);
+				CHECK_ADDR(3);
+				body += "\t" + ADDR(3) + " = " + ADDR(1) + ".get_type() == Variant::Type(" + itos(code[ip + 2]) + ");\n";
+			} break;
+			case GDScriptFunction::OPCODE_SET:
+			case GDScriptFunction::OPCODE_SET_PACKED: {
+				CHECK_ADDR(1);
+				CHECK_ADDR(2);
+				CHECK_ADDR(3);
+				body += "\tGDAOT_TRY(GDScriptAOT::set(f, " + ADDR(1) + ", " + ADDR(2) + ", " + ADDR(3) + "));\n";
+			} break;
+			case GDScriptFunction::OPCODE_GET:
+			case GDScriptFunction::OPCODE_GET_PACKED: {
+				CHECK_ADDR(1);
+				CHECK_ADDR(2);
+				CHECK_ADDR(3);
+				body += "\tGDAOT_TRY(GDScriptAOT::get(f, " + ADDR(1) + ", " + ADDR(2) + ", " + ADDR(3) + "));\n";
+			} break;
+			case GDScriptFunction::OPCODE_SET_NAMED: {
+				CHECK_ADDR(1);
+				CHECK_ADDR(4);
+				body += "\tGDAOT_TRY(GDScriptAOT::set_named(f, " + ADDR(1) + ", f.global_names[" + itos(code[ip + 2]) + "], " + ADDR(4) + ")); // " + String(p_function->global_names[code[ip + 2]]) + "\n";
+			} break;
+			case GDScriptFunction::OPCODE_GET_NAMED: {
+				CHECK_ADDR(1);
+				CHECK_ADDR(4);
+				body += "\tGDAOT_TRY(GDScriptAOT::get_named(f, " + ADDR(1) + ", f.global_names[" + itos(code[ip + 2]) + "], " + ADDR(4) + ")); // " + String(p_function->global_names[code[ip + 2]]) + "\n";
+			} break;
+			case GDScriptFunction::OPCODE_ASSIGN: {
+				CHECK_ADDR(1);
+				CHECK_ADDR(2);
+				body += "\t" + ADDR(1) + " = " + ADDR(2) + ";\n";
+			} break;
+			case GDScriptFunction::OPCODE_ASSIGN_TRUE:
+			case GDScriptFunction::OPCODE_ASSIGN_FALSE: {
+				CHECK_ADDR(1);
+				body += "\t" + ADDR(1) + " = " + (opcode == GDScriptFunction::OPCODE_ASSIGN_TRUE ? "true" : "false") + ";\n";
+			} break;
+			case GDScriptFunction::OPCODE_ASSIGN_TYPED_BUILTIN: {
+				CHECK_ADDR(2);
+				CHECK_ADDR(3);
+				String type = "Variant::Type(" + itos(code[ip + 1]) + ")";
+				body += "\tif (likely(" + ADDR(3) + ".get_type() == " + type + ")) {\n";
+				body += "\t\t" + ADDR(2) + " = " + ADDR(3) + ";\n";
+				body += "\t} else {\n";
+				body += "\t\tGDAOT_TRY(GDScriptAOT::assign_typed(f, " + type + ", " + ADDR(3) + ", " + ADDR(2) + "));\n";
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_CONSTRUCT:
+			case GDScriptFunction::OPCODE_CALL:
+			case GDScriptFunction::OPCODE_CALL_RETURN:
+			case GDScriptFunction::OPCODE_CALL_PTRCALL:
+			case GDScriptFunction::OPCODE_CALL_PTRCALL_RETURN:
+			case GDScriptFunction::OPCODE_CALL_BUILT_IN: {
+				int argc = opcode == GDScriptFunction::OPCODE_CONSTRUCT || opcode == GDScriptFunction::OPCODE_CALL_BUILT_IN ? code[ip + 2] : code[ip + 1];
+				int first_arg = opcode == GDScriptFunction::OPCODE_CALL_BUILT_IN || opcode == GDScriptFunction::OPCODE_CONSTRUCT ? 3 : 5;
+				bool has_ret = opcode != GDScriptFunction::OPCODE_CALL && opcode != GDScriptFunction::OPCODE_CALL_PTRCALL;
+
+				String args = "nullptr";
+				body += "\t{\n";
+				if (argc) {
+					body += "\t\tconst Variant *args[] = { ";
+					for (int i = 0; i < argc; i++) {
+						CHECK_ADDR(first_arg + i);
+						body += (i ? ", &" : "&") + ADDR(first_arg + i);
+					}
+					body += " };\n";
+					args = "args";
+				}
+				if (has_ret) {
+					CHECK_ADDR(first_arg + argc);
+				}
+				String ret = ADDR(first_arg + argc);
+
+				if (opcode == GDScriptFunction::OPCODE_CONSTRUCT) {
+					body += "\t\tGDAOT_TRY(GDScriptAOT::construct(f, Variant::Type(" + itos(code[ip + 1]) + "), " + args + ", " + itos(argc) + ", " + ret + "));\n";
+				} else if (opcode == GDScriptFunction::OPCODE_CALL_BUILT_IN) {
+					body += "\t\tGDAOT_TRY(GDScriptAOT::call_builtin(f, " + itos(code[ip + 1]) + ", " + args + ", " + itos(argc) + ", " + ret + ")); // " + GDScriptFunctions::get_func_name(GDScriptFunctions::Function(code[ip + 1])) + "\n";
+				} else {
+					CHECK_ADDR(2);
+					body += "\t\tGDAOT_TRY(GDScriptAOT::call(f, " + ADDR(2) + ", f.global_names[" + itos(code[ip + 3]) + "], " + args + ", " + itos(argc) + ", " + (has_ret ? "&" + ret : String("nullptr")) + ")); // " + String(p_function->global_names[code[ip + 3]]) + "\n";
+				}
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_CONSTRUCT_ARRAY: {
+				int argc = code[ip + 1];
+				body += "\t{\n";
+				body += "\t\tArray array;\n";
+				body += "\t\tarray.resize(" + itos(argc) + ");\n";
+				for (int i = 0; i < argc; i++) {
+					CHECK_ADDR(2 + i);
+					body += "\t\tarray[" + itos(i) + "] = " + ADDR(2 + i) + ";\n";
+				}
+				CHECK_ADDR(2 + argc);
+				body += "\t\t" + ADDR(2 + argc) + " = array;\n";
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_CONSTRUCT_DICTIONARY: {
+				int argc = code[ip + 1];
+				body += "\t{\n";
+				body += "\t\tDictionary dict;\n";
+				for (int i = 0; i < argc; i++) {
+					CHECK_ADDR(2 + i * 2);
+					CHECK_ADDR(3 + i * 2);
+					body += "\t\tdict[" + ADDR(2 + i * 2) + "] = " + ADDR(3 + i * 2) + ";\n";
+				}
+				CHECK_ADDR(2 + argc * 2);
+				body += "\t\t" + ADDR(2 + argc * 2) + " = dict;\n";
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_JUMP: {
+				body += "\tgoto L" + itos(code[ip + 1]) + ";\n";
+			} break;
+			case GDScriptFunction::OPCODE_JUMP_IF:
+			case GDScriptFunction::OPCODE_JUMP_IF_NOT: {
+				CHECK_ADDR(1);
+				body += "\tif (" + String(opcode == GDScriptFunction::OPCODE_JUMP_IF_NOT ? "!" : "") + ADDR(1) + ".booleanize()) {\n";
+				body += "\t\tgoto L" + itos(code[ip + 2]) + ";\n";
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_JUMP_TO_DEF_ARGUMENT: {
+				body += "\tswitch (f.defarg) {\n";
+				for (int i = 0; i < p_function->default_arguments.size(); i++) {
+					body += "\t\tcase " + itos(i) + ":\n";
+					body += "\t\t\tgoto L" + itos(p_function->default_arguments[i]) + ";\n";
+				}
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_RETURN: {
+				CHECK_ADDR(1);
+				body += "\t*f.retvalue = " + ADDR(1) + ";\n";
+				body += "\treturn true;\n";
+			} break;
+			case GDScriptFunction::OPCODE_ITERATE_BEGIN:
+			case GDScriptFunction::OPCODE_ITERATE:
+			case GDScriptFunction::OPCODE_ITERATE_BEGIN_PACKED:
+			case GDScriptFunction::OPCODE_ITERATE_PACKED: {
+				CHECK_ADDR(1);
+				CHECK_ADDR(2);
+				CHECK_ADDR(4);
+				bool begin = opcode == GDScriptFunction::OPCODE_ITERATE_BEGIN || opcode == GDScriptFunction::OPCODE_ITERATE_BEGIN_PACKED;
+				body += "\t{\n";
+				body += "\t\tint result = GDScriptAOT::iterate(f, " + String(begin ? "true" : "false") + ", " + ADDR(1) + ", " + ADDR(2) + ", " + ADDR(4) + ");\n";
+				body += "\t\tif (unlikely(result < 0)) {\n";
+				body += "\t\t\treturn false;\n";
+				body += "\t\t}\n";
+				body += "\t\tif (!result) {\n";
+				body += "\t\t\tgoto L" + itos(code[ip + 3]) + ";\n";
+				body += "\t\t}\n";
+				body += "\t}\n";
+			} break;
+			case GDScriptFunction::OPCODE_LINE: {
+				body += "\tf.line = " + itos(code[ip + 1]) + ";\n";
+			} break;
+			case GDScriptFunction::OPCODE_BREAKPOINT: {
+			} break;
+			case GDScriptFunction::OPCODE_END: {
+				body += "\treturn true;\n";
+			} break;
+		}
+
+		ip += size;
+	}
+
+#undef CHECK_ADDR
+#undef ADDR
+
+	if (targets.has(code_size)) {
+		body += "L" + itos(code_size) + ":\n";
+		body += "\treturn true;\n";
+	}
+
+	r_code += "// " + p_script + "::" + String(p_function->get_name()) + "\n";
+	if (evaluator_count) {
+		r_code += "static Variant::ValidatedOperatorEvaluator " + p_symbol + "_ops[" + itos(evaluator_count) + "];\n\n";
+	}
+	r_code += "static bool " + p_symbol + "(GDScriptAOTFrame &f) {\n";
+	if (body.find("f.self") != -1 || body.find("f.members") != -1) {
+		r_code += "\tif (unlikely(!f.self)) {\n";
+		r_code += "\t\tf.error = \"Cannot access member without instance.\";\n";
+		r_code += "\t\treturn false;\n";
+		r_code += "\t}\n";
+	}
+	if (body.find("stack[") != -1) {
+		r_code += "\tVariant *stack = f.stack;\n";
+	}
+	r_code += "\n" + body + "}\n\n";
+
+	r_setup += "\tGDScriptAOT::register_function(\"" + p_script.c_escape() + "\", \"" + String(p_function->get_name()).c_escape() + "\", " + itos(hash) + "u, " + p_symbol + ");\n";
+
+	return OK;
+}
+
+static String _make_symbol(const String &p_name) {
+	String symbol;
+	for (int i = 0; i < p_name.length(); i++) {
+		CharType c = p_name[i];
+		bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+		symbol += valid ? String::chr(c) : String("_");
+	}
+	return symbol;
+}
+
+Error GDScriptAOT::generate(const Ref<GDScript> &p_script, const String &p_register_symbol, String &r_code) {
+	ERR_FAIL_COND_V(p_script.is_null(), ERR_INVALID_PARAMETER);
+
+	String functions_code;
+	String setup;
+	int generated = 0;
+
+	List<Ref<GDScript>> scripts;
+	scripts.push_back(p_script);
+	while (scripts.size()) {
+		Ref<GDScript> script = scripts.front()->get();
+		scripts.pop_front();
+
+		for (Map<StringName, GDScriptFunction *>::Element *E = script->member_functions.front(); E; E = E->next()) {
+			const GDScriptFunction *function = E->get();
+			if (!function->_code_ptr) {
+				continue;
+			}
+
+			String symbol = "_gdaot_" + itos(generated) + "_" + _make_symbol(E->key());
+			Error err = _generate_function(function, script->fully_qualified_name, symbol, functions_code, setup);
+			if (err != OK) {
+				functions_code += "// " + script->fully_qualified_name + "::" + String(E->key()) + " is kept in the interpreter.\n\n";
+				continue;
+			}
+			generated++;
+		}
+
+		for (Map<StringName, Ref<GDScript>>::Element *E = script->subclasses.front(); E; E = E->next()) {
+			scripts.push_back(E->get());
+		}
+	}
+
+	r_code = "/* Generated from " + p_script->fully_qualified_name + " by the GDScript ahead-of-time compiler. */\n";
+	r_code += "/* Bodies are only used while the script compiles to the same bytecode. */\n\n";
+	r_code += "#include \"modules/gdscript/gdscript_aot.h\"\n\n";
+	r_code += functions_code;
+	r_code += "void " + p_register_symbol + "() {\n" + setup + "}\n";
+
+	return generated ? OK : ERR_UNAVAILABLE;
+}
+
+String GDScriptAOT::_get_key(const String &p_script, const StringName &p_function) {
+	return p_script + "::" + String(p_function);
+}
+
+void GDScriptAOT::register_function(const String &p_script, const StringName &p_function, uint32_t p_hash, GDScriptAOTFunction p_body) {
+	ERR_FAIL_NULL(p_body);
+	if (!functions) {
+		functions = memnew(FunctionMap);
+	}
+
+	Entry entry;
+	entry.hash = p_hash;
+	entry.body = p_body;
+	functions->set(_get_key(p_script, p_function), entry);
+}
+
+GDScriptAOTFunction GDScriptAOT::get_function(const String &p_script, const GDScriptFunction *p_function) {
+	if (!functions) {
+		return nullptr;
+	}
+
+	const Entry *entry = functions->getptr(_get_key(p_script, p_function->get_name()));
+	if (!entry) {
+		return nullptr;
+	}
+
+	if (hash_function(p_function) != entry->hash) {
+		print_verbose("GDScript: Compiled body of '" + _get_key(p_script, p_function->get_name()) + "' does not match the script, using the interpreter.");
+		return nullptr;
+	}
+	return entry->body;
+}
+
+void GDScriptAOT::clear() {
+	if (functions) {
+		memdelete(functions);
+		functions = nullptr;
+	}
+}
@@ -0,0 +1,105 @@
+/*************************************************************************/
+/*  gdscript_aot.h                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_AOT_H
+#define GDSCRIPT_AOT_H
+
+#include "core/hash_map.h"
+#include "core/reference.h"
+#include "core/variant.h"
+
+class GDScript;
+class GDScriptFunction;
+
+// State of a GDScriptFunction call handed to its ahead-of-time compiled body.
+// Addresses resolve exactly like in GDScriptFunction::call().
+struct GDScriptAOTFrame {
+	Variant *stack = nullptr;
+	Variant *self = nullptr; // nullptr when called without an instance.
+	Variant *members = nullptr;
+	Variant *constants = nullptr;
+	const StringName *global_names = nullptr;
+	Variant *retvalue = nullptr;
+	Variant nil;
+	int defarg = 0;
+	int line = 0;
+	String error;
+};
+
+// Returns false on a runtime error, described in r_frame.error.
+typedef bool (*GDScriptAOTFunction)(GDScriptAOTFrame &r_frame);
+
+#define GDAOT_TRY(m_expr)      \
+	if (unlikely(!(m_expr))) { \
+		return false;          \
+	}
+
+// Translates compiled GDScript functions to C++ and keeps the registry of translated
+// bodies. Generated files are built into the engine (usually as a custom module) and
+// register their functions at startup. A body only replaces the bytecode it was
+// generated from, functions that changed since then keep running in the interpreter.
+class GDScriptAOT {
+	struct Entry {
+		uint32_t hash = 0;
+		GDScriptAOTFunction body = nullptr;
+	};
+
+	typedef HashMap<String, Entry> FunctionMap;
+	static FunctionMap *functions;
+
+	static String _get_key(const String &p_script, const StringName &p_function);
+	static int _get_instruction_size(const GDScriptFunction *p_function, int p_ip);
+	static bool _is_supported_address(int p_address);
+	static String _get_address(int p_address);
+	static Error _generate_function(const GDScriptFunction *p_function, const String &p_script, const String &p_symbol, String &r_code, String &r_setup);
+
+public:
+	// Runtime helpers used by generated code, they report errors like the interpreter.
+	static bool evaluate(GDScriptAOTFrame &r_frame, Variant::Operator p_op, const Variant &p_a, const Variant &p_b, Variant &r_dst);
+	static bool get(GDScriptAOTFrame &r_frame, const Variant &p_src, const Variant &p_index, Variant &r_dst);
+	static bool set(GDScriptAOTFrame &r_frame, Variant &p_dst, const Variant &p_index, const Variant &p_value);
+	static bool get_named(GDScriptAOTFrame &r_frame, const Variant &p_src, const StringName &p_name, Variant &r_dst);
+	static bool set_named(GDScriptAOTFrame &r_frame, Variant &p_dst, const StringName &p_name, const Variant &p_value);
+	static bool assign_typed(GDScriptAOTFrame &r_frame, Variant::Type p_type, const Variant &p_src, Variant &r_dst);
+	static bool construct(GDScriptAOTFrame &r_frame, Variant::Type p_type, const Variant **p_args, int p_argcount, Variant &r_dst);
+	static bool call(GDScriptAOTFrame &r_frame, Variant &p_base, const StringName &p_method, const Variant **p_args, int p_argcount, Variant *r_ret);
+	static bool call_builtin(GDScriptAOTFrame &r_frame, int p_function, const Variant **p_args, int p_argcount, Variant &r_dst);
+	// Returns 1 when there is a next element, 0 when done and -1 on error.
+	static int iterate(GDScriptAOTFrame &r_frame, bool p_begin, Variant &p_counter, const Variant &p_container, Variant &r_iterator);
+
+	static uint32_t hash_function(const GDScriptFunction *p_function);
+	static Error generate(const Ref<GDScript> &p_script, const String &p_register_symbol, String &r_code);
+
+	static void register_function(const String &p_script, const StringName &p_function, uint32_t p_hash, GDScriptAOTFunction p_body);
+	static GDScriptAOTFunction get_function(const String &p_script, const GDScriptFunction *p_function);
+	static void clear();
+};
+
+#endif // GDSCRIPT_AOT_H
@@ -0,0 +1,370 @@
+/*************************************************************************/
+/*  gdscript_batch_loader.cpp                                            */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_batch_loader.h"
+
+#include "core/class_db.h"
+#include "core/io/resource_loader.h"
+#include "core/os/dir_access.h"
+#include "core/os/file_access.h"
+#include "core/os/os.h"
+#include "core/script_language.h"
+#include "gdscript.h"
+#include "gdscript_tokenizer.h"
+
+static String _resolve_path(const String &p_base_dir, const String &p_path) {
+	String path = p_path;
+	if (!path.is_abs_path() && p_base_dir != "") {
+		path = p_base_dir.plus_file(path);
+	}
+	return path.replace("///", "//").simplify_path();
+}
+
+void GDScriptBatchLoader::_find_scripts(const String &p_dir, Vector<String> &r_paths) {
+	DirAccessRef da = DirAccess::open(p_dir);
+	if (!da || da->file_exists(".gdignore")) {
+		return;
+	}
+
+	Vector<String> subdirs;
+	da->list_dir_begin();
+	for (String file = da->get_next(); file != String(); file = da->get_next()) {
+		if (file.begins_with(".")) {
+			continue;
+		}
+		if (da->current_is_dir()) {
+			subdirs.push_back(p_dir.plus_file(file));
+		} else if (file.ends_with(".gd")) {
+			r_paths.push_back(p_dir.plus_file(file));
+		} else if (file.ends_with(".gd.remap")) {
+			// Exported scripts are replaced with their compiled form and a remap file.
+			r_paths.push_back(p_dir.plus_file(file.get_basename()));
+		}
+	}
+	da->list_dir_end();
+
+	for (int i = 0; i < subdirs.size(); i++) {
+		_find_scripts(subdirs[i], r_paths);
+	}
+}
+
+uint32_t GDScriptBatchLoader::_add_entry(const String &p_path) {
+	const uint32_t *index = entry_map.getptr(p_path);
+	if (index) {
+		return *index;
+	}
+
+	Entry entry;
+	entry.path = p_path;
+	entry.script = p_path.get_extension() == "gd";
+	entries.push_back(entry);
+	entry_map[p_path] = entries.size() - 1;
+	return entries.size() - 1;
+}
+
+void GDScriptBatchLoader::_scan_entry(uint32_t p_index, const LocalVector<uint32_t> *p_wave) {
+	Entry &entry = entries[(*p_wave)[p_index]];
+
+	if (entry.script) {
+		_scan_script(entry);
+		return;
+	}
+
+	List<String> dependencies;
+	ResourceLoader::get_dependencies(entry.path, &dependencies);
+	for (List<String>::Element *E = dependencies.front(); E; E = E->next()) {
+		entry.found.push_back(E->get());
+	}
+}
+
+void GDScriptBatchLoader::_scan_script(Entry &r_entry) {
+	// A token scan is enough to find what the script loads while it is compiled,
+	// and it doesn't load anything itself, so it can run on any thread.
+	String remapped = ResourceLoader::path_remap(r_entry.path);
+
+	GDScriptTokenizerText text_tokenizer;
+	GDScriptTokenizerBuffer buffer_tokenizer;
+	GDScriptTokenizer *tokenizer;
+
+	if (remapped.get_extension() == "gd") {
+		Error err;
+		String source = FileAccess::get_file_as_string(remapped, &err);
+		if (err != OK) {
+			r_entry.skip = true;
+			return;
+		}
+		text_tokenizer.set_code(source);
+		tokenizer = &text_tokenizer;
+	} else {
+		Vector<uint8_t> bytecode;
+		if (GDScript::read_byte_code(remapped, bytecode) != OK || buffer_tokenizer.set_code_buffer(bytecode) != OK) {
+			r_entry.skip = true;
+			return;
+		}
+		tokenizer = &buffer_tokenizer;
+	}
+
+	String base_dir = r_entry.path.get_base_dir();
+	Vector<StringName> extended;
+	Set<StringName> declared;
+
+	while (tokenizer->get_token() != GDScriptTokenizer::TK_EOF && tokenizer->get_token() != GDScriptTokenizer::TK_ERROR) {
+		switch (tokenizer->get_token()) {
+			case GDScriptTokenizer::TK_PR_PRELOAD: {
+				if (tokenizer->get_token(1) == GDScriptTokenizer::TK_PARENTHESIS_OPEN && tokenizer->get_token(2) == GDScriptTokenizer::TK_CONSTANT) {
+					const Variant &path = tokenizer->get_token_constant(2);
+					if (path.get_type() == Variant::STRING) {
+						r_entry.found.push_back(_resolve_path(base_dir, path));
+					}
+				}
+			} break;
+			case GDScriptTokenizer::TK_PR_EXTENDS: {
+				if (tokenizer->get_token(1) == GDScriptTokenizer::TK_CONSTANT) {
+					const Variant &path = tokenizer->get_token_constant(1);
+					if (path.get_type() == Variant::STRING) {
+						r_entry.found.push_back(_resolve_path(base_dir, path));
+					}
+				} else if (tokenizer->get_token(1) == GDScriptTokenizer::TK_IDENTIFIER) {
+					extended.push_back(tokenizer->get_token_identifier(1));
+				}
+			} break;
+			case GDScriptTokenizer::TK_PR_CLASS:
+			case GDScriptTokenizer::TK_PR_CONST: {
+				if (tokenizer->get_token(1) == GDScriptTokenizer::TK_IDENTIFIER) {
+					declared.insert(tokenizer->get_token_identifier(1));
+				}
+			} break;
+			case GDScriptTokenizer::TK_IDENTIFIER: {
+				// Global classes are loaded when their name is found, so any mention counts.
+				StringName name = tokenizer->get_token_identifier();
+				if (ScriptServer::is_global_class(name)) {
+					r_entry.found.push_back(ScriptServer::get_global_class_path(name));
+				}
+			} break;
+			default: {
+			}
+		}
+		tokenizer->advance();
+	}
+
+	// Scripts extending a class this build doesn't have, like the editor plugins of
+	// addons in an exported game, would only print errors. They are left alone until
+	// something uses them.
+	for (int i = 0; i < extended.size(); i++) {
+		const StringName &base = extended[i];
+		if (!declared.has(base) && !ScriptServer::is_global_class(base) && !ClassDB::class_exists(base) && !ClassDB::class_exists("_" + String(base))) {
+			r_entry.skip = true;
+			break;
+		}
+	}
+}
+
+void GDScriptBatchLoader::_find_components(uint32_t p_index) {
+	// Tarjan's algorithm. Components are completed after all the components they
+	// depend on, so they come out in an order that can be loaded as is.
+	Entry &entry = entries[p_index];
+	entry.visit_index = visit_count;
+	entry.low_link = visit_count;
+	visit_count++;
+	visit_stack.push_back(p_index);
+	entry.on_stack = true;
+
+	for (uint32_t i = 0; i < entry.dependencies.size(); i++) {
+		uint32_t dependency = entry.dependencies[i];
+		if (entries[dependency].visit_index == -1) {
+			_find_components(dependency);
+			entries[p_index].low_link = MIN(entries[p_index].low_link, entries[dependency].low_link);
+		} else if (entries[dependency].on_stack) {
+			entries[p_index].low_link = MIN(entries[p_index].low_link, entries[dependency].visit_index);
+		}
+	}
+
+	if (entries[p_index].low_link != entries[p_index].visit_index) {
+		return;
+	}
+
+	Component component;
+	uint32_t component_index = components.size();
+	while (true) {
+		uint32_t member = visit_stack[visit_stack.size() - 1];
+		visit_stack.resize(visit_stack.size() - 1);
+		entries[member].on_stack = false;
+		entries[member].component = component_index;
+		component.entries.push_back(member);
+		if (member == p_index) {
+			break;
+		}
+	}
+	components.push_back(component);
+}
+
+void GDScriptBatchLoader::_load_entry(uint32_t p_index) {
+	const Entry &entry = entries[p_index];
+	if (entry.script && !entry.skip) {
+		loaded[p_index] = ResourceLoader::load(entry.path);
+	}
+}
+
+void GDScriptBatchLoader::_load_component(Component *p_component) {
+	// Members of a cycle load each other, so the first one usually brings in the rest.
+	for (uint32_t i = 0; i < p_component->entries.size(); i++) {
+		_load_entry(p_component->entries[i]);
+	}
+}
+
+void GDScriptBatchLoader::load_project_scripts() {
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+
+	Vector<String> paths;
+	_find_scripts("res://", paths);
+	for (int i = 0; i < paths.size(); i++) {
+		_add_entry(paths[i]);
+	}
+
+	ThreadWorkPool *pool = ThreadWorkPool::get_singleton();
+
+	// Scan in waves, as resources found by a wave have to be scanned for their own
+	// dependencies. Entries are only added between waves.
+	LocalVector<uint32_t> wave;
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		wave.push_back(i);
+	}
+	while (wave.size()) {
+		pool->do_work(wave.size(), this, &GDScriptBatchLoader::_scan_entry, (const LocalVector<uint32_t> *)&wave);
+
+		uint32_t first_new = entries.size();
+		for (uint32_t i = 0; i < wave.size(); i++) {
+			uint32_t index = wave[i];
+			Vector<String> found = entries[index].found;
+			entries[index].found.clear();
+
+			for (int j = 0; j < found.size(); j++) {
+				if (!entry_map.has(found[j]) && !ResourceLoader::exists(found[j])) {
+					continue; // Reported by the script itself when it is compiled.
+				}
+				uint32_t dependency = _add_entry(found[j]);
+				if (entries[index].dependencies.find(dependency) == -1) {
+					entries[index].dependencies.push_back(dependency);
+				}
+			}
+		}
+
+		wave.clear();
+		for (uint32_t i = first_new; i < entries.size(); i++) {
+			wave.push_back(i);
+		}
+	}
+
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		if (entries[i].visit_index == -1) {
+			_find_components(i);
+		}
+	}
+
+	for (uint32_t i = 0; i < components.size(); i++) {
+		Component &component = components[i];
+		for (uint32_t j = 0; j < component.entries.size(); j++) {
+			const Entry &entry = entries[component.entries[j]];
+			if (!entry.script) {
+				component.parallel = false;
+			}
+			for (uint32_t k = 0; k < entry.dependencies.size(); k++) {
+				uint32_t dependency = entries[entry.dependencies[k]].component;
+				if (dependency == i) {
+					continue;
+				}
+				if (!components[dependency].parallel) {
+					component.parallel = false;
+				}
+				if (component.dependencies.find(dependency) == -1) {
+					component.dependencies.push_back(dependency);
+				}
+			}
+		}
+	}
+
+	loaded.resize(entries.size());
+
+	// Components come after the ones they depend on, so their jobs already exist.
+	for (uint32_t i = 0; i < components.size(); i++) {
+		Component &component = components[i];
+		if (!component.parallel) {
+			continue;
+		}
+
+		component.job = pool->create_job(this, &GDScriptBatchLoader::_load_component, &component);
+		for (uint32_t j = 0; j < component.dependencies.size(); j++) {
+			pool->add_dependency(component.job, components[component.dependencies[j]].job);
+		}
+		pool->submit_job(component.job);
+	}
+	for (uint32_t i = 0; i < components.size(); i++) {
+		if (components[i].job) {
+			pool->wait_for_job(components[i].job);
+			components[i].job = nullptr;
+		}
+	}
+
+	for (uint32_t i = 0; i < components.size(); i++) {
+		if (!components[i].parallel) {
+			_load_component(&components[i]);
+		}
+	}
+
+	uint32_t script_count = 0;
+	uint32_t parallel_count = 0;
+	LocalVector<RES> keep;
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		if (loaded[i].is_valid()) {
+			keep.push_back(loaded[i]);
+			if (components[entries[i].component].parallel) {
+				parallel_count++;
+			}
+		}
+		if (entries[i].script) {
+			script_count++;
+		}
+	}
+
+	// The loaded scripts are kept, otherwise they would be freed and compiled again
+	// when used. The rest is only needed during the load.
+	entries.clear();
+	entry_map.clear();
+	components.clear();
+	visit_stack.clear();
+	visit_count = 0;
+	loaded = keep;
+
+	print_verbose(vformat("GDScript: Loaded %d of %d scripts in %d ms, %d of them on worker threads.", loaded.size(), script_count, (OS::get_singleton()->get_ticks_usec() - begin) / 1000, parallel_count));
+}
+
+void GDScriptBatchLoader::clear() {
+	loaded.clear();
+}
@@ -0,0 +1,94 @@
+/*************************************************************************/
+/*  gdscript_batch_loader.h                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_BATCH_LOADER_H
+#define GDSCRIPT_BATCH_LOADER_H
+
+#include "core/hash_map.h"
+#include "core/local_vector.h"
+#include "core/resource.h"
+#include "core/thread_work_pool.h"
+#include "core/ustring.h"
+
+// Loads every GDScript of the project up front, using the worker threads.
+//
+// All scripts are first tokenized in parallel to find what each one needs while it is
+// compiled: the scripts and resources it preloads or extends, and the global classes it
+// names. Resources found this way are scanned for their own dependencies. The scripts are
+// then grouped into cycles of mutual dependencies and loaded group by group, each one once
+// the groups it depends on are done, so groups without a path between them are parsed and
+// compiled at the same time. Scripts that depend on other resources (like scenes) are
+// loaded afterwards on the calling thread, in dependency order, as resource loading may
+// not be thread safe for every type.
+class GDScriptBatchLoader {
+	struct Entry {
+		String path;
+		bool script = false;
+		bool skip = false; // Not loaded by the batch, see _scan_script().
+		Vector<String> found; // Paths found by the scan, turned into dependencies afterwards.
+		LocalVector<uint32_t> dependencies;
+
+		uint32_t component = 0;
+		int32_t visit_index = -1;
+		int32_t low_link = 0;
+		bool on_stack = false;
+	};
+
+	struct Component {
+		LocalVector<uint32_t> entries;
+		LocalVector<uint32_t> dependencies;
+		bool parallel = true;
+		ThreadWorkPool::Job *job = nullptr;
+	};
+
+	LocalVector<Entry> entries;
+	HashMap<String, uint32_t> entry_map;
+	LocalVector<Component> components;
+	LocalVector<RES> loaded;
+
+	LocalVector<uint32_t> visit_stack;
+	int32_t visit_count = 0;
+
+	void _find_scripts(const String &p_dir, Vector<String> &r_paths);
+	uint32_t _add_entry(const String &p_path);
+
+	void _scan_entry(uint32_t p_index, const LocalVector<uint32_t> *p_wave);
+	void _scan_script(Entry &r_entry);
+	void _find_components(uint32_t p_index);
+
+	void _load_entry(uint32_t p_index);
+	void _load_component(Component *p_component);
+
+public:
+	void load_project_scripts();
+	void clear();
+};
+
+#endif // GDSCRIPT_BATCH_LOADER_H
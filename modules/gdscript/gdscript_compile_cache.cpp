@@ -0,0 +1,1161 @@
+/*************************************************************************/
+/*  gdscript_compile_cache.cpp                                           */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_compile_cache.h"
+
+#include "core/crypto/crypto_core.h"
+#include "core/debugger/engine_debugger.h"
+#include "core/engine.h"
+#include "core/io/marshalls.h"
+#include "core/io/resource_loader.h"
+#include "core/os/dir_access.h"
+#include "core/os/file_access.h"
+#include "core/project_settings.h"
+#include "core/version.h"
+#include "core/version_hash.gen.h"
+#include "gdscript.h"
+#include "gdscript_aot.h"
+#include "gdscript_compiler.h"
+#include "gdscript_parser.h"
+
+#define CACHE_DIR "user://.gdscript_cache"
+
+enum {
+	CACHE_MAGIC = 0x43434447, // "GDCC"
+	CACHE_FORMAT_VERSION = 5,
+	CACHE_CHECKSUM_SIZE = 32,
+};
+
+enum VariantTag {
+	VARIANT_VALUE,
+	VARIANT_NULL_OBJECT,
+	VARIANT_SCRIPT,
+	VARIANT_RESOURCE,
+	VARIANT_NATIVE_CLASS,
+	VARIANT_ARRAY,
+	VARIANT_DICTIONARY,
+};
+
+struct GDScriptCompileCache::Writer {
+	LocalVector<uint8_t> data;
+	Set<String> scripts; // Paths of the script files referenced by the written data.
+
+	void put_8(uint8_t p_value) {
+		data.push_back(p_value);
+	}
+
+	void put_32(uint32_t p_value) {
+		for (int i = 0; i < 4; i++) {
+			data.push_back(p_value & 0xFF);
+			p_value >>= 8;
+		}
+	}
+
+	void put_buffer(const uint8_t *p_buffer, uint32_t p_len) {
+		if (p_len == 0) {
+			return;
+		}
+		uint32_t from = data.size();
+		data.resize(from + p_len);
+		memcpy(&data[from], p_buffer, p_len);
+	}
+
+	void put_string(const String &p_string) {
+		CharString utf8 = p_string.utf8();
+		put_32(utf8.length());
+		put_buffer((const uint8_t *)utf8.get_data(), utf8.length());
+	}
+};
+
+// Reads never go past the end of the data, once a read fails every following one does too.
+struct GDScriptCompileCache::Reader {
+	const uint8_t *data = nullptr;
+	uint32_t size = 0;
+	uint32_t pos = 0;
+	bool failed = false;
+
+	bool has(uint32_t p_len) {
+		if (failed || p_len > size - pos) {
+			failed = true;
+			return false;
+		}
+		return true;
+	}
+
+	uint8_t get_8() {
+		if (!has(1)) {
+			return 0;
+		}
+		return data[pos++];
+	}
+
+	uint32_t get_32() {
+		if (!has(4)) {
+			return 0;
+		}
+		uint32_t value = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24);
+		pos += 4;
+		return value;
+	}
+
+	// Element counts, every element takes at least one byte so larger counts are corrupt.
+	uint32_t get_count() {
+		uint32_t count = get_32();
+		if (!has(count)) {
+			return 0;
+		}
+		return count;
+	}
+
+	const uint8_t *get_buffer(uint32_t p_len) {
+		if (!has(p_len)) {
+			return nullptr;
+		}
+		const uint8_t *ptr = data + pos;
+		pos += p_len;
+		return ptr;
+	}
+
+	String get_string() {
+		uint32_t len = get_32();
+		const uint8_t *ptr = get_buffer(len);
+		String string;
+		if (ptr && len) {
+			string.parse_utf8((const char *)ptr, len);
+		}
+		return string;
+	}
+};
+
+bool GDScriptCompileCache::enabled = false;
+String GDScriptCompileCache::signature;
+
+GDScript *GDScriptCompileCache::_get_root(GDScript *p_class) {
+	while (p_class->_owner) {
+		p_class = p_class->_owner;
+	}
+	return p_class;
+}
+
+Ref<GDScriptNativeClass> GDScriptCompileCache::_find_native_class(const StringName &p_name) {
+	// Classes exposed with a leading underscore are registered without it.
+	String global_name = p_name;
+	if (global_name.begins_with("_")) {
+		global_name = global_name.substr(1, global_name.length());
+	}
+
+	const Map<StringName, int>::Element *E = GDScriptLanguage::get_singleton()->get_global_map().find(global_name);
+	if (!E) {
+		return Ref<GDScriptNativeClass>();
+	}
+	Ref<GDScriptNativeClass> native = GDScriptLanguage::get_singleton()->get_global_array()[E->get()];
+	if (native.is_null() || native->get_name() != p_name) {
+		return Ref<GDScriptNativeClass>();
+	}
+	return native;
+}
+
+bool GDScriptCompileCache::_is_cacheable_path(const String &p_path) {
+	return p_path != String() && p_path.find("::") == -1;
+}
+
+String GDScriptCompileCache::_get_cache_path(const String &p_path) {
+	return String(CACHE_DIR).plus_file(p_path.md5_text() + ".gdcache");
+}
+
+bool GDScriptCompileCache::_write_script_reference(Writer &w, const Ref<Script> &p_script) {
+	if (p_script.is_null()) {
+		w.put_string(String());
+		return true;
+	}
+
+	// Scripts are referenced by file path, inner classes add their names like in fully qualified names.
+	String path;
+	String reference;
+	Ref<GDScript> gdscript = p_script;
+	if (gdscript.is_valid()) {
+		GDScript *root = _get_root(gdscript.ptr());
+		if (!gdscript->fully_qualified_name.begins_with(root->fully_qualified_name)) {
+			return false;
+		}
+		path = root->get_path();
+		reference = path + gdscript->fully_qualified_name.substr(root->fully_qualified_name.length(), gdscript->fully_qualified_name.length());
+	} else {
+		path = p_script->get_path();
+		reference = path;
+	}
+
+	if (!_is_cacheable_path(path)) {
+		return false;
+	}
+
+	w.scripts.insert(path);
+	w.put_string(reference);
+	return true;
+}
+
+Ref<Script> GDScriptCompileCache::_read_script_reference(Reader &r, GDScript *p_root) {
+	String reference = r.get_string();
+	if (reference == String()) {
+		return Ref<Script>();
+	}
+
+	Vector<String> parts = reference.split("::");
+	Ref<Script> script;
+	if (parts[0] == p_root->get_path()) {
+		script = Ref<Script>(p_root);
+	} else {
+		script = ResourceLoader::load(parts[0]);
+	}
+
+	for (int i = 1; i < parts.size(); i++) {
+		Ref<GDScript> gdscript = script;
+		if (gdscript.is_null() || !gdscript->subclasses.has(parts[i])) {
+			return Ref<Script>();
+		}
+		script = gdscript->subclasses[parts[i]];
+	}
+	return script;
+}
+
+bool GDScriptCompileCache::_write_variant(Writer &w, const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::_RID:
+		case Variant::CALLABLE:
+		case Variant::SIGNAL: {
+			return false;
+		} break;
+		case Variant::OBJECT: {
+			Object *obj = p_value;
+			if (!obj) {
+				w.put_8(VARIANT_NULL_OBJECT);
+				return true;
+			}
+
+			Script *script = Object::cast_to<Script>(obj);
+			if (script) {
+				w.put_8(VARIANT_SCRIPT);
+				return _write_script_reference(w, Ref<Script>(script));
+			}
+
+			GDScriptNativeClass *native = Object::cast_to<GDScriptNativeClass>(obj);
+			if (native) {
+				w.put_8(VARIANT_NATIVE_CLASS);
+				w.put_string(native->get_name());
+				return true;
+			}
+
+			Resource *resource = Object::cast_to<Resource>(obj);
+			if (resource && _is_cacheable_path(resource->get_path())) {
+				w.put_8(VARIANT_RESOURCE);
+				w.put_string(resource->get_path());
+				return true;
+			}
+
+			// Other objects only exist at runtime.
+			return false;
+		} break;
+		case Variant::ARRAY: {
+			Array array = p_value;
+			w.put_8(VARIANT_ARRAY);
+			w.put_32(array.size());
+			for (int i = 0; i < array.size(); i++) {
+				if (!_write_variant(w, array[i])) {
+					return false;
+				}
+			}
+			return true;
+		} break;
+		case Variant::DICTIONARY: {
+			Dictionary dictionary = p_value;
+			List<Variant> keys;
+			dictionary.get_key_list(&keys);
+			w.put_8(VARIANT_DICTIONARY);
+			w.put_32(keys.size());
+			for (List<Variant>::Element *E = keys.front(); E; E = E->next()) {
+				if (!_write_variant(w, E->get()) || !_write_variant(w, dictionary[E->get()])) {
+					return false;
+				}
+			}
+			return true;
+		} break;
+		default: {
+			int len;
+			if (encode_variant(p_value, nullptr, len) != OK) {
+				return false;
+			}
+			w.put_8(VARIANT_VALUE);
+			w.put_32(len);
+			uint32_t from = w.data.size();
+			w.data.resize(from + len);
+			return encode_variant(p_value, &w.data[from], len) == OK;
+		} break;
+	}
+}
+
+bool GDScriptCompileCache::_read_variant(Reader &r, GDScript *p_root, Variant &r_value) {
+	switch (r.get_8()) {
+		case VARIANT_VALUE: {
+			uint32_t len = r.get_32();
+			const uint8_t *buffer = r.get_buffer(len);
+			if (!buffer) {
+				return false;
+			}
+			return decode_variant(r_value, buffer, len) == OK;
+		} break;
+		case VARIANT_NULL_OBJECT: {
+			r_value = Variant((Object *)nullptr);
+		} break;
+		case VARIANT_SCRIPT: {
+			Ref<Script> script = _read_script_reference(r, p_root);
+			if (script.is_null()) {
+				return false;
+			}
+			r_value = script;
+		} break;
+		case VARIANT_RESOURCE: {
+			RES resource = ResourceLoader::load(r.get_string());
+			if (resource.is_null()) {
+				return false;
+			}
+			r_value = resource;
+		} break;
+		case VARIANT_NATIVE_CLASS: {
+			Ref<GDScriptNativeClass> native = _find_native_class(r.get_string());
+			if (native.is_null()) {
+				return false;
+			}
+			r_value = native;
+		} break;
+		case VARIANT_ARRAY: {
+			Array array;
+			array.resize(r.get_count());
+			for (int i = 0; i < array.size(); i++) {
+				if (!_read_variant(r, p_root, array[i])) {
+					return false;
+				}
+			}
+			r_value = array;
+		} break;
+		case VARIANT_DICTIONARY: {
+			Dictionary dictionary;
+			uint32_t count = r.get_count();
+			for (uint32_t i = 0; i < count; i++) {
+				Variant key;
+				Variant value;
+				if (!_read_variant(r, p_root, key) || !_read_variant(r, p_root, value)) {
+					return false;
+				}
+				dictionary[key] = value;
+			}
+			r_value = dictionary;
+		} break;
+		default: {
+			return false;
+		} break;
+	}
+	return !r.failed;
+}
+
+bool GDScriptCompileCache::_write_data_type(Writer &w, const GDScriptDataType &p_type) {
+	w.put_8(p_type.has_type);
+	w.put_8(p_type.kind);
+	w.put_32(p_type.builtin_type);
+	w.put_string(p_type.native_type);
+	return _write_script_reference(w, p_type.script_type);
+}
+
+bool GDScriptCompileCache::_read_data_type(Reader &r, GDScript *p_root, GDScriptDataType &r_type) {
+	r_type.has_type = r.get_8();
+	uint8_t kind = r.get_8();
+	uint32_t builtin_type = r.get_32();
+	if (kind > GDScriptDataType::GDSCRIPT || builtin_type >= Variant::VARIANT_MAX) {
+		return false;
+	}
+	r_type.kind = GDScriptDataType::Kind(kind);
+	r_type.builtin_type = Variant::Type(builtin_type);
+	r_type.native_type = r.get_string();
+	r_type.script_type = _read_script_reference(r, p_root);
+	if ((r_type.kind == GDScriptDataType::SCRIPT || r_type.kind == GDScriptDataType::GDSCRIPT) && r_type.script_type.is_null()) {
+		return false;
+	}
+	return !r.failed;
+}
+
+void GDScriptCompileCache::_order_classes(GDScript *p_root, GDScript *p_class, LocalVector<GDScript *> &r_order, Set<GDScript *> &r_visited) {
+	if (r_visited.has(p_class)) {
+		return;
+	}
+	r_visited.insert(p_class);
+
+	// Members of a base class in the same file are copied when restoring, so it goes first.
+	if (p_class->_base && _get_root(p_class->_base) == p_root) {
+		_order_classes(p_root, p_class->_base, r_order, r_visited);
+	}
+	r_order.push_back(p_class);
+
+	for (Map<StringName, Ref<GDScript>>::Element *E = p_class->subclasses.front(); E; E = E->next()) {
+		_order_classes(p_root, E->get().ptr(), r_order, r_visited);
+	}
+}
+
+void GDScriptCompileCache::_write_subclasses(Writer &w, GDScript *p_class) {
+	w.put_32(p_class->subclasses.size());
+	for (Map<StringName, Ref<GDScript>>::Element *E = p_class->subclasses.front(); E; E = E->next()) {
+		w.put_string(E->key());
+		_write_subclasses(w, E->get().ptr());
+	}
+}
+
+bool GDScriptCompileCache::_read_subclasses(Reader &r, GDScript *p_class) {
+	// Same as GDScriptCompiler::_make_scripts().
+	p_class->subclasses.clear();
+
+	uint32_t count = r.get_count();
+	for (uint32_t i = 0; i < count; i++) {
+		StringName name = r.get_string();
+		if (r.failed) {
+			return false;
+		}
+
+		String fully_qualified_name = p_class->fully_qualified_name + "::" + name;
+		Ref<GDScript> subclass = GDScriptLanguage::get_singleton()->get_orphan_subclass(fully_qualified_name);
+		if (subclass.is_null()) {
+			subclass.instance();
+		}
+
+		subclass->_owner = p_class;
+		subclass->fully_qualified_name = fully_qualified_name;
+		p_class->subclasses.insert(name, subclass);
+
+		if (!_read_subclasses(r, subclass.ptr())) {
+			return false;
+		}
+	}
+	return !r.failed;
+}
+
+void GDScriptCompileCache::_clear_class(GDScript *p_class) {
+	// Same as the start of GDScriptCompiler::_parse_class_level().
+	p_class->native = Ref<GDScriptNativeClass>();
+	p_class->base = Ref<GDScript>();
+	p_class->_base = nullptr;
+	p_class->members.clear();
+	p_class->constants.clear();
+	for (Map<StringName, GDScriptFunction *>::Element *E = p_class->member_functions.front(); E; E = E->next()) {
+		memdelete(E->get());
+	}
+	p_class->member_functions.clear();
+	p_class->member_indices.clear();
+	p_class->member_info.clear();
+	p_class->_signals.clear();
+	p_class->initializer = nullptr;
+#ifdef TOOLS_ENABLED
+	p_class->member_lines.clear();
+	p_class->member_default_values.clear();
+#endif
+}
+
+GDScript *GDScriptCompileCache::_find_class(GDScript *p_root, const String &p_fully_qualified_name) {
+	if (p_fully_qualified_name == p_root->fully_qualified_name) {
+		return p_root;
+	}
+	if (!p_fully_qualified_name.begins_with(p_root->fully_qualified_name + "::")) {
+		return nullptr;
+	}
+
+	Vector<String> names = p_fully_qualified_name.substr(p_root->fully_qualified_name.length() + 2, p_fully_qualified_name.length()).split("::");
+	GDScript *script = p_root;
+	for (int i = 0; i < names.size(); i++) {
+		Map<StringName, Ref<GDScript>>::Element *E = script->subclasses.find(names[i]);
+		if (!E) {
+			return nullptr;
+		}
+		script = E->get().ptr();
+	}
+	return script;
+}
+
+bool GDScriptCompileCache::_write_class_level(Writer &w, GDScript *p_class) {
+	w.put_string(p_class->fully_qualified_name);
+	w.put_8(p_class->tool);
+	w.put_string(p_class->name);
+
+	if (p_class->native.is_valid()) {
+		w.put_8(0);
+		w.put_string(p_class->native->get_name());
+	} else {
+		w.put_8(1);
+		if (p_class->base.is_null() || !_write_script_reference(w, p_class->base)) {
+			return false;
+		}
+	}
+
+	w.put_32(p_class->members.size());
+	for (Set<StringName>::Element *E = p_class->members.front(); E; E = E->next()) {
+		const GDScript::MemberInfo &minfo = p_class->member_indices[E->get()];
+		const PropertyInfo &pinfo = p_class->member_info[E->get()];
+
+		w.put_string(E->get());
+		w.put_32(minfo.index);
+		w.put_string(minfo.setter);
+		w.put_string(minfo.getter);
+		w.put_32(minfo.rpc_mode);
+		if (!_write_data_type(w, minfo.data_type)) {
+			return false;
+		}
+
+		w.put_32(pinfo.type);
+		w.put_string(pinfo.class_name);
+		w.put_32(pinfo.hint);
+		w.put_string(pinfo.hint_string);
+		w.put_32(pinfo.usage);
+	}
+
+#ifdef TOOLS_ENABLED
+	w.put_32(p_class->member_default_values.size());
+	for (Map<StringName, Variant>::Element *E = p_class->member_default_values.front(); E; E = E->next()) {
+		w.put_string(E->key());
+		if (!_write_variant(w, E->get())) {
+			return false;
+		}
+	}
+
+	w.put_32(p_class->member_lines.size());
+	for (Map<StringName, int>::Element *E = p_class->member_lines.front(); E; E = E->next()) {
+		w.put_string(E->key());
+		w.put_32(E->get());
+	}
+#endif
+
+	// Subclasses are also listed as constants, they are added back after restoring.
+	LocalVector<const Map<StringName, Variant>::Element *> constants;
+	for (const Map<StringName, Variant>::Element *E = p_class->constants.front(); E; E = E->next()) {
+		const Map<StringName, Ref<GDScript>>::Element *S = p_class->subclasses.find(E->key());
+		if (!S || E->get().operator Object *() != S->get().ptr()) {
+			constants.push_back(E);
+		}
+	}
+	w.put_32(constants.size());
+	for (uint32_t i = 0; i < constants.size(); i++) {
+		w.put_string(constants[i]->key());
+		if (!_write_variant(w, constants[i]->get())) {
+			return false;
+		}
+	}
+
+	w.put_32(p_class->_signals.size());
+	for (Map<StringName, Vector<StringName>>::Element *E = p_class->_signals.front(); E; E = E->next()) {
+		w.put_string(E->key());
+		w.put_32(E->get().size());
+		for (int i = 0; i < E->get().size(); i++) {
+			w.put_string(E->get()[i]);
+		}
+	}
+
+	return true;
+}
+
+bool GDScriptCompileCache::_read_class_level(Reader &r, GDScript *p_root) {
+	GDScript *script = _find_class(p_root, r.get_string());
+	if (!script) {
+		return false;
+	}
+
+	script->tool = r.get_8();
+	script->name = r.get_string();
+
+	if (r.get_8() == 0) {
+		Ref<GDScriptNativeClass> native = _find_native_class(r.get_string());
+		if (native.is_null()) {
+			return false;
+		}
+		script->native = native;
+	} else {
+		Ref<GDScript> base = _read_script_reference(r, p_root);
+		if (base.is_null() || (_get_root(base.ptr()) != p_root && !base->valid)) {
+			return false;
+		}
+		script->base = base;
+		script->_base = base.ptr();
+		script->member_indices = base->member_indices;
+	}
+
+	uint32_t member_count = r.get_count();
+	for (uint32_t i = 0; i < member_count; i++) {
+		StringName name = r.get_string();
+
+		GDScript::MemberInfo minfo;
+		minfo.index = r.get_32();
+		minfo.setter = r.get_string();
+		minfo.getter = r.get_string();
+		minfo.rpc_mode = MultiplayerAPI::RPCMode(r.get_32());
+		if (!_read_data_type(r, p_root, minfo.data_type)) {
+			return false;
+		}
+
+		PropertyInfo pinfo;
+		pinfo.type = Variant::Type(r.get_32());
+		pinfo.name = name;
+		pinfo.class_name = r.get_string();
+		pinfo.hint = PropertyHint(r.get_32());
+		pinfo.hint_string = r.get_string();
+		pinfo.usage = r.get_32();
+
+		script->member_info[name] = pinfo;
+		script->member_indices[name] = minfo;
+		script->members.insert(name);
+	}
+
+#ifdef TOOLS_ENABLED
+	uint32_t default_value_count = r.get_count();
+	for (uint32_t i = 0; i < default_value_count; i++) {
+		StringName name = r.get_string();
+		if (!_read_variant(r, p_root, script->member_default_values[name])) {
+			return false;
+		}
+	}
+
+	uint32_t line_count = r.get_count();
+	for (uint32_t i = 0; i < line_count; i++) {
+		StringName name = r.get_string();
+		script->member_lines[name] = r.get_32();
+	}
+#endif
+
+	uint32_t constant_count = r.get_count();
+	for (uint32_t i = 0; i < constant_count; i++) {
+		StringName name = r.get_string();
+		Variant value;
+		if (!_read_variant(r, p_root, value)) {
+			return false;
+		}
+		script->constants.insert(name, value);
+	}
+
+	uint32_t signal_count = r.get_count();
+	for (uint32_t i = 0; i < signal_count; i++) {
+		StringName name = r.get_string();
+		Vector<StringName> arguments;
+		arguments.resize(r.get_count());
+		for (int j = 0; j < arguments.size(); j++) {
+			arguments.write[j] = r.get_string();
+		}
+		script->_signals[name] = arguments;
+	}
+
+	return !r.failed;
+}
+
+bool GDScriptCompileCache::_write_function(Writer &w, GDScript *p_class, GDScriptFunction *p_function) {
+	w.put_string(p_function->name);
+	w.put_8(p_function->_static);
+	w.put_32(p_function->rpc_mode);
+
+	if (!_write_data_type(w, p_function->return_type)) {
+		return false;
+	}
+	w.put_32(p_function->argument_types.size());
+	for (int i = 0; i < p_function->argument_types.size(); i++) {
+		if (!_write_data_type(w, p_function->argument_types[i])) {
+			return false;
+		}
+	}
+#ifdef TOOLS_ENABLED
+	w.put_32(p_function->arg_names.size());
+	for (int i = 0; i < p_function->arg_names.size(); i++) {
+		w.put_string(p_function->arg_names[i]);
+	}
+#endif
+
+	w.put_32(p_function->constants.size());
+	for (int i = 0; i < p_function->constants.size(); i++) {
+		if (!_write_variant(w, p_function->constants[i])) {
+			return false;
+		}
+	}
+
+	w.put_32(p_function->global_names.size());
+	for (int i = 0; i < p_function->global_names.size(); i++) {
+		w.put_string(p_function->global_names[i]);
+	}
+
+	// Method binds are looked up again, only the signature is needed to find them.
+	w.put_32(p_function->native_calls.size());
+	for (int i = 0; i < p_function->native_calls.size(); i++) {
+		const MethodBind *method = p_function->native_calls[i].method;
+		w.put_string(method->get_instance_class());
+		w.put_string(method->get_name());
+	}
+
+#ifdef TOOLS_ENABLED
+	w.put_32(p_function->named_globals.size());
+	for (int i = 0; i < p_function->named_globals.size(); i++) {
+		w.put_string(p_function->named_globals[i]);
+	}
+#endif
+
+	w.put_32(p_function->default_arguments.size());
+	for (int i = 0; i < p_function->default_arguments.size(); i++) {
+		w.put_32(p_function->default_arguments[i]);
+	}
+
+	w.put_32(p_function->code.size());
+	for (int i = 0; i < p_function->code.size(); i++) {
+		w.put_32(p_function->code[i]);
+	}
+
+	w.put_32(p_function->_argument_count);
+	w.put_32(p_function->_stack_size);
+	w.put_32(p_function->_call_size);
+	w.put_32(p_function->_initial_line);
+	w.put_32(p_function->_inline_cache_count);
+	w.put_8(p_function->_can_yield);
+	w.put_8(p_class->initializer == p_function);
+
+	return true;
+}
+
+bool GDScriptCompileCache::_read_function(Reader &r, GDScript *p_root, GDScript *p_class) {
+	// Same as the end of GDScriptCompiler::_parse_function().
+	StringName name = r.get_string();
+	if (r.failed || p_class->member_functions.has(name)) {
+		return false;
+	}
+
+	// Owned by the class from here, a failed restore leaves it to the compiler to free.
+	GDScriptFunction *function = memnew(GDScriptFunction);
+	p_class->member_functions[name] = function;
+
+	function->_static = r.get_8();
+	function->rpc_mode = MultiplayerAPI::RPCMode(r.get_32());
+
+	if (!_read_data_type(r, p_root, function->return_type)) {
+		return false;
+	}
+	function->argument_types.resize(r.get_count());
+	for (int i = 0; i < function->argument_types.size(); i++) {
+		if (!_read_data_type(r, p_root, function->argument_types.write[i])) {
+			return false;
+		}
+	}
+#ifdef TOOLS_ENABLED
+	function->arg_names.resize(r.get_count());
+	for (int i = 0; i < function->arg_names.size(); i++) {
+		function->arg_names.write[i] = r.get_string();
+	}
+#endif
+
+	function->constants.resize(r.get_count());
+	for (int i = 0; i < function->constants.size(); i++) {
+		if (!_read_variant(r, p_root, function->constants.write[i])) {
+			return false;
+		}
+	}
+	function->_constants_ptr = function->constants.size() ? function->constants.ptrw() : nullptr;
+	function->_constant_count = function->constants.size();
+
+	function->global_names.resize(r.get_count());
+	for (int i = 0; i < function->global_names.size(); i++) {
+		function->global_names.write[i] = r.get_string();
+	}
+	function->_global_names_ptr = function->global_names.size() ? function->global_names.ptr() : nullptr;
+	function->_global_names_count = function->global_names.size();
+
+	uint32_t native_call_count = r.get_count();
+	for (uint32_t i = 0; i < native_call_count; i++) {
+		StringName class_name = r.get_string();
+		StringName method_name = r.get_string();
+		MethodBind *method = ClassDB::get_method(class_name, method_name);
+		GDScriptFunction::NativeCall native_call;
+		if (!method || !GDScriptFunction::make_native_call(method, native_call)) {
+			return false;
+		}
+		function->native_calls.push_back(native_call);
+	}
+	function->_native_calls_ptr = function->native_calls.size() ? function->native_calls.ptr() : nullptr;
+	function->_native_calls_count = function->native_calls.size();
+
+#ifdef TOOLS_ENABLED
+	function->named_globals.resize(r.get_count());
+	for (int i = 0; i < function->named_globals.size(); i++) {
+		function->named_globals.write[i] = r.get_string();
+	}
+	function->_named_globals_ptr = function->named_globals.size() ? function->named_globals.ptr() : nullptr;
+	function->_named_globals_count = function->named_globals.size();
+#endif
+
+	function->default_arguments.resize(r.get_count());
+	for (int i = 0; i < function->default_arguments.size(); i++) {
+		function->default_arguments.write[i] = r.get_32();
+	}
+	function->_default_arg_ptr = function->default_arguments.size() ? function->default_arguments.ptr() : nullptr;
+	function->_default_arg_count = function->default_arguments.size() ? function->default_arguments.size() - 1 : 0;
+
+	function->code.resize(r.get_count());
+	for (int i = 0; i < function->code.size(); i++) {
+		function->code.write[i] = r.get_32();
+	}
+	function->_code_ptr = function->code.size() ? function->code.ptr() : nullptr;
+	function->_code_size = function->code.size();
+
+	function->_argument_count = r.get_32();
+	function->_stack_size = r.get_32();
+	function->_call_size = r.get_32();
+	function->_initial_line = r.get_32();
+
+	uint32_t inline_cache_count = r.get_32();
+	if (inline_cache_count > (uint32_t)function->code.size()) {
+		return false;
+	}
+	if (inline_cache_count) {
+		function->_inline_caches = memnew_arr(GDScriptFunction::InlineCache, inline_cache_count);
+		function->_inline_cache_count = inline_cache_count;
+	}
+
+	function->_can_yield = r.get_8();
+	bool is_initializer = r.get_8();
+	if (r.failed) {
+		return false;
+	}
+
+	function->name = name;
+	function->_script = p_class;
+	function->source = p_root->get_path();
+#ifdef DEBUG_ENABLED
+	function->func_cname = (String(function->source) + " - " + String(name)).utf8();
+	function->_func_cname = function->func_cname.get_data();
+#endif
+	function->_aot_function = GDScriptAOT::get_function(p_class->fully_qualified_name, function);
+
+	if (is_initializer) {
+		p_class->initializer = function;
+	}
+
+	return true;
+}
+
+void GDScriptCompileCache::init() {
+	// The editor reloads and hot-swaps scripts and the debugger needs per-line stack data,
+	// so the cache is only used when running a project.
+	enabled = GLOBAL_GET("gdscript/compile_cache/enabled") && !Engine::get_singleton()->is_editor_hint() && !EngineDebugger::is_active();
+	if (!enabled) {
+		return;
+	}
+
+	// Anything that changes how the same source compiles invalidates every entry.
+	String key = itos(CACHE_FORMAT_VERSION) + "|" + VERSION_FULL_BUILD + "|" + VERSION_HASH;
+#ifdef DEBUG_ENABLED
+	key += "|debug";
+#endif
+#ifdef TOOLS_ENABLED
+	key += "|tools";
+#endif
+#ifdef DEBUG_METHODS_ENABLED
+	key += "|debug_methods";
+#endif
+#ifdef PTRCALL_ENABLED
+	key += "|ptrcall";
+#endif
+
+	Vector<String> entries;
+
+	List<StringName> global_classes;
+	ScriptServer::get_global_class_list(&global_classes);
+	for (List<StringName>::Element *E = global_classes.front(); E; E = E->next()) {
+		entries.push_back(String(E->get()) + "=" + ScriptServer::get_global_class_path(E->get()));
+	}
+
+	List<PropertyInfo> properties;
+	ProjectSettings::get_singleton()->get_property_list(&properties);
+	for (List<PropertyInfo>::Element *E = properties.front(); E; E = E->next()) {
+		if (E->get().name.begins_with("autoload/")) {
+			entries.push_back(E->get().name + "=" + String(ProjectSettings::get_singleton()->get(E->get().name)));
+		}
+	}
+
+	entries.sort();
+	for (int i = 0; i < entries.size(); i++) {
+		key += "|" + entries[i];
+	}
+
+	signature = key.md5_text();
+}
+
+String GDScriptCompileCache::hash_source(const String &p_source) {
+	return p_source.sha256_text();
+}
+
+String GDScriptCompileCache::hash_source(const Vector<uint8_t> &p_bytecode) {
+	unsigned char hash[32];
+	CryptoCore::sha256(p_bytecode.ptr(), p_bytecode.size(), hash);
+	return String::hex_encode_buffer(hash, 32);
+}
+
+bool GDScriptCompileCache::load(GDScript *p_script) {
+	String path = p_script->get_path();
+	if (!enabled || p_script->source_hash == String() || !_is_cacheable_path(path)) {
+		return false;
+	}
+
+	FileAccessRef f = FileAccess::open(_get_cache_path(path), FileAccess::READ);
+	if (!f) {
+		return false;
+	}
+	Vector<uint8_t> buffer;
+	buffer.resize(f->get_len());
+	if (f->get_buffer(buffer.ptrw(), buffer.size()) != buffer.size()) {
+		return false;
+	}
+	f->close();
+
+	Reader r;
+	r.data = buffer.ptr();
+	r.size = buffer.size();
+
+	if (r.get_32() != CACHE_MAGIC || r.get_32() != CACHE_FORMAT_VERSION) {
+		return false;
+	}
+
+	// Restored bytecode is run as is, and the interpreter only checks its operands in debug
+	// builds. A truncated or corrupted entry has to be recompiled instead.
+	const uint8_t *checksum = r.get_buffer(CACHE_CHECKSUM_SIZE);
+	if (!checksum) {
+		return false;
+	}
+	unsigned char hash[CACHE_CHECKSUM_SIZE];
+	if (CryptoCore::sha256(r.data + r.pos, r.size - r.pos, hash) != OK || memcmp(hash, checksum, CACHE_CHECKSUM_SIZE) != 0) {
+		return false;
+	}
+
+	if (r.get_string() != signature || r.get_string() != p_script->source_hash) {
+		return false;
+	}
+
+	// Dependencies are checked by their effective hash, so an edit further up the chain
+	// (like a base of a base gaining a member) also invalidates this entry.
+	String effective_hash = p_script->source_hash;
+	uint32_t dependency_count = r.get_count();
+	for (uint32_t i = 0; i < dependency_count; i++) {
+		String dependency_path = r.get_string();
+		String dependency_hash = r.get_string();
+		if (r.failed) {
+			return false;
+		}
+		Ref<GDScript> dependency = ResourceLoader::load(dependency_path);
+		if (dependency.is_null() || dependency->effective_hash == String() || dependency->effective_hash != dependency_hash) {
+			return false;
+		}
+		effective_hash += "|" + dependency_path + "=" + dependency_hash;
+	}
+
+	const Map<StringName, int> &global_map = GDScriptLanguage::get_singleton()->get_global_map();
+	uint32_t global_count = r.get_count();
+	for (uint32_t i = 0; i < global_count; i++) {
+		StringName name = r.get_string();
+		int index = r.get_32();
+		const Map<StringName, int>::Element *E = global_map.find(name);
+		if (r.failed || !E || E->get() != index) {
+			return false;
+		}
+	}
+
+	// The entry is current. The script is only modified from here on, if restoring still
+	// fails it is left for a regular compile which resets it again.
+	_clear_class(p_script);
+	p_script->fully_qualified_name = p_script->path;
+	p_script->_owner = nullptr;
+	if (!_read_subclasses(r, p_script)) {
+		return false;
+	}
+
+	LocalVector<GDScript *> classes;
+	uint32_t class_count = r.get_count();
+	for (uint32_t i = 0; i < class_count; i++) {
+		uint32_t from = r.pos;
+		GDScript *script = _find_class(p_script, r.get_string());
+		if (!script) {
+			return false;
+		}
+		if (script != p_script) {
+			_clear_class(script);
+		}
+		r.pos = from;
+		if (!_read_class_level(r, p_script)) {
+			return false;
+		}
+		classes.push_back(script);
+	}
+
+	for (uint32_t i = 0; i < class_count; i++) {
+		GDScript *script = _find_class(p_script, r.get_string());
+		if (!script) {
+			return false;
+		}
+		uint32_t function_count = r.get_count();
+		for (uint32_t j = 0; j < function_count; j++) {
+			if (!_read_function(r, p_script, script)) {
+				return false;
+			}
+		}
+	}
+
+	if (r.failed || r.pos != r.size) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < classes.size(); i++) {
+		GDScript *script = classes[i];
+		for (Map<StringName, Ref<GDScript>>::Element *E = script->subclasses.front(); E; E = E->next()) {
+			script->constants.insert(E->key(), E->get());
+		}
+		script->valid = true;
+	}
+	p_script->effective_hash = effective_hash.sha256_text();
+
+	GDScriptLanguage::get_singleton()->invalidate_inline_caches();
+	return true;
+}
+
+void GDScriptCompileCache::save(GDScript *p_script, const GDScriptParser &p_parser, const GDScriptCompiler &p_compiler) {
+	String path = p_script->get_path();
+	if (!enabled || p_script->source_hash == String() || !_is_cacheable_path(path)) {
+		return;
+	}
+
+	LocalVector<GDScript *> classes;
+	Set<GDScript *> visited;
+	_order_classes(p_script, p_script, classes, visited);
+
+	Writer body;
+	_write_subclasses(body, p_script);
+
+	body.put_32(classes.size());
+	for (uint32_t i = 0; i < classes.size(); i++) {
+		if (!_write_class_level(body, classes[i])) {
+			return;
+		}
+	}
+
+	for (uint32_t i = 0; i < classes.size(); i++) {
+		body.put_string(classes[i]->fully_qualified_name);
+		body.put_32(classes[i]->member_functions.size());
+		for (Map<StringName, GDScriptFunction *>::Element *E = classes[i]->member_functions.front(); E; E = E->next()) {
+			if (!_write_function(body, classes[i], E->get())) {
+				return;
+			}
+		}
+	}
+
+	// Every script whose contents may have been folded into this one must be unchanged
+	// for the entry to be used, so they are recorded with their effective hash.
+	Set<String> dependencies = body.scripts;
+	for (const List<String>::Element *E = p_parser.get_dependencies().front(); E; E = E->next()) {
+		dependencies.insert(E->get());
+	}
+	for (const Set<String>::Element *E = p_parser.get_referenced_scripts().front(); E; E = E->next()) {
+		dependencies.insert(E->get());
+	}
+	dependencies.erase(path);
+
+	Writer w;
+	w.put_string(signature);
+	w.put_string(p_script->source_hash);
+
+	// Folded in the same order load() reads them back. A dependency without an effective
+	// hash (not compiled yet, or not cacheable itself) makes this script uncacheable too.
+	String effective_hash = p_script->source_hash;
+	Writer scripts;
+	uint32_t script_count = 0;
+	for (Set<String>::Element *E = dependencies.front(); E; E = E->next()) {
+		Resource *dependency = ResourceCache::get(E->get());
+		if (!dependency) {
+			return;
+		}
+		GDScript *script = Object::cast_to<GDScript>(dependency);
+		if (!script) {
+			continue;
+		}
+		if (script->effective_hash == String()) {
+			return;
+		}
+		scripts.put_string(E->get());
+		scripts.put_string(script->effective_hash);
+		effective_hash += "|" + E->get() + "=" + script->effective_hash;
+		script_count++;
+	}
+	w.put_32(script_count);
+	w.put_buffer(scripts.data.ptr(), scripts.data.size());
+	p_script->effective_hash = effective_hash.sha256_text();
+
+	const Map<StringName, int> &global_map = GDScriptLanguage::get_singleton()->get_global_map();
+	const Set<StringName> &used_globals = p_compiler.get_used_globals();
+	w.put_32(used_globals.size());
+	for (const Set<StringName>::Element *E = used_globals.front(); E; E = E->next()) {
+		const Map<StringName, int>::Element *G = global_map.find(E->get());
+		if (!G) {
+			return;
+		}
+		w.put_string(E->get());
+		w.put_32(G->get());
+	}
+
+	w.put_buffer(body.data.ptr(), body.data.size());
+
+	unsigned char checksum[CACHE_CHECKSUM_SIZE];
+	if (CryptoCore::sha256(w.data.ptr(), w.data.size(), checksum) != OK) {
+		return;
+	}
+	Writer header;
+	header.put_32(CACHE_MAGIC);
+	header.put_32(CACHE_FORMAT_VERSION);
+	header.put_buffer(checksum, CACHE_CHECKSUM_SIZE);
+
+	DirAccessRef da = DirAccess::create(DirAccess::ACCESS_USERDATA);
+	if (da->make_dir_recursive(CACHE_DIR) != OK) {
+		return;
+	}
+
+	// Written next to the entry and moved in place, so a reader never sees a partial file.
+	String cache_path = _get_cache_path(path);
+	String temp_path = cache_path + ".tmp";
+	{
+		FileAccessRef f = FileAccess::open(temp_path, FileAccess::WRITE);
+		if (!f) {
+			return;
+		}
+		f->store_buffer(header.data.ptr(), header.data.size());
+		f->store_buffer(w.data.ptr(), w.data.size());
+		f->close();
+	}
+	if (da->rename(temp_path, cache_path) != OK) {
+		da->remove(temp_path);
+	}
+}
@@ -0,0 +1,93 @@
+/*************************************************************************/
+/*  gdscript_compile_cache.h                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_COMPILE_CACHE_H
+#define GDSCRIPT_COMPILE_CACHE_H
+
+#include "core/local_vector.h"
+#include "core/script_language.h"
+#include "core/set.h"
+#include "core/ustring.h"
+#include "core/variant.h"
+
+class GDScript;
+class GDScriptFunction;
+class GDScriptNativeClass;
+class GDScriptParser;
+class GDScriptCompiler;
+struct GDScriptDataType;
+
+// Stores the compiled form of scripts under user:// so later runs can skip parsing and
+// compiling them. An entry is keyed by the script path and only used when the source hash,
+// the engine build, the global class and autoload setup, the hashes of every script it
+// references and the global indices baked into its bytecode all still match.
+class GDScriptCompileCache {
+	struct Writer;
+	struct Reader;
+
+	static bool enabled;
+	static String signature;
+
+	static GDScript *_get_root(GDScript *p_class);
+	static Ref<GDScriptNativeClass> _find_native_class(const StringName &p_name);
+	static bool _is_cacheable_path(const String &p_path);
+	static String _get_cache_path(const String &p_path);
+
+	static bool _write_script_reference(Writer &w, const Ref<Script> &p_script);
+	static Ref<Script> _read_script_reference(Reader &r, GDScript *p_root);
+	static bool _write_variant(Writer &w, const Variant &p_value);
+	static bool _read_variant(Reader &r, GDScript *p_root, Variant &r_value);
+	static bool _write_data_type(Writer &w, const GDScriptDataType &p_type);
+	static bool _read_data_type(Reader &r, GDScript *p_root, GDScriptDataType &r_type);
+
+	static void _order_classes(GDScript *p_root, GDScript *p_class, LocalVector<GDScript *> &r_order, Set<GDScript *> &r_visited);
+	static void _write_subclasses(Writer &w, GDScript *p_class);
+	static bool _read_subclasses(Reader &r, GDScript *p_class);
+	static void _clear_class(GDScript *p_class);
+	static GDScript *_find_class(GDScript *p_root, const String &p_fully_qualified_name);
+
+	static bool _write_class_level(Writer &w, GDScript *p_class);
+	static bool _read_class_level(Reader &r, GDScript *p_root);
+	static bool _write_function(Writer &w, GDScript *p_class, GDScriptFunction *p_function);
+	static bool _read_function(Reader &r, GDScript *p_root, GDScript *p_class);
+
+public:
+	static void init();
+	static bool is_enabled() { return enabled; }
+
+	static String hash_source(const String &p_source);
+	static String hash_source(const Vector<uint8_t> &p_bytecode);
+
+	// Restores p_script from its cache entry. On failure the script is left for a regular compile.
+	static bool load(GDScript *p_script);
+	static void save(GDScript *p_script, const GDScriptParser &p_parser, const GDScriptCompiler &p_compiler);
+};
+
+#endif // GDSCRIPT_COMPILE_CACHE_H
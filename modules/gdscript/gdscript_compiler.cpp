@@ -82,7 +82,9 @@ bool GDScriptCompiler::_create_unary_operator(CodeGen &codegen, const GDScriptPa
 		return false;
 	}
 
-	codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR); // perform operator
+	GDScriptParser::DataType type_a = on->arguments[0]->get_datatype();
+
+	codegen.opcodes.push_back(_get_operator_opcode(op, type_a, type_a)); // perform operator
 	codegen.opcodes.push_back(op); //which operator
 	codegen.opcodes.push_back(src_address_a); // argument 1
 	codegen.opcodes.push_back(src_address_a); // argument 2 (repeated)
@@ -106,13 +108,162 @@ bool GDScriptCompiler::_create_binary_operator(CodeGen &codegen, const GDScriptP
 		return false;
 	}
 
-	codegen.opcodes.push_back(GDScriptFunction::OPCODE_OPERATOR); // perform operator
+	codegen.opcodes.push_back(_get_operator_opcode(op, on->arguments[0]->get_datatype(), on->arguments[1]->get_datatype())); // perform operator
 	codegen.opcodes.push_back(op); //which operator
 	codegen.opcodes.push_back(src_address_a); // argument 1
 	codegen.opcodes.push_back(src_address_b); // argument 2 (unary only takes one parameter)
 	return true;
 }
 
+GDScriptFunction::Opcode GDScriptCompiler::_get_operator_opcode(Variant::Operator p_op, const GDScriptParser::DataType &p_type_a, const GDScriptParser::DataType &p_type_b) const {
+	// The specialized opcodes still check the operand types at run time,
+	// so they are only worth emitting when the parser knows both of them.
+	if (!p_type_a.has_type || p_type_a.is_meta_type || p_type_a.kind != GDScriptParser::DataType::BUILTIN) {
+		return GDScriptFunction::OPCODE_OPERATOR;
+	}
+	if (!p_type_b.has_type || p_type_b.is_meta_type || p_type_b.kind != GDScriptParser::DataType::BUILTIN) {
+		return GDScriptFunction::OPCODE_OPERATOR;
+	}
+
+	Variant::Type a = p_type_a.builtin_type;
+	Variant::Type b = p_type_b.builtin_type;
+	bool numeric_b = b == Variant::INT || b == Variant::FLOAT;
+
+	switch (p_op) {
+		case Variant::OP_EQUAL:
+		case Variant::OP_NOT_EQUAL:
+		case Variant::OP_LESS:
+		case Variant::OP_LESS_EQUAL:
+		case Variant::OP_GREATER:
+		case Variant::OP_GREATER_EQUAL:
+		case Variant::OP_ADD:
+		case Variant::OP_SUBTRACT:
+		case Variant::OP_NEGATE:
+		case Variant::OP_POSITIVE: {
+			if (a == Variant::INT && b == Variant::INT) {
+				return GDScriptFunction::OPCODE_OPERATOR_INT;
+			}
+			if ((a == Variant::FLOAT && numeric_b) || (a == Variant::INT && b == Variant::FLOAT)) {
+				return GDScriptFunction::OPCODE_OPERATOR_FLOAT;
+			}
+			if (a == Variant::VECTOR2 && b == Variant::VECTOR2) {
+				return GDScriptFunction::OPCODE_OPERATOR_VECTOR2;
+			}
+			if (a == Variant::VECTOR3 && b == Variant::VECTOR3) {
+				return GDScriptFunction::OPCODE_OPERATOR_VECTOR3;
+			}
+		} break;
+		case Variant::OP_MULTIPLY:
+		case Variant::OP_DIVIDE: {
+			if (a == Variant::INT && b == Variant::INT) {
+				return GDScriptFunction::OPCODE_OPERATOR_INT;
+			}
+			if ((a == Variant::FLOAT && numeric_b) || (a == Variant::INT && b == Variant::FLOAT)) {
+				return GDScriptFunction::OPCODE_OPERATOR_FLOAT;
+			}
+			if (a == Variant::VECTOR2 && (b == Variant::VECTOR2 || numeric_b)) {
+				return GDScriptFunction::OPCODE_OPERATOR_VECTOR2;
+			}
+			if (a == Variant::VECTOR3 && (b == Variant::VECTOR3 || numeric_b)) {
+				return GDScriptFunction::OPCODE_OPERATOR_VECTOR3;
+			}
+		} break;
+		case Variant::OP_MODULE:
+		case Variant::OP_SHIFT_LEFT:
+		case Variant::OP_SHIFT_RIGHT:
+		case Variant::OP_BIT_AND:
+		case Variant::OP_BIT_OR:
+		case Variant::OP_BIT_XOR:
+		case Variant::OP_BIT_NEGATE: {
+			if (a == Variant::INT && b == Variant::INT) {
+				return GDScriptFunction::OPCODE_OPERATOR_INT;
+			}
+		} break;
+		default: {
+		}
+	}
+
+	return GDScriptFunction::OPCODE_OPERATOR;
+}
+
+bool GDScriptCompiler::_is_packed_array(const GDScriptParser::Node *p_node) const {
+	// Packed arrays of strings hold objects that are not worth special casing, the
+	// others are indexed and iterated in place by the *_PACKED opcodes.
+	GDScriptParser::DataType datatype = p_node->get_datatype();
+	if (!datatype.has_type || datatype.is_meta_type || datatype.kind != GDScriptParser::DataType::BUILTIN) {
+		return false;
+	}
+
+	switch (datatype.builtin_type) {
+		case Variant::PACKED_BYTE_ARRAY:
+		case Variant::PACKED_INT32_ARRAY:
+		case Variant::PACKED_INT64_ARRAY:
+		case Variant::PACKED_FLOAT32_ARRAY:
+		case Variant::PACKED_FLOAT64_ARRAY:
+		case Variant::PACKED_VECTOR2_ARRAY:
+		case Variant::PACKED_VECTOR3_ARRAY:
+		case Variant::PACKED_COLOR_ARRAY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+int GDScriptCompiler::_get_native_call_pos(CodeGen &codegen, const GDScriptParser::OperatorNode *p_call) {
+	const GDScriptParser::Node *instance = p_call->arguments[0];
+	StringName native_type;
+
+	if (instance->type == GDScriptParser::Node::TYPE_SELF) {
+		if (!codegen.script || !codegen.function_node || codegen.function_node->_static) {
+			return -1;
+		}
+		native_type = codegen.script->get_instance_base_type();
+	} else {
+		GDScriptParser::DataType datatype = instance->get_datatype();
+		if (!datatype.has_type || datatype.is_meta_type) {
+			return -1;
+		}
+		switch (datatype.kind) {
+			case GDScriptParser::DataType::NATIVE: {
+				native_type = datatype.native_type;
+			} break;
+			case GDScriptParser::DataType::SCRIPT:
+			case GDScriptParser::DataType::GDSCRIPT: {
+				if (datatype.script_type.is_valid()) {
+					native_type = datatype.script_type->get_instance_base_type();
+				}
+			} break;
+			default: {
+			}
+		}
+	}
+
+	if (native_type == StringName()) {
+		return -1;
+	}
+
+	const StringName &method_name = static_cast<const GDScriptParser::IdentifierNode *>(p_call->arguments[1])->name;
+	MethodBind *method = ClassDB::get_method(native_type, method_name);
+	if (!method || method->get_argument_count() != p_call->arguments.size() - 2) {
+		return -1;
+	}
+
+	GDScriptFunction::NativeCall native_call;
+	if (!GDScriptFunction::make_native_call(method, native_call)) {
+		return -1;
+	}
+
+	// Only use the direct call when the parser proved the argument types.
+	for (int i = 0; i < method->get_argument_count(); i++) {
+		GDScriptParser::DataType arg_type = p_call->arguments[i + 2]->get_datatype();
+		if (!arg_type.has_type || arg_type.is_meta_type || arg_type.kind != GDScriptParser::DataType::BUILTIN || arg_type.builtin_type != native_call.argument_types[i]) {
+			return -1;
+		}
+	}
+
+	return codegen.get_native_call_pos(native_call);
+}
+
 GDScriptDataType GDScriptCompiler::_gdtype_from_datatype(const GDScriptParser::DataType &p_datatype) const {
 	if (!p_datatype.has_type) {
 		return GDScriptDataType();
@@ -317,6 +468,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 
 			if (GDScriptLanguage::get_singleton()->get_global_map().has(identifier)) {
 				int idx = GDScriptLanguage::get_singleton()->get_global_map()[identifier];
+				used_globals.insert(identifier);
 				return idx | (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS); //argument (stack root)
 			}
 
@@ -493,6 +645,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 					int class_idx;
 					if (GDScriptLanguage::get_singleton()->get_global_map().has(cast_type.native_type)) {
 						class_idx = GDScriptLanguage::get_singleton()->get_global_map()[cast_type.native_type];
+						used_globals.insert(cast_type.native_type);
 						class_idx |= (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS); //argument (stack root)
 					} else {
 						_set_error("Invalid native class type '" + String(cast_type.native_type) + "'.", cn);
@@ -659,11 +812,27 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 							arguments.push_back(ret);
 						}
 
-						codegen.opcodes.push_back(p_root ? GDScriptFunction::OPCODE_CALL : GDScriptFunction::OPCODE_CALL_RETURN); // perform operator
-						codegen.opcodes.push_back(on->arguments.size() - 2);
-						codegen.alloc_call(on->arguments.size() - 2);
-						for (int i = 0; i < arguments.size(); i++) {
-							codegen.opcodes.push_back(arguments[i]);
+						int native_call = _get_native_call_pos(codegen, on);
+						if (native_call >= 0) {
+							codegen.opcodes.push_back(p_root ? GDScriptFunction::OPCODE_CALL_PTRCALL : GDScriptFunction::OPCODE_CALL_PTRCALL_RETURN); // direct native call
+							codegen.opcodes.push_back(on->arguments.size() - 2);
+							codegen.alloc_call(on->arguments.size() - 2);
+							codegen.opcodes.push_back(arguments[0]); // instance
+							codegen.opcodes.push_back(arguments[1]); // method name
+							codegen.opcodes.push_back(native_call); // resolved method bind
+							for (int i = 2; i < arguments.size(); i++) {
+								codegen.opcodes.push_back(arguments[i]);
+							}
+						} else {
+							codegen.opcodes.push_back(p_root ? GDScriptFunction::OPCODE_CALL : GDScriptFunction::OPCODE_CALL_RETURN); // perform operator
+							codegen.opcodes.push_back(on->arguments.size() - 2);
+							codegen.alloc_call(on->arguments.size() - 2);
+							codegen.opcodes.push_back(arguments[0]); // instance
+							codegen.opcodes.push_back(arguments[1]); // method name
+							codegen.opcodes.push_back(codegen.alloc_inline_cache()); // method lookup cache
+							for (int i = 2; i < arguments.size(); i++) {
+								codegen.opcodes.push_back(arguments[i]);
+							}
 						}
 					}
 				} break;
@@ -685,6 +854,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 					}
 
 					//push call bytecode
+					codegen.can_yield = true;
 					codegen.opcodes.push_back(arguments.size() == 0 ? GDScriptFunction::OPCODE_YIELD : GDScriptFunction::OPCODE_YIELD_SIGNAL); // basic type constructor
 					for (int i = 0; i < arguments.size(); i++) {
 						codegen.opcodes.push_back(arguments[i]); //arguments
@@ -752,9 +922,16 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 						}
 					}
 
-					codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_GET_NAMED : GDScriptFunction::OPCODE_GET); // perform operator
+					if (named) {
+						codegen.opcodes.push_back(GDScriptFunction::OPCODE_GET_NAMED); // perform operator
+					} else {
+						codegen.opcodes.push_back(_is_packed_array(on->arguments[0]) ? GDScriptFunction::OPCODE_GET_PACKED : GDScriptFunction::OPCODE_GET); // perform operator
+					}
 					codegen.opcodes.push_back(from); // argument 1
 					codegen.opcodes.push_back(index); // argument 2 (unary only takes one parameter)
+					if (named) {
+						codegen.opcodes.push_back(codegen.alloc_inline_cache()); // property lookup cache
+					}
 
 				} break;
 				case GDScriptParser::OperatorNode::OP_AND: {
@@ -1094,9 +1271,14 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 								return key_idx;
 							}
 
-							codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_GET_NAMED : GDScriptFunction::OPCODE_GET);
+							bool packed = !named && _is_packed_array(E->get()->arguments[0]);
+
+							codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_GET_NAMED : (packed ? GDScriptFunction::OPCODE_GET_PACKED : GDScriptFunction::OPCODE_GET));
 							codegen.opcodes.push_back(prev_pos);
 							codegen.opcodes.push_back(key_idx);
+							if (named) {
+								codegen.opcodes.push_back(codegen.alloc_inline_cache());
+							}
 							slevel++;
 							codegen.alloc_stack(slevel);
 							int dst_pos = (GDScriptFunction::ADDR_TYPE_STACK << GDScriptFunction::ADDR_BITS) | slevel;
@@ -1106,9 +1288,12 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 							//add in reverse order, since it will be reverted
 
 							setchain.push_back(dst_pos);
+							if (named) {
+								setchain.push_back(codegen.alloc_inline_cache());
+							}
 							setchain.push_back(key_idx);
 							setchain.push_back(prev_pos);
-							setchain.push_back(named ? GDScriptFunction::OPCODE_SET_NAMED : GDScriptFunction::OPCODE_SET);
+							setchain.push_back(named ? GDScriptFunction::OPCODE_SET_NAMED : (packed ? GDScriptFunction::OPCODE_SET_PACKED : GDScriptFunction::OPCODE_SET));
 
 							prev_pos = dst_pos;
 						}
@@ -1140,9 +1325,16 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 							return set_value;
 						}
 
-						codegen.opcodes.push_back(named ? GDScriptFunction::OPCODE_SET_NAMED : GDScriptFunction::OPCODE_SET);
+						if (named) {
+							codegen.opcodes.push_back(GDScriptFunction::OPCODE_SET_NAMED);
+						} else {
+							codegen.opcodes.push_back(_is_packed_array(op->arguments[0]) ? GDScriptFunction::OPCODE_SET_PACKED : GDScriptFunction::OPCODE_SET);
+						}
 						codegen.opcodes.push_back(prev_pos);
 						codegen.opcodes.push_back(set_index);
+						if (named) {
+							codegen.opcodes.push_back(codegen.alloc_inline_cache());
+						}
 						codegen.opcodes.push_back(set_value);
 
 						for (int i = 0; i < setchain.size(); i++) {
@@ -1203,6 +1395,7 @@ int GDScriptCompiler::_parse_expression(CodeGen &codegen, const GDScriptParser::
 									int class_idx;
 									if (GDScriptLanguage::get_singleton()->get_global_map().has(assign_type.native_type)) {
 										class_idx = GDScriptLanguage::get_singleton()->get_global_map()[assign_type.native_type];
+										used_globals.insert(assign_type.native_type);
 										class_idx |= (GDScriptFunction::ADDR_TYPE_GLOBAL << GDScriptFunction::ADDR_BITS); //argument (stack root)
 									} else {
 										_set_error("Invalid native class type '" + String(assign_type.native_type) + "'.", on->arguments[0]);
@@ -1455,8 +1648,10 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 						codegen.opcodes.push_back(container_pos);
 						codegen.opcodes.push_back(ret2);
 
+						bool packed = _is_packed_array(cf->arguments[1]);
+
 						//begin loop
-						codegen.opcodes.push_back(GDScriptFunction::OPCODE_ITERATE_BEGIN);
+						codegen.opcodes.push_back(packed ? GDScriptFunction::OPCODE_ITERATE_BEGIN_PACKED : GDScriptFunction::OPCODE_ITERATE_BEGIN);
 						codegen.opcodes.push_back(counter_pos);
 						codegen.opcodes.push_back(container_pos);
 						codegen.opcodes.push_back(codegen.opcodes.size() + 4);
@@ -1469,7 +1664,7 @@ Error GDScriptCompiler::_parse_block(CodeGen &codegen, const GDScriptParser::Blo
 						codegen.opcodes.push_back(0); //skip code for next
 						//next loop
 						int continue_pos = codegen.opcodes.size();
-						codegen.opcodes.push_back(GDScriptFunction::OPCODE_ITERATE);
+						codegen.opcodes.push_back(packed ? GDScriptFunction::OPCODE_ITERATE_PACKED : GDScriptFunction::OPCODE_ITERATE);
 						codegen.opcodes.push_back(counter_pos);
 						codegen.opcodes.push_back(container_pos);
 						codegen.opcodes.push_back(break_pos);
@@ -1618,6 +1813,8 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 	codegen.stack_max = 0;
 	codegen.current_line = 0;
 	codegen.call_max = 0;
+	codegen.inline_cache_count = 0;
+	codegen.can_yield = false;
 	codegen.debug_stack = EngineDebugger::is_active();
 	Vector<StringName> argnames;
 
@@ -1762,6 +1959,22 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 		gdfunc->_global_names_count = 0;
 	}
 
+	//native calls
+	if (codegen.native_calls.size()) {
+		gdfunc->native_calls = codegen.native_calls;
+		gdfunc->_native_calls_ptr = gdfunc->native_calls.ptr();
+		gdfunc->_native_calls_count = gdfunc->native_calls.size();
+	} else {
+		gdfunc->_native_calls_ptr = nullptr;
+		gdfunc->_native_calls_count = 0;
+	}
+
+	//inline caches
+	if (codegen.inline_cache_count) {
+		gdfunc->_inline_caches = memnew_arr(GDScriptFunction::InlineCache, codegen.inline_cache_count);
+		gdfunc->_inline_cache_count = codegen.inline_cache_count;
+	}
+
 #ifdef TOOLS_ENABLED
 	// Named globals
 	if (codegen.named_globals.size()) {
@@ -1796,6 +2009,7 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 	gdfunc->_argument_count = p_func ? p_func->arguments.size() : 0;
 	gdfunc->_stack_size = codegen.stack_max;
 	gdfunc->_call_size = codegen.call_max;
+	gdfunc->_can_yield = codegen.can_yield;
 	gdfunc->name = func_name;
 #ifdef DEBUG_ENABLED
 	if (EngineDebugger::is_active()) {
@@ -1847,6 +2061,8 @@ Error GDScriptCompiler::_parse_function(GDScript *p_script, const GDScriptParser
 		gdfunc->stack_debug = codegen.stack_debug;
 	}
 
+	gdfunc->_aot_function = GDScriptAOT::get_function(p_script->fully_qualified_name, gdfunc);
+
 	if (is_initializer) {
 		p_script->initializer = gdfunc;
 	}
@@ -1876,6 +2092,7 @@ Error GDScriptCompiler::_parse_class_level(GDScript *p_script, const GDScriptPar
 	p_script->_base = nullptr;
 	p_script->members.clear();
 	p_script->constants.clear();
+	GDScriptLanguage::get_singleton()->invalidate_inline_caches();
 	for (Map<StringName, GDScriptFunction *>::Element *E = p_script->member_functions.front(); E; E = E->next()) {
 		memdelete(E->get());
 	}
@@ -2186,6 +2403,7 @@ Error GDScriptCompiler::compile(const GDScriptParser *p_parser, GDScript *p_scri
 	ERR_FAIL_COND_V(root->type != GDScriptParser::Node::TYPE_CLASS, ERR_INVALID_DATA);
 
 	source = p_script->get_path();
+	used_globals.clear();
 
 	// The best fully qualified name for a base level script is its file path
 	p_script->fully_qualified_name = p_script->path;
@@ -2202,6 +2420,9 @@ Error GDScriptCompiler::compile(const GDScriptParser *p_parser, GDScript *p_scri
 
 	err = _parse_class_blocks(p_script, static_cast<const GDScriptParser::ClassNode *>(root), p_keep_state);
 
+	// Members and functions are final now, drop anything cached while they were being rebuilt.
+	GDScriptLanguage::get_singleton()->invalidate_inline_caches();
+
 	if (err) {
 		return err;
 	}
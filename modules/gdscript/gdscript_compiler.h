@@ -109,6 +109,20 @@ class GDScriptCompiler {
 			return ret;
 		}
 
+		Map<MethodBind *, int> native_call_map;
+		Vector<GDScriptFunction::NativeCall> native_calls;
+
+		int get_native_call_pos(const GDScriptFunction::NativeCall &p_native_call) {
+			const Map<MethodBind *, int>::Element *E = native_call_map.find(p_native_call.method);
+			if (E) {
+				return E->get();
+			}
+			int pos = native_calls.size();
+			native_calls.push_back(p_native_call);
+			native_call_map[p_native_call.method] = pos;
+			return pos;
+		}
+
 		int get_constant_pos(const Variant &p_constant) {
 			if (constant_map.has(p_constant)) {
 				return constant_map[p_constant];
@@ -130,9 +144,16 @@ class GDScriptCompiler {
 			}
 		}
 
+		// Each named call or member access gets its own inline cache slot.
+		int alloc_inline_cache() {
+			return inline_cache_count++;
+		}
+
 		int current_line;
 		int stack_max;
 		int call_max;
+		int inline_cache_count;
+		bool can_yield;
 	};
 
 	bool _is_class_member_property(CodeGen &codegen, const StringName &p_name);
@@ -142,6 +163,9 @@ class GDScriptCompiler {
 
 	bool _create_unary_operator(CodeGen &codegen, const GDScriptParser::OperatorNode *on, Variant::Operator op, int p_stack_level);
 	bool _create_binary_operator(CodeGen &codegen, const GDScriptParser::OperatorNode *on, Variant::Operator op, int p_stack_level, bool p_initializer = false, int p_index_addr = 0);
+	GDScriptFunction::Opcode _get_operator_opcode(Variant::Operator p_op, const GDScriptParser::DataType &p_type_a, const GDScriptParser::DataType &p_type_b) const;
+	bool _is_packed_array(const GDScriptParser::Node *p_node) const;
+	int _get_native_call_pos(CodeGen &codegen, const GDScriptParser::OperatorNode *p_call);
 
 	GDScriptDataType _gdtype_from_datatype(const GDScriptParser::DataType &p_datatype) const;
 
@@ -156,6 +180,7 @@ class GDScriptCompiler {
 	int err_column;
 	StringName source;
 	String error;
+	Set<StringName> used_globals;
 
 public:
 	Error compile(const GDScriptParser *p_parser, GDScript *p_script, bool p_keep_state = false);
@@ -163,6 +188,8 @@ public:
 	String get_error() const;
 	int get_error_line() const;
 	int get_error_column() const;
+	// Names whose global array index was baked into the bytecode.
+	const Set<StringName> &get_used_globals() const { return used_globals; }
 
 	GDScriptCompiler();
 };
@@ -30,9 +30,14 @@
 
 #include "gdscript_function.h"
 
+#include "core/class_db.h"
+#include "core/core_string_names.h"
+#include "core/engine.h"
 #include "core/os/os.h"
+#include "core/os/rw_lock.h"
 #include "gdscript.h"
 #include "gdscript_functions.h"
+#include "gdscript_sampling_profiler.h"
 
 Variant *GDScriptFunction::_get_variant(int p_address, GDScriptInstance *p_instance, GDScript *p_script, Variant &self, Variant &static_ref, Variant *p_stack, String &r_error) const {
 	int address = p_address & ADDR_MASK;
@@ -184,14 +189,722 @@ String GDScriptFunction::_get_call_error(const Callable::CallError &p_err, const
 	return err_text;
 }
 
+// Fast paths for the typed operator opcodes. They return false when the
+// operation has to go through Variant::evaluate() instead, either to report
+// an error (like division by zero) or because it is not specialized.
+
+static _FORCE_INLINE_ bool _evaluate_int(Variant::Operator p_op, int64_t p_a, int64_t p_b, Variant &r_ret) {
+	switch (p_op) {
+		case Variant::OP_EQUAL: {
+			r_ret = p_a == p_b;
+		} break;
+		case Variant::OP_NOT_EQUAL: {
+			r_ret = p_a != p_b;
+		} break;
+		case Variant::OP_LESS: {
+			r_ret = p_a < p_b;
+		} break;
+		case Variant::OP_LESS_EQUAL: {
+			r_ret = p_a <= p_b;
+		} break;
+		case Variant::OP_GREATER: {
+			r_ret = p_a > p_b;
+		} break;
+		case Variant::OP_GREATER_EQUAL: {
+			r_ret = p_a >= p_b;
+		} break;
+		case Variant::OP_ADD: {
+			r_ret = p_a + p_b;
+		} break;
+		case Variant::OP_SUBTRACT: {
+			r_ret = p_a - p_b;
+		} break;
+		case Variant::OP_MULTIPLY: {
+			r_ret = p_a * p_b;
+		} break;
+		case Variant::OP_DIVIDE: {
+			if (p_b == 0) {
+				return false;
+			}
+			r_ret = p_a / p_b;
+		} break;
+		case Variant::OP_MODULE: {
+			if (p_b == 0) {
+				return false;
+			}
+			r_ret = p_a % p_b;
+		} break;
+		case Variant::OP_NEGATE: {
+			r_ret = -p_a;
+		} break;
+		case Variant::OP_POSITIVE: {
+			r_ret = p_a;
+		} break;
+		case Variant::OP_SHIFT_LEFT: {
+			if (p_b < 0 || p_b >= 64) {
+				return false;
+			}
+			r_ret = p_a << p_b;
+		} break;
+		case Variant::OP_SHIFT_RIGHT: {
+			if (p_b < 0 || p_b >= 64) {
+				return false;
+			}
+			r_ret = p_a >> p_b;
+		} break;
+		case Variant::OP_BIT_AND: {
+			r_ret = p_a & p_b;
+		} break;
+		case Variant::OP_BIT_OR: {
+			r_ret = p_a | p_b;
+		} break;
+		case Variant::OP_BIT_XOR: {
+			r_ret = p_a ^ p_b;
+		} break;
+		case Variant::OP_BIT_NEGATE: {
+			r_ret = ~p_a;
+		} break;
+		default: {
+			return false;
+		}
+	}
+	return true;
+}
+
+static _FORCE_INLINE_ bool _evaluate_float(Variant::Operator p_op, double p_a, double p_b, Variant &r_ret) {
+	switch (p_op) {
+		case Variant::OP_EQUAL: {
+			r_ret = p_a == p_b;
+		} break;
+		case Variant::OP_NOT_EQUAL: {
+			r_ret = p_a != p_b;
+		} break;
+		case Variant::OP_LESS: {
+			r_ret = p_a < p_b;
+		} break;
+		case Variant::OP_LESS_EQUAL: {
+			r_ret = p_a <= p_b;
+		} break;
+		case Variant::OP_GREATER: {
+			r_ret = p_a > p_b;
+		} break;
+		case Variant::OP_GREATER_EQUAL: {
+			r_ret = p_a >= p_b;
+		} break;
+		case Variant::OP_ADD: {
+			r_ret = p_a + p_b;
+		} break;
+		case Variant::OP_SUBTRACT: {
+			r_ret = p_a - p_b;
+		} break;
+		case Variant::OP_MULTIPLY: {
+			r_ret = p_a * p_b;
+		} break;
+		case Variant::OP_DIVIDE: {
+#ifdef DEBUG_ENABLED
+			if (p_b == 0) {
+				return false;
+			}
+#endif
+			r_ret = p_a / p_b;
+		} break;
+		case Variant::OP_NEGATE: {
+			r_ret = -p_a;
+		} break;
+		case Variant::OP_POSITIVE: {
+			r_ret = p_a;
+		} break;
+		default: {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <class T, Variant::Type VT>
+static _FORCE_INLINE_ bool _evaluate_vector(Variant::Operator p_op, const Variant &p_a, const Variant &p_b, Variant &r_ret) {
+	const T a = p_a;
+
+	if (p_b.get_type() == VT) {
+		const T b = p_b;
+		switch (p_op) {
+			case Variant::OP_EQUAL: {
+				r_ret = a == b;
+			} break;
+			case Variant::OP_NOT_EQUAL: {
+				r_ret = a != b;
+			} break;
+			case Variant::OP_LESS: {
+				r_ret = a < b;
+			} break;
+			case Variant::OP_LESS_EQUAL: {
+				r_ret = a <= b;
+			} break;
+			case Variant::OP_GREATER: {
+				r_ret = b < a;
+			} break;
+			case Variant::OP_GREATER_EQUAL: {
+				r_ret = b <= a;
+			} break;
+			case Variant::OP_ADD: {
+				r_ret = a + b;
+			} break;
+			case Variant::OP_SUBTRACT: {
+				r_ret = a - b;
+			} break;
+			case Variant::OP_MULTIPLY: {
+				r_ret = a * b;
+			} break;
+			case Variant::OP_DIVIDE: {
+				r_ret = a / b;
+			} break;
+			case Variant::OP_NEGATE: {
+				r_ret = -a;
+			} break;
+			case Variant::OP_POSITIVE: {
+				r_ret = a;
+			} break;
+			default: {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (p_b.get_type() == Variant::INT || p_b.get_type() == Variant::FLOAT) {
+		const real_t b = p_b;
+		switch (p_op) {
+			case Variant::OP_MULTIPLY: {
+				r_ret = a * b;
+			} break;
+			case Variant::OP_DIVIDE: {
+				r_ret = a / b;
+			} break;
+			default: {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+// Packed array accesses read and write the array in place, without going through the
+// generic Variant::get()/set() and iterator dispatch. They return false when the fast
+// path does not apply (including out of range indices), so the caller can fall back
+// to the generic path and its error messages.
+
+template <class T>
+static _FORCE_INLINE_ bool _get_packed_element(const Variant &p_array, int64_t p_index, Variant &r_dst) {
+	const Vector<T> *arr = p_array.get_packed_array_ptr<T>();
+	int64_t size = arr->size();
+	if (p_index < 0) {
+		p_index += size;
+	}
+	if (unlikely(p_index < 0 || p_index >= size)) {
+		return false;
+	}
+	// Read the element before assigning, r_dst may be the array itself.
+	const T value = arr->ptr()[p_index];
+	r_dst = value;
+	return true;
+}
+
+template <class T, Variant::Type VT>
+static _FORCE_INLINE_ bool _set_packed_element(Variant &p_array, int64_t p_index, const Variant &p_value) {
+	if (VT == Variant::INT || VT == Variant::FLOAT) {
+		if (p_value.get_type() != Variant::INT && p_value.get_type() != Variant::FLOAT) {
+			return false;
+		}
+	} else if (p_value.get_type() != VT) {
+		return false;
+	}
+
+	Vector<T> *arr = p_array.get_packed_array_ptr<T>();
+	int64_t size = arr->size();
+	if (p_index < 0) {
+		p_index += size;
+	}
+	if (unlikely(p_index < 0 || p_index >= size)) {
+		return false;
+	}
+	arr->ptrw()[p_index] = p_value;
+	return true;
+}
+
+static _FORCE_INLINE_ bool _get_packed(const Variant &p_array, int64_t p_index, Variant &r_dst) {
+	switch (p_array.get_type()) {
+		case Variant::PACKED_BYTE_ARRAY:
+			return _get_packed_element<uint8_t>(p_array, p_index, r_dst);
+		case Variant::PACKED_INT32_ARRAY:
+			return _get_packed_element<int32_t>(p_array, p_index, r_dst);
+		case Variant::PACKED_INT64_ARRAY:
+			return _get_packed_element<int64_t>(p_array, p_index, r_dst);
+		case Variant::PACKED_FLOAT32_ARRAY:
+			return _get_packed_element<float>(p_array, p_index, r_dst);
+		case Variant::PACKED_FLOAT64_ARRAY:
+			return _get_packed_element<double>(p_array, p_index, r_dst);
+		case Variant::PACKED_VECTOR2_ARRAY:
+			return _get_packed_element<Vector2>(p_array, p_index, r_dst);
+		case Variant::PACKED_VECTOR3_ARRAY:
+			return _get_packed_element<Vector3>(p_array, p_index, r_dst);
+		case Variant::PACKED_COLOR_ARRAY:
+			return _get_packed_element<Color>(p_array, p_index, r_dst);
+		default:
+			return false;
+	}
+}
+
+static _FORCE_INLINE_ bool _set_packed(Variant &p_array, int64_t p_index, const Variant &p_value) {
+	switch (p_array.get_type()) {
+		case Variant::PACKED_BYTE_ARRAY:
+			return _set_packed_element<uint8_t, Variant::INT>(p_array, p_index, p_value);
+		case Variant::PACKED_INT32_ARRAY:
+			return _set_packed_element<int32_t, Variant::INT>(p_array, p_index, p_value);
+		case Variant::PACKED_INT64_ARRAY:
+			return _set_packed_element<int64_t, Variant::INT>(p_array, p_index, p_value);
+		case Variant::PACKED_FLOAT32_ARRAY:
+			return _set_packed_element<float, Variant::FLOAT>(p_array, p_index, p_value);
+		case Variant::PACKED_FLOAT64_ARRAY:
+			return _set_packed_element<double, Variant::FLOAT>(p_array, p_index, p_value);
+		case Variant::PACKED_VECTOR2_ARRAY:
+			return _set_packed_element<Vector2, Variant::VECTOR2>(p_array, p_index, p_value);
+		case Variant::PACKED_VECTOR3_ARRAY:
+			return _set_packed_element<Vector3, Variant::VECTOR3>(p_array, p_index, p_value);
+		case Variant::PACKED_COLOR_ARRAY:
+			return _set_packed_element<Color, Variant::COLOR>(p_array, p_index, p_value);
+		default:
+			return false;
+	}
+}
+
+static _FORCE_INLINE_ bool _is_packed_fast_type(Variant::Type p_type) {
+	switch (p_type) {
+		case Variant::PACKED_BYTE_ARRAY:
+		case Variant::PACKED_INT32_ARRAY:
+		case Variant::PACKED_INT64_ARRAY:
+		case Variant::PACKED_FLOAT32_ARRAY:
+		case Variant::PACKED_FLOAT64_ARRAY:
+		case Variant::PACKED_VECTOR2_ARRAY:
+		case Variant::PACKED_VECTOR3_ARRAY:
+		case Variant::PACKED_COLOR_ARRAY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+#ifdef PTRCALL_ENABLED
+// Storage for the arguments and return value of a direct native call, large
+// enough for every type accepted by GDScriptFunction::make_native_call().
+struct _PtrcallValue {
+	alignas(int64_t) uint8_t data[sizeof(Transform)];
+};
+
+static _FORCE_INLINE_ bool _is_ptrcall_type(Variant::Type p_type) {
+	switch (p_type) {
+		case Variant::BOOL:
+		case Variant::INT:
+		case Variant::FLOAT:
+		case Variant::VECTOR2:
+		case Variant::VECTOR2I:
+		case Variant::RECT2:
+		case Variant::RECT2I:
+		case Variant::VECTOR3:
+		case Variant::VECTOR3I:
+		case Variant::TRANSFORM2D:
+		case Variant::PLANE:
+		case Variant::QUAT:
+		case Variant::AABB:
+		case Variant::BASIS:
+		case Variant::TRANSFORM:
+		case Variant::COLOR:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static _FORCE_INLINE_ void _ptrcall_encode(const Variant &p_value, void *r_ptr) {
+	switch (p_value.get_type()) {
+		case Variant::BOOL: {
+			*reinterpret_cast<bool *>(r_ptr) = p_value;
+		} break;
+		case Variant::INT: {
+			*reinterpret_cast<int64_t *>(r_ptr) = p_value;
+		} break;
+		case Variant::FLOAT: {
+			*reinterpret_cast<double *>(r_ptr) = p_value;
+		} break;
+		case Variant::VECTOR2: {
+			memnew_placement(r_ptr, Vector2(p_value));
+		} break;
+		case Variant::VECTOR2I: {
+			memnew_placement(r_ptr, Vector2i(p_value));
+		} break;
+		case Variant::RECT2: {
+			memnew_placement(r_ptr, Rect2(p_value));
+		} break;
+		case Variant::RECT2I: {
+			memnew_placement(r_ptr, Rect2i(p_value));
+		} break;
+		case Variant::VECTOR3: {
+			memnew_placement(r_ptr, Vector3(p_value));
+		} break;
+		case Variant::VECTOR3I: {
+			memnew_placement(r_ptr, Vector3i(p_value));
+		} break;
+		case Variant::TRANSFORM2D: {
+			memnew_placement(r_ptr, Transform2D(p_value));
+		} break;
+		case Variant::PLANE: {
+			memnew_placement(r_ptr, Plane(p_value));
+		} break;
+		case Variant::QUAT: {
+			memnew_placement(r_ptr, Quat(p_value));
+		} break;
+		case Variant::AABB: {
+			memnew_placement(r_ptr, AABB(p_value));
+		} break;
+		case Variant::BASIS: {
+			memnew_placement(r_ptr, Basis(p_value));
+		} break;
+		case Variant::TRANSFORM: {
+			memnew_placement(r_ptr, Transform(p_value));
+		} break;
+		case Variant::COLOR: {
+			memnew_placement(r_ptr, Color(p_value));
+		} break;
+		default: {
+		}
+	}
+}
+
+static _FORCE_INLINE_ void _ptrcall_decode(Variant::Type p_type, const void *p_ptr, Variant &r_value) {
+	switch (p_type) {
+		case Variant::BOOL: {
+			r_value = *reinterpret_cast<const bool *>(p_ptr);
+		} break;
+		case Variant::INT: {
+			r_value = *reinterpret_cast<const int64_t *>(p_ptr);
+		} break;
+		case Variant::FLOAT: {
+			r_value = *reinterpret_cast<const double *>(p_ptr);
+		} break;
+		case Variant::VECTOR2: {
+			r_value = *reinterpret_cast<const Vector2 *>(p_ptr);
+		} break;
+		case Variant::VECTOR2I: {
+			r_value = *reinterpret_cast<const Vector2i *>(p_ptr);
+		} break;
+		case Variant::RECT2: {
+			r_value = *reinterpret_cast<const Rect2 *>(p_ptr);
+		} break;
+		case Variant::RECT2I: {
+			r_value = *reinterpret_cast<const Rect2i *>(p_ptr);
+		} break;
+		case Variant::VECTOR3: {
+			r_value = *reinterpret_cast<const Vector3 *>(p_ptr);
+		} break;
+		case Variant::VECTOR3I: {
+			r_value = *reinterpret_cast<const Vector3i *>(p_ptr);
+		} break;
+		case Variant::TRANSFORM2D: {
+			r_value = *reinterpret_cast<const Transform2D *>(p_ptr);
+		} break;
+		case Variant::PLANE: {
+			r_value = *reinterpret_cast<const Plane *>(p_ptr);
+		} break;
+		case Variant::QUAT: {
+			r_value = *reinterpret_cast<const Quat *>(p_ptr);
+		} break;
+		case Variant::AABB: {
+			r_value = *reinterpret_cast<const AABB *>(p_ptr);
+		} break;
+		case Variant::BASIS: {
+			r_value = *reinterpret_cast<const Basis *>(p_ptr);
+		} break;
+		case Variant::TRANSFORM: {
+			r_value = *reinterpret_cast<const Transform *>(p_ptr);
+		} break;
+		case Variant::COLOR: {
+			r_value = *reinterpret_cast<const Color *>(p_ptr);
+		} break;
+		default: {
+			r_value = Variant();
+		}
+	}
+}
+#endif // PTRCALL_ENABLED
+
+bool GDScriptFunction::make_native_call(MethodBind *p_method, NativeCall &r_call) {
+#if defined(PTRCALL_ENABLED) && defined(DEBUG_METHODS_ENABLED)
+	ERR_FAIL_NULL_V(p_method, false);
+
+	if (p_method->is_vararg() || p_method->get_argument_count() > PTRCALL_MAX_ARGS) {
+		return false;
+	}
+
+	// Enums are passed as 32-bit ints, which the fixed size encoding can't express.
+	if (p_method->has_return()) {
+		if (!_is_ptrcall_type(p_method->get_argument_type(-1)) || (p_method->get_return_info().usage & PROPERTY_USAGE_CLASS_IS_ENUM)) {
+			return false;
+		}
+	}
+	for (int i = 0; i < p_method->get_argument_count(); i++) {
+		if (!_is_ptrcall_type(p_method->get_argument_type(i)) || (p_method->get_argument_info(i).usage & PROPERTY_USAGE_CLASS_IS_ENUM)) {
+			return false;
+		}
+	}
+
+	const ClassDB::ClassInfo *class_info = ClassDB::classes.getptr(p_method->get_instance_class());
+	ERR_FAIL_COND_V(!class_info, false);
+
+	r_call.method = p_method;
+	r_call.class_ptr = class_info->class_ptr;
+	r_call.return_type = p_method->has_return() ? p_method->get_argument_type(-1) : Variant::NIL;
+	for (int i = 0; i < p_method->get_argument_count(); i++) {
+		r_call.argument_types[i] = p_method->get_argument_type(i);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void GDScriptFunction::_resolve_inline_cache(InlineCacheAccess p_access, Object *p_object, const GDScript *p_script, const StringName &p_name, InlineCacheEntry &r_entry) {
+	r_entry.kind = INLINE_CACHE_GENERIC;
+
+	switch (p_access) {
+		case INLINE_CACHE_CALL: {
+			if (p_name == CoreStringNames::get_singleton()->_free) {
+				return; // Object::call handles it before anything else.
+			}
+			if (Object::cast_to<Script>(p_object)) {
+				return; // Scripts override Object::call to reach their static functions.
+			}
+			for (const GDScript *sptr = p_script; sptr; sptr = sptr->_base) {
+				const Map<StringName, GDScriptFunction *>::Element *E = sptr->member_functions.find(p_name);
+				if (E) {
+					r_entry.kind = INLINE_CACHE_SCRIPT_FUNCTION;
+					r_entry.function = E->get();
+					return;
+				}
+			}
+			MethodBind *method = ClassDB::get_method(p_object->get_class_name(), p_name);
+			if (method) {
+				r_entry.kind = INLINE_CACHE_METHOD;
+				r_entry.method = method;
+			}
+			return;
+		}
+		case INLINE_CACHE_GET: {
+			// Same lookup order as GDScriptInstance::get, members with getters are left to it.
+			if (p_script) {
+				const Map<StringName, GDScript::MemberInfo>::Element *E = p_script->member_indices.find(p_name);
+				if (E) {
+					if (E->get().getter == StringName()) {
+						r_entry.kind = INLINE_CACHE_MEMBER;
+						r_entry.index = E->get().index;
+					}
+					return;
+				}
+				for (const GDScript *sptr = p_script; sptr; sptr = sptr->_base) {
+					if (sptr->constants.has(p_name) || sptr->member_functions.has(GDScriptLanguage::get_singleton()->strings._get)) {
+						return;
+					}
+				}
+			}
+
+			// Same lookup order as ClassDB::get_property.
+			RWLockRead read_lock(ClassDB::lock);
+			for (const ClassDB::ClassInfo *check = ClassDB::classes.getptr(p_object->get_class_name()); check; check = check->inherits_ptr) {
+				const ClassDB::PropertySetGet *psg = check->property_setget.getptr(p_name);
+				if (psg) {
+					if (psg->getter != StringName() && psg->index < 0 && psg->_getptr) {
+						r_entry.kind = INLINE_CACHE_GETTER;
+						r_entry.method = psg->_getptr;
+					}
+					return;
+				}
+				if (check->constant_map.has(p_name) || check->method_map.has(p_name) || check->signal_map.has(p_name)) {
+					return;
+				}
+			}
+			return;
+		}
+		case INLINE_CACHE_SET: {
+#ifdef TOOLS_ENABLED
+			if (Engine::get_singleton()->is_editor_hint()) {
+				return; // Object::set also flags the object as edited.
+			}
+#endif
+			// Same lookup order as GDScriptInstance::set, members with setters are left to it.
+			if (p_script) {
+				const Map<StringName, GDScript::MemberInfo>::Element *E = p_script->member_indices.find(p_name);
+				if (E) {
+					if (E->get().setter == StringName()) {
+						r_entry.kind = INLINE_CACHE_MEMBER;
+						r_entry.index = E->get().index;
+						r_entry.member_type = E->get().data_type;
+					}
+					return;
+				}
+				for (const GDScript *sptr = p_script; sptr; sptr = sptr->_base) {
+					if (sptr->member_functions.has(GDScriptLanguage::get_singleton()->strings._set)) {
+						return;
+					}
+				}
+			}
+
+			// Same lookup order as ClassDB::set_property.
+			RWLockRead read_lock(ClassDB::lock);
+			for (const ClassDB::ClassInfo *check = ClassDB::classes.getptr(p_object->get_class_name()); check; check = check->inherits_ptr) {
+				const ClassDB::PropertySetGet *psg = check->property_setget.getptr(p_name);
+				if (psg) {
+					if (psg->setter != StringName() && psg->_setptr) {
+						r_entry.kind = INLINE_CACHE_SETTER;
+						r_entry.method = psg->_setptr;
+						r_entry.index = psg->index;
+					}
+					return;
+				}
+			}
+			return;
+		}
+	}
+}
+
+const GDScriptFunction::InlineCacheEntry *GDScriptFunction::_get_inline_cache(int p_cache, InlineCacheAccess p_access, Object *p_object, const StringName &p_name) const {
+	ERR_FAIL_INDEX_V(p_cache, _inline_cache_count, nullptr);
+
+	const GDScript *script = nullptr;
+	ScriptInstance *script_instance = p_object->get_script_instance();
+	if (script_instance) {
+		if (script_instance->is_placeholder() || script_instance->get_language() != GDScriptLanguage::get_singleton()) {
+			return nullptr;
+		}
+		script = static_cast<GDScriptInstance *>(script_instance)->script.ptr();
+	}
+
+	InlineCache &cache = _inline_caches[p_cache];
+	uint32_t epoch = GDScriptLanguage::get_singleton()->get_inline_cache_epoch();
+	InlineCacheEntry *entry = cache.entry.load(std::memory_order_seq_cst);
+	if (likely(entry && entry->epoch == epoch && entry->script == script && entry->class_name == p_object->get_class_name())) {
+		return entry;
+	}
+
+	if (!_can_refill_inline_cache(cache, entry, epoch)) {
+		return nullptr;
+	}
+
+	InlineCacheEntry *new_entry = memnew(InlineCacheEntry);
+	new_entry->epoch = epoch;
+	new_entry->class_name = p_object->get_class_name();
+	new_entry->script = script;
+	_resolve_inline_cache(p_access, p_object, script, p_name, *new_entry);
+
+	return _store_inline_cache(cache, entry, new_entry);
+}
+
+const GDScriptFunction::InlineCacheEntry *GDScriptFunction::_get_builtin_inline_cache(int p_cache, Variant::Type p_type, const StringName &p_name) const {
+	ERR_FAIL_INDEX_V(p_cache, _inline_cache_count, nullptr);
+
+	InlineCache &cache = _inline_caches[p_cache];
+	uint32_t epoch = GDScriptLanguage::get_singleton()->get_inline_cache_epoch();
+	InlineCacheEntry *entry = cache.entry.load(std::memory_order_seq_cst);
+	if (likely(entry && entry->epoch == epoch && entry->builtin_type == p_type)) {
+		return entry;
+	}
+	if (!_can_refill_inline_cache(cache, entry, epoch)) {
+		return nullptr;
+	}
+
+	InlineCacheEntry *new_entry = memnew(InlineCacheEntry);
+	new_entry->epoch = epoch;
+	new_entry->builtin_type = p_type;
+	new_entry->index = Variant::get_builtin_method_index(p_type, p_name);
+	if (new_entry->index >= 0) {
+		new_entry->kind = INLINE_CACHE_BUILTIN_METHOD;
+	}
+	return _store_inline_cache(cache, entry, new_entry);
+}
+
+bool GDScriptFunction::_can_refill_inline_cache(InlineCache &p_cache, const InlineCacheEntry *p_current, uint32_t p_epoch) {
+	// Only count receivers changing under a valid entry, recompiling scripts doesn't make a site megamorphic.
+	if (p_current && p_current->epoch == p_epoch) {
+		if (p_cache.misses.load(std::memory_order_relaxed) >= INLINE_CACHE_MAX_MISSES) {
+			return false;
+		}
+		p_cache.misses.fetch_add(1, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+const GDScriptFunction::InlineCacheEntry *GDScriptFunction::_store_inline_cache(InlineCache &p_cache, InlineCacheEntry *p_current, InlineCacheEntry *p_entry) const {
+	p_entry->replaced = p_current;
+	if (!p_cache.entry.compare_exchange_strong(p_current, p_entry, std::memory_order_seq_cst)) {
+		// Another thread filled it first, this call just takes the generic path.
+		memdelete(p_entry);
+		return nullptr;
+	}
+
+	// When this is the only frame running the function, no one else can hold the replaced
+	// entries: frames entered from now on only see the new one (entries and the frame count
+	// use sequentially consistent accesses for this). Otherwise they are freed by a later
+	// refill, or with the function.
+	if (_running_frames.load(std::memory_order_seq_cst) == 1) {
+		InlineCacheEntry *replaced = p_entry->replaced;
+		p_entry->replaced = nullptr;
+		while (replaced) {
+			InlineCacheEntry *next = replaced->replaced;
+			memdelete(replaced);
+			replaced = next;
+		}
+	}
+	return p_entry;
+}
+
+// Counts the frames running a function, for _store_inline_cache().
+struct _GDScriptRunningFrame {
+	std::atomic<uint32_t> &count;
+
+	_GDScriptRunningFrame(std::atomic<uint32_t> &p_count) :
+			count(p_count) {
+		count.fetch_add(1, std::memory_order_seq_cst);
+	}
+	~_GDScriptRunningFrame() {
+		count.fetch_sub(1, std::memory_order_seq_cst);
+	}
+};
+
+// Receiver for the inline caches, or null if only the generic path can handle it.
+static _FORCE_INLINE_ Object *_get_inline_cache_object(const Variant *p_base) {
+	if (p_base->get_type() != Variant::OBJECT) {
+		return nullptr;
+	}
+#ifdef DEBUG_ENABLED
+	return p_base->get_validated_object();
+#else
+	return p_base->operator Object *();
+#endif
+}
+
 #if defined(__GNUC__)
 #define OPCODES_TABLE                         \
 	static const void *switch_table_ops[] = { \
 		&&OPCODE_OPERATOR,                    \
+		&&OPCODE_OPERATOR_INT,                \
+		&&OPCODE_OPERATOR_FLOAT,              \
+		&&OPCODE_OPERATOR_VECTOR2,            \
+		&&OPCODE_OPERATOR_VECTOR3,            \
 		&&OPCODE_EXTENDS_TEST,                \
 		&&OPCODE_IS_BUILTIN,                  \
 		&&OPCODE_SET,                         \
 		&&OPCODE_GET,                         \
+		&&OPCODE_SET_PACKED,                  \
+		&&OPCODE_GET_PACKED,                  \
 		&&OPCODE_SET_NAMED,                   \
 		&&OPCODE_GET_NAMED,                   \
 		&&OPCODE_SET_MEMBER,                  \
@@ -210,6 +923,8 @@ String GDScriptFunction::_get_call_error(const Callable::CallError &p_err, const
 		&&OPCODE_CONSTRUCT_DICTIONARY,        \
 		&&OPCODE_CALL,                        \
 		&&OPCODE_CALL_RETURN,                 \
+		&&OPCODE_CALL_PTRCALL,                \
+		&&OPCODE_CALL_PTRCALL_RETURN,         \
 		&&OPCODE_CALL_BUILT_IN,               \
 		&&OPCODE_CALL_SELF,                   \
 		&&OPCODE_CALL_SELF_BASE,              \
@@ -223,6 +938,8 @@ String GDScriptFunction::_get_call_error(const Callable::CallError &p_err, const
 		&&OPCODE_RETURN,                      \
 		&&OPCODE_ITERATE_BEGIN,               \
 		&&OPCODE_ITERATE,                     \
+		&&OPCODE_ITERATE_BEGIN_PACKED,        \
+		&&OPCODE_ITERATE_PACKED,              \
 		&&OPCODE_ASSERT,                      \
 		&&OPCODE_BREAKPOINT,                  \
 		&&OPCODE_LINE,                        \
@@ -240,6 +957,7 @@ String GDScriptFunction::_get_call_error(const Callable::CallError &p_err, const
 #define OPCODE_SWITCH(m_test) DISPATCH_OPCODE;
 #define OPCODE_BREAK goto OPSEXIT
 #define OPCODE_OUT goto OPSOUT
+#define OPCODE_FALLTHROUGH
 #else
 #define OPCODES_TABLE
 #define OPCODE(m_op) case m_op:
@@ -250,6 +968,7 @@ String GDScriptFunction::_get_call_error(const Callable::CallError &p_err, const
 #define OPCODE_SWITCH(m_test) switch (m_test)
 #define OPCODE_BREAK break
 #define OPCODE_OUT break
+#define OPCODE_FALLTHROUGH [[fallthrough]]
 #endif
 
 Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_args, int p_argcount, Callable::CallError &r_err, CallState *p_state) {
@@ -259,6 +978,8 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 		return Variant();
 	}
 
+	_GDScriptRunningFrame running_frame(_running_frames);
+
 	r_err.error = Callable::CallError::CALL_OK;
 
 	Variant self;
@@ -266,6 +987,7 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 	Variant retvalue;
 	Variant *stack = nullptr;
 	Variant **call_args;
+	uint8_t *frame = nullptr; // Pooled frame owned by this call, released on exit unless a yield takes it.
 	int defarg = 0;
 
 #ifdef DEBUG_ENABLED
@@ -280,17 +1002,21 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 	int line = _initial_line;
 
 	if (p_state) {
-		//use existing (supplied) state (yielded)
-		stack = (Variant *)p_state->stack.ptr();
-		call_args = (Variant **)&p_state->stack.ptr()[sizeof(Variant) * p_state->stack_size]; //ptr() to avoid bounds check
+		//use existing (supplied) state (yielded), its frame is resumed in place
+		frame = p_state->frame;
+		stack = (Variant *)frame;
+		call_args = frame ? (Variant **)&frame[sizeof(Variant) * p_state->stack_size] : nullptr;
 		line = p_state->line;
 		ip = p_state->ip;
-		alloca_size = p_state->stack.size();
+		alloca_size = p_state->alloca_size;
 		script = p_state->script;
 		p_instance = p_state->instance;
 		defarg = p_state->defarg;
 		self = p_state->self;
 
+		p_state->frame = nullptr;
+		p_state->stack_size = 0;
+
 	} else {
 		if (p_argcount != _argument_count) {
 			if (p_argcount > _argument_count) {
@@ -310,7 +1036,13 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 		alloca_size = sizeof(Variant *) * _call_size + sizeof(Variant) * _stack_size;
 
 		if (alloca_size) {
-			uint8_t *aptr = (uint8_t *)alloca(alloca_size);
+			uint8_t *aptr;
+			if (_can_yield) {
+				frame = GDScriptFramePool::alloc_frame(alloca_size);
+				aptr = frame;
+			} else {
+				aptr = (uint8_t *)alloca(alloca_size);
+			}
 
 			if (_stack_size) {
 				stack = (Variant *)aptr;
@@ -324,6 +1056,12 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 						r_err.error = Callable::CallError::CALL_ERROR_INVALID_ARGUMENT;
 						r_err.argument = i;
 						r_err.expected = argument_types[i].kind == GDScriptDataType::BUILTIN ? argument_types[i].builtin_type : Variant::OBJECT;
+						if (frame) {
+							for (int j = 0; j < i; j++) {
+								stack[j].~Variant();
+							}
+							GDScriptFramePool::free_frame(frame, alloca_size);
+						}
 						return Variant();
 					}
 					if (argument_types[i].kind == GDScriptDataType::BUILTIN) {
@@ -365,6 +1103,39 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 	static_ref = script;
 
+	// Publish this function to the sampling profiler, the caller is restored on exit.
+	GDScriptSamplingProfiler::Slot *sample_slot = nullptr;
+	const GDScriptFunction *sample_caller = nullptr;
+	int sample_caller_line = 0;
+	if (unlikely(GDScriptSamplingProfiler::is_sampling())) {
+		sample_slot = GDScriptSamplingProfiler::get_thread_slot();
+		sample_caller = sample_slot->function.load(std::memory_order_relaxed);
+		sample_caller_line = sample_slot->line.load(std::memory_order_relaxed);
+		sample_slot->set(this, line);
+	}
+
+	if (_aot_function && !p_state) {
+#ifdef DEBUG_ENABLED
+		// Compiled bodies have no line hooks, keep stepping and breakpoints working.
+		if (!EngineDebugger::is_active()) {
+#endif
+			_call_aot(p_instance, script, self, stack, defarg, retvalue);
+
+			for (int i = 0; i < _stack_size; i++) {
+				stack[i].~Variant();
+			}
+			if (frame) {
+				GDScriptFramePool::free_frame(frame, alloca_size);
+			}
+			if (sample_slot) {
+				sample_slot->set(sample_caller, sample_caller_line);
+			}
+			return retvalue;
+#ifdef DEBUG_ENABLED
+		}
+#endif
+	}
+
 	String err_text;
 
 #ifdef DEBUG_ENABLED
@@ -399,6 +1170,32 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 #endif
 
+#ifdef DEBUG_ENABLED
+#define EVALUATE_OPERATOR(m_op, m_a, m_b, m_dst)                                                                                                                                     \
+	{                                                                                                                                                                                \
+		bool valid;                                                                                                                                                                  \
+		Variant ret;                                                                                                                                                                 \
+		Variant::evaluate(m_op, *m_a, *m_b, ret, valid);                                                                                                                             \
+		if (!valid) {                                                                                                                                                                \
+			if (ret.get_type() == Variant::STRING) {                                                                                                                                 \
+				/* return a string when invalid with the error */                                                                                                                    \
+				err_text = ret;                                                                                                                                                      \
+				err_text += " in operator '" + Variant::get_operator_name(m_op) + "'.";                                                                                              \
+			} else {                                                                                                                                                                 \
+				err_text = "Invalid operands '" + Variant::get_type_name(m_a->get_type()) + "' and '" + Variant::get_type_name(m_b->get_type()) + "' in operator '" + Variant::get_operator_name(m_op) + "'."; \
+			}                                                                                                                                                                        \
+			OPCODE_BREAK;                                                                                                                                                            \
+		}                                                                                                                                                                            \
+		*m_dst = ret;                                                                                                                                                                \
+	}
+#else
+#define EVALUATE_OPERATOR(m_op, m_a, m_b, m_dst)             \
+	{                                                        \
+		bool valid;                                          \
+		Variant::evaluate(m_op, *m_a, *m_b, *m_dst, valid); \
+	}
+#endif
+
 #ifdef DEBUG_ENABLED
 
 	uint64_t function_start_time = 0;
@@ -425,7 +1222,6 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			OPCODE(OPCODE_OPERATOR) {
 				CHECK_SPACE(5);
 
-				bool valid;
 				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
 				GD_ERR_BREAK(op >= Variant::OP_MAX);
 
@@ -433,26 +1229,95 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				GET_VARIANT_PTR(b, 3);
 				GET_VARIANT_PTR(dst, 4);
 
-#ifdef DEBUG_ENABLED
+				EVALUATE_OPERATOR(op, a, b, dst);
 
-				Variant ret;
-				Variant::evaluate(op, *a, *b, ret, valid);
-#else
-				Variant::evaluate(op, *a, *b, *dst, valid);
-#endif
-#ifdef DEBUG_ENABLED
-				if (!valid) {
-					if (ret.get_type() == Variant::STRING) {
-						//return a string when invalid with the error
-						err_text = ret;
-						err_text += " in operator '" + Variant::get_operator_name(op) + "'.";
-					} else {
-						err_text = "Invalid operands '" + Variant::get_type_name(a->get_type()) + "' and '" + Variant::get_type_name(b->get_type()) + "' in operator '" + Variant::get_operator_name(op) + "'.";
-					}
-					OPCODE_BREAK;
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_INT) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				if (likely(a->get_type() == Variant::INT && b->get_type() == Variant::INT) && _evaluate_int(op, *a, *b, *dst)) {
+					ip += 5;
+					DISPATCH_OPCODE;
 				}
-				*dst = ret;
-#endif
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_FLOAT) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				// Mixed int and float operands promote to float, but two ints must keep integer semantics.
+				Variant::Type type_a = a->get_type();
+				Variant::Type type_b = b->get_type();
+				if (likely((type_a == Variant::FLOAT && (type_b == Variant::FLOAT || type_b == Variant::INT)) || (type_a == Variant::INT && type_b == Variant::FLOAT)) && _evaluate_float(op, *a, *b, *dst)) {
+					ip += 5;
+					DISPATCH_OPCODE;
+				}
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_VECTOR2) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				if (likely(a->get_type() == Variant::VECTOR2) && _evaluate_vector<Vector2, Variant::VECTOR2>(op, *a, *b, *dst)) {
+					ip += 5;
+					DISPATCH_OPCODE;
+				}
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+
+				ip += 5;
+			}
+			DISPATCH_OPCODE;
+
+			OPCODE(OPCODE_OPERATOR_VECTOR3) {
+				CHECK_SPACE(5);
+
+				Variant::Operator op = (Variant::Operator)_code_ptr[ip + 1];
+				GD_ERR_BREAK(op >= Variant::OP_MAX);
+
+				GET_VARIANT_PTR(a, 2);
+				GET_VARIANT_PTR(b, 3);
+				GET_VARIANT_PTR(dst, 4);
+
+				if (likely(a->get_type() == Variant::VECTOR3) && _evaluate_vector<Vector3, Variant::VECTOR3>(op, *a, *b, *dst)) {
+					ip += 5;
+					DISPATCH_OPCODE;
+				}
+
+				EVALUATE_OPERATOR(op, a, b, dst);
+
 				ip += 5;
 			}
 			DISPATCH_OPCODE;
@@ -546,6 +1411,22 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			// The packed opcodes share the operand layout of the generic ones, which
+			// follow them and are reached by falling through when the fast path fails.
+			OPCODE(OPCODE_SET_PACKED) {
+				CHECK_SPACE(3);
+
+				GET_VARIANT_PTR(dst, 1);
+				GET_VARIANT_PTR(index, 2);
+				GET_VARIANT_PTR(value, 3);
+
+				if (likely(index->get_type() == Variant::INT) && _set_packed(*dst, int64_t(*index), *value)) {
+					ip += 4;
+					DISPATCH_OPCODE;
+				}
+				OPCODE_FALLTHROUGH;
+			}
+
 			OPCODE(OPCODE_SET) {
 				CHECK_SPACE(3);
 
@@ -572,6 +1453,20 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_GET_PACKED) {
+				CHECK_SPACE(3);
+
+				GET_VARIANT_PTR(src, 1);
+				GET_VARIANT_PTR(index, 2);
+				GET_VARIANT_PTR(dst, 3);
+
+				if (likely(index->get_type() == Variant::INT) && _get_packed(*src, int64_t(*index), *dst)) {
+					ip += 4;
+					DISPATCH_OPCODE;
+				}
+				OPCODE_FALLTHROUGH;
+			}
+
 			OPCODE(OPCODE_GET) {
 				CHECK_SPACE(3);
 
@@ -605,10 +1500,10 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			DISPATCH_OPCODE;
 
 			OPCODE(OPCODE_SET_NAMED) {
-				CHECK_SPACE(3);
+				CHECK_SPACE(4);
 
 				GET_VARIANT_PTR(dst, 1);
-				GET_VARIANT_PTR(value, 3);
+				GET_VARIANT_PTR(value, 4);
 
 				int indexname = _code_ptr[ip + 2];
 
@@ -616,7 +1511,29 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				const StringName *index = &_global_names_ptr[indexname];
 
 				bool valid;
-				dst->set_named(*index, *value, &valid);
+				const InlineCacheEntry *cache = nullptr;
+				Object *obj = _get_inline_cache_object(dst);
+				if (obj) {
+					cache = _get_inline_cache(_code_ptr[ip + 3], INLINE_CACHE_SET, obj, *index);
+				}
+
+				if (cache && cache->kind == INLINE_CACHE_MEMBER && cache->member_type.is_type(*value)) {
+					static_cast<GDScriptInstance *>(obj->get_script_instance())->members.write[cache->index] = *value;
+					valid = true;
+				} else if (cache && cache->kind == INLINE_CACHE_SETTER) {
+					Callable::CallError ce;
+					if (cache->index >= 0) {
+						Variant setter_index = cache->index;
+						const Variant *args[2] = { &setter_index, value };
+						cache->method->call(obj, args, 2, ce);
+					} else {
+						const Variant *args[1] = { value };
+						cache->method->call(obj, args, 1, ce);
+					}
+					valid = ce.error == Callable::CallError::CALL_OK;
+				} else {
+					dst->set_named(*index, *value, &valid);
+				}
 
 #ifdef DEBUG_ENABLED
 				if (!valid) {
@@ -625,15 +1542,15 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 					OPCODE_BREAK;
 				}
 #endif
-				ip += 4;
+				ip += 5;
 			}
 			DISPATCH_OPCODE;
 
 			OPCODE(OPCODE_GET_NAMED) {
-				CHECK_SPACE(4);
+				CHECK_SPACE(5);
 
 				GET_VARIANT_PTR(src, 1);
-				GET_VARIANT_PTR(dst, 3);
+				GET_VARIANT_PTR(dst, 4);
 
 				int indexname = _code_ptr[ip + 2];
 
@@ -641,13 +1558,33 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				const StringName *index = &_global_names_ptr[indexname];
 
 				bool valid;
-#ifdef DEBUG_ENABLED
-				//allow better error message in cases where src and dst are the same stack position
-				Variant ret = src->get_named(*index, &valid);
+				const InlineCacheEntry *cache = nullptr;
+				Object *obj = _get_inline_cache_object(src);
+				if (obj) {
+					cache = _get_inline_cache(_code_ptr[ip + 3], INLINE_CACHE_GET, obj, *index);
+				}
 
+				if (cache && cache->kind == INLINE_CACHE_MEMBER) {
+					// Copy first, dst may hold the last reference to the instance.
+					Variant ret = static_cast<GDScriptInstance *>(obj->get_script_instance())->members[cache->index];
+					*dst = ret;
+					valid = true;
+				} else if (cache && cache->kind == INLINE_CACHE_GETTER) {
+					// Like ClassDB::get_property, the result is used even if the getter fails.
+					Callable::CallError ce;
+					*dst = cache->method->call(obj, nullptr, 0, ce);
+					valid = true;
+				} else {
+#ifdef DEBUG_ENABLED
+					//allow better error message in cases where src and dst are the same stack position
+					Variant ret = src->get_named(*index, &valid);
+					if (valid) {
+						*dst = ret;
+					}
 #else
-				*dst = src->get_named(*index, &valid);
+					*dst = src->get_named(*index, &valid);
 #endif
+				}
 #ifdef DEBUG_ENABLED
 				if (!valid) {
 					if (src->has_method(*index)) {
@@ -657,9 +1594,8 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 					}
 					OPCODE_BREAK;
 				}
-				*dst = ret;
 #endif
-				ip += 4;
+				ip += 5;
 			}
 			DISPATCH_OPCODE;
 
@@ -1008,18 +1944,19 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 			OPCODE(OPCODE_CALL_RETURN)
 			OPCODE(OPCODE_CALL) {
-				CHECK_SPACE(4);
+				CHECK_SPACE(5);
 				bool call_ret = _code_ptr[ip] == OPCODE_CALL_RETURN;
 
 				int argc = _code_ptr[ip + 1];
 				GET_VARIANT_PTR(base, 2);
 				int nameg = _code_ptr[ip + 3];
+				int cache_idx = _code_ptr[ip + 4];
 
 				GD_ERR_BREAK(nameg < 0 || nameg >= _global_names_count);
 				const StringName *methodname = &_global_names_ptr[nameg];
 
 				GD_ERR_BREAK(argc < 0);
-				ip += 4;
+				ip += 5;
 				CHECK_SPACE(argc + 1);
 				Variant **argptrs = call_args;
 
@@ -1037,7 +1974,37 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 
 #endif
 				Callable::CallError err;
-				if (call_ret) {
+				const InlineCacheEntry *cache = nullptr;
+				Object *obj = _get_inline_cache_object(base);
+				if (obj) {
+					cache = _get_inline_cache(cache_idx, INLINE_CACHE_CALL, obj, *methodname);
+				} else if (base->get_type() != Variant::OBJECT) {
+					cache = _get_builtin_inline_cache(cache_idx, base->get_type(), *methodname);
+				}
+
+				if (cache && cache->kind == INLINE_CACHE_BUILTIN_METHOD) {
+					if (call_ret) {
+						GET_VARIANT_PTR(ret, argc);
+						base->call_builtin_method(cache->index, (const Variant **)argptrs, argc, ret, err);
+					} else {
+						base->call_builtin_method(cache->index, (const Variant **)argptrs, argc, nullptr, err);
+					}
+				} else if (cache && (cache->kind == INLINE_CACHE_SCRIPT_FUNCTION || cache->kind == INLINE_CACHE_METHOD)) {
+#ifdef DEBUG_ENABLED
+					// Locked like Object::call() does, so a method freeing its own receiver is reported.
+					_ObjectDebugLock debug_lock(obj);
+#endif
+					Variant ret;
+					if (cache->kind == INLINE_CACHE_SCRIPT_FUNCTION) {
+						ret = cache->function->call(static_cast<GDScriptInstance *>(obj->get_script_instance()), (const Variant **)argptrs, argc, err);
+					} else {
+						ret = cache->method->call(obj, (const Variant **)argptrs, argc, err);
+					}
+					if (call_ret && err.error == Callable::CallError::CALL_OK) {
+						GET_VARIANT_PTR(dst, argc);
+						*dst = ret;
+					}
+				} else if (call_ret) {
 					GET_VARIANT_PTR(ret, argc);
 					base->call_ptr(*methodname, (const Variant **)argptrs, argc, ret, err);
 				} else {
@@ -1080,6 +2047,115 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_CALL_PTRCALL_RETURN)
+			OPCODE(OPCODE_CALL_PTRCALL) {
+				CHECK_SPACE(5);
+				bool call_ret = _code_ptr[ip] == OPCODE_CALL_PTRCALL_RETURN;
+
+				int argc = _code_ptr[ip + 1];
+				GET_VARIANT_PTR(base, 2);
+				int nameg = _code_ptr[ip + 3];
+
+				GD_ERR_BREAK(nameg < 0 || nameg >= _global_names_count);
+				const StringName *methodname = &_global_names_ptr[nameg];
+
+#ifdef PTRCALL_ENABLED
+				int native_call_idx = _code_ptr[ip + 4];
+				GD_ERR_BREAK(native_call_idx < 0 || native_call_idx >= _native_calls_count);
+				const NativeCall &native_call = _native_calls_ptr[native_call_idx];
+#endif
+
+				GD_ERR_BREAK(argc < 0 || argc > PTRCALL_MAX_ARGS);
+				ip += 5;
+				CHECK_SPACE(argc + 1);
+				Variant **argptrs = call_args;
+
+				for (int i = 0; i < argc; i++) {
+					GET_VARIANT_PTR(v, i);
+					argptrs[i] = v;
+				}
+
+#ifdef DEBUG_ENABLED
+				uint64_t call_time = 0;
+
+				if (GDScriptLanguage::get_singleton()->profiling) {
+					call_time = OS::get_singleton()->get_ticks_usec();
+				}
+
+#endif
+				// The compiler only knows the static types, so check the receiver and the
+				// arguments before bypassing Variant. Scripts on the receiver may also
+				// override the native method, in which case the regular call is used.
+				Object *obj = nullptr;
+#ifdef PTRCALL_ENABLED
+				if (base->get_type() == Variant::OBJECT) {
+					obj = base->get_validated_object();
+				}
+				if (obj && obj->is_class_ptr(native_call.class_ptr)) {
+					ScriptInstance *script_instance = obj->get_script_instance();
+					if (script_instance && script_instance->has_method(*methodname)) {
+						obj = nullptr;
+					}
+				} else {
+					obj = nullptr;
+				}
+				for (int i = 0; obj && i < argc; i++) {
+					if (argptrs[i]->get_type() != native_call.argument_types[i]) {
+						obj = nullptr;
+					}
+				}
+
+				if (obj) {
+					_PtrcallValue args[PTRCALL_MAX_ARGS];
+					const void *argp[PTRCALL_MAX_ARGS];
+					for (int i = 0; i < argc; i++) {
+						_ptrcall_encode(*argptrs[i], args[i].data);
+						argp[i] = args[i].data;
+					}
+
+					if (native_call.return_type != Variant::NIL) {
+						_PtrcallValue ret;
+						native_call.method->ptrcall(obj, argp, ret.data);
+						if (call_ret) {
+							GET_VARIANT_PTR(dst, argc);
+							_ptrcall_decode(native_call.return_type, ret.data, *dst);
+						}
+					} else {
+						native_call.method->ptrcall(obj, argp, nullptr);
+						if (call_ret) {
+							GET_VARIANT_PTR(dst, argc);
+							*dst = Variant();
+						}
+					}
+				}
+#endif
+				if (!obj) {
+					Callable::CallError err;
+					if (call_ret) {
+						GET_VARIANT_PTR(ret, argc);
+						base->call_ptr(*methodname, (const Variant **)argptrs, argc, ret, err);
+					} else {
+						base->call_ptr(*methodname, (const Variant **)argptrs, argc, nullptr, err);
+					}
+#ifdef DEBUG_ENABLED
+					if (err.error != Callable::CallError::CALL_OK) {
+						String methodstr = *methodname;
+						String basestr = _get_var_type(base);
+						err_text = _get_call_error(err, "function '" + methodstr + "' in base '" + basestr + "'", (const Variant **)argptrs);
+						OPCODE_BREAK;
+					}
+#endif
+				}
+#ifdef DEBUG_ENABLED
+				if (GDScriptLanguage::get_singleton()->profiling) {
+					function_call_time += OS::get_singleton()->get_ticks_usec() - call_time;
+				}
+#endif
+
+				ip += argc + 1;
+			}
+			DISPATCH_OPCODE;
+
 			OPCODE(OPCODE_CALL_BUILT_IN) {
 				CHECK_SPACE(4);
 
@@ -1205,11 +2281,9 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				Ref<GDScriptFunctionState> gdfs = memnew(GDScriptFunctionState);
 				gdfs->function = this;
 
-				gdfs->state.stack.resize(alloca_size);
-				//copy variant stack
-				for (int i = 0; i < _stack_size; i++) {
-					memnew_placement(&gdfs->state.stack.write[sizeof(Variant) * i], Variant(stack[i]));
-				}
+				//hand over the frame, the stack stays where it is
+				gdfs->state.frame = frame;
+				frame = nullptr;
 				gdfs->state.stack_size = _stack_size;
 				gdfs->state.self = self;
 				gdfs->state.alloca_size = alloca_size;
@@ -1363,6 +2437,30 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				OPCODE_BREAK;
 			}
 
+			// The counter stays an int, as with Variant::iter_init()/iter_next(), and the
+			// size is read on every step so the loop sees changes made by its body.
+			OPCODE(OPCODE_ITERATE_BEGIN_PACKED) {
+				CHECK_SPACE(8);
+
+				GET_VARIANT_PTR(counter, 1);
+				GET_VARIANT_PTR(container, 2);
+
+				if (likely(_is_packed_fast_type(container->get_type()))) {
+					GET_VARIANT_PTR(iterator, 4);
+
+					if (_get_packed(*container, 0, *iterator)) {
+						*counter = 0;
+						ip += 5; //skip regular iterate which is always next
+					} else {
+						int jumpto = _code_ptr[ip + 3];
+						GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+						ip = jumpto;
+					}
+					DISPATCH_OPCODE;
+				}
+				OPCODE_FALLTHROUGH;
+			}
+
 			OPCODE(OPCODE_ITERATE_BEGIN) {
 				CHECK_SPACE(8); //space for this a regular iterate
 
@@ -1395,6 +2493,29 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 			}
 			DISPATCH_OPCODE;
 
+			OPCODE(OPCODE_ITERATE_PACKED) {
+				CHECK_SPACE(4);
+
+				GET_VARIANT_PTR(counter, 1);
+				GET_VARIANT_PTR(container, 2);
+
+				if (likely(_is_packed_fast_type(container->get_type()) && counter->get_type() == Variant::INT)) {
+					GET_VARIANT_PTR(iterator, 4);
+
+					int64_t idx = int64_t(*counter) + 1;
+					if (_get_packed(*container, idx, *iterator)) {
+						*counter = idx;
+						ip += 5; //loop again
+					} else {
+						int jumpto = _code_ptr[ip + 3];
+						GD_ERR_BREAK(jumpto < 0 || jumpto > _code_size);
+						ip = jumpto;
+					}
+					DISPATCH_OPCODE;
+				}
+				OPCODE_FALLTHROUGH;
+			}
+
 			OPCODE(OPCODE_ITERATE) {
 				CHECK_SPACE(4);
 
@@ -1469,6 +2590,10 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 				line = _code_ptr[ip + 1];
 				ip += 2;
 
+				if (unlikely(sample_slot)) {
+					sample_slot->line.store(line, std::memory_order_relaxed);
+				}
+
 				if (EngineDebugger::is_active()) {
 					// line
 					bool do_break = false;
@@ -1564,22 +2689,49 @@ Variant GDScriptFunction::call(GDScriptInstance *p_instance, const Variant **p_a
 		if (EngineDebugger::is_active()) {
 			GDScriptLanguage::get_singleton()->exit_function();
 		}
+	}
 #endif
 
-		if (_stack_size) {
-			//free stack
-			for (int i = 0; i < _stack_size; i++) {
-				stack[i].~Variant();
-			}
+	// A frame that was yielded belongs to the new state now, only free what this call still owns.
+	if (frame || !_can_yield) {
+		//free stack
+		for (int i = 0; i < _stack_size; i++) {
+			stack[i].~Variant();
 		}
+	}
+	if (frame) {
+		GDScriptFramePool::free_frame(frame, alloca_size);
+	}
 
-#ifdef DEBUG_ENABLED
+	if (sample_slot) {
+		sample_slot->set(sample_caller, sample_caller_line);
 	}
-#endif
 
 	return retvalue;
 }
 
+void GDScriptFunction::_call_aot(GDScriptInstance *p_instance, GDScript *p_script, Variant &p_self, Variant *p_stack, int p_defarg, Variant &r_ret) {
+	GDScriptAOTFrame frame;
+	frame.stack = p_stack;
+	if (p_instance) {
+		frame.self = &p_self;
+		frame.members = p_instance->members.ptrw();
+	}
+	frame.constants = _constants_ptr;
+	frame.global_names = _global_names_ptr;
+	frame.retvalue = &r_ret;
+	frame.defarg = p_defarg;
+	frame.line = _initial_line;
+
+	if (likely(_aot_function(frame))) {
+		return;
+	}
+
+	String err_file = p_script && p_script->path != "" ? p_script->path : String("<built-in>");
+	String err_text = frame.error != "" ? frame.error : String("Internal Script Error! - compiled body failed (report please).");
+	_err_print_error(String(name).utf8().get_data(), err_file.utf8().get_data(), frame.line, err_text.utf8().get_data(), ERR_HANDLER_SCRIPT);
+}
+
 const int *GDScriptFunction::get_code() const {
 	return _code_ptr;
 }
@@ -1687,10 +2839,83 @@ void GDScriptFunction::debug_get_stack_member_state(int p_line, List<Pair<String
 	}
 }
 
+GDScriptFramePool::SizeClass GDScriptFramePool::size_classes[GDScriptFramePool::SIZE_CLASS_COUNT];
+
+int GDScriptFramePool::_get_size_class(uint32_t p_size) {
+	int size_class = 0;
+	while (size_class < SIZE_CLASS_COUNT && (1u << (MIN_SIZE_SHIFT + size_class)) < p_size) {
+		size_class++;
+	}
+	return size_class;
+}
+
+uint8_t *GDScriptFramePool::alloc_frame(uint32_t p_size) {
+	int size_class = _get_size_class(p_size);
+	if (size_class == SIZE_CLASS_COUNT) {
+		return (uint8_t *)memalloc(p_size);
+	}
+
+	SizeClass &sc = size_classes[size_class];
+	sc.lock.lock();
+	uint8_t *frame = sc.free_list;
+	if (frame) {
+		sc.free_list = *(uint8_t **)frame;
+		sc.free_count--;
+	}
+	sc.lock.unlock();
+
+	if (!frame) {
+		frame = (uint8_t *)memalloc(1u << (MIN_SIZE_SHIFT + size_class));
+	}
+	return frame;
+}
+
+void GDScriptFramePool::free_frame(uint8_t *p_frame, uint32_t p_size) {
+	int size_class = _get_size_class(p_size);
+	if (size_class < SIZE_CLASS_COUNT) {
+		SizeClass &sc = size_classes[size_class];
+		sc.lock.lock();
+		if (sc.free_count < MAX_FREE_FRAMES) {
+			*(uint8_t **)p_frame = sc.free_list;
+			sc.free_list = p_frame;
+			sc.free_count++;
+			p_frame = nullptr;
+		}
+		sc.lock.unlock();
+	}
+
+	if (p_frame) {
+		memfree(p_frame);
+	}
+}
+
+void GDScriptFramePool::clear() {
+	for (int i = 0; i < SIZE_CLASS_COUNT; i++) {
+		SizeClass &sc = size_classes[i];
+		sc.lock.lock();
+		uint8_t *frame = sc.free_list;
+		sc.free_list = nullptr;
+		sc.free_count = 0;
+		sc.lock.unlock();
+
+		while (frame) {
+			uint8_t *next = *(uint8_t **)frame;
+			memfree(frame);
+			frame = next;
+		}
+	}
+}
+
 GDScriptFunction::GDScriptFunction() :
 		function_list(this) {
 	_stack_size = 0;
 	_call_size = 0;
+	_native_calls_ptr = nullptr;
+	_native_calls_count = 0;
+	_inline_caches = nullptr;
+	_inline_cache_count = 0;
+	_aot_function = nullptr;
+	_can_yield = false;
 	rpc_mode = MultiplayerAPI::RPC_MODE_DISABLED;
 	name = "<anonymous>";
 #ifdef DEBUG_ENABLED
@@ -1716,6 +2941,20 @@ GDScriptFunction::GDScriptFunction() :
 }
 
 GDScriptFunction::~GDScriptFunction() {
+	GDScriptSamplingProfiler::function_freed(this);
+
+	for (int i = 0; i < _inline_cache_count; i++) {
+		InlineCacheEntry *entry = _inline_caches[i].entry.load(std::memory_order_acquire);
+		while (entry) {
+			InlineCacheEntry *replaced = entry->replaced;
+			memdelete(entry);
+			entry = replaced;
+		}
+	}
+	if (_inline_caches) {
+		memdelete_arr(_inline_caches);
+	}
+
 #ifdef DEBUG_ENABLED
 
 	MutexLock lock(GDScriptLanguage::get_singleton()->lock);
@@ -1840,11 +3079,13 @@ Variant GDScriptFunctionState::resume(const Variant &p_arg) {
 }
 
 void GDScriptFunctionState::_clear_stack() {
-	if (state.stack_size) {
-		Variant *stack = (Variant *)state.stack.ptr();
+	if (state.frame) {
+		Variant *stack = (Variant *)state.frame;
 		for (int i = 0; i < state.stack_size; i++) {
 			stack[i].~Variant();
 		}
+		GDScriptFramePool::free_frame(state.frame, state.alloca_size);
+		state.frame = nullptr;
 		state.stack_size = 0;
 	}
 }
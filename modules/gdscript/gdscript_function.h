@@ -36,11 +36,16 @@
 #include "core/reference.h"
 #include "core/script_language.h"
 #include "core/self_list.h"
+#include "core/spin_lock.h"
 #include "core/string_name.h"
 #include "core/variant.h"
+#include "gdscript_aot.h"
+
+#include <atomic>
 
 class GDScriptInstance;
 class GDScript;
+class MethodBind;
 
 struct GDScriptDataType {
 	enum Kind {
@@ -154,14 +159,46 @@ struct GDScriptDataType {
 	GDScriptDataType() {}
 };
 
+// Frames of functions that can yield are taken from here instead of the C stack, so a
+// yield hands the live frame to its GDScriptFunctionState and resuming runs it in place.
+// Released frames are kept per size class for the next call.
+class GDScriptFramePool {
+	enum {
+		MIN_SIZE_SHIFT = 6, // 64 bytes.
+		SIZE_CLASS_COUNT = 11, // Up to 64 KiB, larger frames are not kept.
+		MAX_FREE_FRAMES = 4096, // Per size class.
+	};
+
+	struct SizeClass {
+		SpinLock lock;
+		uint8_t *free_list = nullptr; // Linked through the first word of each frame.
+		uint32_t free_count = 0;
+	};
+
+	static SizeClass size_classes[SIZE_CLASS_COUNT];
+
+	static int _get_size_class(uint32_t p_size);
+
+public:
+	static uint8_t *alloc_frame(uint32_t p_size);
+	static void free_frame(uint8_t *p_frame, uint32_t p_size);
+	static void clear();
+};
+
 class GDScriptFunction {
 public:
 	enum Opcode {
 		OPCODE_OPERATOR,
+		OPCODE_OPERATOR_INT,
+		OPCODE_OPERATOR_FLOAT,
+		OPCODE_OPERATOR_VECTOR2,
+		OPCODE_OPERATOR_VECTOR3,
 		OPCODE_EXTENDS_TEST,
 		OPCODE_IS_BUILTIN,
 		OPCODE_SET,
 		OPCODE_GET,
+		OPCODE_SET_PACKED,
+		OPCODE_GET_PACKED,
 		OPCODE_SET_NAMED,
 		OPCODE_GET_NAMED,
 		OPCODE_SET_MEMBER,
@@ -180,6 +217,8 @@ public:
 		OPCODE_CONSTRUCT_DICTIONARY,
 		OPCODE_CALL,
 		OPCODE_CALL_RETURN,
+		OPCODE_CALL_PTRCALL,
+		OPCODE_CALL_PTRCALL_RETURN,
 		OPCODE_CALL_BUILT_IN,
 		OPCODE_CALL_SELF,
 		OPCODE_CALL_SELF_BASE,
@@ -193,6 +232,8 @@ public:
 		OPCODE_RETURN,
 		OPCODE_ITERATE_BEGIN,
 		OPCODE_ITERATE,
+		OPCODE_ITERATE_BEGIN_PACKED,
+		OPCODE_ITERATE_PACKED,
 		OPCODE_ASSERT,
 		OPCODE_BREAKPOINT,
 		OPCODE_LINE,
@@ -215,6 +256,10 @@ public:
 		ADDR_TYPE_NIL = 9
 	};
 
+	enum {
+		PTRCALL_MAX_ARGS = 5
+	};
+
 	struct StackDebug {
 		int line;
 		int pos;
@@ -222,8 +267,70 @@ public:
 		StringName identifier;
 	};
 
+	// Native method resolved by the compiler for OPCODE_CALL_PTRCALL.
+	// The signature is copied here as MethodBind only exposes it in debug builds.
+	struct NativeCall {
+		MethodBind *method = nullptr;
+		void *class_ptr = nullptr; // Receivers must inherit this class to use the direct call.
+		Variant::Type return_type = Variant::NIL; // NIL if the method returns nothing.
+		Variant::Type argument_types[PTRCALL_MAX_ARGS] = {};
+	};
+
 private:
 	friend class GDScriptCompiler;
+	friend class GDScriptAOT;
+	friend class GDScriptCompileCache;
+
+	// Inline caches remember how a named call or member access was resolved for the last
+	// receiver seen at that instruction. Entries are immutable once published, replaced
+	// entries are kept while other frames running the function may still read them.
+	enum {
+		INLINE_CACHE_MAX_MISSES = 8 // Megamorphic sites stop refilling and use the generic path.
+	};
+
+	enum InlineCacheAccess {
+		INLINE_CACHE_CALL,
+		INLINE_CACHE_GET,
+		INLINE_CACHE_SET,
+	};
+
+	enum InlineCacheKind {
+		INLINE_CACHE_GENERIC, // Resolved, but only the generic path handles it.
+		INLINE_CACHE_METHOD,
+		INLINE_CACHE_SCRIPT_FUNCTION,
+		INLINE_CACHE_GETTER,
+		INLINE_CACHE_SETTER,
+		INLINE_CACHE_MEMBER,
+		INLINE_CACHE_BUILTIN_METHOD,
+	};
+
+	struct InlineCacheEntry {
+		uint32_t epoch = 0;
+		StringName class_name;
+		const GDScript *script = nullptr;
+		Variant::Type builtin_type = Variant::OBJECT; // Receiver type of builtin method entries.
+		InlineCacheKind kind = INLINE_CACHE_GENERIC;
+		MethodBind *method = nullptr;
+		GDScriptFunction *function = nullptr;
+		int index = -1;
+		GDScriptDataType member_type;
+		InlineCacheEntry *replaced = nullptr;
+	};
+
+	struct InlineCache {
+		std::atomic<InlineCacheEntry *> entry = { nullptr };
+		std::atomic<uint32_t> misses = { 0 };
+	};
+
+	InlineCache *_inline_caches;
+	int _inline_cache_count;
+	mutable std::atomic<uint32_t> _running_frames = { 0 };
+
+	static void _resolve_inline_cache(InlineCacheAccess p_access, Object *p_object, const GDScript *p_script, const StringName &p_name, InlineCacheEntry &r_entry);
+	static bool _can_refill_inline_cache(InlineCache &p_cache, const InlineCacheEntry *p_current, uint32_t p_epoch);
+	const InlineCacheEntry *_store_inline_cache(InlineCache &p_cache, InlineCacheEntry *p_current, InlineCacheEntry *p_entry) const;
+	const InlineCacheEntry *_get_inline_cache(int p_cache, InlineCacheAccess p_access, Object *p_object, const StringName &p_name) const;
+	const InlineCacheEntry *_get_builtin_inline_cache(int p_cache, Variant::Type p_type, const StringName &p_name) const;
 
 	StringName source;
 
@@ -232,6 +339,8 @@ private:
 	int _constant_count;
 	const StringName *_global_names_ptr;
 	int _global_names_count;
+	const NativeCall *_native_calls_ptr;
+	int _native_calls_count;
 #ifdef TOOLS_ENABLED
 	const StringName *_named_globals_ptr;
 	int _named_globals_count;
@@ -245,13 +354,16 @@ private:
 	int _call_size;
 	int _initial_line;
 	bool _static;
+	bool _can_yield; // Runs on a pooled frame, see GDScriptFramePool.
 	MultiplayerAPI::RPCMode rpc_mode;
+	GDScriptAOTFunction _aot_function; // Ahead-of-time compiled body matching this bytecode, if any.
 
 	GDScript *_script;
 
 	StringName name;
 	Vector<Variant> constants;
 	Vector<StringName> global_names;
+	Vector<NativeCall> native_calls;
 #ifdef TOOLS_ENABLED
 	Vector<StringName> named_globals;
 #endif
@@ -268,6 +380,7 @@ private:
 
 	_FORCE_INLINE_ Variant *_get_variant(int p_address, GDScriptInstance *p_instance, GDScript *p_script, Variant &self, Variant &static_ref, Variant *p_stack, String &r_error) const;
 	_FORCE_INLINE_ String _get_call_error(const Callable::CallError &p_err, const String &p_where, const Variant **argptrs) const;
+	void _call_aot(GDScriptInstance *p_instance, GDScript *p_script, Variant &p_self, Variant *p_stack, int p_defarg, Variant &r_ret);
 
 	friend class GDScriptLanguage;
 
@@ -299,7 +412,7 @@ public:
 		StringName function_name;
 		String script_path;
 #endif
-		Vector<uint8_t> stack;
+		uint8_t *frame = nullptr; // Owned by the state while the function is suspended.
 		int stack_size;
 		Variant self;
 		uint32_t alloca_size;
@@ -344,6 +457,8 @@ public:
 
 	Variant call(GDScriptInstance *p_instance, const Variant **p_args, int p_argcount, Callable::CallError &r_err, CallState *p_state = nullptr);
 
+	static bool make_native_call(MethodBind *p_method, NativeCall &r_call);
+
 	_FORCE_INLINE_ MultiplayerAPI::RPCMode get_rpc_mode() const { return rpc_mode; }
 	GDScriptFunction();
 	~GDScriptFunction();
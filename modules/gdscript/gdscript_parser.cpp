@@ -817,6 +817,7 @@ GDScriptParser::Node *GDScriptParser::_parse_expression(Node *p_parent, bool p_s
 
 				if (!dependencies_only) {
 					if (!bfn && ScriptServer::is_global_class(identifier)) {
+						referenced_scripts.insert(ScriptServer::get_global_class_path(identifier));
 						Ref<Script> scr = ResourceLoader::load(ScriptServer::get_global_class_path(identifier));
 						if (scr.is_valid() && scr->is_valid()) {
 							ConstantNode *constant = alloc_node<ConstantNode>();
@@ -5393,6 +5394,7 @@ void GDScriptParser::_determine_inheritance(ClassNode *p_class, bool p_recursive
 			Ref<GDScript> base_script;
 
 			if (ScriptServer::is_global_class(base)) {
+				referenced_scripts.insert(ScriptServer::get_global_class_path(base));
 				base_script = ResourceLoader::load(ScriptServer::get_global_class_path(base));
 				if (!base_script.is_valid()) {
 					_set_error("The class \"" + base + "\" couldn't be fully loaded (script error or cyclic dependency).", p_class->line);
@@ -5416,6 +5418,7 @@ void GDScriptParser::_determine_inheritance(ClassNode *p_class, bool p_recursive
 						if (!singleton_path.begins_with("res://")) {
 							singleton_path = "res://" + singleton_path;
 						}
+						referenced_scripts.insert(singleton_path);
 						base_script = ResourceLoader::load(singleton_path);
 						if (!base_script.is_valid()) {
 							_set_error("Class '" + base + "' could not be fully loaded (script error or cyclic inheritance).", p_class->line);
@@ -5751,6 +5754,7 @@ GDScriptParser::DataType GDScriptParser::_resolve_type(const DataType &p_source,
 					result.kind = DataType::CLASS;
 					result.class_type = static_cast<ClassNode *>(head);
 				} else {
+					referenced_scripts.insert(script_path);
 					Ref<Script> script = ResourceLoader::load(script_path);
 					Ref<GDScript> gds = script;
 					if (gds.is_valid()) {
@@ -5792,6 +5796,7 @@ GDScriptParser::DataType GDScriptParser::_resolve_type(const DataType &p_source,
 				}
 			}
 			if (!singleton_path.empty()) {
+				referenced_scripts.insert(singleton_path);
 				Ref<Script> script = ResourceLoader::load(singleton_path);
 				Ref<GDScript> gds = script;
 				if (gds.is_valid()) {
@@ -7656,6 +7661,7 @@ GDScriptParser::DataType GDScriptParser::_reduce_identifier_type(const DataType
 		}
 
 		if (ScriptServer::is_global_class(p_identifier)) {
+			referenced_scripts.insert(ScriptServer::get_global_class_path(p_identifier));
 			Ref<Script> scr = ResourceLoader::load(ScriptServer::get_global_class_path(p_identifier));
 			if (scr.is_valid()) {
 				DataType result;
@@ -7708,6 +7714,7 @@ GDScriptParser::DataType GDScriptParser::_reduce_identifier_type(const DataType
 				if (!script.begins_with("res://")) {
 					script = "res://" + script;
 				}
+				referenced_scripts.insert(script);
 				Ref<Script> singleton = ResourceLoader::load(script);
 				if (singleton.is_valid()) {
 					DataType result;
@@ -8819,6 +8826,7 @@ void GDScriptParser::clear() {
 	check_types = true;
 	dependencies_only = false;
 	dependencies.clear();
+	referenced_scripts.clear();
 	error = "";
 #ifdef DEBUG_ENABLED
 	safe_lines = nullptr;
@@ -539,6 +539,7 @@ private:
 	bool check_types;
 	bool dependencies_only;
 	List<String> dependencies;
+	Set<String> referenced_scripts; // Scripts resolved by class name or autoload, their contents may be folded in.
 #ifdef DEBUG_ENABLED
 	Set<int> *safe_lines;
 #endif // DEBUG_ENABLED
@@ -686,6 +687,7 @@ public:
 	bool get_completion_identifier_is_function();
 
 	const List<String> &get_dependencies() const { return dependencies; }
+	const Set<String> &get_referenced_scripts() const { return referenced_scripts; }
 
 	void clear();
 	GDScriptParser();
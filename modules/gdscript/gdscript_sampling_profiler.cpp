@@ -0,0 +1,268 @@
+/*************************************************************************/
+/*  gdscript_sampling_profiler.cpp                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "gdscript_sampling_profiler.h"
+
+#include "core/debugger/engine_debugger.h"
+#include "core/engine.h"
+#include "core/os/os.h"
+#include "gdscript_function.h"
+
+GDScriptSamplingProfiler *GDScriptSamplingProfiler::singleton = nullptr;
+std::atomic<bool> GDScriptSamplingProfiler::sampling = { false };
+thread_local GDScriptSamplingProfiler::Slot *GDScriptSamplingProfiler::thread_slot = nullptr;
+
+bool GDScriptSamplingProfiler::Location::operator<(const Location &p_location) const {
+	if (source != p_location.source) {
+		return source < p_location.source;
+	}
+	if (function != p_location.function) {
+		return function < p_location.function;
+	}
+	return line < p_location.line;
+}
+
+GDScriptSamplingProfiler::Slot *GDScriptSamplingProfiler::get_thread_slot() {
+	if (likely(thread_slot)) {
+		return thread_slot;
+	}
+
+	// Slots are kept until the profiler is freed, threads that exit leave an empty one.
+	Slot *slot = memnew(Slot);
+	MutexLock lock(singleton->mutex);
+	slot->next = singleton->slots;
+	singleton->slots = slot;
+	thread_slot = slot;
+	return slot;
+}
+
+void GDScriptSamplingProfiler::function_freed(const GDScriptFunction *p_function) {
+	if (!is_sampling()) {
+		return;
+	}
+
+	// A function being freed is not running anywhere, so once the lock is held no new
+	// samples can point to it.
+	MutexLock lock(singleton->mutex);
+	LocalVector<SampleKey> keys;
+	const SampleKey *K = nullptr;
+	while ((K = singleton->samples.next(K))) {
+		if (K->function == p_function) {
+			keys.push_back(*K);
+		}
+	}
+	for (uint32_t i = 0; i < keys.size(); i++) {
+		singleton->freed_samples.push_back(Pair<Location, uint32_t>(_get_location(keys[i]), singleton->samples[keys[i]]));
+		singleton->samples.erase(keys[i]);
+	}
+}
+
+void GDScriptSamplingProfiler::_thread_func(void *p_user) {
+	GDScriptSamplingProfiler *profiler = (GDScriptSamplingProfiler *)p_user;
+
+	while (!profiler->exit_thread.load(std::memory_order_acquire)) {
+		OS::get_singleton()->delay_usec(profiler->interval_usec);
+
+		MutexLock lock(profiler->mutex);
+		for (Slot *slot = profiler->slots; slot; slot = slot->next) {
+			SampleKey key;
+			key.function = slot->function.load(std::memory_order_acquire);
+			if (!key.function) {
+				continue;
+			}
+			key.line = slot->line.load(std::memory_order_relaxed);
+
+			uint32_t *count = profiler->samples.getptr(key);
+			if (count) {
+				(*count)++;
+			} else {
+				profiler->samples.set(key, 1);
+			}
+		}
+		profiler->frame_ticks++;
+	}
+}
+
+GDScriptSamplingProfiler::Location GDScriptSamplingProfiler::_get_location(const SampleKey &p_key) {
+	Location location;
+	location.source = p_key.function->get_source();
+	location.function = p_key.function->get_name();
+	location.line = p_key.line;
+	return location;
+}
+
+void GDScriptSamplingProfiler::_push_location(Array &r_data, const Location &p_location, uint64_t p_count) {
+	r_data.push_back(p_location.source);
+	r_data.push_back(p_location.function);
+	r_data.push_back(p_location.line);
+	r_data.push_back(p_count);
+}
+
+void GDScriptSamplingProfiler::_start(uint32_t p_interval_usec) {
+	interval_usec = MAX(p_interval_usec, 1u);
+	frame_ticks = 0;
+	total_ticks = 0;
+	totals.clear();
+
+	exit_thread.store(false, std::memory_order_release);
+	sampling.store(true, std::memory_order_release);
+	thread = Thread::create(_thread_func, this);
+}
+
+void GDScriptSamplingProfiler::_stop() {
+	exit_thread.store(true, std::memory_order_release);
+	Thread::wait_to_finish(thread);
+	memdelete(thread);
+	thread = nullptr;
+
+	// Include what was sampled since the last frame. Until then samples still point to
+	// functions, so function_freed() has to keep resolving them.
+	_send_frame();
+	sampling.store(false, std::memory_order_release);
+	_send_totals();
+
+	MutexLock lock(mutex);
+	samples.clear();
+	freed_samples.clear();
+	totals.clear();
+}
+
+void GDScriptSamplingProfiler::_send_frame() {
+	// [frame, sample ticks, interval in usec, location count, then source, function, line and sample count per location]
+	Array entries;
+	uint64_t ticks;
+	{
+		MutexLock lock(mutex);
+		ticks = frame_ticks;
+		frame_ticks = 0;
+
+		const SampleKey *K = nullptr;
+		while ((K = samples.next(K))) {
+			freed_samples.push_back(Pair<Location, uint32_t>(_get_location(*K), samples[*K]));
+		}
+		samples.clear();
+
+		for (uint32_t i = 0; i < freed_samples.size(); i++) {
+			_push_location(entries, freed_samples[i].first, freed_samples[i].second);
+
+			Map<Location, uint64_t>::Element *E = totals.find(freed_samples[i].first);
+			if (E) {
+				E->get() += freed_samples[i].second;
+			} else {
+				totals.insert(freed_samples[i].first, freed_samples[i].second);
+			}
+		}
+		freed_samples.clear();
+		total_ticks += ticks;
+	}
+
+	if (!EngineDebugger::get_singleton() || (ticks == 0 && entries.empty())) {
+		return;
+	}
+
+	Array data;
+	data.push_back(Engine::get_singleton()->get_idle_frames());
+	data.push_back(ticks);
+	data.push_back(interval_usec);
+	data.push_back(entries.size() / 4);
+	for (int i = 0; i < entries.size(); i++) {
+		data.push_back(entries[i]);
+	}
+	EngineDebugger::get_singleton()->send_message("gdscript_samples:profile_frame", data);
+}
+
+void GDScriptSamplingProfiler::_send_totals() {
+	if (!EngineDebugger::get_singleton()) {
+		return;
+	}
+
+	// Same layout as the frames, with the hottest lines first.
+	LocalVector<Pair<uint64_t, const Location *>> sorted;
+	for (const Map<Location, uint64_t>::Element *E = totals.front(); E; E = E->next()) {
+		sorted.push_back(Pair<uint64_t, const Location *>(E->get(), &E->key()));
+	}
+	sorted.sort_custom<HottestFirst>();
+
+	Array data;
+	data.push_back(Engine::get_singleton()->get_idle_frames());
+	data.push_back(total_ticks);
+	data.push_back(interval_usec);
+	data.push_back(sorted.size());
+	for (uint32_t i = 0; i < sorted.size(); i++) {
+		_push_location(data, *sorted[i].second, sorted[i].first);
+	}
+	EngineDebugger::get_singleton()->send_message("gdscript_samples:profile_total", data);
+}
+
+void GDScriptSamplingProfiler::toggle(bool p_enable, const Array &p_opts) {
+	if (p_enable == (thread != nullptr)) {
+		return;
+	}
+
+	if (p_enable) {
+		// The only option is the sampling interval in microseconds.
+		_start(p_opts.size() > 0 ? uint32_t(p_opts[0]) : 1000);
+	} else {
+		_stop();
+	}
+}
+
+void GDScriptSamplingProfiler::tick(float p_frame_time, float p_idle_time, float p_physics_time, float p_physics_frame_time) {
+	_send_frame();
+}
+
+GDScriptSamplingProfiler::GDScriptSamplingProfiler() {
+	singleton = this;
+
+	EngineDebugger::Profiler profiler(
+			this,
+			[](void *p_user, bool p_enable, const Array &p_opts) {
+				((GDScriptSamplingProfiler *)p_user)->toggle(p_enable, p_opts);
+			},
+			nullptr,
+			[](void *p_user, float p_frame_time, float p_idle_time, float p_physics_time, float p_physics_frame_time) {
+				((GDScriptSamplingProfiler *)p_user)->tick(p_frame_time, p_idle_time, p_physics_time, p_physics_frame_time);
+			});
+	EngineDebugger::register_profiler("gdscript_samples", profiler);
+}
+
+GDScriptSamplingProfiler::~GDScriptSamplingProfiler() {
+	if (thread) {
+		_stop();
+	}
+	EngineDebugger::unregister_profiler("gdscript_samples");
+
+	while (slots) {
+		Slot *next = slots->next;
+		memdelete(slots);
+		slots = next;
+	}
+	singleton = nullptr;
+}
@@ -0,0 +1,127 @@
+/*************************************************************************/
+/*  gdscript_sampling_profiler.h                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef GDSCRIPT_SAMPLING_PROFILER_H
+#define GDSCRIPT_SAMPLING_PROFILER_H
+
+#include "core/array.h"
+#include "core/hash_map.h"
+#include "core/local_vector.h"
+#include "core/map.h"
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
+#include "core/pair.h"
+#include "core/string_name.h"
+
+#include <atomic>
+
+class GDScriptFunction;
+
+// Statistical profiler for GDScript, exposed to the debugger as the "gdscript_samples"
+// profiler. While it runs, every thread publishes the function and line it is executing
+// and a background thread samples them at a fixed interval, so the cost in the interpreter
+// is a couple of stores per call and per line instead of timing every call.
+class GDScriptSamplingProfiler {
+public:
+	// What a thread is executing, written by GDScriptFunction::call().
+	struct Slot {
+		std::atomic<const GDScriptFunction *> function = { nullptr };
+		std::atomic<int> line = { 0 };
+		Slot *next = nullptr;
+
+		_FORCE_INLINE_ void set(const GDScriptFunction *p_function, int p_line) {
+			line.store(p_line, std::memory_order_relaxed);
+			function.store(p_function, std::memory_order_release);
+		}
+	};
+
+private:
+	struct SampleKey {
+		const GDScriptFunction *function = nullptr;
+		int line = 0;
+
+		bool operator==(const SampleKey &p_key) const { return function == p_key.function && line == p_key.line; }
+	};
+
+	struct SampleKeyHasher {
+		static _FORCE_INLINE_ uint32_t hash(const SampleKey &p_key) { return hash_djb2_one_32(p_key.line, hash_one_uint64((uint64_t)p_key.function)); }
+	};
+
+	// Functions can be freed between two frames, their samples are resolved to names first.
+	struct Location {
+		StringName source;
+		StringName function;
+		int line = 0;
+
+		bool operator<(const Location &p_location) const;
+	};
+
+	struct HottestFirst {
+		bool operator()(const Pair<uint64_t, const Location *> &p_a, const Pair<uint64_t, const Location *> &p_b) const { return p_a.first > p_b.first; }
+	};
+
+	static GDScriptSamplingProfiler *singleton;
+	static std::atomic<bool> sampling;
+	static thread_local Slot *thread_slot;
+
+	Mutex mutex; // Guards everything below, the sampling thread holds it while reading slots.
+	Slot *slots = nullptr;
+	HashMap<SampleKey, uint32_t, SampleKeyHasher> samples;
+	LocalVector<Pair<Location, uint32_t>> freed_samples;
+	Map<Location, uint64_t> totals;
+	uint64_t frame_ticks = 0;
+	uint64_t total_ticks = 0;
+
+	Thread *thread = nullptr;
+	std::atomic<bool> exit_thread = { false };
+	uint32_t interval_usec = 1000;
+
+	static void _thread_func(void *p_user);
+	static Location _get_location(const SampleKey &p_key);
+	static void _push_location(Array &r_data, const Location &p_location, uint64_t p_count);
+
+	void _start(uint32_t p_interval_usec);
+	void _stop();
+	void _send_frame();
+	void _send_totals();
+
+public:
+	_FORCE_INLINE_ static bool is_sampling() { return sampling.load(std::memory_order_relaxed); }
+	static Slot *get_thread_slot();
+	static void function_freed(const GDScriptFunction *p_function);
+
+	void toggle(bool p_enable, const Array &p_opts);
+	void tick(float p_frame_time, float p_idle_time, float p_physics_time, float p_physics_frame_time);
+
+	GDScriptSamplingProfiler();
+	~GDScriptSamplingProfiler();
+};
+
+#endif // GDSCRIPT_SAMPLING_PROFILER_H
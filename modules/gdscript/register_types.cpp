@@ -35,9 +35,12 @@
 #include "core/os/dir_access.h"
 #include "core/os/file_access.h"
 #include "gdscript.h"
+#include "gdscript_aot.h"
+#include "gdscript_sampling_profiler.h"
 #include "gdscript_tokenizer.h"
 
 GDScriptLanguage *script_language_gd = nullptr;
+GDScriptSamplingProfiler *sampling_profiler_gd = nullptr;
 Ref<ResourceFormatLoaderGDScript> resource_loader_gd;
 Ref<ResourceFormatSaverGDScript> resource_saver_gd;
 
@@ -155,6 +158,8 @@ void register_gdscript_types() {
 	script_language_gd = memnew(GDScriptLanguage);
 	ScriptServer::register_language(script_language_gd);
 
+	sampling_profiler_gd = memnew(GDScriptSamplingProfiler);
+
 	resource_loader_gd.instance();
 	ResourceLoader::add_resource_format_loader(resource_loader_gd);
 
@@ -168,6 +173,10 @@ void register_gdscript_types() {
 }
 
 void unregister_gdscript_types() {
+	if (sampling_profiler_gd) {
+		memdelete(sampling_profiler_gd);
+	}
+
 	ScriptServer::unregister_language(script_language_gd);
 
 	if (script_language_gd) {
@@ -179,4 +188,7 @@ void unregister_gdscript_types() {
 
 	ResourceSaver::remove_resource_format_saver(resource_saver_gd);
 	resource_saver_gd.unref();
+
+	GDScriptAOT::clear();
+	GDScriptFramePool::clear();
 }
@@ -137,6 +137,15 @@ float NavigationMesh::get_cell_height() const {
 	return cell_height;
 }
 
+void NavigationMesh::set_tile_size(float p_value) {
+	ERR_FAIL_COND(p_value < 0);
+	tile_size = p_value;
+}
+
+float NavigationMesh::get_tile_size() const {
+	return tile_size;
+}
+
 void NavigationMesh::set_agent_height(float p_value) {
 	agent_height = p_value;
 }
@@ -403,6 +412,9 @@ void NavigationMesh::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_cell_height", "cell_height"), &NavigationMesh::set_cell_height);
 	ClassDB::bind_method(D_METHOD("get_cell_height"), &NavigationMesh::get_cell_height);
 
+	ClassDB::bind_method(D_METHOD("set_tile_size", "tile_size"), &NavigationMesh::set_tile_size);
+	ClassDB::bind_method(D_METHOD("get_tile_size"), &NavigationMesh::get_tile_size);
+
 	ClassDB::bind_method(D_METHOD("set_agent_height", "agent_height"), &NavigationMesh::set_agent_height);
 	ClassDB::bind_method(D_METHOD("get_agent_height"), &NavigationMesh::get_agent_height);
 
@@ -477,6 +489,7 @@ void NavigationMesh::_bind_methods() {
 
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cell/size", PROPERTY_HINT_RANGE, "0.1,1.0,0.01,or_greater"), "set_cell_size", "get_cell_size");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cell/height", PROPERTY_HINT_RANGE, "0.1,1.0,0.01,or_greater"), "set_cell_height", "get_cell_height");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cell/tile_size", PROPERTY_HINT_RANGE, "0.0,256.0,0.1,or_greater"), "set_tile_size", "get_tile_size");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "agent/height", PROPERTY_HINT_RANGE, "0.1,5.0,0.01,or_greater"), "set_agent_height", "get_agent_height");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "agent/radius", PROPERTY_HINT_RANGE, "0.1,5.0,0.01,or_greater"), "set_agent_radius", "get_agent_radius");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "agent/max_climb", PROPERTY_HINT_RANGE, "0.1,5.0,0.01,or_greater"), "set_agent_max_climb", "get_agent_max_climb");
@@ -513,6 +526,7 @@ void NavigationMesh::_validate_property(PropertyInfo &property) const {
 NavigationMesh::NavigationMesh() {
 	cell_size = 0.3f;
 	cell_height = 0.2f;
+	tile_size = 0.0f;
 	agent_height = 2.0f;
 	agent_radius = 0.6f;
 	agent_max_climb = 0.9f;
@@ -90,6 +90,10 @@ public:
 	/// Returns the navigation path to reach the destination from the origin.
 	virtual Vector<Vector3> map_get_path(RID p_map, Vector3 p_origin, Vector3 p_destination, bool p_optimize) const = 0;
 
+	/// Queues a path query, solved on the worker threads after the next map sync.
+	/// The path is passed to the receiver method, with the userdata if set.
+	virtual void map_query_path(RID p_map, Vector3 p_origin, Vector3 p_destination, bool p_optimize, Object *p_receiver, StringName p_method, Variant p_udata = Variant()) const = 0;
+
 	virtual Vector3 map_get_closest_point_to_segment(RID p_map, const Vector3 &p_from, const Vector3 &p_to, const bool p_use_collision = false) const = 0;
 	virtual Vector3 map_get_closest_point(RID p_map, const Vector3 &p_point) const = 0;
 	virtual Vector3 map_get_closest_point_normal(RID p_map, const Vector3 &p_point) const = 0;
@@ -199,20 +199,35 @@ public:
 	_FORCE_INLINE_ void set_biased_angular_velocity(real_t p_velocity) { biased_angular_velocity = p_velocity; }
 	_FORCE_INLINE_ real_t get_biased_angular_velocity() const { return biased_angular_velocity; }
 
+	// Static and kinematic bodies have no inverse mass, so impulses are skipped for them.
+	// This also keeps them untouched when constraint islands sharing them are solved in parallel.
+
 	_FORCE_INLINE_ void apply_central_impulse(const Vector2 &p_impulse) {
+		if (mode <= PhysicsServer2D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		linear_velocity += p_impulse * _inv_mass;
 	}
 
 	_FORCE_INLINE_ void apply_impulse(const Vector2 &p_offset, const Vector2 &p_impulse) {
+		if (mode <= PhysicsServer2D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		linear_velocity += p_impulse * _inv_mass;
 		angular_velocity += _inv_inertia * p_offset.cross(p_impulse);
 	}
 
 	_FORCE_INLINE_ void apply_torque_impulse(real_t p_torque) {
+		if (mode <= PhysicsServer2D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		angular_velocity += _inv_inertia * p_torque;
 	}
 
 	_FORCE_INLINE_ void apply_bias_impulse(const Vector2 &p_pos, const Vector2 &p_j) {
+		if (mode <= PhysicsServer2D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		biased_linear_velocity += p_j * _inv_mass;
 		biased_angular_velocity += _inv_inertia * p_pos.cross(p_j);
 	}
@@ -33,57 +33,111 @@
 
 #define LARGE_ELEMENT_FI 1.01239812
 
-void BroadPhase2DHashGrid::_pair_attempt(Element *p_elem, Element *p_with) {
-	Map<Element *, PairData *>::Element *E = p_elem->paired.find(p_with);
+int BroadPhase2DHashGrid::_cell_inc(LocalVector<CellElement> &p_set, Element *p_elem) {
+	for (uint32_t i = 0; i < p_set.size(); i++) {
+		if (p_set[i].element == p_elem) {
+			return p_set[i].rc.inc();
+		}
+	}
+
+	CellElement ce;
+	ce.element = p_elem;
+	ce.rc.inc();
+	p_set.push_back(ce);
+	return 1;
+}
 
+int BroadPhase2DHashGrid::_cell_dec(LocalVector<CellElement> &p_set, Element *p_elem) {
+	for (uint32_t i = 0; i < p_set.size(); i++) {
+		if (p_set[i].element == p_elem) {
+			int rc = p_set[i].rc.dec();
+			if (rc == 0) {
+				p_set[i] = p_set[p_set.size() - 1];
+				p_set.resize(p_set.size() - 1);
+			}
+			return rc;
+		}
+	}
+
+	ERR_FAIL_V_MSG(0, "Element not found in cell."); //should exist!!
+}
+
+void BroadPhase2DHashGrid::_pair_attempt(Element *p_elem, Element *p_with) {
 	ERR_FAIL_COND(p_elem->_static && p_with->_static);
 
-	if (!E) {
-		PairData *pd = memnew(PairData);
-		p_elem->paired[p_with] = pd;
-		p_with->paired[p_elem] = pd;
+	uint64_t key = PairKey(p_elem->self, p_with->self).key;
+	PairData **pdp = pair_map.lookup_ptr(key);
+
+	if (!pdp) {
+		PairData *pd = pair_pool.alloc();
+		pd->a = p_elem;
+		pd->b = p_with;
+		pd->index_in_a = p_elem->paired.size();
+		pd->index_in_b = p_with->paired.size();
+		p_elem->paired.push_back(pd);
+		p_with->paired.push_back(pd);
+		pair_map.insert(key, pd);
 	} else {
-		E->get()->rc++;
+		(*pdp)->rc++;
 	}
 }
 
 void BroadPhase2DHashGrid::_unpair_attempt(Element *p_elem, Element *p_with) {
-	Map<Element *, PairData *>::Element *E = p_elem->paired.find(p_with);
+	uint64_t key = PairKey(p_elem->self, p_with->self).key;
+	PairData **pdp = pair_map.lookup_ptr(key);
 
-	ERR_FAIL_COND(!E); //this should really be paired..
+	ERR_FAIL_COND(!pdp); //this should really be paired..
 
-	E->get()->rc--;
+	PairData *pd = *pdp;
+	pd->rc--;
 
-	if (E->get()->rc == 0) {
-		if (E->get()->colliding) {
+	if (pd->rc == 0) {
+		if (pd->colliding) {
 			//uncollide
 			if (unpair_callback) {
-				unpair_callback(p_elem->owner, p_elem->subindex, p_with->owner, p_with->subindex, E->get()->ud, unpair_userdata);
+				unpair_callback(p_elem->owner, p_elem->subindex, p_with->owner, p_with->subindex, pd->ud, unpair_userdata);
+			}
+		}
+
+		//swap-remove from both pair lists, fixing the index of the moved pair
+		Element *elems[2] = { pd->a, pd->b };
+		uint32_t indices[2] = { pd->index_in_a, pd->index_in_b };
+		for (int i = 0; i < 2; i++) {
+			LocalVector<PairData *> &paired = elems[i]->paired;
+			PairData *last = paired[paired.size() - 1];
+			paired[indices[i]] = last;
+			if (last->a == elems[i]) {
+				last->index_in_a = indices[i];
+			} else {
+				last->index_in_b = indices[i];
 			}
+			paired.resize(paired.size() - 1);
 		}
 
-		memdelete(E->get());
-		p_elem->paired.erase(E);
-		p_with->paired.erase(p_elem);
+		pair_map.remove(key);
+		pair_pool.free(pd);
 	}
 }
 
 void BroadPhase2DHashGrid::_check_motion(Element *p_elem) {
-	for (Map<Element *, PairData *>::Element *E = p_elem->paired.front(); E; E = E->next()) {
-		bool pairing = p_elem->aabb.intersects(E->key()->aabb);
+	for (uint32_t i = 0; i < p_elem->paired.size(); i++) {
+		PairData *pd = p_elem->paired[i];
+		Element *other = pd->a == p_elem ? pd->b : pd->a;
+
+		bool pairing = p_elem->aabb.intersects(other->aabb);
 
-		if (pairing != E->get()->colliding) {
+		if (pairing != pd->colliding) {
 			if (pairing) {
 				if (pair_callback) {
-					E->get()->ud = pair_callback(p_elem->owner, p_elem->subindex, E->key()->owner, E->key()->subindex, pair_userdata);
+					pd->ud = pair_callback(p_elem->owner, p_elem->subindex, other->owner, other->subindex, pair_userdata);
 				}
 			} else {
 				if (unpair_callback) {
-					unpair_callback(p_elem->owner, p_elem->subindex, E->key()->owner, E->key()->subindex, E->get()->ud, unpair_userdata);
+					unpair_callback(p_elem->owner, p_elem->subindex, other->owner, other->subindex, pd->ud, unpair_userdata);
 				}
 			}
 
-			E->get()->colliding = pairing;
+			pd->colliding = pairing;
 		}
 	}
 }
@@ -92,18 +146,19 @@ void BroadPhase2DHashGrid::_enter_grid(Element *p_elem, const Rect2 &p_rect, boo
 	Vector2 sz = (p_rect.size / cell_size * LARGE_ELEMENT_FI); //use magic number to avoid floating point issues
 	if (sz.width * sz.height > large_object_min_surface) {
 		//large object, do not use grid, must check against all elements
-		for (Map<ID, Element>::Element *E = element_map.front(); E; E = E->next()) {
-			if (E->key() == p_elem->self) {
+		for (OAHashMap<ID, Element *>::Iterator it = element_map.iter(); it.valid; it = element_map.next_iter(it)) {
+			Element *e = *it.value;
+			if (e == p_elem) {
 				continue; // do not pair against itself
 			}
-			if (E->get().owner == p_elem->owner) {
+			if (e->owner == p_elem->owner) {
 				continue;
 			}
-			if (E->get()._static && p_static) {
+			if (e->_static && p_static) {
 				continue;
 			}
 
-			_pair_attempt(p_elem, &E->get());
+			_pair_attempt(p_elem, e);
 		}
 
 		large_elements[p_elem].inc();
@@ -134,36 +189,38 @@ void BroadPhase2DHashGrid::_enter_grid(Element *p_elem, const Rect2 &p_rect, boo
 
 			if (!pb) {
 				//does not exist, create!
-				pb = memnew(PosBin);
+				pb = pos_bin_pool.alloc();
 				pb->key = pk;
 				pb->next = hash_table[idx];
 				hash_table[idx] = pb;
 			}
 
 			if (p_static) {
-				if (pb->static_object_set[p_elem].inc() == 1) {
+				if (_cell_inc(pb->static_object_set, p_elem) == 1) {
 					entered = true;
 				}
 			} else {
-				if (pb->object_set[p_elem].inc() == 1) {
+				if (_cell_inc(pb->object_set, p_elem) == 1) {
 					entered = true;
 				}
 			}
 
 			if (entered) {
-				for (Map<Element *, RC>::Element *E = pb->object_set.front(); E; E = E->next()) {
-					if (E->key()->owner == p_elem->owner) {
+				for (uint32_t k = 0; k < pb->object_set.size(); k++) {
+					Element *e = pb->object_set[k].element;
+					if (e->owner == p_elem->owner) {
 						continue;
 					}
-					_pair_attempt(p_elem, E->key());
+					_pair_attempt(p_elem, e);
 				}
 
 				if (!p_static) {
-					for (Map<Element *, RC>::Element *E = pb->static_object_set.front(); E; E = E->next()) {
-						if (E->key()->owner == p_elem->owner) {
+					for (uint32_t k = 0; k < pb->static_object_set.size(); k++) {
+						Element *e = pb->static_object_set[k].element;
+						if (e->owner == p_elem->owner) {
 							continue;
 						}
-						_pair_attempt(p_elem, E->key());
+						_pair_attempt(p_elem, e);
 					}
 				}
 			}
@@ -191,11 +248,10 @@ void BroadPhase2DHashGrid::_exit_grid(Element *p_elem, const Rect2 &p_rect, bool
 	Vector2 sz = (p_rect.size / cell_size * LARGE_ELEMENT_FI);
 	if (sz.width * sz.height > large_object_min_surface) {
 		//unpair all elements, instead of checking all, just check what is already paired, so we at least save from checking static vs static
-		Map<Element *, PairData *>::Element *E = p_elem->paired.front();
-		while (E) {
-			Map<Element *, PairData *>::Element *next = E->next();
-			_unpair_attempt(p_elem, E->key());
-			E = next;
+		//iterate backwards, pairs that go away are swapped with ones already visited
+		for (uint32_t i = p_elem->paired.size(); i > 0; i--) {
+			PairData *pd = p_elem->paired[i - 1];
+			_unpair_attempt(p_elem, pd->a == p_elem ? pd->b : pd->a);
 		}
 
 		if (large_elements[p_elem].dec() == 0) {
@@ -229,31 +285,31 @@ void BroadPhase2DHashGrid::_exit_grid(Element *p_elem, const Rect2 &p_rect, bool
 			bool exited = false;
 
 			if (p_static) {
-				if (pb->static_object_set[p_elem].dec() == 0) {
-					pb->static_object_set.erase(p_elem);
+				if (_cell_dec(pb->static_object_set, p_elem) == 0) {
 					exited = true;
 				}
 			} else {
-				if (pb->object_set[p_elem].dec() == 0) {
-					pb->object_set.erase(p_elem);
+				if (_cell_dec(pb->object_set, p_elem) == 0) {
 					exited = true;
 				}
 			}
 
 			if (exited) {
-				for (Map<Element *, RC>::Element *E = pb->object_set.front(); E; E = E->next()) {
-					if (E->key()->owner == p_elem->owner) {
+				for (uint32_t k = 0; k < pb->object_set.size(); k++) {
+					Element *e = pb->object_set[k].element;
+					if (e->owner == p_elem->owner) {
 						continue;
 					}
-					_unpair_attempt(p_elem, E->key());
+					_unpair_attempt(p_elem, e);
 				}
 
 				if (!p_static) {
-					for (Map<Element *, RC>::Element *E = pb->static_object_set.front(); E; E = E->next()) {
-						if (E->key()->owner == p_elem->owner) {
+					for (uint32_t k = 0; k < pb->static_object_set.size(); k++) {
+						Element *e = pb->static_object_set[k].element;
+						if (e->owner == p_elem->owner) {
 							continue;
 						}
-						_unpair_attempt(p_elem, E->key());
+						_unpair_attempt(p_elem, e);
 					}
 				}
 			}
@@ -276,7 +332,7 @@ void BroadPhase2DHashGrid::_exit_grid(Element *p_elem, const Rect2 &p_rect, bool
 					ERR_CONTINUE(!px);
 				}
 
-				memdelete(pb);
+				pos_bin_pool.free(pb);
 			}
 		}
 	}
@@ -300,93 +356,87 @@ void BroadPhase2DHashGrid::_exit_grid(Element *p_elem, const Rect2 &p_rect, bool
 BroadPhase2DHashGrid::ID BroadPhase2DHashGrid::create(CollisionObject2DSW *p_object, int p_subindex) {
 	current++;
 
-	Element e;
-	e.owner = p_object;
-	e._static = false;
-	e.subindex = p_subindex;
-	e.self = current;
-	e.pass = 0;
+	Element *e = element_pool.alloc();
+	e->owner = p_object;
+	e->_static = false;
+	e->subindex = p_subindex;
+	e->self = current;
+	e->pass = 0;
+	e->aabb = Rect2();
 
-	element_map[current] = e;
+	element_map.insert(current, e);
 	return current;
 }
 
 void BroadPhase2DHashGrid::move(ID p_id, const Rect2 &p_aabb) {
-	Map<ID, Element>::Element *E = element_map.find(p_id);
-	ERR_FAIL_COND(!E);
+	Element *e = nullptr;
+	ERR_FAIL_COND(!element_map.lookup(p_id, e));
 
-	Element &e = E->get();
-
-	if (p_aabb == e.aabb) {
+	if (p_aabb == e->aabb) {
 		return;
 	}
 
 	if (p_aabb != Rect2()) {
-		_enter_grid(&e, p_aabb, e._static);
+		_enter_grid(e, p_aabb, e->_static);
 	}
 
-	if (e.aabb != Rect2()) {
-		_exit_grid(&e, e.aabb, e._static);
+	if (e->aabb != Rect2()) {
+		_exit_grid(e, e->aabb, e->_static);
 	}
 
-	e.aabb = p_aabb;
-
-	_check_motion(&e);
+	e->aabb = p_aabb;
 
-	e.aabb = p_aabb;
+	_check_motion(e);
 }
 
 void BroadPhase2DHashGrid::set_static(ID p_id, bool p_static) {
-	Map<ID, Element>::Element *E = element_map.find(p_id);
-	ERR_FAIL_COND(!E);
+	Element *e = nullptr;
+	ERR_FAIL_COND(!element_map.lookup(p_id, e));
 
-	Element &e = E->get();
-
-	if (e._static == p_static) {
+	if (e->_static == p_static) {
 		return;
 	}
 
-	if (e.aabb != Rect2()) {
-		_exit_grid(&e, e.aabb, e._static);
+	if (e->aabb != Rect2()) {
+		_exit_grid(e, e->aabb, e->_static);
 	}
 
-	e._static = p_static;
+	e->_static = p_static;
 
-	if (e.aabb != Rect2()) {
-		_enter_grid(&e, e.aabb, e._static);
-		_check_motion(&e);
+	if (e->aabb != Rect2()) {
+		_enter_grid(e, e->aabb, e->_static);
+		_check_motion(e);
 	}
 }
 
 void BroadPhase2DHashGrid::remove(ID p_id) {
-	Map<ID, Element>::Element *E = element_map.find(p_id);
-	ERR_FAIL_COND(!E);
-
-	Element &e = E->get();
+	Element *e = nullptr;
+	ERR_FAIL_COND(!element_map.lookup(p_id, e));
 
-	if (e.aabb != Rect2()) {
-		_exit_grid(&e, e.aabb, e._static);
+	if (e->aabb != Rect2()) {
+		_exit_grid(e, e->aabb, e->_static);
 	}
 
-	element_map.erase(p_id);
+	element_map.remove(p_id);
+	element_pool.free(e);
 }
 
 CollisionObject2DSW *BroadPhase2DHashGrid::get_object(ID p_id) const {
-	const Map<ID, Element>::Element *E = element_map.find(p_id);
-	ERR_FAIL_COND_V(!E, nullptr);
-	return E->get().owner;
+	Element *e = nullptr;
+	ERR_FAIL_COND_V(!element_map.lookup(p_id, e), nullptr);
+	return e->owner;
 }
 
 bool BroadPhase2DHashGrid::is_static(ID p_id) const {
-	const Map<ID, Element>::Element *E = element_map.find(p_id);
-	ERR_FAIL_COND_V(!E, false);
-	return E->get()._static;
+	Element *e = nullptr;
+	ERR_FAIL_COND_V(!element_map.lookup(p_id, e), false);
+	return e->_static;
 }
 
 int BroadPhase2DHashGrid::get_subindex(ID p_id) const {
-	const Map<ID, Element>::Element *E = element_map.find(p_id);
-	ERR_FAIL_COND_V(!E, -1);
-	return E->get().subindex;
+	Element *e = nullptr;
+	ERR_FAIL_COND_V(!element_map.lookup(p_id, e), -1);
+	return e->subindex;
 }
 
 template <bool use_aabb, bool use_segment>
@@ -410,48 +460,50 @@ void BroadPhase2DHashGrid::_cull(const Point2i p_cell, const Rect2 &p_aabb, cons
 		return;
 	}
 
-	for (Map<Element *, RC>::Element *E = pb->object_set.front(); E; E = E->next()) {
+	for (uint32_t i = 0; i < pb->object_set.size(); i++) {
 		if (index >= p_max_results) {
 			break;
 		}
-		if (E->key()->pass == pass) {
+		Element *e = pb->object_set[i].element;
+		if (e->pass == pass) {
 			continue;
 		}
 
-		E->key()->pass = pass;
+		e->pass = pass;
 
-		if (use_aabb && !p_aabb.intersects(E->key()->aabb)) {
+		if (use_aabb && !p_aabb.intersects(e->aabb)) {
 			continue;
 		}
 
-		if (use_segment && !E->key()->aabb.intersects_segment(p_from, p_to)) {
+		if (use_segment && !e->aabb.intersects_segment(p_from, p_to)) {
 			continue;
 		}
 
-		p_results[index] = E->key()->owner;
-		p_result_indices[index] = E->key()->subindex;
+		p_results[index] = e->owner;
+		p_result_indices[index] = e->subindex;
 		index++;
 	}
 
-	for (Map<Element *, RC>::Element *E = pb->static_object_set.front(); E; E = E->next()) {
+	for (uint32_t i = 0; i < pb->static_object_set.size(); i++) {
 		if (index >= p_max_results) {
 			break;
 		}
-		if (E->key()->pass == pass) {
+		Element *e = pb->static_object_set[i].element;
+		if (e->pass == pass) {
 			continue;
 		}
 
-		if (use_aabb && !p_aabb.intersects(E->key()->aabb)) {
+		if (use_aabb && !p_aabb.intersects(e->aabb)) {
 			continue;
 		}
 
-		if (use_segment && !E->key()->aabb.intersects_segment(p_from, p_to)) {
+		if (use_segment && !e->aabb.intersects_segment(p_from, p_to)) {
 			continue;
 		}
 
-		E->key()->pass = pass;
-		p_results[index] = E->key()->owner;
-		p_result_indices[index] = E->key()->subindex;
+		e->pass = pass;
+		p_results[index] = e->owner;
+		p_result_indices[index] = e->subindex;
 		index++;
 	}
 }
@@ -617,6 +669,11 @@ BroadPhase2DSW *BroadPhase2DHashGrid::_create() {
 }
 
 BroadPhase2DHashGrid::BroadPhase2DHashGrid() {
+	// A space usually holds far fewer than the default page size of elements.
+	element_pool.configure(256);
+	pair_pool.configure(256);
+	pos_bin_pool.configure(256);
+
 	hash_table_size = GLOBAL_DEF("physics/2d/bp_hash_table_size", 4096);
 	ProjectSettings::get_singleton()->set_custom_property_info("physics/2d/bp_hash_table_size", PropertyInfo(Variant::INT, "physics/2d/bp_hash_table_size", PROPERTY_HINT_RANGE, "0,8192,1,or_greater"));
 	hash_table_size = Math::larger_prime(hash_table_size);
@@ -641,11 +698,19 @@ BroadPhase2DHashGrid::~BroadPhase2DHashGrid() {
 		while (hash_table[i]) {
 			PosBin *pb = hash_table[i];
 			hash_table[i] = pb->next;
-			memdelete(pb);
+			pos_bin_pool.free(pb);
 		}
 	}
 
 	memdelete_arr(hash_table);
+
+	for (OAHashMap<uint64_t, PairData *>::Iterator it = pair_map.iter(); it.valid; it = pair_map.next_iter(it)) {
+		pair_pool.free(*it.value);
+	}
+
+	for (OAHashMap<ID, Element *>::Iterator it = element_map.iter(); it.valid; it = element_map.next_iter(it)) {
+		element_pool.free(*it.value);
+	}
 }
 
 /* 3D version of voxel traversal:
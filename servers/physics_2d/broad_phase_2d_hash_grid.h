@@ -32,18 +32,22 @@
 #define BROAD_PHASE_2D_HASH_GRID_H
 
 #include "broad_phase_2d_sw.h"
+#include "core/local_vector.h"
 #include "core/map.h"
+#include "core/oa_hash_map.h"
+#include "core/paged_allocator.h"
 
 class BroadPhase2DHashGrid : public BroadPhase2DSW {
+	struct Element;
+
 	struct PairData {
-		bool colliding;
-		int rc;
-		void *ud;
-		PairData() {
-			colliding = false;
-			rc = 1;
-			ud = nullptr;
-		}
+		Element *a = nullptr;
+		Element *b = nullptr;
+		uint32_t index_in_a = 0; // Position in a->paired.
+		uint32_t index_in_b = 0; // Position in b->paired.
+		bool colliding = false;
+		int rc = 1;
+		void *ud = nullptr;
 	};
 
 	struct Element {
@@ -53,7 +57,7 @@ class BroadPhase2DHashGrid : public BroadPhase2DSW {
 		Rect2 aabb;
 		int subindex;
 		uint64_t pass;
-		Map<Element *, PairData *> paired;
+		LocalVector<PairData *> paired;
 	};
 
 	struct RC {
@@ -73,9 +77,12 @@ class BroadPhase2DHashGrid : public BroadPhase2DSW {
 		}
 	};
 
-	Map<ID, Element> element_map;
+	OAHashMap<ID, Element *> element_map;
 	Map<Element *, RC> large_elements;
 
+	PagedAllocator<Element> element_pool;
+	PagedAllocator<PairData> pair_pool;
+
 	ID current;
 
 	uint64_t pass;
@@ -105,7 +112,7 @@ class BroadPhase2DHashGrid : public BroadPhase2DSW {
 		}
 	};
 
-	Map<PairKey, PairData> pair_map;
+	OAHashMap<uint64_t, PairData *> pair_map;
 
 	int cell_size;
 	int large_object_min_surface;
@@ -146,16 +153,27 @@ class BroadPhase2DHashGrid : public BroadPhase2DSW {
 		}
 	};
 
+	// Cells hold few elements, so a flat array beats a tree here.
+	struct CellElement {
+		Element *element;
+		RC rc;
+	};
+
 	struct PosBin {
 		PosKey key;
-		Map<Element *, RC> object_set;
-		Map<Element *, RC> static_object_set;
+		LocalVector<CellElement> object_set;
+		LocalVector<CellElement> static_object_set;
 		PosBin *next;
 	};
 
 	uint32_t hash_table_size;
 	PosBin **hash_table;
 
+	PagedAllocator<PosBin> pos_bin_pool;
+
+	_FORCE_INLINE_ static int _cell_inc(LocalVector<CellElement> &p_set, Element *p_elem);
+	_FORCE_INLINE_ static int _cell_dec(LocalVector<CellElement> &p_set, Element *p_elem);
+
 	void _pair_attempt(Element *p_elem, Element *p_with);
 	void _unpair_attempt(Element *p_elem, Element *p_with);
 	void _check_motion(Element *p_elem);
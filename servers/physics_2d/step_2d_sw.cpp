@@ -29,9 +29,11 @@
 /*************************************************************************/
 
 #include "step_2d_sw.h"
+
 #include "core/os/os.h"
+#include "core/os/threaded_array_processor.h"
 
-void Step2DSW::_populate_island(Body2DSW *p_body, Body2DSW **p_island, Constraint2DSW **p_constraint_island) {
+void Step2DSW::_populate_island(Body2DSW *p_body, Body2DSW **p_island, Constraint2DSW **p_constraint_island, bool *r_serial_setup) {
 	p_body->set_island_step(_step);
 	p_body->set_island_next(*p_island);
 	*p_island = p_body;
@@ -42,9 +44,24 @@ void Step2DSW::_populate_island(Body2DSW *p_body, Body2DSW **p_island, Constrain
 			continue; //already processed
 		}
 		c->set_island_step(_step);
+
+		if (c->get_body_count() == 0) {
+			//area pair, writes to the area so it is set up apart from the islands
+			area_constraints.push_back(c);
+			continue;
+		}
+
 		c->set_island_next(*p_constraint_island);
 		*p_constraint_island = c;
 
+		for (int i = 0; i < c->get_body_count(); i++) {
+			Body2DSW *b = c->get_body_ptr()[i];
+			if (b->get_mode() <= PhysicsServer2D::BODY_MODE_KINEMATIC && b->can_report_contacts()) {
+				//body may be shared with other islands, and setup adds contacts to it
+				*r_serial_setup = true;
+			}
+		}
+
 		for (int i = 0; i < c->get_body_count(); i++) {
 			if (i == E->get()) {
 				continue;
@@ -53,40 +70,37 @@ void Step2DSW::_populate_island(Body2DSW *p_body, Body2DSW **p_island, Constrain
 			if (b->get_island_step() == _step || b->get_mode() == PhysicsServer2D::BODY_MODE_STATIC || b->get_mode() == PhysicsServer2D::BODY_MODE_KINEMATIC) {
 				continue; //no go
 			}
-			_populate_island(c->get_body_ptr()[i], p_island, p_constraint_island);
+			_populate_island(c->get_body_ptr()[i], p_island, p_constraint_island, r_serial_setup);
 		}
 	}
 }
 
-bool Step2DSW::_setup_island(Constraint2DSW *p_island, real_t p_delta) {
-	Constraint2DSW *ci = p_island;
+void Step2DSW::_setup_island(uint32_t p_island_index, Constraint2DSW **p_islands) {
+	Constraint2DSW *ci = p_islands[p_island_index];
 	Constraint2DSW *prev_ci = nullptr;
-	bool removed_root = false;
 	while (ci) {
-		bool process = ci->setup(p_delta);
+		bool process = ci->setup(delta);
 
 		if (!process) {
 			//remove from island if process fails
 			if (prev_ci) {
 				prev_ci->set_island_next(ci->get_island_next());
 			} else {
-				removed_root = true;
-				prev_ci = ci;
+				p_islands[p_island_index] = ci->get_island_next();
 			}
 		} else {
 			prev_ci = ci;
 		}
 		ci = ci->get_island_next();
 	}
-
-	return removed_root;
 }
 
-void Step2DSW::_solve_island(Constraint2DSW *p_island, int p_iterations, real_t p_delta) {
-	for (int i = 0; i < p_iterations; i++) {
-		Constraint2DSW *ci = p_island;
+void Step2DSW::_solve_island(uint32_t p_island_index, Constraint2DSW **p_islands) {
+	Constraint2DSW *island = p_islands[p_island_index];
+	for (int i = 0; i < iterations; i++) {
+		Constraint2DSW *ci = island;
 		while (ci) {
-			ci->solve(p_delta);
+			ci->solve(delta);
 			ci = ci->get_island_next();
 		}
 	}
@@ -160,25 +174,34 @@ void Step2DSW::step(Space2DSW *p_space, real_t p_delta, int p_iterations) {
 	/* GENERATE CONSTRAINT ISLANDS */
 
 	Body2DSW *island_list = nullptr;
-	Constraint2DSW *constraint_island_list = nullptr;
+	parallel_setup_islands.clear();
+	serial_setup_islands.clear();
+	area_constraints.clear();
 	b = body_list->first();
 
 	int island_count = 0;
 
+	//debug contacts are written to the space, keep it to a single thread
+	bool serial_setup = p_space->is_debugging_contacts();
+
 	while (b) {
 		Body2DSW *body = b->self();
 
 		if (body->get_island_step() != _step) {
 			Body2DSW *island = nullptr;
 			Constraint2DSW *constraint_island = nullptr;
-			_populate_island(body, &island, &constraint_island);
+			bool island_serial_setup = serial_setup;
+			_populate_island(body, &island, &constraint_island, &island_serial_setup);
 
 			island->set_island_list_next(island_list);
 			island_list = island;
 
 			if (constraint_island) {
-				constraint_island->set_island_list_next(constraint_island_list);
-				constraint_island_list = constraint_island;
+				if (island_serial_setup) {
+					serial_setup_islands.push_back(constraint_island);
+				} else {
+					parallel_setup_islands.push_back(constraint_island);
+				}
 				island_count++;
 			}
 		}
@@ -196,9 +219,7 @@ void Step2DSW::step(Space2DSW *p_space, real_t p_delta, int p_iterations) {
 				continue;
 			}
 			c->set_island_step(_step);
-			c->set_island_next(nullptr);
-			c->set_island_list_next(constraint_island_list);
-			constraint_island_list = c;
+			area_constraints.push_back(c);
 		}
 		p_space->area_remove_from_moved_list((SelfList<Area2DSW> *)aml.first()); //faster to remove here
 	}
@@ -211,38 +232,34 @@ void Step2DSW::step(Space2DSW *p_space, real_t p_delta, int p_iterations) {
 
 	/* SETUP CONSTRAINT ISLANDS */
 
-	{
-		Constraint2DSW *ci = constraint_island_list;
-		Constraint2DSW *prev_ci = nullptr;
-		while (ci) {
-			if (_setup_island(ci, p_delta)) {
-				//removed the root from the island graph because it is not to be processed
-
-				Constraint2DSW *next = ci->get_island_next();
-
-				if (next) {
-					//root from list being deleted no longer exists, replace by next
-					next->set_island_list_next(ci->get_island_list_next());
-					if (prev_ci) {
-						prev_ci->set_island_list_next(next);
-					} else {
-						constraint_island_list = next;
-					}
-					prev_ci = next;
-				} else {
-					//list is empty, just skip
-					if (prev_ci) {
-						prev_ci->set_island_list_next(ci->get_island_list_next());
+	// Narrow phase for body pairs happens in setup. Islands share no rigid
+	// bodies, so they are set up and solved in parallel. Each island is
+	// processed in order by a single thread, which keeps the results
+	// independent from scheduling and identical from run to run.
 
-					} else {
-						constraint_island_list = ci->get_island_list_next();
-					}
-				}
-			} else {
-				prev_ci = ci;
-			}
+	delta = p_delta;
+	iterations = p_iterations;
 
-			ci = ci->get_island_list_next();
+	thread_process_array(parallel_setup_islands.size(), this, &Step2DSW::_setup_island, parallel_setup_islands.ptr());
+
+	for (uint32_t i = 0; i < serial_setup_islands.size(); i++) {
+		_setup_island(i, serial_setup_islands.ptr());
+	}
+
+	for (uint32_t i = 0; i < area_constraints.size(); i++) {
+		area_constraints[i]->setup(p_delta);
+	}
+
+	//islands left empty by setup are not solved
+	constraint_islands.clear();
+	for (uint32_t i = 0; i < parallel_setup_islands.size(); i++) {
+		if (parallel_setup_islands[i]) {
+			constraint_islands.push_back(parallel_setup_islands[i]);
+		}
+	}
+	for (uint32_t i = 0; i < serial_setup_islands.size(); i++) {
+		if (serial_setup_islands[i]) {
+			constraint_islands.push_back(serial_setup_islands[i]);
 		}
 	}
 
@@ -254,14 +271,8 @@ void Step2DSW::step(Space2DSW *p_space, real_t p_delta, int p_iterations) {
 
 	/* SOLVE CONSTRAINT ISLANDS */
 
-	{
-		Constraint2DSW *ci = constraint_island_list;
-		while (ci) {
-			//iterating each island separatedly improves cache efficiency
-			_solve_island(ci, p_iterations, p_delta);
-			ci = ci->get_island_list_next();
-		}
-	}
+	//iterating each island separatedly improves cache efficiency
+	thread_process_array(constraint_islands.size(), this, &Step2DSW::_solve_island, constraint_islands.ptr());
 
 	{ //profile
 		profile_endtime = OS::get_singleton()->get_ticks_usec();
@@ -33,12 +33,22 @@
 
 #include "space_2d_sw.h"
 
+#include "core/local_vector.h"
+
 class Step2DSW {
 	uint64_t _step;
 
-	void _populate_island(Body2DSW *p_body, Body2DSW **p_island, Constraint2DSW **p_constraint_island);
-	bool _setup_island(Constraint2DSW *p_island, real_t p_delta);
-	void _solve_island(Constraint2DSW *p_island, int p_iterations, real_t p_delta);
+	int iterations = 0;
+	real_t delta = 0.0;
+
+	LocalVector<Constraint2DSW *> parallel_setup_islands;
+	LocalVector<Constraint2DSW *> serial_setup_islands;
+	LocalVector<Constraint2DSW *> area_constraints;
+	LocalVector<Constraint2DSW *> constraint_islands;
+
+	void _populate_island(Body2DSW *p_body, Body2DSW **p_island, Constraint2DSW **p_constraint_island, bool *r_serial_setup);
+	void _setup_island(uint32_t p_island_index, Constraint2DSW **p_islands);
+	void _solve_island(uint32_t p_island_index, Constraint2DSW **p_islands);
 	void _check_suspend(Body2DSW *p_island, real_t p_delta);
 
 public:
@@ -216,20 +216,35 @@ public:
 	_FORCE_INLINE_ const Vector3 &get_biased_linear_velocity() const { return biased_linear_velocity; }
 	_FORCE_INLINE_ const Vector3 &get_biased_angular_velocity() const { return biased_angular_velocity; }
 
+	// Static and kinematic bodies have no inverse mass, so impulses are skipped for them.
+	// This also keeps them untouched when constraint islands sharing them are solved in parallel.
+
 	_FORCE_INLINE_ void apply_central_impulse(const Vector3 &p_j) {
+		if (mode <= PhysicsServer3D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		linear_velocity += p_j * _inv_mass;
 	}
 
 	_FORCE_INLINE_ void apply_impulse(const Vector3 &p_pos, const Vector3 &p_j) {
+		if (mode <= PhysicsServer3D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		linear_velocity += p_j * _inv_mass;
 		angular_velocity += _inv_inertia_tensor.xform((p_pos - center_of_mass).cross(p_j));
 	}
 
 	_FORCE_INLINE_ void apply_torque_impulse(const Vector3 &p_j) {
+		if (mode <= PhysicsServer3D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		angular_velocity += _inv_inertia_tensor.xform(p_j);
 	}
 
 	_FORCE_INLINE_ void apply_bias_impulse(const Vector3 &p_pos, const Vector3 &p_j, real_t p_max_delta_av = -1.0) {
+		if (mode <= PhysicsServer3D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		biased_linear_velocity += p_j * _inv_mass;
 		if (p_max_delta_av != 0.0) {
 			Vector3 delta_av = _inv_inertia_tensor.xform((p_pos - center_of_mass).cross(p_j));
@@ -241,6 +256,9 @@ public:
 	}
 
 	_FORCE_INLINE_ void apply_bias_torque_impulse(const Vector3 &p_j) {
+		if (mode <= PhysicsServer3D::BODY_MODE_KINEMATIC) {
+			return;
+		}
 		biased_angular_velocity += _inv_inertia_tensor.xform(p_j);
 	}
 
@@ -0,0 +1,605 @@
+/*************************************************************************/
+/*  broad_phase_3d_bvh.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "broad_phase_3d_bvh.h"
+
+#include "core/project_settings.h"
+
+// Surface area heuristic, half the surface is enough to compare costs.
+static _FORCE_INLINE_ real_t _surface_cost(const AABB &p_aabb) {
+	const Vector3 &s = p_aabb.size;
+	return s.x * s.y + s.y * s.z + s.z * s.x;
+}
+
+int BroadPhase3DBVH::Tree::_alloc_node() {
+	int index;
+	if (free_list != -1) {
+		index = free_list;
+		free_list = nodes[index].parent;
+	} else {
+		index = nodes.size();
+		nodes.push_back(Node());
+	}
+
+	Node &node = nodes[index];
+	node.parent = -1;
+	node.children[0] = -1;
+	node.children[1] = -1;
+	node.height = 0;
+	node.element = nullptr;
+	return index;
+}
+
+void BroadPhase3DBVH::Tree::_free_node(int p_node) {
+	nodes[p_node].parent = free_list;
+	nodes[p_node].height = -1;
+	free_list = p_node;
+}
+
+void BroadPhase3DBVH::Tree::_insert_leaf(int p_leaf) {
+	if (root == -1) {
+		root = p_leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+
+	// Find the best sibling, descending while it is cheaper than pairing with the current node.
+	AABB leaf_aabb = nodes[p_leaf].aabb;
+	int index = root;
+	while (!nodes[index].is_leaf()) {
+		const Node &node = nodes[index];
+
+		real_t area = _surface_cost(node.aabb);
+		real_t combined_area = _surface_cost(node.aabb.merge(leaf_aabb));
+
+		// Cost of creating a new parent for this node and the new leaf.
+		real_t cost = 2.0 * combined_area;
+		// Minimum cost of pushing the leaf further down the tree.
+		real_t inheritance_cost = 2.0 * (combined_area - area);
+
+		real_t child_cost[2];
+		for (int i = 0; i < 2; i++) {
+			const Node &child = nodes[node.children[i]];
+			real_t merged_area = _surface_cost(child.aabb.merge(leaf_aabb));
+			if (child.is_leaf()) {
+				child_cost[i] = merged_area + inheritance_cost;
+			} else {
+				child_cost[i] = merged_area - _surface_cost(child.aabb) + inheritance_cost;
+			}
+		}
+
+		if (cost < child_cost[0] && cost < child_cost[1]) {
+			break;
+		}
+
+		index = child_cost[0] < child_cost[1] ? node.children[0] : node.children[1];
+	}
+
+	int sibling = index;
+
+	// Allocating may reallocate the node array, so no references are held across it.
+	int new_parent = _alloc_node();
+	int old_parent = nodes[sibling].parent;
+
+	nodes[new_parent].parent = old_parent;
+	nodes[new_parent].aabb = nodes[sibling].aabb.merge(leaf_aabb);
+	nodes[new_parent].height = nodes[sibling].height + 1;
+	nodes[new_parent].children[0] = sibling;
+	nodes[new_parent].children[1] = p_leaf;
+	nodes[sibling].parent = new_parent;
+	nodes[p_leaf].parent = new_parent;
+
+	if (old_parent != -1) {
+		if (nodes[old_parent].children[0] == sibling) {
+			nodes[old_parent].children[0] = new_parent;
+		} else {
+			nodes[old_parent].children[1] = new_parent;
+		}
+	} else {
+		root = new_parent;
+	}
+
+	_refit(new_parent);
+}
+
+void BroadPhase3DBVH::Tree::_remove_leaf(int p_leaf) {
+	if (p_leaf == root) {
+		root = -1;
+		return;
+	}
+
+	int parent = nodes[p_leaf].parent;
+	int grand_parent = nodes[parent].parent;
+	int sibling = nodes[parent].children[0] == p_leaf ? nodes[parent].children[1] : nodes[parent].children[0];
+
+	_free_node(parent);
+
+	if (grand_parent != -1) {
+		if (nodes[grand_parent].children[0] == parent) {
+			nodes[grand_parent].children[0] = sibling;
+		} else {
+			nodes[grand_parent].children[1] = sibling;
+		}
+		nodes[sibling].parent = grand_parent;
+		_refit(grand_parent);
+	} else {
+		root = sibling;
+		nodes[sibling].parent = -1;
+	}
+}
+
+void BroadPhase3DBVH::Tree::_refit(int p_node) {
+	int index = p_node;
+	while (index != -1) {
+		index = _balance(index);
+
+		Node &node = nodes[index];
+		const Node &child0 = nodes[node.children[0]];
+		const Node &child1 = nodes[node.children[1]];
+
+		node.height = 1 + MAX(child0.height, child1.height);
+		node.aabb = child0.aabb.merge(child1.aabb);
+
+		index = node.parent;
+	}
+}
+
+// Rotates the taller child of p_node up if the subtree is unbalanced, returns the new subtree root.
+int BroadPhase3DBVH::Tree::_balance(int p_node) {
+	Node &a = nodes[p_node];
+	if (a.is_leaf() || a.height < 2) {
+		return p_node;
+	}
+
+	int i_b = a.children[0];
+	int i_c = a.children[1];
+	Node &b = nodes[i_b];
+	Node &c = nodes[i_c];
+
+	int balance = c.height - b.height;
+
+	if (balance > 1) {
+		// Rotate c up.
+		int i_f = c.children[0];
+		int i_g = c.children[1];
+		Node &f = nodes[i_f];
+		Node &g = nodes[i_g];
+
+		c.children[0] = p_node;
+		c.parent = a.parent;
+		a.parent = i_c;
+
+		if (c.parent != -1) {
+			if (nodes[c.parent].children[0] == p_node) {
+				nodes[c.parent].children[0] = i_c;
+			} else {
+				nodes[c.parent].children[1] = i_c;
+			}
+		} else {
+			root = i_c;
+		}
+
+		if (f.height > g.height) {
+			c.children[1] = i_f;
+			a.children[1] = i_g;
+			g.parent = p_node;
+			a.aabb = b.aabb.merge(g.aabb);
+			c.aabb = a.aabb.merge(f.aabb);
+			a.height = 1 + MAX(b.height, g.height);
+			c.height = 1 + MAX(a.height, f.height);
+		} else {
+			c.children[1] = i_g;
+			a.children[1] = i_f;
+			f.parent = p_node;
+			a.aabb = b.aabb.merge(f.aabb);
+			c.aabb = a.aabb.merge(g.aabb);
+			a.height = 1 + MAX(b.height, f.height);
+			c.height = 1 + MAX(a.height, g.height);
+		}
+
+		return i_c;
+	}
+
+	if (balance < -1) {
+		// Rotate b up.
+		int i_d = b.children[0];
+		int i_e = b.children[1];
+		Node &d = nodes[i_d];
+		Node &e = nodes[i_e];
+
+		b.children[0] = p_node;
+		b.parent = a.parent;
+		a.parent = i_b;
+
+		if (b.parent != -1) {
+			if (nodes[b.parent].children[0] == p_node) {
+				nodes[b.parent].children[0] = i_b;
+			} else {
+				nodes[b.parent].children[1] = i_b;
+			}
+		} else {
+			root = i_b;
+		}
+
+		if (d.height > e.height) {
+			b.children[1] = i_d;
+			a.children[0] = i_e;
+			e.parent = p_node;
+			a.aabb = c.aabb.merge(e.aabb);
+			b.aabb = a.aabb.merge(d.aabb);
+			a.height = 1 + MAX(c.height, e.height);
+			b.height = 1 + MAX(a.height, d.height);
+		} else {
+			b.children[1] = i_e;
+			a.children[0] = i_d;
+			d.parent = p_node;
+			a.aabb = c.aabb.merge(d.aabb);
+			b.aabb = a.aabb.merge(e.aabb);
+			a.height = 1 + MAX(c.height, d.height);
+			b.height = 1 + MAX(a.height, e.height);
+		}
+
+		return i_b;
+	}
+
+	return p_node;
+}
+
+int BroadPhase3DBVH::Tree::create_leaf(Element *p_element, const AABB &p_aabb) {
+	int leaf = _alloc_node();
+	nodes[leaf].aabb = p_aabb;
+	nodes[leaf].element = p_element;
+	_insert_leaf(leaf);
+	return leaf;
+}
+
+void BroadPhase3DBVH::Tree::move_leaf(int p_leaf, const AABB &p_aabb) {
+	_remove_leaf(p_leaf);
+	nodes[p_leaf].aabb = p_aabb;
+	_insert_leaf(p_leaf);
+}
+
+void BroadPhase3DBVH::Tree::free_leaf(int p_leaf) {
+	_remove_leaf(p_leaf);
+	_free_node(p_leaf);
+}
+
+/* BROAD PHASE */
+
+struct BroadPhase3DBVH::PairCull {
+	BroadPhase3DBVH *bp;
+	Element *elem;
+
+	_FORCE_INLINE_ bool test(const AABB &p_aabb) const {
+		return p_aabb.intersects_inclusive(elem->aabb);
+	}
+
+	_FORCE_INLINE_ bool leaf(Element *p_other) {
+		if (p_other == elem || p_other->owner == elem->owner) {
+			return true;
+		}
+		if (!elem->aabb.intersects_inclusive(p_other->aabb)) {
+			return true; // Only the fattened box overlaps.
+		}
+		if (!bp->pair_map.has(_pair_key(elem->self, p_other->self))) {
+			bp->_pair(elem, p_other);
+		}
+		return true;
+	}
+};
+
+struct BroadPhase3DBVH::ResultCull {
+	CollisionObject3DSW **results;
+	int *result_indices;
+	int max_results;
+	int count = 0;
+
+	_FORCE_INLINE_ bool add(Element *p_elem) {
+		results[count] = p_elem->owner;
+		if (result_indices) {
+			result_indices[count] = p_elem->subindex;
+		}
+		count++;
+		return count < max_results;
+	}
+};
+
+void BroadPhase3DBVH::_pair(Element *p_a, Element *p_b) {
+	PairData *pd = pair_pool.alloc();
+	pd->a = p_a;
+	pd->b = p_b;
+	pd->index_in_a = p_a->paired.size();
+	pd->index_in_b = p_b->paired.size();
+	p_a->paired.push_back(pd);
+	p_b->paired.push_back(pd);
+	pair_map.insert(_pair_key(p_a->self, p_b->self), pd);
+
+	if (pair_callback) {
+		pd->ud = pair_callback(p_a->owner, p_a->subindex, p_b->owner, p_b->subindex, pair_userdata);
+	}
+}
+
+void BroadPhase3DBVH::_unpair(PairData *p_pair) {
+	if (unpair_callback) {
+		unpair_callback(p_pair->a->owner, p_pair->a->subindex, p_pair->b->owner, p_pair->b->subindex, p_pair->ud, unpair_userdata);
+	}
+
+	//swap-remove from both pair lists, fixing the index of the moved pair
+	Element *elems[2] = { p_pair->a, p_pair->b };
+	uint32_t indices[2] = { p_pair->index_in_a, p_pair->index_in_b };
+	for (int i = 0; i < 2; i++) {
+		LocalVector<PairData *> &paired = elems[i]->paired;
+		PairData *last = paired[paired.size() - 1];
+		paired[indices[i]] = last;
+		if (last->a == elems[i]) {
+			last->index_in_a = indices[i];
+		} else {
+			last->index_in_b = indices[i];
+		}
+		paired.resize(paired.size() - 1);
+	}
+
+	pair_map.remove(_pair_key(p_pair->a->self, p_pair->b->self));
+	pair_pool.free(p_pair);
+}
+
+void BroadPhase3DBVH::_update_leaf(Element *p_elem) {
+	Tree &tree = _get_tree(p_elem);
+
+	if (p_elem->aabb.has_no_surface()) {
+		// Same as the octree, elements without a surface are not inserted.
+		if (p_elem->leaf != -1) {
+			tree.free_leaf(p_elem->leaf);
+			p_elem->leaf = -1;
+		}
+		return;
+	}
+
+	// Static elements rarely move, a tight box gives fewer false positives.
+	AABB fat_aabb = p_elem->_static ? p_elem->aabb : p_elem->aabb.grow(margin);
+
+	if (p_elem->leaf == -1) {
+		p_elem->leaf = tree.create_leaf(p_elem, fat_aabb);
+	} else if (p_elem->_static || !tree.get_leaf_aabb(p_elem->leaf).encloses(p_elem->aabb)) {
+		tree.move_leaf(p_elem->leaf, fat_aabb);
+	}
+}
+
+void BroadPhase3DBVH::_update_pairs(Element *p_elem) {
+	// Iterate backwards, pairs that go away are swapped with ones already visited.
+	for (uint32_t i = p_elem->paired.size(); i > 0; i--) {
+		PairData *pd = p_elem->paired[i - 1];
+		Element *other = pd->a == p_elem ? pd->b : pd->a;
+		if (p_elem->leaf == -1 || other->leaf == -1 || (p_elem->_static && other->_static) || !p_elem->aabb.intersects_inclusive(other->aabb)) {
+			_unpair(pd);
+		}
+	}
+
+	if (p_elem->leaf == -1) {
+		return;
+	}
+
+	PairCull cull;
+	cull.bp = this;
+	cull.elem = p_elem;
+
+	dynamic_tree.cull(cull);
+	if (!p_elem->_static) {
+		static_tree.cull(cull);
+	}
+}
+
+BroadPhase3DSW::ID BroadPhase3DBVH::create(CollisionObject3DSW *p_object, int p_subindex) {
+	current++;
+
+	Element *e = element_pool.alloc();
+	e->self = current;
+	e->owner = p_object;
+	e->subindex = p_subindex;
+
+	element_map.insert(current, e);
+	return current;
+}
+
+void BroadPhase3DBVH::move(ID p_id, const AABB &p_aabb) {
+	Element *e = nullptr;
+	ERR_FAIL_COND(!element_map.lookup(p_id, e));
+
+	e->aabb = p_aabb;
+	_update_leaf(e);
+	_update_pairs(e);
+}
+
+void BroadPhase3DBVH::set_static(ID p_id, bool p_static) {
+	Element *e = nullptr;
+	ERR_FAIL_COND(!element_map.lookup(p_id, e));
+
+	if (e->_static == p_static) {
+		return;
+	}
+
+	if (e->leaf != -1) {
+		_get_tree(e).free_leaf(e->leaf);
+		e->leaf = -1;
+	}
+
+	e->_static = p_static;
+
+	_update_leaf(e);
+	_update_pairs(e);
+}
+
+void BroadPhase3DBVH::remove(ID p_id) {
+	Element *e = nullptr;
+	ERR_FAIL_COND(!element_map.lookup(p_id, e));
+
+	while (e->paired.size()) {
+		_unpair(e->paired[e->paired.size() - 1]);
+	}
+
+	if (e->leaf != -1) {
+		_get_tree(e).free_leaf(e->leaf);
+	}
+
+	element_map.remove(p_id);
+	element_pool.free(e);
+}
+
+CollisionObject3DSW *BroadPhase3DBVH::get_object(ID p_id) const {
+	Element *e = nullptr;
+	ERR_FAIL_COND_V(!element_map.lookup(p_id, e), nullptr);
+	return e->owner;
+}
+
+bool BroadPhase3DBVH::is_static(ID p_id) const {
+	Element *e = nullptr;
+	ERR_FAIL_COND_V(!element_map.lookup(p_id, e), false);
+	return e->_static;
+}
+
+int BroadPhase3DBVH::get_subindex(ID p_id) const {
+	Element *e = nullptr;
+	ERR_FAIL_COND_V(!element_map.lookup(p_id, e), -1);
+	return e->subindex;
+}
+
+int BroadPhase3DBVH::cull_point(const Vector3 &p_point, CollisionObject3DSW **p_results, int p_max_results, int *p_result_indices) {
+	struct PointCull : public ResultCull {
+		Vector3 point;
+
+		_FORCE_INLINE_ bool test(const AABB &p_aabb) const { return p_aabb.has_point(point); }
+		_FORCE_INLINE_ bool leaf(Element *p_elem) { return !p_elem->aabb.has_point(point) || add(p_elem); }
+	};
+
+	ERR_FAIL_COND_V(p_max_results <= 0, 0);
+
+	PointCull cull;
+	cull.results = p_results;
+	cull.result_indices = p_result_indices;
+	cull.max_results = p_max_results;
+	cull.point = p_point;
+
+	dynamic_tree.cull(cull);
+	if (cull.count < p_max_results) {
+		static_tree.cull(cull);
+	}
+	return cull.count;
+}
+
+int BroadPhase3DBVH::cull_segment(const Vector3 &p_from, const Vector3 &p_to, CollisionObject3DSW **p_results, int p_max_results, int *p_result_indices) {
+	struct SegmentCull : public ResultCull {
+		Vector3 from;
+		Vector3 to;
+
+		_FORCE_INLINE_ bool test(const AABB &p_aabb) const { return p_aabb.intersects_segment(from, to); }
+		_FORCE_INLINE_ bool leaf(Element *p_elem) { return !p_elem->aabb.intersects_segment(from, to) || add(p_elem); }
+	};
+
+	ERR_FAIL_COND_V(p_max_results <= 0, 0);
+
+	SegmentCull cull;
+	cull.results = p_results;
+	cull.result_indices = p_result_indices;
+	cull.max_results = p_max_results;
+	cull.from = p_from;
+	cull.to = p_to;
+
+	dynamic_tree.cull(cull);
+	if (cull.count < p_max_results) {
+		static_tree.cull(cull);
+	}
+	return cull.count;
+}
+
+int BroadPhase3DBVH::cull_aabb(const AABB &p_aabb, CollisionObject3DSW **p_results, int p_max_results, int *p_result_indices) {
+	struct AABBCull : public ResultCull {
+		AABB aabb;
+
+		_FORCE_INLINE_ bool test(const AABB &p_aabb) const { return p_aabb.intersects_inclusive(aabb); }
+		_FORCE_INLINE_ bool leaf(Element *p_elem) { return !p_elem->aabb.intersects_inclusive(aabb) || add(p_elem); }
+	};
+
+	ERR_FAIL_COND_V(p_max_results <= 0, 0);
+
+	AABBCull cull;
+	cull.results = p_results;
+	cull.result_indices = p_result_indices;
+	cull.max_results = p_max_results;
+	cull.aabb = p_aabb;
+
+	dynamic_tree.cull(cull);
+	if (cull.count < p_max_results) {
+		static_tree.cull(cull);
+	}
+	return cull.count;
+}
+
+void BroadPhase3DBVH::set_pair_callback(PairCallback p_pair_callback, void *p_userdata) {
+	pair_callback = p_pair_callback;
+	pair_userdata = p_userdata;
+}
+
+void BroadPhase3DBVH::set_unpair_callback(UnpairCallback p_unpair_callback, void *p_userdata) {
+	unpair_callback = p_unpair_callback;
+	unpair_userdata = p_userdata;
+}
+
+void BroadPhase3DBVH::update() {
+	// Pairs are kept up to date in move().
+}
+
+BroadPhase3DSW *BroadPhase3DBVH::_create() {
+	return memnew(BroadPhase3DBVH);
+}
+
+BroadPhase3DBVH::BroadPhase3DBVH() {
+	element_pool.configure(256);
+	pair_pool.configure(256);
+
+	margin = GLOBAL_DEF("physics/3d/bvh_collision_margin", 0.1);
+	ProjectSettings::get_singleton()->set_custom_property_info("physics/3d/bvh_collision_margin", PropertyInfo(Variant::FLOAT, "physics/3d/bvh_collision_margin", PROPERTY_HINT_RANGE, "0,1,0.001,or_greater"));
+
+	current = 0;
+
+	pair_callback = nullptr;
+	pair_userdata = nullptr;
+	unpair_callback = nullptr;
+	unpair_userdata = nullptr;
+}
+
+BroadPhase3DBVH::~BroadPhase3DBVH() {
+	for (OAHashMap<uint64_t, PairData *>::Iterator it = pair_map.iter(); it.valid; it = pair_map.next_iter(it)) {
+		pair_pool.free(*it.value);
+	}
+
+	for (OAHashMap<ID, Element *>::Iterator it = element_map.iter(); it.valid; it = element_map.next_iter(it)) {
+		element_pool.free(*it.value);
+	}
+}
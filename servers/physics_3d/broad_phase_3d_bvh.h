@@ -0,0 +1,186 @@
+/*************************************************************************/
+/*  broad_phase_3d_bvh.h                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef BROAD_PHASE_3D_BVH_H
+#define BROAD_PHASE_3D_BVH_H
+
+#include "broad_phase_3d_sw.h"
+#include "core/local_vector.h"
+#include "core/oa_hash_map.h"
+#include "core/paged_allocator.h"
+
+class BroadPhase3DBVH : public BroadPhase3DSW {
+	struct Element;
+
+	struct PairData {
+		Element *a = nullptr;
+		Element *b = nullptr;
+		uint32_t index_in_a = 0; // Position in a->paired.
+		uint32_t index_in_b = 0; // Position in b->paired.
+		void *ud = nullptr;
+	};
+
+	struct Element {
+		ID self = 0;
+		CollisionObject3DSW *owner = nullptr;
+		int subindex = 0;
+		bool _static = false;
+		AABB aabb;
+		int leaf = -1; // Node in the tree matching _static, -1 while not in a tree.
+		LocalVector<PairData *> paired;
+	};
+
+	struct Node {
+		AABB aabb;
+		int parent = -1;
+		int children[2] = { -1, -1 };
+		int height = 0;
+		Element *element = nullptr;
+
+		_FORCE_INLINE_ bool is_leaf() const { return children[0] == -1; }
+	};
+
+	/**
+	 * Dynamic AABB tree. Leaves are inserted next to the sibling that grows the
+	 * least in surface area, and ancestors are refitted and rebalanced with tree
+	 * rotations on the way back to the root, so the tree never needs a rebuild.
+	 */
+	class Tree {
+		LocalVector<Node> nodes;
+		LocalVector<int> stack;
+		int root = -1;
+		int free_list = -1;
+
+		int _alloc_node();
+		void _free_node(int p_node);
+		void _insert_leaf(int p_leaf);
+		void _remove_leaf(int p_leaf);
+		void _refit(int p_node);
+		int _balance(int p_node);
+
+	public:
+		int create_leaf(Element *p_element, const AABB &p_aabb);
+		void move_leaf(int p_leaf, const AABB &p_aabb);
+		void free_leaf(int p_leaf);
+
+		_FORCE_INLINE_ const AABB &get_leaf_aabb(int p_leaf) const { return nodes[p_leaf].aabb; }
+
+		// p_cull.test(aabb) decides whether to descend into a node, p_cull.leaf(element) returns false to stop.
+		template <class T>
+		void cull(T &p_cull) {
+			if (root == -1) {
+				return;
+			}
+
+			stack.clear();
+			stack.push_back(root);
+
+			while (stack.size()) {
+				int index = stack[stack.size() - 1];
+				stack.resize(stack.size() - 1);
+
+				const Node &node = nodes[index];
+				if (!p_cull.test(node.aabb)) {
+					continue;
+				}
+
+				if (node.is_leaf()) {
+					if (!p_cull.leaf(node.element)) {
+						return;
+					}
+				} else {
+					stack.push_back(node.children[0]);
+					stack.push_back(node.children[1]);
+				}
+			}
+		}
+	};
+
+	Tree static_tree;
+	Tree dynamic_tree;
+
+	// Moving bodies are stored with an AABB grown by this much, so small motions don't touch the tree.
+	real_t margin;
+
+	OAHashMap<ID, Element *> element_map;
+	OAHashMap<uint64_t, PairData *> pair_map;
+
+	PagedAllocator<Element> element_pool;
+	PagedAllocator<PairData> pair_pool;
+
+	ID current;
+
+	PairCallback pair_callback;
+	void *pair_userdata;
+	UnpairCallback unpair_callback;
+	void *unpair_userdata;
+
+	_FORCE_INLINE_ static uint64_t _pair_key(ID p_a, ID p_b) {
+		return p_a < p_b ? ((uint64_t(p_a) << 32) | p_b) : ((uint64_t(p_b) << 32) | p_a);
+	}
+
+	_FORCE_INLINE_ Tree &_get_tree(const Element *p_elem) {
+		return p_elem->_static ? static_tree : dynamic_tree;
+	}
+
+	struct PairCull;
+	struct ResultCull;
+
+	void _pair(Element *p_a, Element *p_b);
+	void _unpair(PairData *p_pair);
+	void _update_leaf(Element *p_elem);
+	void _update_pairs(Element *p_elem);
+
+public:
+	// 0 is an invalid ID
+	virtual ID create(CollisionObject3DSW *p_object, int p_subindex = 0);
+	virtual void move(ID p_id, const AABB &p_aabb);
+	virtual void set_static(ID p_id, bool p_static);
+	virtual void remove(ID p_id);
+
+	virtual CollisionObject3DSW *get_object(ID p_id) const;
+	virtual bool is_static(ID p_id) const;
+	virtual int get_subindex(ID p_id) const;
+
+	virtual int cull_point(const Vector3 &p_point, CollisionObject3DSW **p_results, int p_max_results, int *p_result_indices = nullptr);
+	virtual int cull_segment(const Vector3 &p_from, const Vector3 &p_to, CollisionObject3DSW **p_results, int p_max_results, int *p_result_indices = nullptr);
+	virtual int cull_aabb(const AABB &p_aabb, CollisionObject3DSW **p_results, int p_max_results, int *p_result_indices = nullptr);
+
+	virtual void set_pair_callback(PairCallback p_pair_callback, void *p_userdata);
+	virtual void set_unpair_callback(UnpairCallback p_unpair_callback, void *p_userdata);
+
+	virtual void update();
+
+	static BroadPhase3DSW *_create();
+	BroadPhase3DBVH();
+	~BroadPhase3DBVH();
+};
+
+#endif // BROAD_PHASE_3D_BVH_H
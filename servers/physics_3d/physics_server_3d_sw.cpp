@@ -31,9 +31,11 @@
 #include "physics_server_3d_sw.h"
 
 #include "broad_phase_3d_basic.h"
+#include "broad_phase_3d_bvh.h"
 #include "broad_phase_octree.h"
 #include "core/debugger/engine_debugger.h"
 #include "core/os/os.h"
+#include "core/project_settings.h"
 #include "joints/cone_twist_joint_3d_sw.h"
 #include "joints/generic_6dof_joint_3d_sw.h"
 #include "joints/hinge_joint_3d_sw.h"
@@ -1439,7 +1441,15 @@ void PhysicsServer3DSW::_shape_col_cbk(const Vector3 &p_point_A, const Vector3 &
 PhysicsServer3DSW *PhysicsServer3DSW::singleton = nullptr;
 PhysicsServer3DSW::PhysicsServer3DSW() {
 	singleton = this;
-	BroadPhase3DSW::create_func = BroadPhaseOctree::_create;
+
+	String broad_phase = GLOBAL_DEF("physics/3d/broad_phase", "DynamicBVH");
+	ProjectSettings::get_singleton()->set_custom_property_info("physics/3d/broad_phase", PropertyInfo(Variant::STRING, "physics/3d/broad_phase", PROPERTY_HINT_ENUM, "DynamicBVH,Octree"));
+	if (broad_phase == "Octree") {
+		BroadPhase3DSW::create_func = BroadPhaseOctree::_create;
+	} else {
+		BroadPhase3DSW::create_func = BroadPhase3DBVH::_create;
+	}
+
 	island_count = 0;
 	active_objects = 0;
 	collision_pairs = 0;
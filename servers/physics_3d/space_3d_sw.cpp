@@ -231,6 +231,240 @@ int PhysicsDirectSpaceState3DSW::intersect_shape(const RID &p_shape, const Trans
 	return cc;
 }
 
+// Collects the shapes touching p_aabb that pass the filters. Returns false if the broad phase
+// result buffer overflowed, in which case the batch is not coherent and is better queried one by one.
+bool PhysicsDirectSpaceState3DSW::_cull_batch(const AABB &p_aabb, const Set<RID> &p_exclude, uint32_t p_collision_mask, bool p_collide_with_bodies, bool p_collide_with_areas) {
+	int amount = space->broadphase->cull_aabb(p_aabb, space->intersection_query_results, Space3DSW::INTERSECTION_QUERY_MAX, space->intersection_query_subindex_results);
+	if (amount >= Space3DSW::INTERSECTION_QUERY_MAX) {
+		return false;
+	}
+
+	batch_candidates.clear();
+	for (int k = 0; k < 3; k++) {
+		batch_min[k].clear();
+		batch_max[k].clear();
+	}
+
+	for (int i = 0; i < amount; i++) {
+		if (!_can_collide_with(space->intersection_query_results[i], p_collision_mask, p_collide_with_bodies, p_collide_with_areas)) {
+			continue;
+		}
+
+		if (p_exclude.has(space->intersection_query_results[i]->get_self())) {
+			continue;
+		}
+
+		BatchCandidate candidate;
+		candidate.object = space->intersection_query_results[i];
+		candidate.shape = space->intersection_query_subindex_results[i];
+		batch_candidates.push_back(candidate);
+
+		const AABB &aabb = candidate.object->get_shape_aabb(candidate.shape);
+		for (int k = 0; k < 3; k++) {
+			batch_min[k].push_back(aabb.position[k]);
+			batch_max[k].push_back(aabb.position[k] + aabb.size[k]);
+		}
+	}
+
+	batch_overlap.resize(batch_candidates.size());
+	return true;
+}
+
+int PhysicsDirectSpaceState3DSW::intersect_rays(const Vector3 *p_from, const Vector3 *p_to, int p_ray_count, RayResult *r_results, const Set<RID> &p_exclude, uint32_t p_collision_mask, bool p_collide_with_bodies, bool p_collide_with_areas) {
+	ERR_FAIL_COND_V(space->locked, 0);
+
+	int hits = 0;
+
+	for (int from = 0; from < p_ray_count; from += QUERY_BATCH_SIZE) {
+		int to = MIN(from + QUERY_BATCH_SIZE, p_ray_count);
+
+		AABB batch_aabb(p_from[from], Vector3());
+		for (int i = from; i < to; i++) {
+			batch_aabb.expand_to(p_from[i]);
+			batch_aabb.expand_to(p_to[i]);
+		}
+
+		if (!_cull_batch(batch_aabb, p_exclude, p_collision_mask, p_collide_with_bodies, p_collide_with_areas)) {
+			for (int i = from; i < to; i++) {
+				if (intersect_ray(p_from[i], p_to[i], r_results[i], p_exclude, p_collision_mask, p_collide_with_bodies, p_collide_with_areas)) {
+					hits++;
+				} else {
+					r_results[i].rid = RID();
+				}
+			}
+			continue;
+		}
+
+		const uint32_t candidate_count = batch_candidates.size();
+		const real_t *min_x = batch_min[0].ptr();
+		const real_t *min_y = batch_min[1].ptr();
+		const real_t *min_z = batch_min[2].ptr();
+		const real_t *max_x = batch_max[0].ptr();
+		const real_t *max_y = batch_max[1].ptr();
+		const real_t *max_z = batch_max[2].ptr();
+		uint8_t *overlap = batch_overlap.ptr();
+
+		for (int i = from; i < to; i++) {
+			const Vector3 &begin = p_from[i];
+			const Vector3 &end = p_to[i];
+			Vector3 dir = end - begin;
+
+			// Slab test against every candidate box. Zero components are nudged so the inverse stays finite.
+			Vector3 inv_dir;
+			for (int k = 0; k < 3; k++) {
+				real_t d = dir[k];
+				if (Math::abs(d) < CMP_EPSILON2) {
+					d = d < 0 ? -CMP_EPSILON2 : CMP_EPSILON2;
+				}
+				inv_dir[k] = 1.0 / d;
+			}
+
+			for (uint32_t c = 0; c < candidate_count; c++) {
+				real_t tx1 = (min_x[c] - begin.x) * inv_dir.x;
+				real_t tx2 = (max_x[c] - begin.x) * inv_dir.x;
+				real_t ty1 = (min_y[c] - begin.y) * inv_dir.y;
+				real_t ty2 = (max_y[c] - begin.y) * inv_dir.y;
+				real_t tz1 = (min_z[c] - begin.z) * inv_dir.z;
+				real_t tz2 = (max_z[c] - begin.z) * inv_dir.z;
+
+				real_t tmin = MAX(MAX(MIN(tx1, tx2), MIN(ty1, ty2)), MIN(tz1, tz2));
+				real_t tmax = MIN(MIN(MAX(tx1, tx2), MAX(ty1, ty2)), MAX(tz1, tz2));
+
+				overlap[c] = (tmax >= tmin) & (tmax >= 0) & (tmin <= 1);
+			}
+
+			Vector3 normal = dir.normalized();
+
+			bool collided = false;
+			Vector3 res_point, res_normal;
+			int res_shape = 0;
+			const CollisionObject3DSW *res_obj = nullptr;
+			real_t min_d = 1e10;
+
+			for (uint32_t c = 0; c < candidate_count; c++) {
+				if (!overlap[c]) {
+					continue;
+				}
+
+				const CollisionObject3DSW *col_obj = batch_candidates[c].object;
+				int shape_idx = batch_candidates[c].shape;
+
+				Transform inv_xform = col_obj->get_shape_inv_transform(shape_idx) * col_obj->get_inv_transform();
+
+				Vector3 local_from = inv_xform.xform(begin);
+				Vector3 local_to = inv_xform.xform(end);
+
+				Vector3 shape_point, shape_normal;
+
+				if (col_obj->get_shape(shape_idx)->intersect_segment(local_from, local_to, shape_point, shape_normal)) {
+					Transform xform = col_obj->get_transform() * col_obj->get_shape_transform(shape_idx);
+					shape_point = xform.xform(shape_point);
+
+					real_t ld = normal.dot(shape_point);
+
+					if (ld < min_d) {
+						min_d = ld;
+						res_point = shape_point;
+						res_normal = inv_xform.basis.xform_inv(shape_normal).normalized();
+						res_shape = shape_idx;
+						res_obj = col_obj;
+						collided = true;
+					}
+				}
+			}
+
+			RayResult &r = r_results[i];
+			if (!collided) {
+				r.rid = RID();
+				continue;
+			}
+
+			r.collider_id = res_obj->get_instance_id();
+			if (r.collider_id.is_valid()) {
+				r.collider = ObjectDB::get_instance(r.collider_id);
+			} else {
+				r.collider = nullptr;
+			}
+			r.normal = res_normal;
+			r.position = res_point;
+			r.rid = res_obj->get_self();
+			r.shape = res_shape;
+			hits++;
+		}
+	}
+
+	return hits;
+}
+
+void PhysicsDirectSpaceState3DSW::intersect_shapes(const RID &p_shape, const Transform *p_xforms, int p_query_count, real_t p_margin, ShapeResult *r_results, int p_result_max, int *r_result_counts, const Set<RID> &p_exclude, uint32_t p_collision_mask, bool p_collide_with_bodies, bool p_collide_with_areas) {
+	Shape3DSW *shape = static_cast<PhysicsServer3DSW *>(PhysicsServer3D::get_singleton())->shape_owner.getornull(p_shape);
+	ERR_FAIL_COND(!shape);
+
+	for (int from = 0; from < p_query_count; from += QUERY_BATCH_SIZE) {
+		int to = MIN(from + QUERY_BATCH_SIZE, p_query_count);
+
+		AABB batch_aabb = p_xforms[from].xform(shape->get_aabb());
+		for (int i = from + 1; i < to; i++) {
+			batch_aabb.merge_with(p_xforms[i].xform(shape->get_aabb()));
+		}
+
+		if (p_result_max <= 0 || !_cull_batch(batch_aabb, p_exclude, p_collision_mask, p_collide_with_bodies, p_collide_with_areas)) {
+			for (int i = from; i < to; i++) {
+				r_result_counts[i] = intersect_shape(p_shape, p_xforms[i], p_margin, r_results + i * p_result_max, p_result_max, p_exclude, p_collision_mask, p_collide_with_bodies, p_collide_with_areas);
+			}
+			continue;
+		}
+
+		const uint32_t candidate_count = batch_candidates.size();
+		const real_t *min_x = batch_min[0].ptr();
+		const real_t *min_y = batch_min[1].ptr();
+		const real_t *min_z = batch_min[2].ptr();
+		const real_t *max_x = batch_max[0].ptr();
+		const real_t *max_y = batch_max[1].ptr();
+		const real_t *max_z = batch_max[2].ptr();
+		uint8_t *overlap = batch_overlap.ptr();
+
+		for (int i = from; i < to; i++) {
+			AABB aabb = p_xforms[i].xform(shape->get_aabb());
+			Vector3 aabb_end = aabb.position + aabb.size;
+
+			for (uint32_t c = 0; c < candidate_count; c++) {
+				overlap[c] = (min_x[c] <= aabb_end.x) & (max_x[c] >= aabb.position.x) &
+							 (min_y[c] <= aabb_end.y) & (max_y[c] >= aabb.position.y) &
+							 (min_z[c] <= aabb_end.z) & (max_z[c] >= aabb.position.z);
+			}
+
+			ShapeResult *results = r_results + i * p_result_max;
+			int cc = 0;
+
+			for (uint32_t c = 0; c < candidate_count && cc < p_result_max; c++) {
+				if (!overlap[c]) {
+					continue;
+				}
+
+				const CollisionObject3DSW *col_obj = batch_candidates[c].object;
+				int shape_idx = batch_candidates[c].shape;
+
+				if (!CollisionSolver3DSW::solve_static(shape, p_xforms[i], col_obj->get_shape(shape_idx), col_obj->get_transform() * col_obj->get_shape_transform(shape_idx), nullptr, nullptr, nullptr, p_margin, 0)) {
+					continue;
+				}
+
+				results[cc].collider_id = col_obj->get_instance_id();
+				if (results[cc].collider_id.is_valid()) {
+					results[cc].collider = ObjectDB::get_instance(results[cc].collider_id);
+				} else {
+					results[cc].collider = nullptr;
+				}
+				results[cc].rid = col_obj->get_self();
+				results[cc].shape = shape_idx;
+				cc++;
+			}
+
+			r_result_counts[i] = cc;
+		}
+	}
+}
+
 bool PhysicsDirectSpaceState3DSW::cast_motion(const RID &p_shape, const Transform &p_xform, const Vector3 &p_motion, real_t p_margin, real_t &p_closest_safe, real_t &p_closest_unsafe, const Set<RID> &p_exclude, uint32_t p_collision_mask, bool p_collide_with_bodies, bool p_collide_with_areas, ShapeRestInfo *r_info) {
 	Shape3DSW *shape = static_cast<PhysicsServer3DSW *>(PhysicsServer3D::get_singleton())->shape_owner.getornull(p_shape);
 	ERR_FAIL_COND_V(!shape, false);
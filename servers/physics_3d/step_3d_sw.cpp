@@ -32,8 +32,9 @@
 #include "joints_3d_sw.h"
 
 #include "core/os/os.h"
+#include "core/os/threaded_array_processor.h"
 
-void Step3DSW::_populate_island(Body3DSW *p_body, Body3DSW **p_island, Constraint3DSW **p_constraint_island) {
+void Step3DSW::_populate_island(Body3DSW *p_body, Body3DSW **p_island, Constraint3DSW **p_constraint_island, bool *r_serial_setup) {
 	p_body->set_island_step(_step);
 	p_body->set_island_next(*p_island);
 	*p_island = p_body;
@@ -44,9 +45,24 @@ void Step3DSW::_populate_island(Body3DSW *p_body, Body3DSW **p_island, Constrain
 			continue; //already processed
 		}
 		c->set_island_step(_step);
+
+		if (c->get_body_count() == 0) {
+			//area pair, writes to the area so it is set up apart from the islands
+			area_constraints.push_back(c);
+			continue;
+		}
+
 		c->set_island_next(*p_constraint_island);
 		*p_constraint_island = c;
 
+		for (int i = 0; i < c->get_body_count(); i++) {
+			Body3DSW *b = c->get_body_ptr()[i];
+			if (b->get_mode() <= PhysicsServer3D::BODY_MODE_KINEMATIC && b->can_report_contacts()) {
+				//body may be shared with other islands, and setup adds contacts to it
+				*r_serial_setup = true;
+			}
+		}
+
 		for (int i = 0; i < c->get_body_count(); i++) {
 			if (i == E->get()) {
 				continue;
@@ -55,28 +71,29 @@ void Step3DSW::_populate_island(Body3DSW *p_body, Body3DSW **p_island, Constrain
 			if (b->get_island_step() == _step || b->get_mode() == PhysicsServer3D::BODY_MODE_STATIC || b->get_mode() == PhysicsServer3D::BODY_MODE_KINEMATIC) {
 				continue; //no go
 			}
-			_populate_island(c->get_body_ptr()[i], p_island, p_constraint_island);
+			_populate_island(c->get_body_ptr()[i], p_island, p_constraint_island, r_serial_setup);
 		}
 	}
 }
 
-void Step3DSW::_setup_island(Constraint3DSW *p_island, real_t p_delta) {
-	Constraint3DSW *ci = p_island;
+void Step3DSW::_setup_island(uint32_t p_island_index, Constraint3DSW **p_islands) {
+	Constraint3DSW *ci = p_islands[p_island_index];
 	while (ci) {
-		ci->setup(p_delta);
+		ci->setup(delta);
 		//todo remove from island if process fails
 		ci = ci->get_island_next();
 	}
 }
 
-void Step3DSW::_solve_island(Constraint3DSW *p_island, int p_iterations, real_t p_delta) {
+void Step3DSW::_solve_island(uint32_t p_island_index, Constraint3DSW **p_islands) {
+	Constraint3DSW *island = p_islands[p_island_index];
 	int at_priority = 1;
 
-	while (p_island) {
-		for (int i = 0; i < p_iterations; i++) {
-			Constraint3DSW *ci = p_island;
+	while (island) {
+		for (int i = 0; i < iterations; i++) {
+			Constraint3DSW *ci = island;
 			while (ci) {
-				ci->solve(p_delta);
+				ci->solve(delta);
 				ci = ci->get_island_next();
 			}
 		}
@@ -84,14 +101,14 @@ void Step3DSW::_solve_island(Constraint3DSW *p_island, int p_iterations, real_t
 		at_priority++;
 
 		{
-			Constraint3DSW *ci = p_island;
+			Constraint3DSW *ci = island;
 			Constraint3DSW *prev = nullptr;
 			while (ci) {
 				if (ci->get_priority() < at_priority) {
 					if (prev) {
 						prev->set_island_next(ci->get_island_next()); //remove
 					} else {
-						p_island = ci->get_island_next();
+						island = ci->get_island_next();
 					}
 				} else {
 					prev = ci;
@@ -171,10 +188,18 @@ void Step3DSW::step(Space3DSW *p_space, real_t p_delta, int p_iterations) {
 	/* GENERATE CONSTRAINT ISLANDS */
 
 	Body3DSW *island_list = nullptr;
-	Constraint3DSW *constraint_island_list = nullptr;
+	constraint_islands.clear();
+	parallel_setup_islands.clear();
+	serial_setup_islands.clear();
+	area_constraints.clear();
 	b = body_list->first();
 
-	int island_count = 0;
+#ifdef DEBUG_ENABLED
+	//debug contacts are written to the space, keep it to a single thread
+	bool serial_setup = p_space->is_debugging_contacts();
+#else
+	bool serial_setup = false;
+#endif
 
 	while (b) {
 		Body3DSW *body = b->self();
@@ -182,21 +207,25 @@ void Step3DSW::step(Space3DSW *p_space, real_t p_delta, int p_iterations) {
 		if (body->get_island_step() != _step) {
 			Body3DSW *island = nullptr;
 			Constraint3DSW *constraint_island = nullptr;
-			_populate_island(body, &island, &constraint_island);
+			bool island_serial_setup = serial_setup;
+			_populate_island(body, &island, &constraint_island, &island_serial_setup);
 
 			island->set_island_list_next(island_list);
 			island_list = island;
 
 			if (constraint_island) {
-				constraint_island->set_island_list_next(constraint_island_list);
-				constraint_island_list = constraint_island;
-				island_count++;
+				constraint_islands.push_back(constraint_island);
+				if (island_serial_setup) {
+					serial_setup_islands.push_back(constraint_island);
+				} else {
+					parallel_setup_islands.push_back(constraint_island);
+				}
 			}
 		}
 		b = b->next();
 	}
 
-	p_space->set_island_count(island_count);
+	p_space->set_island_count(constraint_islands.size());
 
 	const SelfList<Area3DSW>::List &aml = p_space->get_moved_area_list();
 
@@ -207,9 +236,7 @@ void Step3DSW::step(Space3DSW *p_space, real_t p_delta, int p_iterations) {
 				continue;
 			}
 			c->set_island_step(_step);
-			c->set_island_next(nullptr);
-			c->set_island_list_next(constraint_island_list);
-			constraint_island_list = c;
+			area_constraints.push_back(c);
 		}
 		p_space->area_remove_from_moved_list((SelfList<Area3DSW> *)aml.first()); //faster to remove here
 	}
@@ -222,12 +249,21 @@ void Step3DSW::step(Space3DSW *p_space, real_t p_delta, int p_iterations) {
 
 	/* SETUP CONSTRAINT ISLANDS */
 
-	{
-		Constraint3DSW *ci = constraint_island_list;
-		while (ci) {
-			_setup_island(ci, p_delta);
-			ci = ci->get_island_list_next();
-		}
+	// Islands share no rigid bodies, so they are set up and solved in parallel.
+	// Each island is processed in order by a single thread, which keeps the
+	// results independent from scheduling.
+
+	delta = p_delta;
+	iterations = p_iterations;
+
+	thread_process_array(parallel_setup_islands.size(), this, &Step3DSW::_setup_island, parallel_setup_islands.ptr());
+
+	for (uint32_t i = 0; i < serial_setup_islands.size(); i++) {
+		_setup_island(i, serial_setup_islands.ptr());
+	}
+
+	for (uint32_t i = 0; i < area_constraints.size(); i++) {
+		area_constraints[i]->setup(p_delta);
 	}
 
 	{ //profile
@@ -238,14 +274,8 @@ void Step3DSW::step(Space3DSW *p_space, real_t p_delta, int p_iterations) {
 
 	/* SOLVE CONSTRAINT ISLANDS */
 
-	{
-		Constraint3DSW *ci = constraint_island_list;
-		while (ci) {
-			//iterating each island separatedly improves cache efficiency
-			_solve_island(ci, p_iterations, p_delta);
-			ci = ci->get_island_list_next();
-		}
-	}
+	//iterating each island separatedly improves cache efficiency
+	thread_process_array(constraint_islands.size(), this, &Step3DSW::_solve_island, constraint_islands.ptr());
 
 	{ //profile
 		profile_endtime = OS::get_singleton()->get_ticks_usec();
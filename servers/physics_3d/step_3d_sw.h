@@ -33,12 +33,22 @@
 
 #include "space_3d_sw.h"
 
+#include "core/local_vector.h"
+
 class Step3DSW {
 	uint64_t _step;
 
-	void _populate_island(Body3DSW *p_body, Body3DSW **p_island, Constraint3DSW **p_constraint_island);
-	void _setup_island(Constraint3DSW *p_island, real_t p_delta);
-	void _solve_island(Constraint3DSW *p_island, int p_iterations, real_t p_delta);
+	int iterations = 0;
+	real_t delta = 0.0;
+
+	LocalVector<Constraint3DSW *> constraint_islands;
+	LocalVector<Constraint3DSW *> parallel_setup_islands;
+	LocalVector<Constraint3DSW *> serial_setup_islands;
+	LocalVector<Constraint3DSW *> area_constraints;
+
+	void _populate_island(Body3DSW *p_body, Body3DSW **p_island, Constraint3DSW **p_constraint_island, bool *r_serial_setup);
+	void _setup_island(uint32_t p_island_index, Constraint3DSW **p_islands);
+	void _solve_island(uint32_t p_island_index, Constraint3DSW **p_islands);
 	void _check_suspend(Body3DSW *p_island, real_t p_delta);
 
 public:
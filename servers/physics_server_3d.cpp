@@ -272,6 +272,36 @@ Dictionary PhysicsDirectSpaceState3D::_intersect_ray(const Vector3 &p_from, cons
 	return d;
 }
 
+Array PhysicsDirectSpaceState3D::_intersect_rays(const PackedVector3Array &p_from, const PackedVector3Array &p_to, const Vector<RID> &p_exclude, uint32_t p_collision_mask, bool p_collide_with_bodies, bool p_collide_with_areas) {
+	ERR_FAIL_COND_V(p_from.size() != p_to.size(), Array());
+
+	Set<RID> exclude;
+	for (int i = 0; i < p_exclude.size(); i++) {
+		exclude.insert(p_exclude[i]);
+	}
+
+	Vector<RayResult> rr;
+	rr.resize(p_from.size());
+	intersect_rays(p_from.ptr(), p_to.ptr(), p_from.size(), rr.ptrw(), exclude, p_collision_mask, p_collide_with_bodies, p_collide_with_areas);
+
+	Array ret;
+	ret.resize(rr.size());
+	for (int i = 0; i < rr.size(); i++) {
+		Dictionary d;
+		if (rr[i].rid.is_valid()) {
+			d["position"] = rr[i].position;
+			d["normal"] = rr[i].normal;
+			d["collider_id"] = rr[i].collider_id;
+			d["collider"] = rr[i].collider;
+			d["shape"] = rr[i].shape;
+			d["rid"] = rr[i].rid;
+		}
+		ret[i] = d;
+	}
+
+	return ret;
+}
+
 Array PhysicsDirectSpaceState3D::_intersect_shape(const Ref<PhysicsShapeQueryParameters3D> &p_shape_query, int p_max_results) {
 	ERR_FAIL_COND_V(!p_shape_query.is_valid(), Array());
 
@@ -346,11 +376,30 @@ Dictionary PhysicsDirectSpaceState3D::_get_rest_info(const Ref<PhysicsShapeQuery
 	return r;
 }
 
+int PhysicsDirectSpaceState3D::intersect_rays(const Vector3 *p_from, const Vector3 *p_to, int p_ray_count, RayResult *r_results, const Set<RID> &p_exclude, uint32_t p_collision_mask, bool p_collide_with_bodies, bool p_collide_with_areas) {
+	int hits = 0;
+	for (int i = 0; i < p_ray_count; i++) {
+		if (intersect_ray(p_from[i], p_to[i], r_results[i], p_exclude, p_collision_mask, p_collide_with_bodies, p_collide_with_areas)) {
+			hits++;
+		} else {
+			r_results[i].rid = RID();
+		}
+	}
+	return hits;
+}
+
+void PhysicsDirectSpaceState3D::intersect_shapes(const RID &p_shape, const Transform *p_xforms, int p_query_count, float p_margin, ShapeResult *r_results, int p_result_max, int *r_result_counts, const Set<RID> &p_exclude, uint32_t p_collision_mask, bool p_collide_with_bodies, bool p_collide_with_areas) {
+	for (int i = 0; i < p_query_count; i++) {
+		r_result_counts[i] = intersect_shape(p_shape, p_xforms[i], p_margin, r_results + i * p_result_max, p_result_max, p_exclude, p_collision_mask, p_collide_with_bodies, p_collide_with_areas);
+	}
+}
+
 PhysicsDirectSpaceState3D::PhysicsDirectSpaceState3D() {
 }
 
 void PhysicsDirectSpaceState3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("intersect_ray", "from", "to", "exclude", "collision_mask", "collide_with_bodies", "collide_with_areas"), &PhysicsDirectSpaceState3D::_intersect_ray, DEFVAL(Array()), DEFVAL(0x7FFFFFFF), DEFVAL(true), DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("intersect_rays", "from", "to", "exclude", "collision_mask", "collide_with_bodies", "collide_with_areas"), &PhysicsDirectSpaceState3D::_intersect_rays, DEFVAL(Array()), DEFVAL(0x7FFFFFFF), DEFVAL(true), DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("intersect_shape", "shape", "max_results"), &PhysicsDirectSpaceState3D::_intersect_shape, DEFVAL(32));
 	ClassDB::bind_method(D_METHOD("cast_motion", "shape", "motion"), &PhysicsDirectSpaceState3D::_cast_motion);
 	ClassDB::bind_method(D_METHOD("collide_shape", "shape", "max_results"), &PhysicsDirectSpaceState3D::_collide_shape, DEFVAL(32));
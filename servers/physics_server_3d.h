@@ -143,6 +143,7 @@ class PhysicsDirectSpaceState3D : public Object {
 
 private:
 	Dictionary _intersect_ray(const Vector3 &p_from, const Vector3 &p_to, const Vector<RID> &p_exclude = Vector<RID>(), uint32_t p_collision_mask = 0, bool p_collide_with_bodies = true, bool p_collide_with_areas = false);
+	Array _intersect_rays(const PackedVector3Array &p_from, const PackedVector3Array &p_to, const Vector<RID> &p_exclude = Vector<RID>(), uint32_t p_collision_mask = 0, bool p_collide_with_bodies = true, bool p_collide_with_areas = false);
 	Array _intersect_shape(const Ref<PhysicsShapeQueryParameters3D> &p_shape_query, int p_max_results = 32);
 	Array _cast_motion(const Ref<PhysicsShapeQueryParameters3D> &p_shape_query, const Vector3 &p_motion);
 	Array _collide_shape(const Ref<PhysicsShapeQueryParameters3D> &p_shape_query, int p_max_results = 32);
@@ -174,6 +175,12 @@ public:
 
 	virtual int intersect_shape(const RID &p_shape, const Transform &p_xform, float p_margin, ShapeResult *r_results, int p_result_max, const Set<RID> &p_exclude = Set<RID>(), uint32_t p_collision_mask = 0xFFFFFFFF, bool p_collide_with_bodies = true, bool p_collide_with_areas = false) = 0;
 
+	// Batched queries, meant for many small queries per frame. The default implementations just loop over the single queries.
+	// r_results[i] holds the hit of ray i, with a null rid if it hit nothing. Returns how many rays hit.
+	virtual int intersect_rays(const Vector3 *p_from, const Vector3 *p_to, int p_ray_count, RayResult *r_results, const Set<RID> &p_exclude = Set<RID>(), uint32_t p_collision_mask = 0xFFFFFFFF, bool p_collide_with_bodies = true, bool p_collide_with_areas = false);
+	// Query i writes up to p_result_max results starting at r_results[i * p_result_max], and its result count to r_result_counts[i].
+	virtual void intersect_shapes(const RID &p_shape, const Transform *p_xforms, int p_query_count, float p_margin, ShapeResult *r_results, int p_result_max, int *r_result_counts, const Set<RID> &p_exclude = Set<RID>(), uint32_t p_collision_mask = 0xFFFFFFFF, bool p_collide_with_bodies = true, bool p_collide_with_areas = false);
+
 	struct ShapeRestInfo {
 		Vector3 point;
 		Vector3 normal;
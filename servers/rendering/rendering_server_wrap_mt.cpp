@@ -63,8 +63,8 @@ void RenderingServerWrapMT::thread_loop() {
 	exit = false;
 	draw_thread_up = true;
 	while (!exit) {
-		// flush commands one by one, until exit is requested
-		command_queue.wait_and_flush_one();
+		// flush commands as they arrive, until exit is requested
+		command_queue.wait_and_flush();
 	}
 
 	command_queue.flush_all(); // flush all